@@ -0,0 +1,65 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+from libc.stdint cimport uint64_t
+
+cdef extern from "dataset_builder_kernel.hpp":
+    ctypedef struct DatasetBuildParams:
+        const char* src_dir
+        const char* out_dir
+        double train
+        double val
+        uint64_t seed
+        int link
+        int threads
+        double progress_interval
+    ctypedef struct DatasetBuildStats:
+        uint64_t images
+        uint64_t objects
+        uint64_t bad_rows
+        uint64_t failed
+        uint64_t linked
+        uint64_t copied
+        uint64_t bytes
+        uint64_t split[3]
+        double seconds
+    int _build_dataset(const DatasetBuildParams*, DatasetBuildStats*, char*,
+                       size_t) nogil
+
+def build_dataset(src_dir, out_dir, double train=0.64, double val=0.16,
+                  uint64_t seed=0, link=False, int threads=0,
+                  double progress_interval=5.):
+    """
+    csvToXml + split_dataset in one parallel pass (see
+    dataset_builder_kernel.hpp). The default fractions are the ones
+    split_dataset used: 80% train + val, a fifth of it val.
+
+    Returns a dict of counts: images, objects, bad_rows, failed, linked,
+    copied, bytes, train, val, test and seconds.
+    """
+    assert 0 <= train and 0 <= val and train + val <= 1
+    cdef bytes src = src_dir.encode('utf-8') if isinstance(src_dir, unicode) else src_dir
+    cdef bytes out = out_dir.encode('utf-8') if isinstance(out_dir, unicode) else out_dir
+    cdef DatasetBuildParams p
+    p.src_dir = src
+    p.out_dir = out
+    p.train = train
+    p.val = val
+    p.seed = seed
+    p.link = bool(link)
+    p.threads = threads
+    p.progress_interval = progress_interval
+
+    cdef DatasetBuildStats s
+    cdef char err[1024]
+    cdef int ok
+    with nogil:
+        ok = _build_dataset(&p, &s, err, sizeof(err))
+    if not ok:
+        raise IOError(err.decode('utf-8', 'replace'))
+    return {'images': s.images, 'objects': s.objects, 'bad_rows': s.bad_rows,
+            'failed': s.failed, 'linked': s.linked, 'copied': s.copied,
+            'bytes': s.bytes, 'train': s.split[0], 'val': s.split[1],
+            'test': s.split[2], 'seconds': s.seconds}
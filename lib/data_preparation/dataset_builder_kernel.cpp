@@ -0,0 +1,486 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "dataset_builder_kernel.hpp"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Problems of single rows and images reported before going quiet.
+const int kMaxReports = 20;
+const size_t kCopyBuffer = 1 << 20;
+
+enum Split { kTrain = 0, kVal = 1, kTest = 2 };
+const char* const kSplitNames[] = {"train", "val", "test"};
+
+struct Box {
+  int x1, y1, x2, y2;
+};
+
+struct Job {
+  std::string cls, file;       // source: <src_dir>/<cls>/<file>
+  std::string name, index;     // <cls>_<file>, without the extension
+  int width, height;
+  std::vector<Box> boxes;
+  int split;
+  bool ok;
+};
+
+double now() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// splitmix64, so that the shuffle is the same with every standard library.
+uint64_t nextRandom(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+uint64_t hashString(const std::string& s) {
+  uint64_t h = 0xCBF29CE484222325ull;  // FNV-1a
+  for (size_t i = 0; i < s.size(); ++i) h = (h ^ (unsigned char)s[i]) * 0x100000001B3ull;
+  return h;
+}
+
+bool makeDir(const std::string& path) {
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// Sorted subdirectories of path.
+bool listDirs(const std::string& path, std::vector<std::string>& dirs) {
+  DIR* d = opendir(path.c_str());
+  if (!d) return false;
+  while (struct dirent* e = readdir(d)) {
+    if (e->d_name[0] == '.') continue;
+    bool isDir = e->d_type == DT_DIR;
+    if (e->d_type == DT_UNKNOWN || e->d_type == DT_LNK) {
+      struct stat st;
+      isDir = stat((path + "/" + e->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (isDir) dirs.push_back(e->d_name);
+  }
+  closedir(d);
+  std::sort(dirs.begin(), dirs.end());
+  return true;
+}
+
+// Splits a ';' separated line, dropping quotes and surrounding blanks.
+void splitFields(char* line, std::vector<char*>& fields) {
+  fields.clear();
+  char* p = line;
+  for (;;) {
+    while (*p == ' ' || *p == '\t') ++p;
+    char* f = p;
+    char* end;
+    if (*p == '"') {
+      f = ++p;
+      while (*p && *p != '"') ++p;
+      end = p;
+      if (*p) ++p;
+      while (*p && *p != ';') ++p;
+    } else {
+      while (*p && *p != ';' && *p != '\r' && *p != '\n') ++p;
+      end = p;
+      while (end > f && (end[-1] == ' ' || end[-1] == '\t')) --end;
+    }
+    char sep = *p;
+    *end = 0;
+    fields.push_back(f);
+    if (sep != ';') break;
+    ++p;
+  }
+}
+
+bool parseInt(const char* s, int& v) {
+  char* end;
+  errno = 0;
+  long l = strtol(s, &end, 10);
+  if (end == s || *end || errno || l < -2147483647L || l > 2147483647L) return false;
+  v = (int)l;
+  return true;
+}
+
+void appendEscaped(std::string& out, const std::string& s) {
+  for (size_t i = 0; i < s.size(); ++i) {
+    switch (s[i]) {
+      case '&': out += "&amp;"; break;
+      case '<': out += "&lt;"; break;
+      case '>': out += "&gt;"; break;
+      default: out += s[i];
+    }
+  }
+}
+
+// The fields csvToXml wrote, with the objects as direct children of
+// <annotation> (where datasets.traffic looks for them). The fields
+// traffic_eval.parse_rec reads as numbers get VOC's values instead of
+// UNDEFINED: segmented, truncated and difficult 0, pose Unspecified.
+std::string annotationXml(const Job& job) {
+  const char* undef = "UNDEFINED\n";
+  std::string x;
+  x.reserve(1024 + 256 * job.boxes.size());
+  x += "<annotation>\n<fileName>\n";
+  appendEscaped(x, job.cls + "/" + job.file);
+  x += "\n</fileName>\n<source>\n<database>\nGTRSB\n</database>\n<annotation>\n";
+  x += undef;
+  x += "</annotation>\n<image>\n";
+  appendEscaped(x, job.name);
+  x += "\n</image>\n<flickrid>\n";
+  x += undef;
+  x += "</flickrid>\n</source>\n<owner>\n<flickrid>\n";
+  x += undef;
+  x += "</flickrid>\n<name>\n";
+  appendEscaped(x, job.cls);
+  x += "\n</name>\n</owner>\n<size>\n<width>\n" + std::to_string(job.width) +
+       "\n</width>\n<height>\n" + std::to_string(job.height) +
+       "\n</height>\n</size>\n<depth>\n3\n</depth>\n<segmented>\n0\n</segmented>\n";
+  for (size_t i = 0; i < job.boxes.size(); ++i) {
+    const Box& b = job.boxes[i];
+    x += "<object>\n<name>\n";
+    appendEscaped(x, job.cls);
+    x += "\n</name>\n<pose>\nUnspecified\n</pose>\n<truncated>\n0\n</truncated>\n"
+         "<difficult>\n0\n</difficult>\n<bndbox>\n<xmin>\n" +
+         std::to_string(b.x1) + "\n</xmin>\n<ymin>\n" + std::to_string(b.y1) +
+         "\n</ymin>\n<xmax>\n" + std::to_string(b.x2) + "\n</xmax>\n<ymax>\n" +
+         std::to_string(b.y2) + "\n</ymax>\n</bndbox>\n</object>\n";
+  }
+  x += "</annotation>\n";
+  return x;
+}
+
+bool writeFile(const std::string& path, const std::string& data) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size();
+  return (close(fd) == 0) && ok;
+}
+
+// Copies src to dst, in the kernel where it can; returns the size or -1.
+long long copyFile(const std::string& src, const std::string& dst, std::vector<char>& buffer) {
+  int in = open(src.c_str(), O_RDONLY);
+  if (in < 0) return -1;
+  struct stat st;
+  int out = -1;
+  long long done = -1;
+  if (fstat(in, &st) == 0 && (out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0) {
+    done = 0;
+    while (done < st.st_size) {
+      ssize_t n = sendfile(out, in, 0, st.st_size - done);
+      if (n <= 0) break;
+      done += n;
+    }
+    if (done < st.st_size) {
+      // no sendfile between these file systems: plain read / write
+      buffer.resize(kCopyBuffer);
+      if (lseek(in, done, SEEK_SET) < 0) done = -1;
+      for (ssize_t n; done >= 0 && (n = read(in, &buffer[0], buffer.size())) != 0;) {
+        if (n < 0 || write(out, &buffer[0], n) != n) done = -1;
+        else done += n;
+      }
+    }
+    if (close(out) != 0) done = -1;
+  }
+  close(in);
+  return done;
+}
+
+class Builder {
+ public:
+  Builder(const DatasetBuildParams& p, DatasetBuildStats& s)
+      : p_(p), s_(s), next_(0), producing_(true), done_(0), bytes_(0), linked_(0),
+        copied_(0), failed_(0), reports_(0) {}
+
+  int run(char* err, size_t err_size);
+
+ private:
+  void readClass(const std::string& cls);
+  void splitClass(size_t first);
+  void worker();
+  void process(Job& job, std::vector<char>& buffer);
+  void report(const char* fmt, const std::string& a, const char* b);
+  void progress(double start, bool last);
+
+  const DatasetBuildParams& p_;
+  DatasetBuildStats& s_;
+  std::string src_, images_, annotations_, sets_;
+
+  // jobs are appended by the reader and taken in order by the workers;
+  // a deque keeps the taken ones in place while it grows
+  std::deque<Job> jobs_;
+  size_t next_;
+  bool producing_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+
+  std::atomic<uint64_t> done_, bytes_, linked_, copied_, failed_;
+  std::atomic<int> reports_;
+  double lastProgress_;
+};
+
+void Builder::report(const char* fmt, const std::string& a, const char* b) {
+  int n = reports_++;
+  if (n < kMaxReports) fprintf(stderr, fmt, a.c_str(), b);
+  if (n == kMaxReports) fprintf(stderr, "build_dataset: further problems are only counted\n");
+}
+
+void Builder::readClass(const std::string& cls) {
+  std::string csv = src_ + "/" + cls + "/GT-" + cls + ".csv";
+  FILE* f = fopen(csv.c_str(), "r");
+  if (!f) {
+    report("build_dataset: cannot read %s: %s\n", csv, strerror(errno));
+    return;
+  }
+
+  std::vector<Job> images;
+  std::unordered_map<std::string, size_t> byFile;
+  std::vector<char*> fields;
+  char* line = 0;
+  size_t cap = 0;
+  int lineNo = 0;
+  while (getline(&line, &cap, f) > 0) {
+    ++lineNo;
+    splitFields(line, fields);
+    if (fields.size() == 1 && !fields[0][0]) continue;  // empty line
+
+    int v[6];
+    bool ok = fields.size() >= 7;
+    for (int i = 0; ok && i < 6; ++i) ok = parseInt(fields[i + 1], v[i]);
+    if (!ok && lineNo == 1) continue;  // header
+    // the loader reads 1-based pixel boxes: 1 <= x1 <= x2 <= width
+    Box b = {v[2], v[3], v[4], v[5]};
+    ok = ok && fields[0][0] && v[0] > 0 && v[1] > 0 && b.x1 >= 1 && b.x1 <= b.x2 &&
+         b.x2 <= v[0] && b.y1 >= 1 && b.y1 <= b.y2 && b.y2 <= v[1];
+    if (!ok) {
+      ++s_.bad_rows;
+      report("build_dataset: %s: dropped invalid row %s\n", csv,
+             std::to_string(lineNo).c_str());
+      continue;
+    }
+
+    std::string file = fields[0];
+    std::unordered_map<std::string, size_t>::iterator it = byFile.find(file);
+    if (it == byFile.end()) {
+      it = byFile.insert(std::make_pair(file, images.size())).first;
+      images.push_back(Job());
+      Job& job = images.back();
+      job.cls = cls;
+      job.file = file;
+      job.name = cls + "_" + file;
+      size_t dot = job.name.rfind('.');
+      job.index = job.name.substr(0, dot > cls.size() ? dot : std::string::npos);
+      job.width = v[0];
+      job.height = v[1];
+      job.ok = false;
+    }
+    images[it->second].boxes.push_back(b);
+  }
+  free(line);
+  fclose(f);
+
+  // names of a class in sorted order, so that the split does not depend on
+  // the row order of the CSV
+  std::sort(images.begin(), images.end(),
+            [](const Job& a, const Job& b) { return a.name < b.name; });
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t first = jobs_.size();
+  for (size_t i = 0; i < images.size(); ++i) jobs_.push_back(std::move(images[i]));
+  splitClass(first);
+  ready_.notify_all();
+}
+
+// Seeded shuffle of the images of one class (jobs first..end), the first
+// round(train * n) go to train, the next round(val * n) to val.
+void Builder::splitClass(size_t first) {
+  size_t n = jobs_.size() - first;
+  if (!n) return;
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i) order[i] = i;
+  uint64_t state = p_.seed ^ hashString(jobs_[first].cls);
+  for (size_t i = n - 1; i > 0; --i) std::swap(order[i], order[nextRandom(state) % (i + 1)]);
+
+  size_t numTrain = std::min(n, (size_t)(p_.train * n + 0.5));
+  size_t numVal = std::min(n - numTrain, (size_t)(p_.val * n + 0.5));
+  for (size_t i = 0; i < n; ++i)
+    jobs_[first + order[i]].split = i < numTrain ? kTrain : (i < numTrain + numVal ? kVal : kTest);
+}
+
+void Builder::process(Job& job, std::vector<char>& buffer) {
+  std::string src = src_ + "/" + job.cls + "/" + job.file;
+  std::string dst = images_ + "/" + job.name;
+  long long size = -1;
+
+  if (p_.link) {
+    unlink(dst.c_str());
+    struct stat st;
+    if (link(src.c_str(), dst.c_str()) == 0 && stat(dst.c_str(), &st) == 0) {
+      size = st.st_size;
+      ++linked_;
+    } else if (errno != ENOENT) {
+      size = -2;  // other file system or no links allowed: copy
+    }
+  }
+  if (!p_.link || size == -2) {
+    size = copyFile(src, dst, buffer);
+    if (size >= 0) ++copied_;
+  }
+  if (size < 0) {
+    ++failed_;
+    report("build_dataset: cannot copy %s: %s\n", src, strerror(errno));
+    return;
+  }
+  bytes_ += size;
+
+  if (!writeFile(annotations_ + "/" + job.index + ".xml", annotationXml(job))) {
+    ++failed_;
+    report("build_dataset: cannot write the annotation of %s: %s\n", job.name, strerror(errno));
+    return;
+  }
+  job.ok = true;
+  ++done_;
+}
+
+void Builder::worker() {
+  std::vector<char> buffer;
+  for (;;) {
+    Job* job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this]() { return next_ < jobs_.size() || !producing_; });
+      if (next_ == jobs_.size()) return;
+      job = &jobs_[next_++];
+    }
+    process(*job, buffer);
+  }
+}
+
+void Builder::progress(double start, bool last) {
+  double t = now();
+  if (p_.progress_interval <= 0 || (!last && t - lastProgress_ < p_.progress_interval)) return;
+  lastProgress_ = t;
+  size_t queued;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued = jobs_.size();
+  }
+  double dt = std::max(t - start, 1e-9);
+  printf("build_dataset: %llu/%zu images, %.0f images/s, %.1f MB/s\n",
+         (unsigned long long)done_.load(), queued, done_ / dt, bytes_ / dt / 1e6);
+  fflush(stdout);
+}
+
+int Builder::run(char* err, size_t err_size) {
+  double start = now();
+  lastProgress_ = start;
+  src_ = p_.src_dir;
+  std::string out = p_.out_dir;
+  images_ = out + "/Images";
+  annotations_ = out + "/Annotations";
+  sets_ = out + "/ImageSets";
+
+  std::vector<std::string> classes;
+  if (!listDirs(src_, classes)) {
+    snprintf(err, err_size, "cannot read %s: %s", src_.c_str(), strerror(errno));
+    return 0;
+  }
+  const std::string* dirs[] = {&out, &images_, &annotations_, &sets_};
+  for (int i = 0; i < 4; ++i)
+    if (!makeDir(*dirs[i])) {
+      snprintf(err, err_size, "cannot create %s: %s", dirs[i]->c_str(), strerror(errno));
+      return 0;
+    }
+
+  unsigned int numThreads = p_.threads > 0 ? p_.threads : 2 * std::thread::hardware_concurrency();
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < std::max(numThreads, 1u); ++t)
+    workers.push_back(std::thread(&Builder::worker, this));
+
+  for (size_t c = 0; c < classes.size(); ++c) {
+    readClass(classes[c]);
+    progress(start, false);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    producing_ = false;
+  }
+  ready_.notify_all();
+
+  // report while the workers drain the queue
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (done_ + failed_ == jobs_.size()) break;
+    }
+    progress(start, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+
+  // image sets, sorted
+  std::vector<std::string> sets[3];
+  for (size_t i = 0; i < jobs_.size(); ++i) {
+    const Job& job = jobs_[i];
+    if (!job.ok) continue;
+    sets[job.split].push_back(job.index);
+    s_.objects += job.boxes.size();
+  }
+  std::string trainval;
+  std::vector<std::string> merged(sets[kTrain]);
+  merged.insert(merged.end(), sets[kVal].begin(), sets[kVal].end());
+  std::sort(merged.begin(), merged.end());
+  for (size_t i = 0; i < merged.size(); ++i) trainval += merged[i] + "\n";
+  bool ok = writeFile(sets_ + "/trainval.txt", trainval);
+  for (int k = 0; k < 3 && ok; ++k) {
+    std::sort(sets[k].begin(), sets[k].end());
+    std::string list;
+    for (size_t i = 0; i < sets[k].size(); ++i) list += sets[k][i] + "\n";
+    ok = writeFile(sets_ + "/" + kSplitNames[k] + ".txt", list);
+    s_.split[k] = sets[k].size();
+  }
+  if (!ok) {
+    snprintf(err, err_size, "cannot write the image sets in %s: %s", sets_.c_str(), strerror(errno));
+    return 0;
+  }
+
+  s_.images = done_;
+  s_.failed = failed_;
+  s_.linked = linked_;
+  s_.copied = copied_;
+  s_.bytes = bytes_;
+  s_.seconds = now() - start;
+  progress(start, true);
+  return 1;
+}
+
+}  // namespace
+
+int _build_dataset(const DatasetBuildParams* params, DatasetBuildStats* stats,
+                   char* err, size_t err_size) {
+  memset(stats, 0, sizeof(*stats));
+  Builder builder(*params, *stats);
+  return builder.run(err, err_size);
+}
@@ -0,0 +1,51 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Native csvToXml + split_dataset: builds the Images, Annotations and
+// ImageSets directories of a traffic devkit from GTSRB style label CSVs in
+// one pass.
+//
+// The source directory holds one subdirectory per class (00000, 00001, ..)
+// with the images and a GT-<class>.csv of
+//   Filename;Width;Height;Roi.X1;Roi.Y1;Roi.X2;Roi.Y2;ClassId
+// rows. The CSVs are read line by line while a pool of I/O workers copies or
+// hard-links the images and writes their XML files. Rows with the same
+// Filename become objects of one image.
+//
+// The output only depends on the inputs and the seed: images are named
+// <class>_<Filename> as before, every class is split into train / val / test
+// on its own with a seeded shuffle of its sorted image names, and the image
+// set files are sorted.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+struct DatasetBuildParams {
+  const char* src_dir;         // one subdirectory per class
+  const char* out_dir;         // devkit data directory, created if missing
+  double train, val;           // split fractions, test gets the rest
+  uint64_t seed;
+  int link;                    // hard-link images, copying where that fails
+  int threads;                 // I/O workers, <= 0: two per core
+  double progress_interval;    // seconds between progress lines, <= 0: quiet
+};
+
+struct DatasetBuildStats {
+  uint64_t images;             // written with their annotation
+  uint64_t objects;
+  uint64_t bad_rows;           // unparsable rows and invalid boxes, dropped
+  uint64_t failed;             // images that could not be copied or written
+  uint64_t linked, copied;
+  uint64_t bytes;              // image bytes copied or linked
+  uint64_t split[3];           // train, val, test images
+  double seconds;
+};
+
+// Returns 0 and describes the error in err (err_size bytes) if the source
+// cannot be read or the output cannot be created; per-image problems are
+// reported on stderr and counted in stats.
+int _build_dataset(const DatasetBuildParams* params, DatasetBuildStats* stats,
+                   char* err, size_t err_size);
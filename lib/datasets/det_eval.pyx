@@ -0,0 +1,72 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+import numpy as np
+cimport numpy as np
+
+cdef extern from "det_eval_kernel.hpp":
+    ctypedef struct DetEvalParams:
+        double ovthresh
+        int use_07_metric
+        int threads
+    void _eval_detections(const double*, const int*, const int*, const unsigned char*,
+                          int, const int*, const double*, const int*, const int*, int,
+                          const DetEvalParams*, double*, double*, double*) nogil
+
+assert sizeof(int) == sizeof(np.int32_t)
+
+def eval_detections(gt_boxes, gt_class, gt_image, gt_difficult, npos,
+                    det_boxes, det_image, det_offs, double ovthresh=0.5,
+                    use_07_metric=False, int threads=0):
+    """
+    TP/FP matching and AP of traffic_eval for C classes at once, one class
+    per thread.
+
+    gt_boxes: (G, 4) x1 y1 x2 y2, with gt_class, gt_image, gt_difficult (G,)
+    npos: (C,) non-difficult gt per class
+    det_boxes: (D, 4) and det_image (D,); class c owns rows
+        det_offs[c]:det_offs[c + 1], sorted by descending confidence
+
+    Returns
+    -------
+    rec, prec: (D,) float64
+    ap: (C,) float64
+    """
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] gb = \
+            np.ascontiguousarray(gt_boxes, dtype=np.float64).reshape(-1, 4)
+    cdef np.ndarray[np.int32_t, ndim=1, mode='c'] gc = \
+            np.ascontiguousarray(gt_class, dtype=np.int32)
+    cdef np.ndarray[np.int32_t, ndim=1, mode='c'] gi = \
+            np.ascontiguousarray(gt_image, dtype=np.int32)
+    cdef np.ndarray[np.uint8_t, ndim=1, mode='c'] gd = \
+            np.ascontiguousarray(gt_difficult, dtype=np.uint8)
+    cdef np.ndarray[np.int32_t, ndim=1, mode='c'] pos = \
+            np.ascontiguousarray(npos, dtype=np.int32)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] db = \
+            np.ascontiguousarray(det_boxes, dtype=np.float64).reshape(-1, 4)
+    cdef np.ndarray[np.int32_t, ndim=1, mode='c'] di = \
+            np.ascontiguousarray(det_image, dtype=np.int32)
+    cdef np.ndarray[np.int32_t, ndim=1, mode='c'] offs = \
+            np.ascontiguousarray(det_offs, dtype=np.int32)
+    cdef int num_gt = gb.shape[0], num_classes = offs.shape[0] - 1
+    assert gc.shape[0] == num_gt and gi.shape[0] == num_gt and gd.shape[0] == num_gt
+    assert pos.shape[0] == num_classes and di.shape[0] == db.shape[0]
+    assert offs[0] == 0 and offs[num_classes] == db.shape[0]
+
+    cdef DetEvalParams p
+    p.ovthresh = ovthresh
+    p.use_07_metric = bool(use_07_metric)
+    p.threads = threads
+
+    cdef np.ndarray[np.float64_t, ndim=1] rec = np.empty(db.shape[0], dtype=np.float64)
+    cdef np.ndarray[np.float64_t, ndim=1] prec = np.empty(db.shape[0], dtype=np.float64)
+    cdef np.ndarray[np.float64_t, ndim=1] ap = np.empty(num_classes, dtype=np.float64)
+    with nogil:
+        _eval_detections(<double*> gb.data, <int*> gc.data, <int*> gi.data,
+                         <unsigned char*> gd.data, num_gt, <int*> pos.data,
+                         <double*> db.data, <int*> di.data, <int*> offs.data,
+                         num_classes, &p, <double*> rec.data, <double*> prec.data,
+                         <double*> ap.data)
+    return rec, prec, ap
@@ -0,0 +1,187 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "det_eval_kernel.hpp"
+#include "iou_engine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// np.maximum / np.minimum: NaN wins.
+inline double npMax(double a, double b) { return (a >= b || a != a) ? a : b; }
+inline double npMin(double a, double b) { return (a <= b || a != a) ? a : b; }
+
+// np.sum of a contiguous float64 array (numpy's pairwise summation).
+double pairwiseSum(const double* a, size_t n) {
+  if (n < 8) {
+    double res = 0.;
+    for (size_t i = 0; i < n; ++i) res += a[i];
+    return res;
+  }
+  if (n <= 128) {
+    double r[8];
+    size_t i;
+    for (int j = 0; j < 8; ++j) r[j] = a[j];
+    for (i = 8; i < n - (n % 8); i += 8)
+      for (int j = 0; j < 8; ++j) r[j] += a[i + j];
+    double res = ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+    for (; i < n; ++i) res += a[i];
+    return res;
+  }
+  size_t n2 = n / 2;
+  n2 -= n2 % 8;
+  return pairwiseSum(a, n2) + pairwiseSum(a + n2, n - n2);
+}
+
+// traffic_ap(rec, prec, use_07_metric)
+double averagePrecision(const double* rec, const double* prec, size_t n, bool use_07_metric) {
+  if (use_07_metric) {
+    double ap = 0.;
+    for (int k = 0; k < 11; ++k) {
+      double t = k * 0.1, p = 0;  // np.arange(0., 1.1, 0.1)[k]
+      bool any = false;
+      for (size_t i = 0; i < n; ++i)
+        if (rec[i] >= t) {
+          p = any ? npMax(p, prec[i]) : prec[i];
+          any = true;
+        }
+      ap = ap + p / 11.;
+    }
+    return ap;
+  }
+  std::vector<double> mrec(n + 2), mpre(n + 2), terms;
+  mrec[0] = 0.;
+  mpre[0] = 0.;
+  std::copy(rec, rec + n, mrec.begin() + 1);
+  std::copy(prec, prec + n, mpre.begin() + 1);
+  mrec[n + 1] = 1.;
+  mpre[n + 1] = 0.;
+  for (size_t i = n + 1; i > 0; --i) mpre[i - 1] = npMax(mpre[i - 1], mpre[i]);
+  terms.reserve(n + 1);
+  for (size_t i = 0; i + 1 < n + 2; ++i)
+    if (mrec[i + 1] != mrec[i]) terms.push_back((mrec[i + 1] - mrec[i]) * mpre[i + 1]);
+  return pairwiseSum(terms.data(), terms.size());
+}
+
+struct EvalJob {
+  const double* gt_boxes;
+  const int* gt_image;
+  const unsigned char* gt_difficult;
+  const int* npos;
+  const double* det_boxes;
+  const int* det_image;
+  const int* det_offs;
+  const DetEvalParams* params;
+  // gt rows of class c are class_rows[class_first[c] .. class_first[c + 1])
+  std::vector<int> class_rows, class_first;
+  double *rec, *prec, *ap;
+};
+
+void evalClass(const EvalJob& J, int c) {
+  // this class's gt, grouped by image in annotation order
+  std::vector<int> rows(J.class_rows.begin() + J.class_first[c],
+                        J.class_rows.begin() + J.class_first[c + 1]);
+  std::stable_sort(rows.begin(), rows.end(),
+                   [&](int a, int b) { return J.gt_image[a] < J.gt_image[b]; });
+  size_t ng = rows.size();
+  std::vector<double> x1(ng), y1(ng), x2(ng), y2(ng), area(ng);
+  std::vector<int> image(ng);
+  std::vector<unsigned char> difficult(ng), det(ng, 0);
+  for (size_t j = 0; j < ng; ++j) {
+    const double* g = J.gt_boxes + 4 * rows[j];
+    x1[j] = g[0]; y1[j] = g[1]; x2[j] = g[2]; y2[j] = g[3];
+    area[j] = (g[2] - g[0] + 1.) * (g[3] - g[1] + 1.);
+    image[j] = J.gt_image[rows[j]];
+    difficult[j] = J.gt_difficult[rows[j]];
+  }
+
+  const double eps = std::numeric_limits<double>::epsilon();
+  const double npos = (double) J.npos[c];
+  double tp = 0., fp = 0.;
+  int d0 = J.det_offs[c], d1 = J.det_offs[c + 1];
+  for (int d = d0; d < d1; ++d) {
+    const double* bb = J.det_boxes + 4 * d;
+    std::pair<std::vector<int>::iterator, std::vector<int>::iterator> range =
+        std::equal_range(image.begin(), image.end(), J.det_image[d]);
+    size_t lo = range.first - image.begin(), hi = range.second - image.begin();
+    double ovmax = -std::numeric_limits<double>::infinity();
+    size_t jmax = 0;
+    if (hi > lo) {
+      // overlaps = inters / uni as numpy evaluates them; ovmax/jmax follow
+      // np.max/np.argmax, where the first NaN wins
+      double barea = (bb[2] - bb[0] + 1.) * (bb[3] - bb[1] + 1.);
+      for (size_t j = lo; j < hi; ++j) {
+        double iw = npMax(npMin(x2[j], bb[2]) - npMax(x1[j], bb[0]) + 1., 0.);
+        double ih = npMax(npMin(y2[j], bb[3]) - npMax(y1[j], bb[1]) + 1., 0.);
+        double inters = iw * ih;
+        double ov = inters / (barea + area[j] - inters);
+        if (ov != ov) { ovmax = ov; jmax = j; break; }
+        if (j == lo || ov > ovmax) { ovmax = ov; jmax = j; }
+      }
+    }
+    double is_tp = 0., is_fp = 0.;
+    if (ovmax > J.params->ovthresh) {
+      if (!difficult[jmax]) {
+        if (!det[jmax]) {
+          is_tp = 1.;
+          det[jmax] = 1;
+        } else {
+          is_fp = 1.;
+        }
+      }
+    } else {
+      is_fp = 1.;
+    }
+    tp += is_tp;
+    fp += is_fp;
+    J.rec[d] = tp / npos;
+    J.prec[d] = tp / npMax(tp + fp, eps);
+  }
+  J.ap[c] = averagePrecision(J.rec + d0, J.prec + d0, d1 - d0, J.params->use_07_metric != 0);
+}
+
+}  // namespace
+
+void _eval_detections(const double* gt_boxes, const int* gt_class, const int* gt_image,
+                      const unsigned char* gt_difficult, int num_gt, const int* npos,
+                      const double* det_boxes, const int* det_image, const int* det_offs,
+                      int num_classes, const DetEvalParams* params,
+                      double* rec, double* prec, double* ap) {
+  EvalJob J;
+  J.gt_boxes = gt_boxes;
+  J.gt_image = gt_image;
+  J.gt_difficult = gt_difficult;
+  J.npos = npos;
+  J.det_boxes = det_boxes;
+  J.det_image = det_image;
+  J.det_offs = det_offs;
+  J.params = params;
+  J.rec = rec;
+  J.prec = prec;
+  J.ap = ap;
+
+  // bucket gt rows by class, keeping their order
+  J.class_first.assign(num_classes + 1, 0);
+  for (int i = 0; i < num_gt; ++i)
+    if (gt_class[i] >= 0 && gt_class[i] < num_classes) J.class_first[gt_class[i] + 1]++;
+  for (int c = 0; c < num_classes; ++c) J.class_first[c + 1] += J.class_first[c];
+  J.class_rows.resize(J.class_first[num_classes]);
+  std::vector<int> next(J.class_first.begin(), J.class_first.end() - 1);
+  for (int i = 0; i < num_gt; ++i)
+    if (gt_class[i] >= 0 && gt_class[i] < num_classes) J.class_rows[next[gt_class[i]]++] = i;
+
+  // class sizes vary a lot, so threads pull the next class off a counter
+  int threads = params->threads > 0 ? params->threads
+                : (int) std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                         (size_t) std::max(num_classes, 1));
+  std::atomic<int> next_class(0);
+  iou::parallelRows((size_t) threads, threads, [&](size_t, size_t, int) {
+    for (int c = next_class++; c < num_classes; c = next_class++) evalClass(J, c);
+  });
+}
@@ -0,0 +1,27 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Native TP/FP matching and AP of datasets/traffic_eval.py for all classes
+// at once. Results match traffic_eval / traffic_ap exactly.
+
+#pragma once
+
+struct DetEvalParams {
+  double ovthresh;             // overlap needed for a true positive
+  int use_07_metric;           // VOC07 11 point AP instead of the area
+  int threads;                 // <= 0: one per core (classes run in parallel)
+};
+
+// gt_boxes: num_gt x 4 (x1 y1 x2 y2), with the class, image index and
+// difficult flag of each row; rows of one image keep the annotation order.
+// npos: non-difficult gt count per class.
+// Detections of class c are rows det_offs[c] .. det_offs[c + 1] of det_boxes
+// (x1 y1 x2 y2) and det_image, sorted by descending confidence.
+// rec and prec are written per detection row, ap per class.
+void _eval_detections(const double* gt_boxes, const int* gt_class, const int* gt_image,
+                      const unsigned char* gt_difficult, int num_gt, const int* npos,
+                      const double* det_boxes, const int* det_image, const int* det_offs,
+                      int num_classes, const DetEvalParams* params,
+                      double* rec, double* prec, double* ap);
@@ -8,6 +8,7 @@
 import os
 import os.path as osp
 import PIL
+import cv2
 from utils.cython_bbox import bbox_overlaps
 import numpy as np
 import scipy.sparse
@@ -81,9 +82,31 @@ class imdb(object):
     def image_path_at(self, i):
         raise NotImplementedError
 
+    def image_at(self, i):
+        """Image i, decoded as BGR."""
+        return cv2.imread(self.image_path_at(i))
+
+    def image_source_at(self, i):
+        """Where the native image loader reads image i: a path, or the
+        encoded image in memory."""
+        return self.image_path_at(i)
+
+    def image_sizes(self):
+        """(width, height) of every image if the dataset knows them without
+        opening the images, else None."""
+        return None
+
     def default_roidb(self):
         raise NotImplementedError
 
+    def gt_objects(self):
+        """The gt of every image for scoring detections: a list of dicts with
+        'boxes', 'gt_classes' and 'difficult'. Datasets that drop difficult
+        objects from the gt roidb should return them here, flagged."""
+        return [{'boxes': r['boxes'], 'gt_classes': r['gt_classes'],
+                 'difficult': np.zeros(len(r['gt_classes']), dtype=np.uint8)}
+                for r in self.gt_roidb()]
+
     def evaluate_detections(self, all_boxes, output_dir=None):
         """
         all_boxes is a list of length number-of-classes.
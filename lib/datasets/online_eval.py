@@ -0,0 +1,126 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Running PASCAL VOC style evaluation for streams of frames, e.g. the
+detections of a simulator run scored against the ground truth it sends with
+every frame."""
+
+import numpy as np
+from utils.cython_bbox import bbox_overlaps
+from traffic_eval import traffic_ap
+
+class OnlineEvaluator(object):
+    """Incremental traffic_eval over frames.
+
+    Each frame is matched on its own (TP/FP marking only ever compares the
+    detections of one image, so this is the same matching traffic_eval does)
+    and only the outcome is kept: per class, the TP and FP counts of a fixed
+    histogram over the score range plus the number of non-difficult gt.
+    Memory is O(num_classes * num_bins) however long the stream runs.
+
+    The PR curve has one point per non-empty score bin instead of one per
+    detection, so ap() is exact up to the order of detections that share a
+    bin. Scores outside [score_min, score_max) go to the end bins.
+    """
+
+    def __init__(self, num_classes, ovthresh=0.5, use_07_metric=False,
+                 num_bins=10000, score_min=0., score_max=1.):
+        self.num_classes = num_classes
+        self.ovthresh = ovthresh
+        self.use_07_metric = use_07_metric
+        self.num_bins = num_bins
+        self._score_min = float(score_min)
+        self._bin_scale = num_bins / (float(score_max) - score_min)
+        self.reset()
+
+    def reset(self):
+        self.num_frames = 0
+        self._tp = np.zeros((self.num_classes, self.num_bins), dtype=np.int64)
+        self._fp = np.zeros((self.num_classes, self.num_bins), dtype=np.int64)
+        self._npos = np.zeros(self.num_classes, dtype=np.int64)
+
+    def _bins(self, scores):
+        bins = np.floor((scores - self._score_min) * self._bin_scale)
+        return np.clip(bins, 0, self.num_bins - 1).astype(np.intp)
+
+    def update(self, gt_boxes, gt_classes, dets, gt_difficult=None):
+        """Add one frame.
+
+        gt_boxes: (G, 4) x1 y1 x2 y2 with class indices gt_classes (G,) and
+            optional difficult flags (G,)
+        dets: dets[cls] = N x 5 array (x1, y1, x2, y2, score), as in
+            test_net's all_boxes[cls][image]; empty or None for no detections
+        """
+        gt_boxes = np.asarray(gt_boxes, dtype=np.float).reshape(-1, 4)
+        gt_classes = np.asarray(gt_classes, dtype=np.int32).ravel()
+        if gt_difficult is None:
+            gt_difficult = np.zeros(len(gt_classes), dtype=np.bool)
+        else:
+            gt_difficult = np.asarray(gt_difficult, dtype=np.bool).ravel()
+        self._npos += np.bincount(gt_classes[~gt_difficult],
+                                  minlength=self.num_classes)
+        self.num_frames += 1
+
+        for cls in xrange(min(len(dets), self.num_classes)):
+            if dets[cls] is None or len(dets[cls]) == 0:
+                continue
+            cls_dets = np.asarray(dets[cls], dtype=np.float)
+            scores = cls_dets[:, 4]
+            bins = self._bins(scores)
+            gt_inds = np.where(gt_classes == cls)[0]
+            if len(gt_inds) == 0:
+                np.add.at(self._fp[cls], bins, 1)
+                continue
+
+            order = np.argsort(-scores, kind='mergesort')
+            overlaps = bbox_overlaps(
+                np.ascontiguousarray(cls_dets[order, :4]),
+                np.ascontiguousarray(gt_boxes[gt_inds]))
+            jmax = overlaps.argmax(axis=1)
+            ovmax = overlaps[np.arange(len(order)), jmax]
+            difficult = gt_difficult[gt_inds]
+            matched = np.zeros(len(gt_inds), dtype=np.bool)
+            tp = np.zeros(len(order), dtype=np.bool)
+            fp = ~(ovmax > self.ovthresh)
+            for d in np.where(~fp)[0]:
+                j = jmax[d]
+                if difficult[j]:
+                    continue
+                if matched[j]:
+                    fp[d] = True
+                else:
+                    tp[d] = matched[j] = True
+            np.add.at(self._tp[cls], bins[order[tp]], 1)
+            np.add.at(self._fp[cls], bins[order[fp]], 1)
+
+    def pr(self, cls):
+        """Running recall and precision of class cls, one point per non-empty
+        score bin in descending score order."""
+        tp = self._tp[cls, ::-1]
+        fp = self._fp[cls, ::-1]
+        keep = np.where((tp + fp) > 0)[0]
+        tp = np.cumsum(tp)[keep].astype(np.float)
+        fp = np.cumsum(fp)[keep].astype(np.float)
+        rec = tp / float(self._npos[cls])
+        prec = tp / np.maximum(tp + fp, np.finfo(np.float64).eps)
+        return rec, prec
+
+    def ap(self, cls):
+        """Running AP of class cls (nan before any of its gt was seen)."""
+        if self._npos[cls] == 0:
+            return np.nan
+        rec, prec = self.pr(cls)
+        return traffic_ap(rec, prec, self.use_07_metric)
+
+    def aps(self, classes=None):
+        if classes is None:
+            classes = xrange(1, self.num_classes)
+        return np.array([self.ap(cls) for cls in classes])
+
+    def mean_ap(self, classes=None):
+        """Mean of the running APs over the classes seen so far."""
+        aps = self.aps(classes)
+        aps = aps[~np.isnan(aps)]
+        return aps.mean() if len(aps) else np.nan
@@ -0,0 +1,199 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Packed dataset shards (see shard_io.hpp): one file per image set holding
+the encoded images, an index and a fixed-stride annotation table. Shard maps
+the file and hands out numpy views of it, so opening one costs a few system
+calls however many images it holds."""
+
+import numpy as np
+cimport numpy as np
+from libc.stdint cimport uint8_t, uint16_t, int32_t, uint64_t
+
+np.import_array()
+
+cdef extern from "shard_io.hpp":
+    ctypedef struct ShardHeader:
+        uint64_t num_images
+        uint64_t num_objects
+        uint64_t data_offset
+        uint64_t images_offset
+        uint64_t objects_offset
+        uint64_t names_offset
+        uint64_t file_size
+    ctypedef struct ShardMap:
+        void* base
+        uint64_t size
+        const ShardHeader* header
+    ctypedef struct _ShardWriter "ShardWriter":
+        pass
+    _ShardWriter* _shard_create(const char*, char*, size_t)
+    int _shard_add(_ShardWriter*, const char*, size_t, const uint8_t*, uint64_t,
+                   int, int, const uint16_t*, const int32_t*, const uint8_t*,
+                   int) nogil
+    int _shard_finish(_ShardWriter*, char*, size_t) nogil
+    void _shard_abort(_ShardWriter*)
+    const char* _shard_error(const _ShardWriter*)
+    int _shard_open(const char*, ShardMap*, char*, size_t)
+    void _shard_close(ShardMap*)
+
+# rows of the index and the annotation table, field by field as in shard_io.hpp
+IMAGE_DTYPE = np.dtype([('data_offset', '<u8'), ('data_size', '<u8'),
+                        ('first_object', '<u4'), ('num_objects', '<u4'),
+                        ('name_offset', '<u4'), ('name_size', '<u4'),
+                        ('width', '<u2'), ('height', '<u2'),
+                        ('reserved', '<u4')])
+OBJECT_DTYPE = np.dtype([('box', '<u2', (4,)), ('cls', '<i4'),
+                         ('difficult', 'u1'), ('reserved', 'u1', (3,))])
+
+cdef bytes _path(path):
+    return path.encode('utf-8') if isinstance(path, unicode) else path
+
+cdef class _Mapping:
+    # Owns the mmap; the arrays of a Shard keep it alive as their base, so
+    # views stay valid after the Shard itself is gone.
+    cdef ShardMap map
+
+    def __dealloc__(self):
+        _shard_close(&self.map)
+
+cdef class Shard:
+    """Read-only view of a shard file.
+
+    images: index table (IMAGE_DTYPE), one row per image
+    objects: annotation table (OBJECT_DTYPE); image i owns the rows
+        images['first_object'][i] + range(images['num_objects'][i])
+    """
+    cdef readonly object path
+    cdef readonly object images
+    cdef readonly object objects
+    cdef object _file
+    cdef uint64_t _data_offset, _names_offset
+
+    def __cinit__(self, path):
+        cdef char err[1024]
+        cdef _Mapping m = _Mapping()
+        if not _shard_open(_path(path), &m.map, err, sizeof(err)):
+            raise IOError(err.decode('utf-8', 'replace'))
+        cdef np.npy_intp size = m.map.size
+        cdef np.ndarray f = np.PyArray_SimpleNewFromData(1, &size, np.NPY_UINT8,
+                                                         m.map.base)
+        np.set_array_base(f, m)
+        f.flags.writeable = False
+
+        cdef const ShardHeader* h = m.map.header
+        self.path = path
+        self._file = f
+        self._data_offset = h.data_offset
+        self._names_offset = h.names_offset
+        self.images = f[h.images_offset:h.images_offset +
+                        h.num_images * IMAGE_DTYPE.itemsize].view(IMAGE_DTYPE)
+        self.objects = f[h.objects_offset:h.objects_offset +
+                         h.num_objects * OBJECT_DTYPE.itemsize].view(OBJECT_DTYPE)
+
+    def __len__(self):
+        return len(self.images)
+
+    def names(self):
+        """Image index names, in shard order."""
+        blob = self._file[self._names_offset:].tobytes()
+        names = []
+        for off, size in zip(self.images['name_offset'].tolist(),
+                             self.images['name_size'].tolist()):
+            name = blob[off:off + size]
+            names.append(name if isinstance(name, str) else name.decode('utf-8'))
+        return names
+
+    def image_data(self, int i):
+        """Encoded bytes of image i as a read-only uint8 view of the file."""
+        im = self.images[i]
+        off = self._data_offset + im['data_offset']
+        return self._file[off:off + im['data_size']]
+
+cdef class ShardWriter:
+    """Streams images and their ground truth into a new shard.
+
+    The file is written as path + '.tmp' and only renamed to path by close(),
+    so readers never see a partial shard. Used as a context manager, the
+    shard is dropped if the block raises.
+    """
+    cdef _ShardWriter* _w
+    cdef readonly object path
+
+    def __cinit__(self, path):
+        cdef char err[1024]
+        self._w = _shard_create(_path(path), err, sizeof(err))
+        if self._w == NULL:
+            raise IOError(err.decode('utf-8', 'replace'))
+        self.path = path
+
+    def __dealloc__(self):
+        if self._w != NULL:
+            _shard_abort(self._w)
+
+    def add(self, name, data, boxes, classes, difficult=None, int width=0,
+            int height=0):
+        """Append an image.
+
+        name: image index name
+        data: encoded image (bytes or uint8 array), stored as is
+        boxes: (N, 4) x1 y1 x2 y2, 0-based, with class indices classes (N,)
+            and optional difficult flags (N,)
+        width, height: image size, 0 if unknown
+        """
+        assert self._w != NULL, 'shard is closed'
+        cdef bytes n = _path(name)
+        cdef np.ndarray d = np.frombuffer(data, dtype=np.uint8) \
+                if isinstance(data, bytes) else \
+                np.ascontiguousarray(data, dtype=np.uint8).reshape(-1)
+        cdef np.ndarray b = np.ascontiguousarray(boxes, dtype=np.uint16).reshape(-1, 4)
+        cdef np.ndarray c = np.ascontiguousarray(classes, dtype=np.int32).reshape(-1)
+        cdef np.ndarray f
+        cdef const uint8_t* fp = NULL
+        cdef int num = b.shape[0]
+        assert c.shape[0] == num, 'one class per box'
+        if difficult is not None:
+            f = np.ascontiguousarray(difficult, dtype=np.uint8).reshape(-1)
+            assert f.shape[0] == num, 'one difficult flag per box'
+            fp = <const uint8_t*> np.PyArray_DATA(f)
+
+        cdef const char* name_p = n
+        cdef size_t ns = len(n)
+        cdef const uint8_t* dp = <const uint8_t*> np.PyArray_DATA(d)
+        cdef uint64_t ds = d.shape[0]
+        cdef const uint16_t* bp = <const uint16_t*> np.PyArray_DATA(b)
+        cdef const int32_t* cp = <const int32_t*> np.PyArray_DATA(c)
+        cdef int ok
+        with nogil:
+            ok = _shard_add(self._w, name_p, ns, dp, ds, width, height, bp, cp, fp, num)
+        if not ok:
+            raise IOError('{}: {}'.format(self.path, _shard_error(self._w).decode('utf-8', 'replace')))
+
+    def close(self):
+        """Write the tables and move the shard into place."""
+        cdef char err[1024]
+        cdef int ok
+        if self._w == NULL:
+            return
+        with nogil:
+            ok = _shard_finish(self._w, err, sizeof(err))
+        self._w = NULL
+        if not ok:
+            raise IOError(err.decode('utf-8', 'replace'))
+
+    def abort(self):
+        """Drop the shard."""
+        if self._w != NULL:
+            _shard_abort(self._w)
+            self._w = NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, tb):
+        if exc_type is None:
+            self.close()
+        else:
+            self.abort()
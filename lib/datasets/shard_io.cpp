@@ -0,0 +1,248 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "shard_io.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint64_t kAlign = 64;
+// Write buffer of the image data; images stream through it to the file.
+const size_t kBufferSize = 1 << 20;
+
+void setError(char* err, size_t err_size, const char* fmt, const char* a, const char* b = "") {
+  if (err && err_size) snprintf(err, err_size, fmt, a, b);
+}
+
+uint64_t alignUp(uint64_t v) { return (v + kAlign - 1) & ~(kAlign - 1); }
+
+// off + count * stride <= size, without overflowing.
+bool fits(uint64_t off, uint64_t count, uint64_t stride, uint64_t size) {
+  if (off > size) return false;
+  return count <= (size - off) / stride;
+}
+
+}  // namespace
+
+struct ShardWriter {
+  std::string path, tmp_path, error;
+  FILE* f;
+  uint64_t data_size;
+  std::vector<ShardImage> images;
+  std::vector<ShardObject> objects;
+  std::string names;
+
+  ShardWriter() : f(0), data_size(0) {}
+
+  bool fail(const char* what) {
+    error = what;
+    if (errno) error += std::string(": ") + strerror(errno);
+    return false;
+  }
+
+  bool pad() {
+    static const char zeros[kAlign] = {0};
+    long pos = ftell(f);
+    if (pos < 0) return fail("ftell failed");
+    uint64_t n = alignUp(pos) - pos;
+    return !n || fwrite(zeros, 1, n, f) == n || fail("write failed");
+  }
+
+  template <typename T>
+  bool writeTable(const std::vector<T>& v, uint64_t* offset) {
+    if (!pad()) return false;
+    *offset = ftell(f);
+    return v.empty() || fwrite(&v[0], sizeof(T), v.size(), f) == v.size() || fail("write failed");
+  }
+};
+
+ShardWriter* _shard_create(const char* path, char* err, size_t err_size) {
+  ShardWriter* w = new ShardWriter();
+  w->path = path;
+  w->tmp_path = w->path + ".tmp";
+  w->f = fopen(w->tmp_path.c_str(), "wb");
+  if (!w->f) {
+    setError(err, err_size, "cannot create %s: %s", w->tmp_path.c_str(), strerror(errno));
+    delete w;
+    return 0;
+  }
+  setvbuf(w->f, 0, _IOFBF, kBufferSize);
+
+  // placeholder, the real header is written by _shard_finish
+  ShardHeader h;
+  memset(&h, 0, sizeof(h));
+  if (fwrite(&h, sizeof(h), 1, w->f) != 1) {
+    setError(err, err_size, "cannot write %s: %s", w->tmp_path.c_str(), strerror(errno));
+    _shard_abort(w);
+    return 0;
+  }
+  return w;
+}
+
+int _shard_add(ShardWriter* w, const char* name, size_t name_size,
+               const uint8_t* data, uint64_t data_size, int width, int height,
+               const uint16_t* boxes, const int32_t* classes,
+               const uint8_t* difficult, int num_objects) {
+  errno = 0;
+  if (width < 0 || width > 0xFFFF || height < 0 || height > 0xFFFF || num_objects < 0)
+    return w->fail("image size or object count out of range");
+  if (w->names.size() + name_size > 0xFFFFFFFFu || w->objects.size() + num_objects > 0xFFFFFFFFu)
+    return w->fail("too many names or objects for one shard");
+  if (data_size && fwrite(data, 1, data_size, w->f) != data_size) return w->fail("write failed");
+
+  ShardImage im;
+  memset(&im, 0, sizeof(im));
+  im.data_offset = w->data_size;
+  im.data_size = data_size;
+  im.first_object = w->objects.size();
+  im.num_objects = num_objects;
+  im.name_offset = w->names.size();
+  im.name_size = name_size;
+  im.width = width;
+  im.height = height;
+  w->images.push_back(im);
+  w->data_size += data_size;
+  w->names.append(name, name_size);
+
+  for (int i = 0; i < num_objects; ++i) {
+    ShardObject o;
+    memset(&o, 0, sizeof(o));
+    memcpy(o.box, boxes + 4 * i, sizeof(o.box));
+    o.cls = classes[i];
+    o.difficult = difficult ? difficult[i] : 0;
+    w->objects.push_back(o);
+  }
+  return 1;
+}
+
+int _shard_finish(ShardWriter* w, char* err, size_t err_size) {
+  ShardHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SHARD_MAGIC, sizeof(h.magic));
+  h.version = SHARD_VERSION;
+  h.header_size = sizeof(ShardHeader);
+  h.image_stride = sizeof(ShardImage);
+  h.object_stride = sizeof(ShardObject);
+  h.num_images = w->images.size();
+  h.num_objects = w->objects.size();
+  h.data_offset = sizeof(ShardHeader);
+
+  errno = 0;
+  std::vector<char> names(w->names.begin(), w->names.end());
+  bool ok = w->writeTable(w->images, &h.images_offset) &&
+            w->writeTable(w->objects, &h.objects_offset) &&
+            w->writeTable(names, &h.names_offset);
+  if (ok) {
+    h.file_size = ftell(w->f);
+    ok = (fseek(w->f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, w->f) == 1 &&
+          fflush(w->f) == 0 && fsync(fileno(w->f)) == 0) || w->fail("write failed");
+  }
+  if (ok) {
+    int rc = fclose(w->f);
+    w->f = 0;
+    ok = (rc == 0 || w->fail("close failed")) &&
+         (rename(w->tmp_path.c_str(), w->path.c_str()) == 0 || w->fail("rename failed"));
+  }
+  if (!ok) {
+    setError(err, err_size, "%s: %s", w->path.c_str(), w->error.c_str());
+    _shard_abort(w);
+    return 0;
+  }
+  delete w;
+  return 1;
+}
+
+void _shard_abort(ShardWriter* w) {
+  if (w->f) fclose(w->f);
+  unlink(w->tmp_path.c_str());
+  delete w;
+}
+
+const char* _shard_error(const ShardWriter* w) { return w->error.c_str(); }
+
+int _shard_open(const char* path, ShardMap* map, char* err, size_t err_size) {
+  memset(map, 0, sizeof(*map));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    setError(err, err_size, "cannot open %s: %s", path, strerror(errno));
+    return 0;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ShardHeader)) {
+    close(fd);
+    setError(err, err_size, "%s: %s", path, "not a shard (too small)");
+    return 0;
+  }
+  void* base = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    setError(err, err_size, "cannot map %s: %s", path, strerror(errno));
+    return 0;
+  }
+  map->base = base;
+  map->size = st.st_size;
+
+  const ShardHeader* h = (const ShardHeader*)base;
+  const char* bad = 0;
+  if (memcmp(h->magic, SHARD_MAGIC, sizeof(h->magic)) != 0)
+    bad = "not a shard (bad magic)";
+  else if (h->version != SHARD_VERSION)
+    bad = "unsupported shard version";
+  else if (h->header_size != sizeof(ShardHeader) || h->image_stride != sizeof(ShardImage) ||
+           h->object_stride != sizeof(ShardObject))
+    bad = "unexpected table layout";
+  else if (h->file_size != map->size)
+    bad = "truncated shard";
+  else if ((h->images_offset | h->objects_offset | h->names_offset) % 8)
+    bad = "misaligned tables";
+  else if (h->data_offset < sizeof(ShardHeader) || h->images_offset < h->data_offset ||
+           !fits(h->images_offset, h->num_images, sizeof(ShardImage), map->size) ||
+           !fits(h->objects_offset, h->num_objects, sizeof(ShardObject), map->size) ||
+           h->names_offset > map->size)
+    bad = "table out of bounds";
+
+  if (!bad) {
+    const uint8_t* p = (const uint8_t*)base;
+    map->header = h;
+    map->data = p + h->data_offset;
+    map->images = (const ShardImage*)(p + h->images_offset);
+    map->objects = (const ShardObject*)(p + h->objects_offset);
+    map->names = (const char*)(p + h->names_offset);
+
+    // every slice must stay inside its section, so that readers never fault
+    uint64_t data_size = h->images_offset - h->data_offset;
+    uint64_t names_size = map->size - h->names_offset;
+    for (uint64_t i = 0; i < h->num_images && !bad; ++i) {
+      const ShardImage& im = map->images[i];
+      if (im.data_offset > data_size || im.data_size > data_size - im.data_offset ||
+          (uint64_t)im.first_object + im.num_objects > h->num_objects ||
+          (uint64_t)im.name_offset + im.name_size > names_size)
+        bad = "image entry out of bounds";
+    }
+  }
+  if (bad) {
+    _shard_close(map);
+    setError(err, err_size, "%s: %s", path, bad);
+    return 0;
+  }
+
+  // the tables are read in full by every user, the images on demand
+  uint64_t tables = h->images_offset & ~(uint64_t)(sysconf(_SC_PAGESIZE) - 1);
+  madvise((uint8_t*)base + tables, map->size - tables, MADV_WILLNEED);
+  return 1;
+}
+
+void _shard_close(ShardMap* map) {
+  if (map->base) munmap(map->base, map->size);
+  memset(map, 0, sizeof(*map));
+}
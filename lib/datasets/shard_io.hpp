@@ -0,0 +1,100 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Packed dataset shards: the encoded images of an image set and their ground
+// truth in one file, read through mmap without parsing or copying.
+//
+// Layout (little endian, tables 64 byte aligned):
+//   ShardHeader
+//   image data       encoded images as they were on disk, concatenated
+//   ShardImage[]     index: name, data slice, size and objects of each image
+//   ShardObject[]    annotation table with a fixed stride, image by image
+//   names            image index names, concatenated without separators
+//
+// The data comes first so that the writer streams images straight to disk
+// and only keeps the (small) tables until _shard_finish. The header is written
+// last and the file renamed into place, so a shard is either complete or
+// absent.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHARD_MAGIC "TSSHARD"      // 8 bytes with the terminating 0
+#define SHARD_VERSION 1
+
+struct ShardHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;        // sizeof(ShardHeader)
+  uint32_t image_stride;       // sizeof(ShardImage)
+  uint32_t object_stride;      // sizeof(ShardObject)
+  uint64_t num_images;
+  uint64_t num_objects;
+  uint64_t data_offset;        // file offsets of the sections
+  uint64_t images_offset;
+  uint64_t objects_offset;
+  uint64_t names_offset;
+  uint64_t file_size;
+  uint8_t reserved[48];
+};
+
+struct ShardImage {
+  uint64_t data_offset;        // relative to ShardHeader::data_offset
+  uint64_t data_size;
+  uint32_t first_object;       // row in the annotation table
+  uint32_t num_objects;
+  uint32_t name_offset;        // relative to ShardHeader::names_offset
+  uint32_t name_size;
+  uint16_t width;              // 0 if unknown
+  uint16_t height;
+  uint32_t reserved;
+};
+
+struct ShardObject {
+  uint16_t box[4];             // x1 y1 x2 y2, 0-based pixels as in the roidb
+  int32_t cls;                 // class index
+  uint8_t difficult;
+  uint8_t reserved[3];
+};
+
+// A mapped shard; the pointers are valid until _shard_close.
+struct ShardMap {
+  void* base;
+  uint64_t size;
+  const ShardHeader* header;
+  const uint8_t* data;
+  const ShardImage* images;
+  const ShardObject* objects;
+  const char* names;
+};
+
+struct ShardWriter;
+
+// Creates path + ".tmp" for writing. Returns 0 and describes the failure in
+// err (err_size bytes) if the file cannot be created.
+ShardWriter* _shard_create(const char* path, char* err, size_t err_size);
+
+// Appends an image with num_objects rows of boxes (x1 y1 x2 y2), classes and
+// difficult flags (0 for none). Returns 0 on failure, see _shard_error.
+int _shard_add(ShardWriter* w, const char* name, size_t name_size,
+               const uint8_t* data, uint64_t data_size, int width, int height,
+               const uint16_t* boxes, const int32_t* classes,
+               const uint8_t* difficult, int num_objects);
+
+// Writes the tables and the header and renames the file into place. The
+// writer is freed either way; returns 0 on failure.
+int _shard_finish(ShardWriter* w, char* err, size_t err_size);
+
+// Drops the temporary file and frees the writer.
+void _shard_abort(ShardWriter* w);
+
+const char* _shard_error(const ShardWriter* w);
+
+// Maps a shard read-only and checks that every table and slice lies inside
+// the file. Returns 0 and describes the failure in err on error.
+int _shard_open(const char* path, ShardMap* map, char* err, size_t err_size);
+
+void _shard_close(ShardMap* map);
@@ -6,6 +6,7 @@
 # --------------------------------------------------------
 
 import os
+import io
 from datasets.imdb import imdb
 import datasets.ds_utils as ds_utils
 import xml.etree.ElementTree as ET
@@ -16,17 +17,25 @@ import utils.cython_bbox
 import cPickle
 import subprocess
 import uuid
-from traffic_eval import traffic_eval
+import cv2
+import PIL.Image
+from traffic_eval import traffic_eval, traffic_eval_classes
 from fast_rcnn.config import cfg
 
 class traffic(imdb):
-    def __init__(self, image_set, devkit_path=None):
+    def __init__(self, image_set, devkit_path=None, shard_path=None,
+                 use_shard=True):
         imdb.__init__(self, image_set)
         self._year = '2016'
         self._image_set = image_set
         self._devkit_path = self._get_default_path() if devkit_path is None \
                             else devkit_path
         self._data_path = os.path.join(self._devkit_path, 'data')
+        # Images and annotations come from a packed shard (tools/build_shard.py)
+        # if there is one, else from the Images / Annotations directories
+        self._shard_path = self._get_default_shard_path() \
+                           if shard_path is None else shard_path
+        self._shard = self._open_shard() if use_shard else None
         self._classes = ('__background__', # always index 0
                             '00000','00001','00002','00003','00004','00005','00006',
                             '00007','00008','00009','00010','00011','00012','00013',
@@ -49,13 +58,31 @@ class traffic(imdb):
                        'use_diff'    : False,
                        'matlab_eval' : False,
                        'rpn_file'    : None,
-                       'min_size'    : 2}
+                       'min_size'    : 2,
+                       'native_eval' : True}
 
         assert os.path.exists(self._devkit_path), \
                 'VOCdevkit path does not exist: {}'.format(self._devkit_path)
         assert os.path.exists(self._data_path), \
                 'Path does not exist: {}'.format(self._data_path)
 
+    def _get_default_shard_path(self):
+        return os.path.join(self._data_path, 'Shards',
+                            self._image_set + '.shard')
+
+    @property
+    def shard_path(self):
+        return self._shard_path
+
+    def _open_shard(self):
+        if not os.path.exists(self._shard_path):
+            return None
+        from datasets.cython_shard import Shard
+        shard = Shard(self._shard_path)
+        print '{} images and annotations mapped from {}'.format(
+            len(shard), self._shard_path)
+        return shard
+
     def image_path_at(self, i):
         """
         Return the absolute path to image i in the image sequence.
@@ -65,17 +92,61 @@ class traffic(imdb):
     def image_path_from_index(self, index):
         """
         Construct an image path from the image's "index" identifier.
+        With a shard the file is not looked at; read the image through
+        image_at / image_source_at, which take it from the shard.
         """
         image_path = os.path.join(self._data_path, 'Images',
                                   index + self._image_ext)
-        assert os.path.exists(image_path), \
-                'Path does not exist: {}'.format(image_path)
+        if self._shard is None:
+            assert os.path.exists(image_path), \
+                    'Path does not exist: {}'.format(image_path)
         return image_path
 
+    def image_at(self, i):
+        """
+        Return image i, decoded as BGR.
+        """
+        if self._shard is None:
+            return imdb.image_at(self, i)
+        return cv2.imdecode(self._shard.image_data(i % len(self._shard)),
+                            cv2.IMREAD_COLOR)
+
+    def image_source_at(self, i):
+        """
+        Return the encoded image i as a view of the shard, or its path.
+        """
+        if self._shard is None:
+            return imdb.image_source_at(self, i)
+        return self._shard.image_data(i % len(self._shard))
+
+    def image_sizes(self):
+        """
+        Return (width, height) of every image from the shard index; images
+        packed without a size have it read from their encoded header.
+        None without a shard or with an empty one.
+        """
+        if self._shard is None or len(self._shard) == 0:
+            return imdb.image_sizes(self)
+        images = self._shard.images
+        sizes = zip(images['width'].tolist(), images['height'].tolist())
+        for i, (width, height) in enumerate(sizes):
+            if not width or not height:
+                sizes[i] = PIL.Image.open(
+                    io.BytesIO(self._shard.image_data(i).tobytes())).size
+        return sizes * (self.num_images // len(sizes))
+
+    def _get_widths(self):
+        sizes = self.image_sizes()
+        if sizes is None:
+            return imdb._get_widths(self)
+        return [width for width, height in sizes]
+
     def _load_image_set_index(self):
         """
         Load the indexes listed in this dataset's image set file.
         """
+        if self._shard is not None:
+            return self._shard.names()
         # Example path to image set file:
         # self._devkit_path + /VOCdevkit2007/VOC2007/ImageSets/Main/val.txt
         image_set_file = os.path.join(self._data_path, 'ImageSets',
@@ -97,7 +168,11 @@ class traffic(imdb):
         Return the database of ground-truth regions of interest.
 
         This function loads/saves from/to a cache file to speed up future calls.
+        A shard needs no cache, its annotation table is used in place.
         """
+        if self._shard is not None:
+            return self._load_shard_roidb()
+
         cache_file = os.path.join(self.cache_path, self.name + '_gt_roidb.pkl')
         if os.path.exists(cache_file):
             with open(cache_file, 'rb') as fid:
@@ -225,6 +300,96 @@ class traffic(imdb):
                 'flipped' : False,
                 'seg_areas' : seg_areas}
 
+    def load_traffic_objects(self, index):
+        """
+        Load every object of an image, difficult or not, and the image size
+        from its XML file (used to build shards).
+
+        Returns boxes (N, 4) 0-based, gt_classes (N,), difficult (N,), width
+        and height (0 if the file has no size).
+        """
+        filename = os.path.join(self._data_path, 'Annotations', index + '.xml')
+        tree = ET.parse(filename)
+        objs = tree.findall('object')
+        boxes = np.zeros((len(objs), 4), dtype=np.uint16)
+        gt_classes = np.zeros((len(objs)), dtype=np.int32)
+        difficult = np.zeros((len(objs)), dtype=np.uint8)
+        for ix, obj in enumerate(objs):
+            bbox = obj.find('bndbox')
+            # Make pixel indexes 0-based
+            boxes[ix, :] = [float(bbox.find(k).text) - 1
+                            for k in ('xmin', 'ymin', 'xmax', 'ymax')]
+            gt_classes[ix] = \
+                self._class_to_ind[obj.find('name').text.lower().strip()]
+            difficult[ix] = int(obj.find('difficult').text)
+        size = tree.find('size')
+        width = int(size.find('width').text) if size is not None else 0
+        height = int(size.find('height').text) if size is not None else 0
+        return boxes, gt_classes, difficult, width, height
+
+    def gt_objects(self):
+        """
+        The gt of every image including difficult objects, which the gt
+        roidb drops unless use_diff is set.
+        """
+        if self._shard is not None:
+            objs = self._shard.objects
+            images = self._shard.images
+            gt = []
+            for first, num in zip(images['first_object'].tolist(),
+                                  images['num_objects'].tolist()):
+                rows = slice(first, first + num)
+                gt.append({'boxes': objs['box'][rows],
+                           'gt_classes': objs['cls'][rows],
+                           'difficult': objs['difficult'][rows]})
+            return gt
+        gt = []
+        for index in self.image_index:
+            boxes, gt_classes, difficult, _, _ = \
+                self.load_traffic_objects(index)
+            gt.append({'boxes': boxes, 'gt_classes': gt_classes,
+                       'difficult': difficult})
+        return gt
+
+    def _load_shard_roidb(self):
+        """
+        Build the gt roidb from the annotation table of the shard. Boxes and
+        classes are read-only views of the mapped file unless difficult
+        objects have to be dropped.
+        """
+        images = self._shard.images
+        objs = self._shard.objects
+        all_boxes = objs['box']
+        all_classes = objs['cls']
+        x = all_boxes.astype(np.float32)
+        all_areas = (x[:, 2] - x[:, 0] + 1) * (x[:, 3] - x[:, 1] + 1)
+        keep = None
+        if not self.config['use_diff'] and objs['difficult'].any():
+            keep = objs['difficult'] == 0
+
+        roidb = []
+        for first, num in zip(images['first_object'].tolist(),
+                              images['num_objects'].tolist()):
+            rows = slice(first, first + num)
+            boxes = all_boxes[rows]
+            gt_classes = all_classes[rows]
+            seg_areas = all_areas[rows]
+            if keep is not None:
+                k = keep[rows]
+                boxes, gt_classes, seg_areas = \
+                    boxes[k], gt_classes[k], seg_areas[k]
+            num_objs = len(gt_classes)
+            # one-hot rows, as _load_traffic_annotation builds them densely
+            overlaps = scipy.sparse.csr_matrix(
+                (np.ones(num_objs, dtype=np.float32), gt_classes,
+                 np.arange(num_objs + 1)), shape=(num_objs, self.num_classes))
+            roidb.append({'boxes' : boxes,
+                          'gt_classes': gt_classes,
+                          'gt_overlaps' : overlaps,
+                          'flipped' : False,
+                          'seg_areas' : seg_areas})
+        return roidb
+
     def _get_comp_id(self):
         comp_id = (self._comp_id + '_' + self._salt if self.config['use_salt']
             else self._comp_id)
@@ -276,13 +441,19 @@ class traffic(imdb):
         print 'VOC07 metric? ' + ('Yes' if use_07_metric else 'No')
         if not os.path.isdir(output_dir):
             os.mkdir(output_dir)
-        for i, cls in enumerate(self._classes):
-            if cls == '__background__':
-                continue
-            filename = self._get_traffic_results_file_template().format(cls)
-            rec, prec, ap = traffic_eval(
-                filename, annopath, imagesetfile, cls, cachedir, ovthresh=0.5,
+        classes = [cls for cls in self._classes if cls != '__background__']
+        if self.config['native_eval']:
+            # all classes in one pass, matched natively in parallel
+            results = traffic_eval_classes(
+                self._get_traffic_results_file_template(), annopath,
+                imagesetfile, classes, cachedir, ovthresh=0.5,
                 use_07_metric=use_07_metric)
+        else:
+            results = [traffic_eval(
+                self._get_traffic_results_file_template().format(cls),
+                annopath, imagesetfile, cls, cachedir, ovthresh=0.5,
+                use_07_metric=use_07_metric) for cls in classes]
+        for cls, (rec, prec, ap) in zip(classes, results):
             aps += [ap]
             print('AP for {} = {:.4f}'.format(cls, ap))
             with open(os.path.join(output_dir, cls + '_pr.pkl'), 'w') as f:
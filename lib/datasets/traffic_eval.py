@@ -61,6 +61,47 @@ def traffic_ap(rec, prec, use_07_metric=False):
         ap = np.sum((mrec[i + 1] - mrec[i]) * mpre[i + 1])
     return ap
 
+def _load_annotations(annopath, imagesetfile, cachedir):
+    """Image names of the image set and their parsed annotations, cached
+    in cachedir/annots.pkl."""
+    # first load gt
+    if not os.path.isdir(cachedir):
+        os.mkdir(cachedir)
+    cachefile = os.path.join(cachedir, 'annots.pkl')
+    # read list of images
+    with open(imagesetfile, 'r') as f:
+        lines = f.readlines()
+    imagenames = [x.strip() for x in lines]
+
+    if not os.path.isfile(cachefile):
+        # load annots
+        recs = {}
+        for i, imagename in enumerate(imagenames):
+            recs[imagename] = parse_rec(annopath.format(imagename))
+            if i % 100 == 0:
+                print 'Reading annotation for {:d}/{:d}'.format(
+                    i + 1, len(imagenames))
+        # save
+        print 'Saving cached annotations to {:s}'.format(cachefile)
+        with open(cachefile, 'w') as f:
+            cPickle.dump(recs, f)
+    else:
+        # load
+        with open(cachefile, 'r') as f:
+            recs = cPickle.load(f)
+    return imagenames, recs
+
+def _read_detections(detfile):
+    """Image ids, confidences and (N, 4) boxes of a detection results file."""
+    with open(detfile, 'r') as f:
+        lines = f.readlines()
+
+    splitlines = [x.strip().split(' ') for x in lines]
+    image_ids = [x[0] for x in splitlines]
+    confidence = np.array([float(x[1]) for x in splitlines])
+    BB = np.array([[float(z) for z in x[2:]] for x in splitlines])
+    return image_ids, confidence, BB
+
 def traffic_eval(detpath,
                  annopath,
                  imagesetfile,
@@ -93,31 +134,7 @@ def traffic_eval(detpath,
     # assumes imagesetfile is a text file with each line an image name
     # cachedir caches the annotations in a pickle file
 
-    # first load gt
-    if not os.path.isdir(cachedir):
-        os.mkdir(cachedir)
-    cachefile = os.path.join(cachedir, 'annots.pkl')
-    # read list of images
-    with open(imagesetfile, 'r') as f:
-        lines = f.readlines()
-    imagenames = [x.strip() for x in lines]
-
-    if not os.path.isfile(cachefile):
-        # load annots
-        recs = {}
-        for i, imagename in enumerate(imagenames):
-            recs[imagename] = parse_rec(annopath.format(imagename))
-            if i % 100 == 0:
-                print 'Reading annotation for {:d}/{:d}'.format(
-                    i + 1, len(imagenames))
-        # save
-        print 'Saving cached annotations to {:s}'.format(cachefile)
-        with open(cachefile, 'w') as f:
-            cPickle.dump(recs, f)
-    else:
-        # load
-        with open(cachefile, 'r') as f:
-            recs = cPickle.load(f)
+    imagenames, recs = _load_annotations(annopath, imagesetfile, cachedir)
 
     # extract gt objects for this class
     class_recs = {}
@@ -133,14 +150,7 @@ def traffic_eval(detpath,
                                  'det': det}
 
     # read dets
-    detfile = detpath.format(classname)
-    with open(detfile, 'r') as f:
-        lines = f.readlines()
-
-    splitlines = [x.strip().split(' ') for x in lines]
-    image_ids = [x[0] for x in splitlines]
-    confidence = np.array([float(x[1]) for x in splitlines])
-    BB = np.array([[float(z) for z in x[2:]] for x in splitlines])
+    image_ids, confidence, BB = _read_detections(detpath.format(classname))
 
     # sort by confidence
     sorted_ind = np.argsort(-confidence)
@@ -198,3 +208,73 @@ def traffic_eval(detpath,
     ap = traffic_ap(rec, prec, use_07_metric)
 
     return rec, prec, ap
+
+def traffic_eval_classes(detpath,
+                         annopath,
+                         imagesetfile,
+                         classnames,
+                         cachedir,
+                         ovthresh=0.5,
+                         use_07_metric=False,
+                         threads=0):
+    """[(rec, prec, ap)] = traffic_eval_classes(detpath,
+                                                annopath,
+                                                imagesetfile,
+                                                classnames,
+                                                cachedir,
+                                                [ovthresh],
+                                                [use_07_metric],
+                                                [threads])
+
+    traffic_eval for every class of classnames at once. The annotations are
+    read a single time and the TP/FP matching and AP run natively, one class
+    per thread ([threads] <= 0: one per core). Results are identical to
+    calling traffic_eval per class.
+    """
+    from datasets.cython_det_eval import eval_detections
+
+    imagenames, recs = _load_annotations(annopath, imagesetfile, cachedir)
+    class_ind = dict(zip(classnames, xrange(len(classnames))))
+
+    # flatten the gt of each image once, in annotation order
+    image_ind = {}
+    gt_boxes, gt_class, gt_image, gt_difficult = [], [], [], []
+    for imagename in imagenames:
+        if imagename in image_ind:
+            continue
+        image_ind[imagename] = len(image_ind)
+        for obj in recs[imagename]:
+            if obj['name'] not in class_ind:
+                continue
+            gt_boxes.append(obj['bbox'])
+            gt_class.append(class_ind[obj['name']])
+            gt_image.append(image_ind[imagename])
+            gt_difficult.append(obj['difficult'])
+    gt_boxes = np.array(gt_boxes, dtype=np.float64).reshape(-1, 4)
+    gt_class = np.array(gt_class, dtype=np.int32)
+    gt_image = np.array(gt_image, dtype=np.int32)
+    gt_difficult = np.array(gt_difficult, dtype=np.bool)
+
+    # npos counts an image once per occurrence in the image set, as
+    # traffic_eval does
+    count = np.bincount([image_ind[x] for x in imagenames],
+                        minlength=len(image_ind))
+    npos = np.bincount(gt_class, weights=count[gt_image] * ~gt_difficult,
+                       minlength=len(classnames)).astype(np.int32)
+
+    det_boxes, det_image, det_offs = [], [], [0]
+    for classname in classnames:
+        image_ids, confidence, BB = _read_detections(detpath.format(classname))
+        sorted_ind = np.argsort(-confidence)
+        det_boxes.append(BB.reshape(-1, 4)[sorted_ind, :])
+        det_image.append(np.array([image_ind[image_ids[x]]
+                                   for x in sorted_ind], dtype=np.int32))
+        det_offs.append(det_offs[-1] + len(sorted_ind))
+
+    rec, prec, ap = eval_detections(gt_boxes, gt_class, gt_image, gt_difficult,
+                                    npos, np.vstack(det_boxes),
+                                    np.hstack(det_image), det_offs,
+                                    ovthresh, use_07_metric, threads)
+    return [(rec[det_offs[i]:det_offs[i + 1]],
+             prec[det_offs[i]:det_offs[i + 1]], ap[i])
+            for i in xrange(len(classnames))]
@@ -78,6 +78,17 @@ __C.TRAIN.SNAPSHOT_INFIX = ''
 # So far I haven't found this useful; likely more engineering work is required
 __C.TRAIN.USE_PREFETCH = False
 
+# Load training images with the native loader (utils/image_loader_kernel.cpp):
+# worker threads decode, flip and scale images ahead of the solver, and flips
+# are drawn per iteration instead of doubling the roidb. RPN training only.
+__C.TRAIN.NATIVE_LOADER = False
+# Loader threads, 0 for one per core
+__C.TRAIN.LOADER_THREADS = 0
+# Images decoded ahead of the solver
+__C.TRAIN.LOADER_QUEUE = 8
+# MB of decoded, resized images kept in memory, 0 to decode every time
+__C.TRAIN.LOADER_CACHE_MB = 0
+
 # Normalize the targets (subtract empirical mean, divide by empirical stddev)
 __C.TRAIN.BBOX_NORMALIZE_TARGETS = True
 # Deprecated (inside weights)
@@ -126,10 +137,17 @@ __C.TRAIN.RPN_BBOX_INSIDE_WEIGHTS = (1.0, 1.0, 1.0, 1.0)
 # and give negatives a weight of (1 - p)
 # Set to -1.0 to use uniform example weighting
 __C.TRAIN.RPN_POSITIVE_WEIGHT = -1.0
+# Compute RPN anchor targets in C++ (rpn/anchor_target_kernel.cpp); gives the
+# same result as the Python layer for the same numpy random state
+__C.TRAIN.RPN_NATIVE_TARGETS = True
 
 # whether use class aware box or not
 __C.TRAIN.AGNOSTIC = False
 
+# Sample rois and expand their targets in C++ (rpn/proposal_target_kernel.cpp);
+# gives the same result as the Python layer for the same numpy random state
+__C.TRAIN.NATIVE_ROI_TARGETS = True
+
 #
 # Testing options
 #
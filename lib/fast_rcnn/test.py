@@ -224,8 +224,13 @@ def apply_nms(all_boxes, thresh):
             nms_boxes[cls_ind][im_ind] = dets[keep, :].copy()
     return nms_boxes
 
-def test_net(net, imdb, max_per_image=400, thresh=-np.inf, vis=False):
-    """Test a Fast R-CNN network on an image database."""
+def test_net(net, imdb, max_per_image=400, thresh=-np.inf, vis=False,
+             online_eval=None):
+    """Test a Fast R-CNN network on an image database.
+
+    online_eval: optional datasets.online_eval.OnlineEvaluator that is fed
+    every image against the imdb's gt and reports the running mAP.
+    """
     num_images = len(imdb.image_index)
     # all detections are collected into:
     #    all_boxes[cls][image] = N x 5 array of detections in
@@ -240,6 +245,9 @@ def test_net(net, imdb, max_per_image=400, thresh=-np.inf, vis=False):
 
     if not cfg.TEST.HAS_RPN:
         roidb = imdb.roidb
+    if online_eval is not None:
+        # difficult objects included: matching one is neither TP nor FP
+        gt_objects = imdb.gt_objects()
 
     for i in xrange(num_images):
         # filter out any ground truth boxes
@@ -253,7 +261,7 @@ def test_net(net, imdb, max_per_image=400, thresh=-np.inf, vis=False):
             # ground truth.
             box_proposals = roidb[i]['boxes'][roidb[i]['gt_classes'] == 0]
 
-        im = cv2.imread(imdb.image_path_at(i))
+        im = imdb.image_at(i)
         _t['im_detect'].tic()
         scores, boxes = im_detect(net, im, box_proposals)
         _t['im_detect'].toc()
@@ -284,11 +292,18 @@ def test_net(net, imdb, max_per_image=400, thresh=-np.inf, vis=False):
                 for j in xrange(1, imdb.num_classes):
                     keep = np.where(all_boxes[j][i][:, -1] >= image_thresh)[0]
                     all_boxes[j][i] = all_boxes[j][i][keep, :]
+        if online_eval is not None:
+            online_eval.update(gt_objects[i]['boxes'],
+                               gt_objects[i]['gt_classes'],
+                               [all_boxes[j][i] for j in xrange(imdb.num_classes)],
+                               gt_objects[i]['difficult'])
         _t['misc'].toc()
 
         print 'im_detect: {:d}/{:d} {:.3f}s {:.3f}s' \
               .format(i + 1, num_images, _t['im_detect'].average_time,
                       _t['misc'].average_time)
+        if online_eval is not None and (i + 1) % 100 == 0:
+            print 'running mAP: {:.4f}'.format(online_eval.mean_ap())
 
     det_file = os.path.join(output_dir, 'detections.pkl')
     with open(det_file, 'wb') as f:
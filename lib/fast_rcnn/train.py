@@ -51,6 +51,11 @@ class SolverWrapper(object):
             pb2.text_format.Merge(f.read(), self.solver_param)
 
         self.solver.net.layers[0].set_roidb(roidb)
+        if cfg.TRAIN.NATIVE_LOADER:
+            from utils.prefetch import PrefetchLoader
+            self.prefetch = PrefetchLoader(roidb)
+            self.solver.net.layers[0]._get_next_minibatch = \
+                    self.prefetch.next_minibatch
 
     def snapshot(self):
         """Take a snapshot of the network after unnormalizing the learned
@@ -147,6 +152,10 @@ class SolverWrapper(object):
             timer.toc()
             if self.solver.iter % (10 * self.solver_param.display) == 0:
                 print 'speed: {:.3f}s / iter'.format(timer.average_time)
+                if cfg.TRAIN.NATIVE_LOADER:
+                    print ('loader: {served} images, {cache_hits} cache hits, '
+                           '{decode_seconds:.1f}s decoding').format(
+                               **self.prefetch.stats())
 
             if self.solver.iter % cfg.TRAIN.SNAPSHOT_ITERS == 0:
                 last_snapshot_iter = self.solver.iter
@@ -158,13 +167,19 @@ class SolverWrapper(object):
 
 def get_training_roidb(imdb):
     """Returns a roidb (Region of Interest database) for use in training."""
-    if cfg.TRAIN.USE_FLIPPED:
+    # the native loader flips images itself
+    if cfg.TRAIN.USE_FLIPPED and not cfg.TRAIN.NATIVE_LOADER:
         print 'Appending horizontally-flipped training examples...'
         imdb.append_flipped_images()
         print 'done'
 
     print 'Preparing training data...'
-    rdl_roidb.prepare_roidb(imdb)
+    # sizes known to the imdb (e.g. from a dataset shard) save opening
+    # every image
+    rdl_roidb.prepare_roidb(imdb, sizes=imdb.image_sizes())
+    if cfg.TRAIN.NATIVE_LOADER:
+        for i, entry in enumerate(imdb.roidb):
+            entry['image_source'] = imdb.image_source_at(i)
     print 'done'
 
     return imdb.roidb
@@ -37,6 +37,8 @@ cdef extern from "maskApi.h":
         uint* cnts,
     void rlesInit( RLE **R, siz n )
     void rleEncode( RLE *R, const byte *M, siz h, siz w, siz n )
+    siz rleEncodeBatch( RLE *R, const byte *M, siz h, siz w, siz n, uint *arena, siz cap )
+    uint* rleFrIds( RLE *R, const uint *img, siz h, siz w, long s, const uint *ids, siz n )
     void rleDecode( const RLE *R, byte *mask, siz n )
     void rleMerge( const RLE *R, RLE *M, siz n, bint intersect )
     void rleArea( const RLE *R, siz n, uint *a )
@@ -45,24 +47,44 @@ cdef extern from "maskApi.h":
     void rleToBbox( const RLE *R, BB bb, siz n )
     void rleFrBbox( RLE *R, const BB bb, siz h, siz w, siz n )
     void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w )
+    ctypedef struct RleScratch:
+        void *p
+        siz n
+    void rleScratchFree( RleScratch *S )
+    void rleIouScratch( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o, RleScratch *S )
+    void rleFrPolyScratch( RLE *R, const double *xy, siz k, siz h, siz w, RleScratch *S )
     char* rleToString( const RLE *R )
     void rleFrString( RLE *R, char *s, siz h, siz w )
+    siz rleToStrings( const RLE *R, siz n, char *s )
+    siz rleFrStrings( const char *s, siz n, uint *cnts, siz *offs )
+
+# boxes and areas of iou() on RLEs, kept between calls; only used with the GIL held
+cdef RleScratch _iouScratch
+_iouScratch.p = NULL
+_iouScratch.n = 0
 
 # python class to wrap RLE array in C
 # the class handles the memory allocation and deallocation
 cdef class RLEs:
     cdef RLE *_R
     cdef siz _n
+    # counts of all RLEs in one block when filled by rleEncodeBatch or
+    # rleFrStrings
+    cdef uint *_arena
 
     def __cinit__(self, siz n =0):
         rlesInit(&self._R, n)
         self._n = n
+        self._arena = NULL
 
     # free the RLE array here
     def __dealloc__(self):
         if self._R is not NULL:
-            for i in range(self._n):
-                free(self._R[i].cnts)
+            if self._arena is not NULL:
+                free(self._arena)
+            else:
+                for i in range(self._n):
+                    free(self._R[i].cnts)
             free(self._R)
     def __getattr__(self, key):
         if key == 'n':
@@ -99,29 +121,55 @@ cdef class Masks:
 # internal conversion from Python RLEs object to compressed RLE format
 def _toString(RLEs Rs):
     cdef siz n = Rs.n
-    cdef bytes py_string
+    cdef siz cap = n
+    cdef siz p
     cdef char* c_string
+    if n == 0:
+        return []
+    for i in range(n):
+        cap += 7*Rs._R[i].m
+    # all strings are written into one buffer, NUL separated
+    c_string = <char*> malloc(cap)
+    try:
+        p = rleToStrings( <RLE*> Rs._R, n, c_string )
+        py_strings = c_string[:p-1].split(b'\0')
+    finally:
+        free(c_string)
     objs = []
     for i in range(n):
-        c_string = rleToString( <RLE*> &Rs._R[i] )
-        py_string = c_string
         objs.append({
             'size': [Rs._R[i].h, Rs._R[i].w],
-            'counts': py_string
+            'counts': py_strings[i]
         })
-        free(c_string)
     return objs
 
 # internal conversion from compressed RLE format to Python RLEs object
 def _frString(rleObjs):
     cdef siz n = len(rleObjs)
-    Rs = RLEs(n)
-    cdef bytes py_string
-    cdef char* c_string
-    for i, obj in enumerate(rleObjs):
-        py_string = str(obj['counts'])
-        c_string = py_string
-        rleFrString( <RLE*> &Rs._R[i], <char*> c_string, obj['size'][0], obj['size'][1] )
+    cdef RLEs Rs = RLEs(n)
+    cdef bytes packed
+    cdef siz* offs
+    cdef siz i = 0
+    strings = []
+    for obj in rleObjs:
+        size = obj['size']
+        Rs._R[i].h = size[0]
+        Rs._R[i].w = size[1]
+        strings.append(str(obj['counts']))
+        i += 1
+    # the strings NUL terminated back to back, decoded in one call into a
+    # single counts block owned by Rs; a string holds at most one count per char
+    packed = b'\0'.join(strings) + b'\0'
+    Rs._arena = <uint*> malloc(len(packed)*sizeof(uint))
+    offs = <siz*> malloc((n+1)*sizeof(siz))
+    if Rs._arena is NULL or offs is NULL:
+        free(offs)
+        raise MemoryError()
+    rleFrStrings( <char*> packed, n, Rs._arena, offs )
+    for i in range(n):
+        Rs._R[i].cnts = Rs._arena+offs[i]
+        Rs._R[i].m = offs[i+1]-offs[i]
+    free(offs)
     return Rs
 
 # encode mask to RLEs objects
@@ -129,7 +177,15 @@ def _frString(rleObjs):
 def encode(np.ndarray[np.uint8_t, ndim=3, mode='fortran'] mask):
     h, w, n = mask.shape[0], mask.shape[1], mask.shape[2]
     cdef RLEs Rs = RLEs(n)
-    rleEncode(Rs._R,<byte*>mask.data,h,w,n)
+    # one counts block for all masks; two counts per column is enough for
+    # most instance masks, otherwise grow to the exact size and redo
+    cdef siz cap = n*(2*w+2), need
+    Rs._arena = <uint*> malloc(cap* sizeof(uint))
+    need = rleEncodeBatch(Rs._R,<byte*>mask.data,h,w,n,Rs._arena,cap)
+    if need > cap:
+        free(Rs._arena)
+        Rs._arena = <uint*> malloc(need* sizeof(uint))
+        rleEncodeBatch(Rs._R,<byte*>mask.data,h,w,n,Rs._arena,need)
     objs = _toString(Rs)
     return objs
 
@@ -187,7 +243,7 @@ def iou( dt, gt, pyiscrowd ):
             raise Exception('unrecognized type.  The following type: RLEs (rle), np.ndarray (box), and list (box) are supported.')
         return objs
     def _rleIou(RLEs dt, RLEs gt, np.ndarray[np.uint8_t, ndim=1] iscrowd, siz m, siz n, np.ndarray[np.double_t,  ndim=1] _iou):
-        rleIou( <RLE*> dt._R, <RLE*> gt._R, m, n, <byte*> iscrowd.data, <double*> _iou.data )
+        rleIouScratch( <RLE*> dt._R, <RLE*> gt._R, m, n, <byte*> iscrowd.data, <double*> _iou.data, &_iouScratch )
     def _bbIou(np.ndarray[np.double_t, ndim=2] dt, np.ndarray[np.double_t, ndim=2] gt, np.ndarray[np.uint8_t, ndim=1] iscrowd, siz m, siz n, np.ndarray[np.double_t, ndim=1] _iou):
         bbIou( <BB> dt.data, <BB> gt.data, m, n, <byte*> iscrowd.data, <double*>_iou.data )
     def _len(obj):
@@ -251,11 +307,17 @@ def frBbox(np.ndarray[np.double_t, ndim=2] bb, siz h, siz w ):
 
 def frPoly( poly, siz h, siz w ):
     cdef np.ndarray[np.double_t, ndim=1] np_poly
+    cdef RleScratch S
+    S.p = NULL
+    S.n = 0
     n = len(poly)
     Rs = RLEs(n)
-    for i, p in enumerate(poly):
-        np_poly = np.array(p, dtype=np.double, order='F')
-        rleFrPoly( <RLE*>&Rs._R[i], <const double*> np_poly.data, len(np_poly)/2, h, w )
+    try:
+        for i, p in enumerate(poly):
+            np_poly = np.array(p, dtype=np.double, order='F')
+            rleFrPolyScratch( <RLE*>&Rs._R[i], <const double*> np_poly.data, len(np_poly)/2, h, w, &S )
+    finally:
+        rleScratchFree(&S)
     objs = _toString(Rs)
     return objs
 
@@ -277,6 +339,19 @@ def frUncompressedRLE(ucRles, siz h, siz w):
         objs.append(_toString(Rs)[0])
     return objs
 
+# encode the instance masks of an id image (hxw uint32, e.g. the object id
+# buffer of the IG) in one pass over its pixels; mask i holds the pixels equal
+# to ids[i]. Row-strided views (e.g. flipud) are read in place.
+def frIds(np.ndarray[np.uint32_t, ndim=2] idimg, ids):
+    cdef np.ndarray[np.uint32_t, ndim=1] _ids = np.ascontiguousarray(ids, dtype=np.uint32).reshape(-1)
+    cdef siz n = _ids.shape[0]
+    cdef RLEs Rs = RLEs(n)
+    if idimg.strides[1] != sizeof(uint):
+        idimg = np.ascontiguousarray(idimg)
+    Rs._arena = rleFrIds(Rs._R, <uint*> idimg.data, idimg.shape[0], idimg.shape[1],
+                         idimg.strides[0] // <long> sizeof(uint), <uint*> _ids.data, n)
+    return _toString(Rs)
+
 def frPyObjects(pyobj, siz h, w):
     if type(pyobj) == np.ndarray:
         objs = frBbox(pyobj, h, w )
@@ -35,6 +35,7 @@ import pycocotools._mask as _mask
 #  area           - Compute area of encoded masks.
 #  toBbox         - Get bounding boxes surrounding encoded masks.
 #  frPyObjects    - Convert polygon, bbox, and uncompressed RLE to encoded RLE mask.
+#  frIds          - Encode the instance masks of an object id image.
 #
 # Usage:
 #  Rs     = encode( masks )
@@ -44,11 +45,14 @@ import pycocotools._mask as _mask
 #  a      = area( Rs )
 #  bbs    = toBbox( Rs )
 #  Rs     = frPyObjects( [pyObjects], h, w )
+#  Rs     = frIds( idimg, ids )
 #
 # In the API the following formats are used:
 #  Rs      - [dict] Run-length encoding of binary masks
 #  R       - dict Run-length encoding of binary mask
 #  masks   - [hxwxn] Binary mask(s) (must have type np.ndarray(dtype=uint8) in column-major order)
+#  idimg   - [hxw] Object id per pixel (np.ndarray(dtype=uint32), row-major as rendered)
+#  ids     - [n] Object ids whose masks are wanted
 #  iscrowd - [nx1] list of np.ndarray. 1 indicates corresponding gt image has crowd region to ignore
 #  bbs     - [nx4] Bounding box(es) stored as [x y w h]
 #  poly    - Polygon stored as [[x1 y1 x2 y2...],[x1 y1 ...],...] (2D list)
@@ -79,4 +83,5 @@ iou         = _mask.iou
 merge       = _mask.merge
 area        = _mask.area
 toBbox      = _mask.toBbox
-frPyObjects = _mask.frPyObjects
\ No newline at end of file
+frPyObjects = _mask.frPyObjects
+frIds       = _mask.frIds
\ No newline at end of file
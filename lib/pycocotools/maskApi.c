@@ -5,8 +5,15 @@
 * Licensed under the Simplified BSD License [see coco/license.txt]
 **************************************************************************/
 #include "maskApi.h"
+#include "iou_engine.h"
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RLE_AVX2
+#endif
 
 uint umin( uint a, uint b ) { return (a<b) ? a : b; }
 uint umax( uint a, uint b ) { return (a>b) ? a : b; }
@@ -29,21 +36,130 @@ void rlesFree( RLE **R, siz n ) {
   for(siz i=0; i<n; i++) rleFree((*R)+i); free(*R); *R=0;
 }
 
+static siz rleRunsScalar( const byte *T, siz a, uint *cnts ) {
+  siz j, k=0, s=0; byte p=0;
+  for( j=0; j<a; j++ ) if(T[j]!=p) { cnts[k++]=(uint)(j-s); s=j; p=T[j]; }
+  cnts[k++]=(uint)(a-s); return k;
+}
+
+#ifdef RLE_AVX2
+__attribute__((target("avx2")))
+static siz rleRunsAvx2( const byte *T, siz a, uint *cnts ) {
+  // a run starts at j whenever T[j]!=T[j-1] (T[-1]=0); compare 32 bytes
+  // against the same bytes shifted by one and visit the set bits
+  siz j=1, k=0, s=0;
+  if(a>0 && T[0]) cnts[k++]=0;
+  for( ; j+32<=a; j+=32 ) {
+    __m256i x=_mm256_loadu_si256((const __m256i*)(T+j));
+    __m256i y=_mm256_loadu_si256((const __m256i*)(T+j-1));
+    uint d=~(uint)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x,y));
+    while( d ) { siz b=j+__builtin_ctz(d); cnts[k++]=(uint)(b-s); s=b; d&=d-1; }
+  }
+  for( ; j<a; j++ ) if(T[j]!=T[j-1]) { cnts[k++]=(uint)(j-s); s=j; }
+  cnts[k++]=(uint)(a-s); return k;
+}
+#endif
+
+// Run lengths of one mask of a pixels; writes at most a+1 counts.
+static siz rleRuns( const byte *T, siz a, uint *cnts ) {
+#ifdef RLE_AVX2
+  static int avx2=-1; if(avx2<0) avx2=__builtin_cpu_supports("avx2");
+  if(avx2) return rleRunsAvx2(T,a,cnts);
+#endif
+  return rleRunsScalar(T,a,cnts);
+}
+
 void rleEncode( RLE *R, const byte *M, siz h, siz w, siz n ) {
-  siz i, j, k, a=w*h; uint c, *cnts; byte p;
+  siz i, k, a=w*h; uint *cnts;
   cnts = malloc(sizeof(uint)*(a+1));
+  for(i=0; i<n; i++) { k=rleRuns(M+a*i,a,cnts); rleInit(R+i,h,w,k,cnts); }
+  free(cnts);
+}
+
+siz rleEncodeBatch( RLE *R, const byte *M, siz h, siz w, siz n, uint *arena, siz cap ) {
+  siz i, k, a=w*h, p=0; uint *tmp=0;
   for(i=0; i<n; i++) {
-    const byte *T=M+a*i; k=0; p=0; c=0;
-    for(j=0; j<a; j++) { if(T[j]!=p) { cnts[k++]=c; c=0; p=T[j]; } c++; }
-    cnts[k++]=c; rleInit(R+i,h,w,k,cnts);
+    const byte *T=M+a*i; uint *cnts=arena+p;
+    if(p>cap || cap-p<a+1) {
+      // may not fit: encode aside, keep it if it does
+      if(!tmp) tmp=malloc(sizeof(uint)*(a+1));
+      k=rleRuns(T,a,tmp);
+      if(p<=cap && k<=cap-p) memcpy(cnts,tmp,sizeof(uint)*k); else cnts=0;
+    } else k=rleRuns(T,a,cnts);
+    R[i].h=h; R[i].w=w; R[i].m=cnts?k:0; R[i].cnts=cnts; p+=k;
   }
-  free(cnts);
+  free(tmp); return p;
+}
+
+typedef struct { uint slot, len; siz start; } RleIdRun;
+
+uint* rleFrIds( RLE *R, const uint *img, siz h, siz w, long s, const uint *ids, siz n ) {
+  // runs of equal ids are found column by column in tiles of 16 columns that
+  // are first copied out row by row; every run of a requested id is looked up
+  // once (open addressing on the id) and kept in a run list, from which the
+  // counts of all masks are written into one block
+  enum { TW=16 }; siz a=h*w, nh=16, i, j, x, c, y, nr=0, cr=1024, p;
+  uint *hk, *hs, *T, *cnts, v, slot; siz *last, *k, *o; RleIdRun *runs;
+  while( nh<2*n ) nh*=2;
+  hk=malloc(sizeof(uint)*nh); hs=malloc(sizeof(uint)*nh);
+  last=calloc(n+1,sizeof(siz)); k=calloc(n+1,sizeof(siz)); o=malloc(sizeof(siz)*(n+1));
+  T=malloc(sizeof(uint)*(h*TW+1)); runs=malloc(sizeof(RleIdRun)*cr);
+  for( j=0; j<nh; j++ ) hs[j]=0;
+  for( i=0; i<n; i++ ) {
+    j=(ids[i]*2654435761u)&(nh-1);
+    while( hs[j] && hk[j]!=ids[i] ) j=(j+1)&(nh-1);
+    if(!hs[j]) { hk[j]=ids[i]; hs[j]=(uint)(i+1); }
+  }
+  for( x=0; x<w; x+=TW ) {
+    siz tw = w-x<TW ? w-x : TW;
+    for( y=0; y<h; y++ ) {
+      const uint *row=img+(long)y*s+x;
+      for( c=0; c<tw; c++ ) T[c*h+y]=row[c];
+    }
+    for( c=0; c<tw; c++ ) {
+      const uint *col=T+c*h; siz b=(x+c)*h;
+      for( y=0; y<h; y=j ) {
+        v=col[y]; for( j=y+1; j<h && col[j]==v; j++ );
+        p=(v*2654435761u)&(nh-1);
+        while( hs[p] && hk[p]!=v ) p=(p+1)&(nh-1);
+        if(!hs[p]) continue;
+        slot=hs[p]-1;
+        // a run that continues the previous one of the id (across the column
+        // boundary) only lengthens its last count
+        if(k[slot]==0 || last[slot]!=b+y) k[slot]+=2;
+        last[slot]=b+j;
+        if(nr==cr) { cr*=2; runs=realloc(runs,sizeof(RleIdRun)*cr); }
+        runs[nr].slot=slot; runs[nr].len=(uint)(j-y); runs[nr].start=b+y; nr++;
+      }
+    }
+  }
+  for( i=0, p=0; i<n; i++ ) { o[i]=p; p+=k[i]+(last[i]<a || k[i]==0 ? 1 : 0); }
+  o[n]=p; cnts=malloc(sizeof(uint)*(p?p:1));
+  for( i=0; i<n; i++ ) { k[i]=0; last[i]=0; }
+  for( j=0; j<nr; j++ ) {
+    uint *C=cnts+o[runs[j].slot]; siz *m=k+runs[j].slot, *e=last+runs[j].slot;
+    if(*m && *e==runs[j].start) C[*m-1]+=runs[j].len;
+    else { C[(*m)++]=(uint)(runs[j].start-*e); C[(*m)++]=runs[j].len; }
+    *e=runs[j].start+runs[j].len;
+  }
+  for( i=0; i<n; i++ ) {
+    if(last[i]<a || k[i]==0) cnts[o[i]+k[i]++]=(uint)(a-last[i]);
+    R[i].h=h; R[i].w=w; R[i].m=k[i]; R[i].cnts=cnts+o[i];
+  }
+  // repeated ids share the counts of their first occurrence
+  for( i=0; i<n; i++ ) {
+    j=(ids[i]*2654435761u)&(nh-1);
+    while( hk[j]!=ids[i] ) j=(j+1)&(nh-1);
+    if(hs[j]-1!=i) R[i]=R[hs[j]-1];
+  }
+  free(hk); free(hs); free(last); free(k); free(o); free(T); free(runs);
+  return cnts;
 }
 
 void rleDecode( const RLE *R, byte *M, siz n ) {
   for( siz i=0; i<n; i++ ) {
     byte v=0; for( siz j=0; j<R[i].m; j++ ) {
-      for( siz k=0; k<R[i].cnts[j]; k++ ) *(M++)=v; v=!v; }}
+      memset(M,v,R[i].cnts[j]); M+=R[i].cnts[j]; v=!v; }}
 }
 
 void rleMerge( const RLE *R, RLE *M, siz n, bool intersect ) {
@@ -74,13 +190,22 @@ void rleArea( const RLE *R, siz n, uint *a ) {
     a[i]=0; for( siz j=1; j<R[i].m; j+=2 ) a[i]+=R[i].cnts[j]; }
 }
 
-void rleIou( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o ) {
-  siz g, d; BB db, gb; bool crowd;
-  db=malloc(sizeof(double)*m*4); rleToBbox(dt,db,m);
-  gb=malloc(sizeof(double)*n*4); rleToBbox(gt,gb,n);
-  bbIou(db,gb,m,n,iscrowd,o); free(db); free(gb);
-  for( g=0; g<n; g++ ) for( d=0; d<m; d++ ) if(o[g*m+d]>0) {
-    crowd=iscrowd!=NULL && iscrowd[g];
+void rleScratchFree( RleScratch *S ) {
+  free(S->p); S->p=0; S->n=0;
+}
+
+static void *rleScratchGet( RleScratch *S, siz n ) {
+  // grows like realloc, so the head of the scratch survives a resize
+  if(n>S->n) { S->p=realloc(S->p,n); S->n=n; } return S->p;
+}
+
+typedef struct { RLE *dt, *gt; siz m; byte *iscrowd; double *o; uint *area; } RleIouJob;
+
+static void rleIouRows( void *job, size_t g0, size_t g1 ) {
+  RleIouJob *J=(RleIouJob*) job; RLE *dt=J->dt, *gt=J->gt;
+  siz g, d, m=J->m; double *o=J->o; bool crowd;
+  for( g=g0; g<g1; g++ ) for( d=0; d<m; d++ ) if(o[g*m+d]>0) {
+    crowd=J->iscrowd!=NULL && J->iscrowd[g];
     if(dt[d].h!=gt[g].h || dt[d].w!=gt[g].w) { o[g*m+d]=-1; continue; }
     siz ka, kb, a, b; uint c, ca, cb, ct, i, u; bool va, vb;
     ca=dt[d].cnts[0]; ka=dt[d].m; va=vb=0;
@@ -90,22 +215,31 @@ void rleIou( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o ) {
       ca-=c; if(!ca && a<ka) { ca=dt[d].cnts[a++]; va=!va; } ct+=ca;
       cb-=c; if(!cb && b<kb) { cb=gt[g].cnts[b++]; vb=!vb; } ct+=cb;
     }
-    if(i==0) u=1; else if(crowd) rleArea(dt+d,1,&u);
+    if(i==0) u=1; else if(crowd) u=J->area[d];
     o[g*m+d] = (double)i/(double)u;
   }
 }
 
+void rleIou( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o ) {
+  RleScratch S={0,0}; rleIouScratch(dt,gt,m,n,iscrowd,o,&S); rleScratchFree(&S);
+}
+
+void rleIouScratch( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o, RleScratch *S ) {
+  // boxes and dt areas are computed once per call into the scratch; only
+  // pairs whose boxes overlap are merged, gt rows are spread over threads
+  siz g, d, work=0; double *bb; RleIouJob J;
+  bb=rleScratchGet(S,sizeof(double)*(m+n)*4+sizeof(uint)*m);
+  rleToBbox(dt,bb,m); rleToBbox(gt,bb+4*m,n);
+  J.dt=dt; J.gt=gt; J.m=m; J.iscrowd=iscrowd; J.o=o; J.area=(uint*)(bb+4*(m+n));
+  rleArea(dt,m,J.area); bbIou(bb,bb+4*m,m,n,iscrowd,o);
+  for( g=0; g<n; g++ ) for( d=0; d<m; d++ ) if(o[g*m+d]>0) work+=dt[d].m+gt[g].m;
+  iouParallelFor(n,1,(int)(work>>16)+1,rleIouRows,&J);
+}
+
 void bbIou( BB dt, BB gt, siz m, siz n, byte *iscrowd, double *o ) {
-  double h, w, i, u, ga, da; siz g, d; bool crowd;
-  for( g=0; g<n; g++ ) {
-    BB G=gt+g*4; ga=G[2]*G[3]; crowd=iscrowd!=NULL && iscrowd[g];
-    for( d=0; d<m; d++ ) {
-      BB D=dt+d*4; da=D[2]*D[3]; o[g*m+d]=0;
-      w=fmin(D[2]+D[0],G[2]+G[0])-fmax(D[0],G[0]); if(w<=0) continue;
-      h=fmin(D[3]+D[1],G[3]+G[1])-fmax(D[1],G[1]); if(h<=0) continue;
-      i=w*h; u = crowd ? da : da+ga-i; o[g*m+d]=i/u;
-    }
-  }
+  // rows are gt so that o[g*m+d] is the engine's row-major layout
+  IouOpts opts = { IOU_BOX_XYWH, 0, iscrowd, 0 };
+  iouMatrix(gt,n,4,dt,m,4,&opts,o);
 }
 
 void rleToBbox( const RLE *R, BB bb, siz n ) {
@@ -123,86 +257,193 @@ void rleToBbox( const RLE *R, BB bb, siz n ) {
   }
 }
 
+static void rleFrPoints( RLE *R, uint *a, siz k, siz h, siz w ) {
+  // a holds k sorted y-boundary points and room for one more, h*w, which
+  // exceeds them all unless w==0
+  siz j=k, m=0; uint p=0, e=(uint)(h*w);
+  while(j>0 && a[j-1]>e) { a[j]=a[j-1]; j--; } a[j]=e; k++;
+  for( j=0; j<k; j++ ) { uint t=a[j]; a[j]-=p; p=t; }
+  j=0; a[m++]=a[j++];
+  while(j<k) if(a[j]>0) a[m++]=a[j++]; else {
+    j++; if(j<k) a[m-1]+=a[j++]; }
+  rleInit(R,h,w,m,a);
+}
+
+static uint rleFrPolyY( long v, siz h ) {
+  // ceil of the downsampled y=(v+.5)/5-.5 clamped to [0,h], in integers
+  long y=v-2; y = y>0 ? (y+4)/5 : 0; return (uint)((siz)y>h ? h : (siz)y);
+}
+
+static void rleFrPolyPair( int u0, int v0, int u1, int v1, siz h, siz w, uint *a, siz *m ) {
+  // y-boundary point between consecutive points of the upsampled boundary;
+  // it exists if the step crosses a column center, x=(u+.5)/5-.5 integral
+  long u; if(u1==u0) return;
+  u=(u1<u0?u1:u1-1)-2; if( u<0 || u%5 || (siz)(u/5)>w-1 ) return;
+  a[(*m)++]=(uint)((int)(u/5)*(int)(h)+(int)rleFrPolyY(v1<v0?v1:v0,h));
+}
+
+static void rleFrPolyPt( bool xmajor, int t, int xs, int ys, double s, int *u, int *v ) {
+  // point t of an edge walk, as computed by the dense upsampling pass
+  if(xmajor) { *u=t+xs; *v=(int)(ys+s*t+.5); } else { *v=t+ys; *u=(int)(xs+s*t+.5); }
+}
+
+static bool rleFrPolyPast( int t, int xs, double s, long c ) {
+  // whether point t of a y-major edge lies past the boundary of columns c, c+1
+  int u=(int)(xs+s*t+.5); return s>0 ? u>c : u<=c;
+}
+
+static long rleFrPolyCol( long c ) {
+  // first upsampled x>=c that is a pixel column center (x=2 mod 5)
+  long r=((c-2)%5+5)%5; return r ? c+5-r : c;
+}
+
 void rleFrBbox( RLE *R, const BB bb, siz h, siz w, siz n ) {
+  RleScratch S={0,0};
   for( siz i=0; i<n; i++ ) {
     double xs=bb[4*i+0], xe=xs+bb[4*i+2];
     double ys=bb[4*i+1], ye=ys+bb[4*i+3];
     double xy[8] = {xs,ys,xs,ye,xe,ye,xe,ys};
-    rleFrPoly( R+i, xy, 4, h, w );
+    int x0=(int)(5*xs+.5), x1=(int)(5*xe+.5), y0=(int)(5*ys+.5), y1=(int)(5*ye+.5);
+    if( x0<0 || y0<0 || x1<=x0 || y1<=y0 ) { rleFrPolyScratch(R+i,xy,4,h,w,&S); continue; }
+    // closed form of rleFrPoly for a box: each column center between the
+    // vertical edges gets the boundary points of the bottom and top edges
+    long c, c0=rleFrPolyCol(x0), c1=x1-1; siz m=0; uint *a;
+    if(w>0 && c1>5*(long)w-3) c1=5*(long)w-3;
+    a=rleScratchGet(&S,sizeof(uint)*(c1>=c0 ? 2*((c1-c0)/5+1)+1 : 1));
+    int yb=(int)rleFrPolyY(y0,h), yt=(int)rleFrPolyY(y1,h);
+    for( c=c0; c<=c1; c+=5 ) {
+      int x=(int)((c-2)/5);
+      a[m++]=(uint)(x*(int)(h)+yb); a[m++]=(uint)(x*(int)(h)+yt);
+    }
+    rleFrPoints(R+i,a,m,h,w);
   }
+  rleScratchFree(&S);
 }
 
-int uintCompare(const void *a, const void *b) {
-  uint c=*((uint*)a), d=*((uint*)b); return c>d?1:c<d?-1:0;
+void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
+  RleScratch S={0,0}; rleFrPolyScratch(R,xy,k,h,w,&S); rleScratchFree(&S);
 }
 
-void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w ) {
-  // upsample and get discrete points densely along entire boundary
-  siz j, m=0; double scale=5; int *x, *y, *u, *v; uint *a, *b;
-  x=malloc(sizeof(int)*(k+1)); y=malloc(sizeof(int)*(k+1));
+void rleFrPolyScratch( RLE *R, const double *xy, siz k, siz h, siz w, RleScratch *S ) {
+  // Walk the edges of the polygon upsampled 5x. Only steps that cross a pixel
+  // column center yield a y-boundary point, so those are visited directly:
+  // every fifth step of an x-major edge, and a binary search for each column
+  // change of a y-major edge. Points are then bucketed by column. The upsampled
+  // points are computed exactly as the dense walk computed them, so the output
+  // is unchanged.
+  siz j, m=0, n=1, nb; double scale=5; int *x, *y, pu=0, pv=0; uint *a, *o, *c;
+  long cmax=w>0 ? 5*(long)w-3 : LONG_MAX;
+  x=rleScratchGet(S,sizeof(int)*2*(k+1)); y=x+k+1;
   for(j=0; j<k; j++) x[j]=(int)(scale*xy[j*2+0]+.5); x[k]=x[0];
   for(j=0; j<k; j++) y[j]=(int)(scale*xy[j*2+1]+.5); y[k]=y[0];
-  for(j=0; j<k; j++) m+=umax(abs(x[j]-x[j+1]),abs(y[j]-y[j+1]))+1;
-  u=malloc(sizeof(int)*m); v=malloc(sizeof(int)*m); m=0;
+  for(j=0; j<k; j++) n+=abs(x[j]-x[j+1])/5+3;
+  x=rleScratchGet(S,sizeof(int)*2*(k+1)+sizeof(uint)*(2*n+w+2)); y=x+k+1;
+  a=(uint*)(y+k+1); o=a+n; c=o+n;
   for( j=0; j<k; j++ ) {
-    int xs=x[j], xe=x[j+1], ys=y[j], ye=y[j+1], dx, dy, t;
-    bool flip; double s; dx=abs(xe-xs); dy=abs(ys-ye);
-    flip = (dx>=dy && xs>xe) || (dx<dy && ys>ye);
+    int xs=x[j], xe=x[j+1], ys=y[j], ye=y[j+1], dx, dy, t, nt, u, v, u0, v0;
+    bool flip, xm; double s; long cc, lo, hi; dx=abs(xe-xs); dy=abs(ys-ye);
+    xm=dx>=dy; flip = (xm && xs>xe) || (!xm && ys>ye);
     if(flip) { t=xs; xs=xe; xe=t; t=ys; ys=ye; ye=t; }
-    s = dx>=dy ? (double)(ye-ys)/dx : (double)(xe-xs)/dy;
-    if(dx>=dy) for( int d=0; d<=dx; d++ ) {
-      t=flip?dx-d:d; u[m]=t+xs; v[m]=(int)(ys+s*t+.5); m++;
-    } else for( int d=0; d<=dy; d++ ) {
-      t=flip?dy-d:d; v[m]=t+ys; u[m]=(int)(xs+s*t+.5); m++;
+    s = xm ? (double)(ye-ys)/dx : (double)(xe-xs)/dy; nt = xm ? dx : dy;
+    // the step joining the previous edge to this one
+    rleFrPolyPt(xm,flip?nt:0,xs,ys,s,&u,&v);
+    if(j>0) rleFrPolyPair(pu,pv,u,v,h,w,a,&m);
+    if(xm) {
+      // u moves by one per step: step t+1 crosses column xs+t
+      lo=xs>2?xs:2; hi=xs+dx-1; if(hi>cmax) hi=cmax;
+      for( cc=rleFrPolyCol(lo); cc<=hi; cc+=5 ) {
+        t=(int)(cc-xs); rleFrPolyPt(xm,t,xs,ys,s,&u0,&v0);
+        rleFrPolyPt(xm,t+1,xs,ys,s,&u,&v); rleFrPolyPair(u0,v0,u,v,h,w,a,&m);
+      }
+    } else if(s!=0) {
+      // u is monotone in t and moves by at most one per step
+      int ua=(int)(xs+.5), ub=(int)(xs+s*dy+.5);
+      lo=ua<ub?ua:ub; hi=(ua<ub?ub:ua)-1;
+      if(lo<2) lo=2;
+      if(hi>cmax) hi=cmax;
+      for( cc=rleFrPolyCol(lo); cc<=hi; cc+=5 ) {
+        // first t on the far side of the boundary between cc and cc+1: start
+        // from the real crossing and step to the exact one (rounding may
+        // move it by a step)
+        double tr=ceil((cc+.5-xs)/s); int t0 = tr<1 ? 1 : tr>dy ? dy : (int)tr;
+        while(t0>1 && rleFrPolyPast(t0-1,xs,s,cc)) t0--;
+        while(!rleFrPolyPast(t0,xs,s,cc)) t0++;
+        rleFrPolyPt(xm,t0-1,xs,ys,s,&u0,&v0);
+        rleFrPolyPt(xm,t0,xs,ys,s,&u,&v); rleFrPolyPair(u0,v0,u,v,h,w,a,&m);
+      }
     }
+    rleFrPolyPt(xm,flip?0:nt,xs,ys,s,&pu,&pv);
   }
-  // get points along y-boundary and downsample
-  free(x); free(y); k=m; m=0; double xd, yd;
-  x=malloc(sizeof(int)*k); y=malloc(sizeof(int)*k);
-  for( j=1; j<k; j++ ) if(u[j]!=u[j-1]) {
-    xd=(double)(u[j]<u[j-1]?u[j]:u[j]-1); xd=(xd+.5)/scale-.5;
-    if( floor(xd)!=xd || xd<0 || xd>w-1 ) continue;
-    yd=(double)(v[j]<v[j-1]?v[j]:v[j-1]); yd=(yd+.5)/scale-.5;
-    if(yd<0) yd=0; else if(yd>h) yd=h; yd=ceil(yd);
-    x[m]=(int) xd; y[m]=(int) yd; m++;
+  // bucket the points by column, then sort within columns: a column gets its
+  // points from different edges in walk order, two for a convex polygon, so
+  // the insertion sort moves each point past a few of its column at most
+  if(m>1 && h>0) {
+    uint b0=a[0]/h, b1=b0, t;
+    for( j=1; j<m; j++ ) { t=a[j]/h; b0=t<b0?t:b0; b1=t>b1?t:b1; }
+    nb=b1-b0+1;
+    if(nb<=w+1) {
+      memset(c,0,sizeof(uint)*(nb+1));
+      for( j=0; j<m; j++ ) c[a[j]/h-b0+1]++;
+      for( j=1; j<=nb; j++ ) c[j]+=c[j-1];
+      for( j=0; j<m; j++ ) o[c[a[j]/h-b0]++]=a[j];
+      a=o;
+    }
+    for( j=1; j<m; j++ ) {
+      siz i=j; t=a[j]; while(i>0 && a[i-1]>t) { a[i]=a[i-1]; i--; } a[i]=t;
+    }
   }
-  // compute rle encoding given y-boundary points
-  k=m; a=malloc(sizeof(uint)*(k+1));
-  for( j=0; j<k; j++ ) a[j]=(uint)(x[j]*(int)(h)+y[j]);
-  a[k++]=(uint)(h*w); free(u); free(v); free(x); free(y);
-  qsort(a,k,sizeof(uint),uintCompare); uint p=0;
-  for( j=0; j<k; j++ ) { uint t=a[j]; a[j]-=p; p=t; }
-  b=malloc(sizeof(uint)*k); j=m=0; b[m++]=a[j++];
-  while(j<k) if(a[j]>0) b[m++]=a[j++]; else {
-    j++; if(j<k) b[m-1]+=a[j++]; }
-  rleInit(R,h,w,m,b); free(a); free(b);
+  rleFrPoints(R,a,m,h,w);
 }
 
-char* rleToString( const RLE *R ) {
+static siz rleToStr( const uint *cnts, siz m, char *s ) {
   // Similar to LEB128 but using 6 bits/char and ascii chars 48-111.
-  siz i, m=R->m, p=0; long x; bool more;
-  char *s=malloc(sizeof(char)*m*6);
+  siz i, p=0; long x; bool more;
   for( i=0; i<m; i++ ) {
-    x=(long) R->cnts[i]; if(i>2) x-=(long) R->cnts[i-2]; more=1;
+    x=(long) cnts[i]; if(i>2) x-=(long) cnts[i-2]; more=1;
     while( more ) {
       char c=x & 0x1f; x >>= 5; more=(c & 0x10) ? x!=-1 : x!=0;
       if(more) c |= 0x20; c+=48; s[p++]=c;
     }
   }
-  s[p]=0; return s;
+  s[p]=0; return p;
 }
 
-void rleFrString( RLE *R, char *s, siz h, siz w ) {
-  siz m=0, p=0, k; long x; bool more; uint *cnts;
-  while( s[m] ) m++; cnts=malloc(sizeof(uint)*m); m=0;
-  while( s[p] ) {
-    x=0; k=0; more=1;
-    while( more ) {
-      char c=s[p]-48; x |= (c & 0x1f) << 5*k;
-      more = c & 0x20; p++; k++;
-      if(!more && (c & 0x10)) x |= -1 << 5*k;
-    }
-    if(m>2) x+=(long) cnts[m-2]; cnts[m++]=(uint) x;
+static siz rleFrStr( const char **ps, uint *cnts ) {
+  // Decode up to the terminating NUL, leaving *ps just past it. The last two
+  // counts stay in registers; reading cnts[m-2] back would put a store to
+  // load round trip in the dependency chain.
+  const char *s=*ps; siz m=0, k; long x, b; uint p0=0, p1=0;
+  while( *s ) {
+    char c=*s++-48; x=c & 0x1f; k=0;
+    while( (c & 0x20) && *s ) { c=*s++-48; x |= (long)(c & 0x1f) << 5*++k; }
+    // sign extend from bit 4 of the last char, without a branch on the sign
+    b=0x10L << 5*k; x=(x^b)-b;
+    if(m>2) x+=(long) p0;
+    p0=p1; p1=(uint) x; cnts[m++]=p1;
   }
-  rleInit(R,h,w,m,cnts); free(cnts);
+  *ps=s+1; return m;
+}
+
+char* rleToString( const RLE *R ) {
+  // a count delta takes at most 7 chars
+  char *s=malloc(sizeof(char)*(R->m*7+1)); rleToStr(R->cnts,R->m,s); return s;
+}
+
+siz rleToStrings( const RLE *R, siz n, char *s ) {
+  siz i, p=0;
+  for( i=0; i<n; i++ ) p+=rleToStr(R[i].cnts,R[i].m,s+p)+1;
+  return p;
+}
+
+void rleFrString( RLE *R, char *s, siz h, siz w ) {
+  // at most one count per char; the buffer is handed to R as is
+  const char *p=s; uint *cnts=malloc(sizeof(uint)*(strlen(s)+1));
+  R->h=h; R->w=w; R->m=rleFrStr(&p,cnts);
+  if(R->m==0) { free(cnts); cnts=0; } R->cnts=cnts;
+}
+
+siz rleFrStrings( const char *s, siz n, uint *cnts, siz *offs ) {
+  siz i, m=0;
+  for( i=0; i<n; i++ ) { offs[i]=m; m+=rleFrStr(&s,cnts+m); }
+  offs[n]=m; return m;
 }
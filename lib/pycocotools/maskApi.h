@@ -24,6 +24,18 @@ void rlesFree( RLE **R, siz n );
 // Encode binary masks using RLE.
 void rleEncode( RLE *R, const byte *mask, siz h, siz w, siz n );
 
+// Encode binary masks into one counts arena of cap entries; R[i].cnts point
+// into it and must not be released with rleFree. Returns the number of counts
+// needed; if that exceeds cap, the masks that did not fit get cnts=0.
+siz rleEncodeBatch( RLE *R, const byte *mask, siz h, siz w, siz n, uint *arena, siz cap );
+
+// Encode the instance masks of an id image with one pass over its pixels. img
+// holds h rows of w ids, s ids apart (row-major as rendered; s<0 for images
+// stored bottom-up); R[i] is the mask of the pixels equal to ids[i]. The counts
+// of all masks share the returned block, which is released with free(); R[i].cnts
+// must not be released with rleFree.
+uint* rleFrIds( RLE *R, const uint *img, siz h, siz w, long s, const uint *ids, siz n );
+
 // Decode binary masks encoded via RLE.
 void rleDecode( const RLE *R, byte *mask, siz n );
 
@@ -33,9 +45,16 @@ void rleMerge( const RLE *R, RLE *M, siz n, bool intersect );
 // Compute area of encoded masks.
 void rleArea( const RLE *R, siz n, uint *a );
 
+// Reusable scratch memory; start from {0,0} and release with rleScratchFree.
+typedef struct { void *p; siz n; } RleScratch;
+void rleScratchFree( RleScratch *S );
+
 // Compute intersection over union between masks.
 void rleIou( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o );
 
+// Compute intersection over union between masks, taking temporary memory from S.
+void rleIouScratch( RLE *dt, RLE *gt, siz m, siz n, byte *iscrowd, double *o, RleScratch *S );
+
 // Compute intersection over union between bounding boxes.
 void bbIou( BB dt, BB gt, siz m, siz n, byte *iscrowd, double *o );
 
@@ -48,8 +67,20 @@ void rleFrBbox( RLE *R, const BB bb, siz h, siz w, siz n );
 // Convert polygon to encoded mask.
 void rleFrPoly( RLE *R, const double *xy, siz k, siz h, siz w );
 
+// Convert polygon to encoded mask, taking temporary memory from S.
+void rleFrPolyScratch( RLE *R, const double *xy, siz k, siz h, siz w, RleScratch *S );
+
 // Get compressed string representation of encoded mask.
 char* rleToString( const RLE *R );
 
 // Convert from compressed string representation of encoded mask.
 void rleFrString( RLE *R, char *s, siz h, siz w );
+
+// Get compressed strings of n masks, NUL terminated and packed back to back
+// into s, which must hold sum(7*m+1) chars. Returns the number of chars written.
+siz rleToStrings( const RLE *R, siz n, char *s );
+
+// Decode n packed NUL terminated strings into one counts buffer holding at
+// least one entry per char. Counts of string i are cnts[offs[i]..offs[i+1]),
+// offs has n+1 entries. Returns the total number of counts.
+siz rleFrStrings( const char *s, siz n, uint *cnts, siz *offs );
@@ -0,0 +1,4 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
@@ -0,0 +1,257 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Frames of the RDB shared memory (see shm_kernel.hpp) as numpy arrays.
+
+    shm = Shm()                      # image generator output
+    with shm.wait_frame() as frame:
+        im = frame.bgr()             # decoded copy for im_detect
+        signs = frame.signs.copy()
+
+The arrays of a frame view the shared memory itself. The buffer stays locked
+until the frame is released (at the end of the with block), after which the
+image generator writes into it again: copy what has to outlive the frame.
+"""
+
+import time
+import numpy as np
+cimport numpy as np
+from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t
+from libcpp cimport bool as cbool
+
+np.import_array()
+
+cdef extern from "shm_kernel.hpp":
+    ctypedef struct RDB_IMAGE_t:
+        uint32_t id
+        uint16_t width
+        uint16_t height
+        uint8_t pixelSize
+        uint8_t pixelFormat
+        uint16_t cameraId
+        uint32_t imgSize
+    ctypedef struct RDB_CAMERA_t:
+        pass
+    ctypedef struct RDB_TRAFFIC_SIGN_t:
+        pass
+    ctypedef struct RdbShm:
+        void* base
+        uint64_t size
+        unsigned int key
+    ctypedef struct RdbPackage:
+        const void* data
+        uint32_t count
+        uint32_t element_size
+    ctypedef struct RdbFrame:
+        int buffer
+        uint32_t frame_no
+        double sim_time
+        const RDB_IMAGE_t* image
+        const void* image_data
+        uint32_t image_size
+        RdbPackage cameras, signs
+    int _rdb_shm_attach(unsigned int, RdbShm*, char*, size_t)
+    void _rdb_shm_detach(RdbShm*)
+    int _rdb_shm_acquire(RdbShm*, uint32_t, int, RdbFrame*, char*, size_t)
+    void _rdb_shm_release(RdbShm*, const RdbFrame*, uint32_t)
+
+cdef extern from "PixelDecoder.hh" namespace "Framework":
+    cdef cppclass PixelDecoder:
+        @staticmethod
+        cbool toBGR(const RDB_IMAGE_t&, const void*, unsigned char*)
+
+IMG_GENERATOR_OUT = 0x0816a          # RDB_SHM_ID_IMG_GENERATOR_OUT
+BUFFER_FLAG_TC = 0x02                # RDB_SHM_BUFFER_FLAG_TC
+BUFFER_FLAG_IG = 0x04                # RDB_SHM_BUFFER_FLAG_IG
+
+# RDB_COORD_t, RDB_CAMERA_t and RDB_TRAFFIC_SIGN_t field by field (packed to
+# 4 bytes as in viRDBIcd.h)
+COORD_DTYPE = np.dtype([('x', '<f8'), ('y', '<f8'), ('z', '<f8'),
+                        ('h', '<f4'), ('p', '<f4'), ('r', '<f4'),
+                        ('flags', 'u1'), ('type', 'u1'), ('system', '<u2')])
+CAMERA_DTYPE = np.dtype([('id', '<u2'), ('width', '<u2'), ('height', '<u2'),
+                         ('spare0', '<u2'), ('clipNear', '<f4'),
+                         ('clipFar', '<f4'), ('focalX', '<f4'),
+                         ('focalY', '<f4'), ('principalX', '<f4'),
+                         ('principalY', '<f4'), ('pos', COORD_DTYPE),
+                         ('spare1', '<u4', (4,))])
+SIGN_DTYPE = np.dtype([('id', '<u4'), ('playerId', '<u4'),
+                       ('roadDist', '<f4'), ('pos', COORD_DTYPE),
+                       ('type', '<i4'), ('subType', '<i4'), ('value', '<f4'),
+                       ('state', '<u4'), ('readability', 'i1'),
+                       ('occlusion', 'i1'), ('spare0', '<u2'),
+                       ('addOnId', '<u4'), ('minLane', 'i1'),
+                       ('maxLane', 'i1'), ('spare', '<u2')])
+assert CAMERA_DTYPE.itemsize == sizeof(RDB_CAMERA_t)
+assert SIGN_DTYPE.itemsize == sizeof(RDB_TRAFFIC_SIGN_t)
+
+cdef class _Segment:
+    # Owns the attachment; the arrays of a Shm keep it alive as their base,
+    # so they never point into a detached segment.
+    cdef RdbShm shm
+
+    def __dealloc__(self):
+        _rdb_shm_detach(&self.shm)
+
+cdef class Shm:
+    """Attachment to the RDB shared memory with the given key.
+
+    check_mask: buffer flags that mark a frame as ready for us; cleared when
+        the frame is released (0: read any unlocked buffer, clear nothing)
+    """
+    cdef _Segment _seg
+    cdef object _mem
+    cdef readonly unsigned int key
+    cdef readonly uint32_t check_mask
+
+    def __cinit__(self, unsigned int key=IMG_GENERATOR_OUT,
+                  uint32_t check_mask=BUFFER_FLAG_TC):
+        cdef char err[1024]
+        cdef _Segment seg = _Segment()
+        if not _rdb_shm_attach(key, &seg.shm, err, sizeof(err)):
+            raise IOError(err.decode('utf-8', 'replace'))
+        cdef np.npy_intp size = seg.shm.size
+        cdef np.ndarray mem = np.PyArray_SimpleNewFromData(1, &size, np.NPY_UINT8,
+                                                           seg.shm.base)
+        np.set_array_base(mem, seg)
+        mem.flags.writeable = False
+        self._seg = seg
+        self._mem = mem
+        self.key = key
+        self.check_mask = check_mask
+
+    def frame(self, int force_buffer=-1):
+        """Lock the newest ready buffer (or buffer force_buffer) and return
+        it as a Frame, or None if no buffer is ready."""
+        cdef char err[1024]
+        cdef Frame f = Frame.__new__(Frame)
+        cdef int got = _rdb_shm_acquire(&self._seg.shm, self.check_mask,
+                                        force_buffer, &f._frame, err, sizeof(err))
+        if got < 0:
+            raise IOError(err.decode('utf-8', 'replace'))
+        if not got:
+            return None
+        f._shm = self
+        f._locked = True
+        return f
+
+    def wait_frame(self, timeout=None, interval=0.001):
+        """frame(), polled every interval seconds; None after timeout."""
+        start = time.time()
+        while True:
+            f = self.frame()
+            if f is not None:
+                return f
+            if timeout is not None and time.time() - start >= timeout:
+                return None
+            time.sleep(interval)
+
+    cdef object _view(self, const void* p, size_t nbytes):
+        cdef size_t off = <const char*> p - <const char*> self._seg.shm.base
+        return self._mem[off:off + nbytes]
+
+    cdef object _package(self, const RdbPackage& pkg, dtype):
+        if pkg.data == NULL or pkg.element_size < dtype.itemsize:
+            return np.zeros(0, dtype=dtype)
+        cdef size_t off = <const char*> pkg.data - <const char*> self._seg.shm.base
+        a = np.ndarray((pkg.count,), dtype=dtype, buffer=self._mem, offset=off,
+                       strides=(pkg.element_size,))
+        a.flags.writeable = False
+        return a
+
+cdef class Frame:
+    """A locked buffer of the shared memory.
+
+    frame_no, sim_time: of the RDB message
+    image: the first RDB_IMAGE_t payload, (height, width, bytes per pixel)
+        uint8 as the image generator wrote it (see image_info for its pixel
+        format), or None
+    cameras, signs: RDB_CAMERA_t (CAMERA_DTYPE) and RDB_TRAFFIC_SIGN_t
+        (SIGN_DTYPE) packages of the frame
+    """
+    cdef RdbFrame _frame
+    cdef Shm _shm
+    cdef bint _locked
+    cdef object _image, _cameras, _signs
+
+    def __dealloc__(self):
+        if self._locked:
+            _rdb_shm_release(&self._shm._seg.shm, &self._frame, self._shm.check_mask)
+
+    def release(self):
+        """Hand the buffer back to the image generator."""
+        if self._locked:
+            _rdb_shm_release(&self._shm._seg.shm, &self._frame, self._shm.check_mask)
+            self._locked = False
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, tb):
+        self.release()
+
+    @property
+    def locked(self):
+        return bool(self._locked)
+
+    @property
+    def buffer(self):
+        return self._frame.buffer
+
+    @property
+    def frame_no(self):
+        return self._frame.frame_no
+
+    @property
+    def sim_time(self):
+        return self._frame.sim_time
+
+    @property
+    def image_info(self):
+        cdef const RDB_IMAGE_t* im = self._frame.image
+        if im == NULL:
+            return None
+        return {'id': im.id, 'width': im.width, 'height': im.height,
+                'pixelSize': im.pixelSize, 'pixelFormat': im.pixelFormat,
+                'cameraId': im.cameraId, 'imgSize': im.imgSize}
+
+    @property
+    def image(self):
+        cdef const RDB_IMAGE_t* im = self._frame.image
+        if self._image is not None or im == NULL:
+            return self._image
+        a = self._shm._view(self._frame.image_data, self._frame.image_size)
+        cdef size_t nbytes = <size_t> im.width * im.height * (im.pixelSize // 8)
+        if im.pixelSize % 8 == 0 and 0 < nbytes <= self._frame.image_size:
+            a = a[:nbytes].reshape(im.height, im.width, im.pixelSize // 8)
+        self._image = a
+        return a
+
+    @property
+    def cameras(self):
+        if self._cameras is None:
+            self._cameras = self._shm._package(self._frame.cameras, CAMERA_DTYPE)
+        return self._cameras
+
+    @property
+    def signs(self):
+        if self._signs is None:
+            self._signs = self._shm._package(self._frame.signs, SIGN_DTYPE)
+        return self._signs
+
+    def bgr(self):
+        """The image decoded into a new (height, width, 3) uint8 BGR array
+        (rdbReader/PixelDecoder), or None if there is no image or its pixel
+        format is not supported."""
+        cdef const RDB_IMAGE_t* im = self._frame.image
+        if im == NULL:
+            return None
+        assert self._locked, 'frame is released'
+        cdef np.ndarray out = np.empty((im.height, im.width, 3), dtype=np.uint8)
+        if self._frame.image_size < im.imgSize or \
+           not PixelDecoder.toBGR(im[0], self._frame.image_data,
+                                  <unsigned char*> np.PyArray_DATA(out)):
+            return None
+        return out
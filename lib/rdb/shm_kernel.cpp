@@ -0,0 +1,156 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "shm_kernel.hpp"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace {
+
+struct Buffer {
+  RDB_SHM_BUFFER_INFO_t* info;
+  const char* begin;
+  const char* end;
+  const RDB_MSG_t* msg;        // first message, 0 if it does not fit
+};
+
+// Buffer infos follow the segment header; 0 if they run past the segment.
+int findBuffers(const RdbShm* shm, Buffer* buf, int max_buffers) {
+  const char* base = (const char*)shm->base;
+  const char* end = base + shm->size;
+  if (shm->size < sizeof(RDB_SHM_HDR_t)) return 0;
+  const RDB_SHM_HDR_t* hdr = (const RDB_SHM_HDR_t*)base;
+  if (hdr->noBuffers > max_buffers) return 0;
+  const char* p = base + hdr->headerSize;
+  for (int i = 0; i < hdr->noBuffers; ++i) {
+    if (p < base || p + sizeof(RDB_SHM_BUFFER_INFO_t) > end) return 0;
+    RDB_SHM_BUFFER_INFO_t* info = (RDB_SHM_BUFFER_INFO_t*)p;
+    if (info->thisSize < sizeof(RDB_SHM_BUFFER_INFO_t) || info->offset > shm->size) return 0;
+    buf[i].info = info;
+    buf[i].begin = base + info->offset;
+    buf[i].end = info->bufferSize > shm->size - info->offset ? end : buf[i].begin + info->bufferSize;
+    buf[i].msg = buf[i].end - buf[i].begin >= (ptrdiff_t)sizeof(RDB_MSG_HDR_t)
+                     ? (const RDB_MSG_t*)buf[i].begin
+                     : 0;
+    p += info->thisSize;
+  }
+  return hdr->noBuffers;
+}
+
+bool ready(const Buffer& b, uint32_t check_mask) {
+  uint32_t flags = b.info->flags;
+  return b.msg && (!check_mask || (flags & check_mask)) && !(flags & RDB_SHM_BUFFER_FLAG_LOCK);
+}
+
+// Walks the messages of a buffer and picks the first package of each kind.
+void scan(const Buffer& b, RdbFrame* frame) {
+  const char* p = b.begin;
+  while (b.end - p >= (ptrdiff_t)sizeof(RDB_MSG_HDR_t)) {
+    const RDB_MSG_HDR_t* hdr = (const RDB_MSG_HDR_t*)p;
+    if (hdr->magicNo != RDB_MAGIC_NO || hdr->headerSize < sizeof(RDB_MSG_HDR_t)) break;
+    const char* entry = p + hdr->headerSize;
+    const char* end = entry + hdr->dataSize;
+    if (end > b.end || end < entry) end = b.end;
+    while (end - entry >= (ptrdiff_t)sizeof(RDB_MSG_ENTRY_HDR_t)) {
+      const RDB_MSG_ENTRY_HDR_t* e = (const RDB_MSG_ENTRY_HDR_t*)entry;
+      if (e->headerSize < sizeof(RDB_MSG_ENTRY_HDR_t)) break;
+      const char* data = entry + e->headerSize;
+      if (data > end || e->dataSize > (size_t)(end - data)) break;
+      uint32_t count = e->elementSize ? e->dataSize / e->elementSize : 0;
+
+      if (e->pkgId == RDB_PKG_ID_IMAGE && !frame->image && e->dataSize >= sizeof(RDB_IMAGE_t)) {
+        frame->image = (const RDB_IMAGE_t*)data;
+        frame->image_data = data + sizeof(RDB_IMAGE_t);
+        uint32_t available = e->dataSize - sizeof(RDB_IMAGE_t);
+        frame->image_size = frame->image->imgSize < available ? frame->image->imgSize : available;
+      } else if (e->pkgId == RDB_PKG_ID_CAMERA && !frame->cameras.data && count) {
+        frame->cameras.data = data;
+        frame->cameras.count = count;
+        frame->cameras.element_size = e->elementSize;
+      } else if (e->pkgId == RDB_PKG_ID_TRAFFIC_SIGN && !frame->signs.data && count) {
+        frame->signs.data = data;
+        frame->signs.count = count;
+        frame->signs.element_size = e->elementSize;
+      }
+      entry = data + e->dataSize;
+    }
+    if (!hdr->dataSize) break;
+    p = end;
+  }
+}
+
+}  // namespace
+
+int _rdb_shm_attach(unsigned int key, RdbShm* shm, char* err, size_t err_size) {
+  memset(shm, 0, sizeof(*shm));
+  int id = shmget(key, 0, 0);
+  if (id < 0) {
+    snprintf(err, err_size, "no shared memory with key 0x%x: %s", key, strerror(errno));
+    return 0;
+  }
+  struct shmid_ds info;
+  if (shmctl(id, IPC_STAT, &info) < 0) {
+    snprintf(err, err_size, "shmctl(0x%x): %s", key, strerror(errno));
+    return 0;
+  }
+  void* p = shmat(id, 0, 0);
+  if (p == (void*)-1) {
+    snprintf(err, err_size, "shmat(0x%x): %s", key, strerror(errno));
+    return 0;
+  }
+  shm->base = p;
+  shm->size = info.shm_segsz;
+  shm->key = key;
+  return 1;
+}
+
+void _rdb_shm_detach(RdbShm* shm) {
+  if (shm->base) shmdt(shm->base);
+  shm->base = 0;
+  shm->size = 0;
+}
+
+int _rdb_shm_acquire(RdbShm* shm, uint32_t check_mask, int force_buffer, RdbFrame* frame,
+                     char* err, size_t err_size) {
+  memset(frame, 0, sizeof(*frame));
+  frame->buffer = -1;
+  Buffer buf[2];
+  int n = findBuffers(shm, buf, 2);
+  if (n != 2) {
+    snprintf(err, err_size, "shared memory 0x%x does not hold two RDB buffers", shm->key);
+    return -1;
+  }
+
+  int pick = -1;
+  if (force_buffer >= 0) {
+    if (force_buffer < n && ready(buf[force_buffer], check_mask)) pick = force_buffer;
+  } else if (ready(buf[0], check_mask) && ready(buf[1], check_mask)) {
+    pick = buf[0].msg->hdr.frameNo > buf[1].msg->hdr.frameNo ? 0 : 1;  // the newest
+  } else if (ready(buf[0], check_mask)) {
+    pick = 0;
+  } else if (ready(buf[1], check_mask)) {
+    pick = 1;
+  }
+  if (pick < 0) return 0;
+
+  // the writer may have taken the buffer since we looked
+  uint32_t flags = __sync_fetch_and_or(&buf[pick].info->flags, RDB_SHM_BUFFER_FLAG_LOCK);
+  if (flags & RDB_SHM_BUFFER_FLAG_LOCK) return 0;
+
+  frame->buffer = pick;
+  frame->frame_no = buf[pick].msg->hdr.frameNo;
+  frame->sim_time = buf[pick].msg->hdr.simTime;
+  scan(buf[pick], frame);
+  return 1;
+}
+
+void _rdb_shm_release(RdbShm* shm, const RdbFrame* frame, uint32_t check_mask) {
+  Buffer buf[2];
+  if (frame->buffer < 0 || findBuffers(shm, buf, 2) <= frame->buffer) return;
+  __sync_fetch_and_and(&buf[frame->buffer].info->flags, ~(check_mask | RDB_SHM_BUFFER_FLAG_LOCK));
+}
@@ -0,0 +1,55 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Read access to the double buffered RDB shared memory of the VIRES image
+// generator (see rdbReader/ShmReader.cpp), without copying: a frame is the
+// newest buffer whose flags match the check mask, locked until it is
+// released, with pointers to its first image, camera and traffic sign
+// packages.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "viRDBIcd.h"
+
+struct RdbShm {
+  void* base;
+  uint64_t size;
+  unsigned int key;
+};
+
+// a package vector: count elements of element_size bytes
+struct RdbPackage {
+  const void* data;
+  uint32_t count;
+  uint32_t element_size;
+};
+
+struct RdbFrame {
+  int buffer;                  // index of the locked buffer
+  uint32_t frame_no;
+  double sim_time;
+  const RDB_IMAGE_t* image;    // 0 if the frame has no image
+  const void* image_data;
+  uint32_t image_size;         // bytes of image_data inside the buffer
+  RdbPackage cameras, signs;
+};
+
+// Attaches to an existing segment. Returns 0 and describes the error in err
+// if there is none with that key.
+int _rdb_shm_attach(unsigned int key, RdbShm* shm, char* err, size_t err_size);
+
+void _rdb_shm_detach(RdbShm* shm);
+
+// Locks the newest buffer whose flags intersect check_mask (any unlocked
+// buffer if check_mask is 0), or buffer force_buffer if >= 0. Returns 1 with
+// the frame, 0 if no buffer is ready and -1 (with err) if the segment is not
+// laid out as RDB expects.
+int _rdb_shm_acquire(RdbShm* shm, uint32_t check_mask, int force_buffer, RdbFrame* frame,
+                     char* err, size_t err_size);
+
+// Clears check_mask and the lock of the frame's buffer, handing it back to
+// the image generator. The pointers of the frame must not be used after.
+void _rdb_shm_release(RdbShm* shm, const RdbFrame* frame, uint32_t check_mask);
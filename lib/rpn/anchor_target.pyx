@@ -0,0 +1,84 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+import numpy as np
+cimport numpy as np
+import numpy.random as npr
+from libc.stdint cimport uint32_t
+
+cdef extern from "anchor_target_kernel.hpp":
+    ctypedef struct AnchorTargetParams:
+        double positive_overlap
+        double negative_overlap
+        int clobber_positives
+        int num_fg
+        int batch_size
+        double positive_weight
+        float inside_weights[4]
+        int normalize_targets
+        double means[4]
+        double stds[4]
+        int threads
+    int _anchor_targets(const double*, int, int, int, int, double, double, int,
+                        const float*, int, int, const AnchorTargetParams*,
+                        uint32_t*, int*, float*, float*, float*, float*) nogil
+
+def anchor_targets(anchors, int height, int width, int feat_stride, im_info,
+                   int allowed_border, gt_boxes, train_cfg, int threads=0):
+    """
+    Native AnchorTargetLayer.forward. Takes cfg.TRAIN and draws the fg/bg
+    subsamples from numpy's global RandomState, leaving it exactly where the
+    Python layer would.
+
+    Returns
+    -------
+    labels: (1, 1, A * height, width) float32
+    bbox_targets, bbox_inside_weights, bbox_outside_weights:
+        (1, A * 4, height, width) float32
+    """
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] base = \
+            np.ascontiguousarray(anchors, dtype=np.float64)
+    cdef np.ndarray[np.float32_t, ndim=2, mode='c'] gt = \
+            np.ascontiguousarray(gt_boxes, dtype=np.float32)
+    cdef int A = base.shape[0]
+    assert gt.shape[0] > 0 and gt.shape[1] >= 4
+
+    cdef AnchorTargetParams p
+    p.positive_overlap = train_cfg.RPN_POSITIVE_OVERLAP
+    p.negative_overlap = train_cfg.RPN_NEGATIVE_OVERLAP
+    p.clobber_positives = bool(train_cfg.RPN_CLOBBER_POSITIVES)
+    p.num_fg = int(train_cfg.RPN_FG_FRACTION * train_cfg.RPN_BATCHSIZE)
+    p.batch_size = train_cfg.RPN_BATCHSIZE
+    p.positive_weight = train_cfg.RPN_POSITIVE_WEIGHT
+    p.normalize_targets = bool(train_cfg.RPN_NORMALIZE_TARGETS)
+    for c in range(4):
+        p.inside_weights[c] = train_cfg.RPN_BBOX_INSIDE_WEIGHTS[c]
+        if p.normalize_targets:
+            p.means[c] = train_cfg.RPN_NORMALIZE_MEANS[c]
+            p.stds[c] = train_cfg.RPN_NORMALIZE_STDS[c]
+    p.threads = threads
+    assert p.positive_weight < 0 or 0 < p.positive_weight < 1
+
+    state = npr.get_state()
+    cdef np.ndarray[np.uint32_t, ndim=1, mode='c'] key = \
+            np.array(state[1], dtype=np.uint32)
+    cdef int pos = state[2]
+
+    cdef np.ndarray[np.float32_t, ndim=4] labels = \
+            np.empty((1, 1, A * height, width), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=4] bbox_targets = \
+            np.empty((1, A * 4, height, width), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=4] bbox_inside_weights = \
+            np.empty((1, A * 4, height, width), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=4] bbox_outside_weights = \
+            np.empty((1, A * 4, height, width), dtype=np.float32)
+    _anchor_targets(&base[0, 0], A, height, width, feat_stride,
+                    im_info[0], im_info[1], allowed_border,
+                    &gt[0, 0], gt.shape[0], gt.shape[1], &p, &key[0], &pos,
+                    &labels[0, 0, 0, 0], &bbox_targets[0, 0, 0, 0],
+                    &bbox_inside_weights[0, 0, 0, 0],
+                    &bbox_outside_weights[0, 0, 0, 0])
+    npr.set_state((state[0], key, pos) + tuple(state[3:]))
+    return labels, bbox_targets, bbox_inside_weights, bbox_outside_weights
@@ -0,0 +1,172 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "anchor_target_kernel.hpp"
+#include "iou_engine.hpp"
+#include "np_random.hpp"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Row max/argmax and, per gt column, every row that attains the column max
+// (np.where(overlaps == gt_max_overlaps)[0]), gathered while the tiles go by.
+struct ReduceVisit {
+  double* row_max;
+  int* row_arg;
+  std::vector<double> col_max;
+  std::vector<std::vector<int> > col_rows;
+
+  explicit ReduceVisit(size_t num_gt)
+      : row_max(NULL), row_arg(NULL), col_max(num_gt, -1.0), col_rows(num_gt) {}
+
+  void operator()(size_t i, size_t j0, const double* v, size_t n) {
+    double best = j0 == 0 ? -std::numeric_limits<double>::infinity() : row_max[i];
+    int arg = j0 == 0 ? 0 : row_arg[i];
+    for (size_t j = 0; j < n; ++j) {
+      if (v[j] > best) { best = v[j]; arg = (int) (j0 + j); }
+      double& cm = col_max[j0 + j];
+      if (v[j] > cm) {
+        cm = v[j];
+        col_rows[j0 + j].assign(1, (int) i);
+      } else if (v[j] == cm) {
+        col_rows[j0 + j].push_back((int) i);
+      }
+    }
+    row_max[i] = best;
+    row_arg[i] = arg;
+  }
+};
+
+// npr.choice(inds, size=len(inds) - keep, replace=False) set to don't care
+void subsample(std::vector<float>& labels, float value, int keep, nprand::RandomState& rng) {
+  std::vector<int> inds, disable;
+  for (size_t i = 0; i < labels.size(); ++i)
+    if (labels[i] == value) inds.push_back((int) i);
+  if ((int) inds.size() <= keep) return;
+  rng.choice(inds, inds.size() - keep, disable);
+  for (size_t k = 0; k < disable.size(); ++k) labels[disable[k]] = -1;
+}
+
+}  // namespace
+
+int _anchor_targets(const double* anchors, int num_anchors, int height, int width,
+                    int feat_stride, double im_height, double im_width, int allowed_border,
+                    const float* gt_boxes, int num_gt, int gt_dim,
+                    const AnchorTargetParams* p, uint32_t* mt_key, int* mt_pos,
+                    float* labels_out, float* targets_out, float* inside_out,
+                    float* outside_out) {
+  const int A = num_anchors;
+  const size_t spatial = (size_t) height * width;
+  const size_t total = spatial * A;
+
+  // 1. shifted anchors, in (K, A) order, keeping those inside the image
+  std::vector<double> inside;
+  std::vector<int> inds_inside;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      double sx = x * feat_stride, sy = y * feat_stride;
+      for (int a = 0; a < A; ++a) {
+        const double* b = anchors + a * 4;
+        double x1 = b[0] + sx, y1 = b[1] + sy, x2 = b[2] + sx, y2 = b[3] + sy;
+        if (x1 >= -allowed_border && y1 >= -allowed_border &&
+            x2 < im_width + allowed_border && y2 < im_height + allowed_border) {
+          inds_inside.push_back((int) ((size_t) (y * width + x) * A + a));
+          inside.push_back(x1); inside.push_back(y1);
+          inside.push_back(x2); inside.push_back(y2);
+        }
+      }
+    }
+  }
+  const size_t n = inds_inside.size();
+
+  // 2. overlaps reduced on the fly; the n x num_gt matrix is never stored
+  std::vector<double> gt(num_gt * 4);
+  for (int g = 0; g < num_gt; ++g)
+    for (int c = 0; c < 4; ++c) gt[g * 4 + c] = gt_boxes[g * gt_dim + c];
+  iou::Boxes<double> ex, gtb;
+  ex.assign(n ? &inside[0] : NULL, n, 4, IOU_BOX_XYXY, 1.0);
+  gtb.assign(&gt[0], num_gt, 4, IOU_BOX_XYXY, 1.0);
+
+  std::vector<double> max_overlaps(n);
+  std::vector<int> argmax_overlaps(n);
+  int threads = iou::numThreads(n * num_gt, p->threads);
+  std::vector<ReduceVisit> parts(threads, ReduceVisit(num_gt));
+  iou::parallelRows(n, threads, [&](size_t i0, size_t i1, int tid) {
+    ReduceVisit& visit = parts[tid];
+    visit.row_max = n ? &max_overlaps[0] : NULL;
+    visit.row_arg = n ? &argmax_overlaps[0] : NULL;
+    iou::forEachTile(ex, gtb, 1.0, (const unsigned char*) NULL, i0, i1, visit);
+  });
+
+  // 3. labels: 1 is positive, 0 is negative, -1 is dont care
+  std::vector<float> labels(n, -1);
+  if (!p->clobber_positives)
+    for (size_t i = 0; i < n; ++i) if (max_overlaps[i] < p->negative_overlap) labels[i] = 0;
+  for (int g = 0; g < num_gt; ++g) {
+    double best = -1.0;
+    for (size_t t = 0; t < parts.size(); ++t) best = std::max(best, parts[t].col_max[g]);
+    for (size_t t = 0; t < parts.size(); ++t) {
+      if (parts[t].col_max[g] != best) continue;
+      const std::vector<int>& rows = parts[t].col_rows[g];
+      for (size_t k = 0; k < rows.size(); ++k) labels[rows[k]] = 1;
+    }
+  }
+  for (size_t i = 0; i < n; ++i) if (max_overlaps[i] >= p->positive_overlap) labels[i] = 1;
+  if (p->clobber_positives)
+    for (size_t i = 0; i < n; ++i) if (max_overlaps[i] < p->negative_overlap) labels[i] = 0;
+
+  // 4. subsample fg, then bg, drawing from numpy's generator
+  nprand::RandomState rng(mt_key, *mt_pos);
+  subsample(labels, 1, p->num_fg, rng);
+  int num_pos = 0;
+  for (size_t i = 0; i < n; ++i) num_pos += labels[i] == 1;
+  subsample(labels, 0, p->batch_size - num_pos, rng);
+  rng.store(mt_key, mt_pos);
+
+  // 5. example weights
+  int num_fg = 0, num_bg = 0;
+  for (size_t i = 0; i < n; ++i) { num_fg += labels[i] == 1; num_bg += labels[i] == 0; }
+  float positive_weight, negative_weight;
+  if (p->positive_weight < 0) {
+    positive_weight = negative_weight = (float) (1.0 / (num_fg + num_bg));
+  } else {
+    positive_weight = (float) (p->positive_weight / num_fg);
+    negative_weight = (float) ((1.0 - p->positive_weight) / num_bg);
+  }
+
+  // 6. unmap into the top blobs; bbox_transform keeps the gt side in float32
+  // as the Python layer does (gt_boxes is the float32 blob there)
+  for (size_t m = 0; m < total; ++m) labels_out[m] = -1;
+  for (size_t m = 0; m < total * 4; ++m) targets_out[m] = inside_out[m] = outside_out[m] = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size_t m = inds_inside[i], k = m / A, a = m % A;
+    labels_out[a * spatial + k] = labels[i];
+
+    const double* e = &inside[i * 4];
+    const float* g = gt_boxes + argmax_overlaps[i] * gt_dim;
+    double ew = e[2] - e[0] + 1.0, eh = e[3] - e[1] + 1.0;
+    double ecx = e[0] + 0.5 * ew, ecy = e[1] + 0.5 * eh;
+    float gw = g[2] - g[0] + 1.0f, gh = g[3] - g[1] + 1.0f;
+    float gcx = g[0] + 0.5f * gw, gcy = g[1] + 0.5f * gh;
+    float t[4] = {(float) ((gcx - ecx) / ew), (float) ((gcy - ecy) / eh),
+                  (float) std::log(gw / ew), (float) std::log(gh / eh)};
+    for (int c = 0; c < 4; ++c) {
+      if (p->normalize_targets) {
+        t[c] = (float) (t[c] - p->means[c]);
+        t[c] = (float) (t[c] / p->stds[c]);
+      }
+      size_t o = (a * 4 + c) * spatial + k;
+      targets_out[o] = t[c];
+      if (labels[i] == 1) {
+        inside_out[o] = p->inside_weights[c];
+        outside_out[o] = positive_weight;
+      } else if (labels[i] == 0) {
+        outside_out[o] = negative_weight;
+      }
+    }
+  }
+  return (int) n;
+}
@@ -0,0 +1,35 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Native forward pass of rpn/anchor_target_layer.py. Labels, sampling and
+// targets match the Python layer exactly, including npr.choice draws.
+
+#pragma once
+#include <stdint.h>
+
+struct AnchorTargetParams {
+  double positive_overlap;     // cfg.TRAIN.RPN_POSITIVE_OVERLAP
+  double negative_overlap;     // cfg.TRAIN.RPN_NEGATIVE_OVERLAP
+  int clobber_positives;       // cfg.TRAIN.RPN_CLOBBER_POSITIVES
+  int num_fg;                  // int(RPN_FG_FRACTION * RPN_BATCHSIZE)
+  int batch_size;              // cfg.TRAIN.RPN_BATCHSIZE
+  double positive_weight;      // cfg.TRAIN.RPN_POSITIVE_WEIGHT
+  float inside_weights[4];     // cfg.TRAIN.RPN_BBOX_INSIDE_WEIGHTS
+  int normalize_targets;       // cfg.TRAIN.RPN_NORMALIZE_TARGETS
+  double means[4], stds[4];    // cfg.TRAIN.RPN_NORMALIZE_MEANS / STDS
+  int threads;                 // <= 0 picks from the problem size
+};
+
+// anchors: A x 4 base anchors; gt_boxes: num_gt x gt_dim (x1 y1 x2 y2 ...).
+// mt_key/mt_pos: numpy RandomState, advanced in place.
+// Outputs are written in the layer's top blob layouts: labels (A, H, W),
+// bbox_targets and both weights (A * 4, H, W). Returns the number of
+// anchors inside the image.
+int _anchor_targets(const double* anchors, int num_anchors, int height, int width,
+                    int feat_stride, double im_height, double im_width, int allowed_border,
+                    const float* gt_boxes, int num_gt, int gt_dim,
+                    const AnchorTargetParams* params, uint32_t* mt_key, int* mt_pos,
+                    float* labels, float* bbox_targets, float* bbox_inside_weights,
+                    float* bbox_outside_weights);
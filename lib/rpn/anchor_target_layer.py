@@ -14,6 +14,7 @@ import numpy.random as npr
 from generate_anchors import generate_anchors
 from utils.cython_bbox import bbox_overlaps
 from fast_rcnn.bbox_transform import bbox_transform
+from rpn.cython_anchor_target import anchor_targets
 
 DEBUG = False
 
@@ -81,6 +82,18 @@ class AnchorTargetLayer(caffe.Layer):
         # im_info
         im_info = bottom[2].data[0, :]
 
+        if cfg.TRAIN.RPN_NATIVE_TARGETS and not DEBUG:
+            # same labels, targets and npr draws, without the N x K overlaps
+            outputs = anchor_targets(self._anchors, height, width,
+                                     self._feat_stride, im_info,
+                                     self._allowed_border,
+                                     gt_boxes.reshape(gt_boxes.shape[0], -1),
+                                     cfg.TRAIN)
+            for i, blob in enumerate(outputs):
+                top[i].reshape(*blob.shape)
+                top[i].data[...] = blob
+            return
+
         if DEBUG:
             print ''
             print 'im_size: ({}, {})'.format(im_info[0], im_info[1])
@@ -106,7 +106,7 @@ def imdb_proposals(net, imdb):
     _t = Timer()
     imdb_boxes = [[] for _ in xrange(imdb.num_images)]
     for i in xrange(imdb.num_images):
-        im = cv2.imread(imdb.image_path_at(i))
+        im = imdb.image_at(i)
         _t.tic()
         imdb_boxes[i], scores = im_proposals(net, im)
         _t.toc()
@@ -0,0 +1,99 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+import numpy as np
+cimport numpy as np
+import numpy.random as npr
+from libc.stdint cimport uint32_t
+
+cdef extern from "proposal_target_kernel.hpp":
+    ctypedef struct ProposalTargetParams:
+        double fg_thresh
+        double bg_thresh_hi
+        double bg_thresh_lo
+        int rois_per_image
+        int fg_rois_per_image
+        int normalize_targets
+        double means[4]
+        double stds[4]
+        float inside_weights[4]
+        int agnostic
+        int threads
+    int _sample_rois(const float*, int, const float*, int, int,
+                     const ProposalTargetParams*, uint32_t*, int*,
+                     np.int32_t*, np.int32_t*, int*) nogil
+    void _roi_targets(const float*, int, const float*, int, const np.int32_t*,
+                      const np.int32_t*, int, int, int, const ProposalTargetParams*,
+                      float*, float*, float*, float*, float*) nogil
+
+assert sizeof(int) == sizeof(np.int32_t)
+
+def proposal_targets(rois, gt_boxes, int num_classes, train_cfg, int threads=0):
+    """
+    Native _sample_rois + _get_bbox_regression_labels. The gt boxes are added
+    to the candidate rois, and fg/bg are drawn from numpy's global RandomState
+    exactly as the Python layer does.
+
+    Returns
+    -------
+    labels: (R,) float32
+    rois: (R, 5) float32
+    bbox_targets, bbox_inside_weights, bbox_outside_weights:
+        (R, 4 * num_classes) float32
+    """
+    cdef np.ndarray[np.float32_t, ndim=2, mode='c'] r = \
+            np.ascontiguousarray(rois, dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=2, mode='c'] gt = \
+            np.ascontiguousarray(gt_boxes, dtype=np.float32)
+    cdef int num_rois = r.shape[0], num_gt = gt.shape[0]
+    assert r.shape[1] == 5 and gt.shape[1] == 5 and num_gt > 0
+    assert np.all(r[:, 0] == 0), 'Only single item batches are supported'
+
+    cdef ProposalTargetParams p
+    p.fg_thresh = train_cfg.FG_THRESH
+    p.bg_thresh_hi = train_cfg.BG_THRESH_HI
+    p.bg_thresh_lo = train_cfg.BG_THRESH_LO
+    p.rois_per_image = -1 if train_cfg.BATCH_SIZE == -1 else train_cfg.BATCH_SIZE
+    p.fg_rois_per_image = 0 if p.rois_per_image < 0 else \
+            int(np.round(train_cfg.FG_FRACTION * train_cfg.BATCH_SIZE))
+    p.normalize_targets = bool(train_cfg.BBOX_NORMALIZE_TARGETS_PRECOMPUTED)
+    for c in range(4):
+        p.means[c] = train_cfg.BBOX_NORMALIZE_MEANS[c]
+        p.stds[c] = train_cfg.BBOX_NORMALIZE_STDS[c]
+        p.inside_weights[c] = train_cfg.BBOX_INSIDE_WEIGHTS[c]
+    p.agnostic = bool(train_cfg.AGNOSTIC)
+    p.threads = threads
+
+    state = npr.get_state()
+    cdef np.ndarray[np.uint32_t, ndim=1, mode='c'] key = \
+            np.array(state[1], dtype=np.uint32)
+    cdef int pos = state[2]
+    cdef np.ndarray[np.int32_t, ndim=1] keep_inds = \
+            np.empty(num_rois + num_gt, dtype=np.int32)
+    cdef np.ndarray[np.int32_t, ndim=1] gt_assignment = \
+            np.empty(num_rois + num_gt, dtype=np.int32)
+    cdef int num_fg = 0
+    cdef int num_keep = _sample_rois(<float*> r.data, num_rois, &gt[0, 0], num_gt, 5,
+                                     &p, &key[0], &pos, &keep_inds[0],
+                                     &gt_assignment[0], &num_fg)
+    npr.set_state((state[0], key, pos) + tuple(state[3:]))
+
+    cdef np.ndarray[np.float32_t, ndim=1] labels = \
+            np.empty(num_keep, dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=2] out_rois = \
+            np.empty((num_keep, 5), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=2] bbox_targets = \
+            np.empty((num_keep, 4 * num_classes), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=2] bbox_inside_weights = \
+            np.empty((num_keep, 4 * num_classes), dtype=np.float32)
+    cdef np.ndarray[np.float32_t, ndim=2] bbox_outside_weights = \
+            np.empty((num_keep, 4 * num_classes), dtype=np.float32)
+    if num_keep > 0:
+        _roi_targets(<float*> r.data, num_rois, &gt[0, 0], 5, &keep_inds[0],
+                     &gt_assignment[0], num_keep, num_fg, num_classes, &p,
+                     &out_rois[0, 0], &labels[0], &bbox_targets[0, 0],
+                     &bbox_inside_weights[0, 0], &bbox_outside_weights[0, 0])
+    return labels, out_rois, bbox_targets, bbox_inside_weights, \
+            bbox_outside_weights
@@ -0,0 +1,123 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "proposal_target_kernel.hpp"
+#include "iou_engine.hpp"
+#include "np_random.hpp"
+#include <cmath>
+#include <limits>
+#include <string.h>
+
+namespace {
+
+// overlaps.max(axis=1) / overlaps.argmax(axis=1)
+struct RowMaxVisit {
+  double* row_max;
+  int* row_arg;
+
+  void operator()(size_t i, size_t j0, const double* v, size_t n) {
+    double best = j0 == 0 ? -std::numeric_limits<double>::infinity() : row_max[i];
+    int arg = j0 == 0 ? 0 : row_arg[i];
+    for (size_t j = 0; j < n; ++j)
+      if (v[j] > best) { best = v[j]; arg = (int) (j0 + j); }
+    row_max[i] = best;
+    row_arg[i] = arg;
+  }
+};
+
+// Candidate i as x1 y1 x2 y2: a roi, or one of the gt boxes appended to them.
+inline const float* candidate(const float* rois, int num_rois, const float* gt_boxes,
+                              int gt_dim, int i) {
+  return i < num_rois ? rois + i * 5 + 1 : gt_boxes + (i - num_rois) * gt_dim;
+}
+
+}  // namespace
+
+int _sample_rois(const float* rois, int num_rois, const float* gt_boxes, int num_gt,
+                 int gt_dim, const ProposalTargetParams* p, uint32_t* mt_key,
+                 int* mt_pos, int* keep_inds, int* gt_assignment, int* num_fg) {
+  const int n = num_rois + num_gt;
+  std::vector<double> boxes(n * 4), gt(num_gt * 4);
+  for (int i = 0; i < n; ++i) {
+    const float* b = candidate(rois, num_rois, gt_boxes, gt_dim, i);
+    for (int c = 0; c < 4; ++c) boxes[i * 4 + c] = b[c];
+  }
+  for (int g = 0; g < num_gt; ++g)
+    for (int c = 0; c < 4; ++c) gt[g * 4 + c] = gt_boxes[g * gt_dim + c];
+  iou::Boxes<double> ex, gtb;
+  ex.assign(&boxes[0], n, 4, IOU_BOX_XYXY, 1.0);
+  gtb.assign(&gt[0], num_gt, 4, IOU_BOX_XYXY, 1.0);
+
+  std::vector<double> max_overlaps(n);
+  std::vector<int> assignment(n);
+  iou::parallelRows(n, iou::numThreads((size_t) n * num_gt, p->threads),
+                    [&](size_t i0, size_t i1, int) {
+    RowMaxVisit visit = {&max_overlaps[0], &assignment[0]};
+    iou::forEachTile(ex, gtb, 1.0, (const unsigned char*) NULL, i0, i1, visit);
+  });
+
+  std::vector<int> fg_inds, bg_inds, fg_keep, bg_keep;
+  for (int i = 0; i < n; ++i) {
+    if (max_overlaps[i] >= p->fg_thresh) fg_inds.push_back(i);
+    if (max_overlaps[i] < p->bg_thresh_hi && max_overlaps[i] >= p->bg_thresh_lo)
+      bg_inds.push_back(i);
+  }
+  bool keep_all = p->rois_per_image < 0;
+  int fg_this = keep_all ? (int) fg_inds.size()
+                         : std::min(p->fg_rois_per_image, (int) fg_inds.size());
+  int bg_this = keep_all ? (int) bg_inds.size()
+                         : std::min(p->rois_per_image - fg_this, (int) bg_inds.size());
+
+  // numpy draws a full permutation even when every index is kept
+  nprand::RandomState rng(mt_key, *mt_pos);
+  if (!fg_inds.empty()) rng.choice(fg_inds, fg_this, fg_keep);
+  if (!bg_inds.empty()) rng.choice(bg_inds, bg_this, bg_keep);
+  rng.store(mt_key, mt_pos);
+
+  int k = 0;
+  for (size_t i = 0; i < fg_keep.size(); ++i) keep_inds[k++] = fg_keep[i];
+  for (size_t i = 0; i < bg_keep.size(); ++i) keep_inds[k++] = bg_keep[i];
+  for (int i = 0; i < k; ++i) gt_assignment[i] = assignment[keep_inds[i]];
+  *num_fg = fg_this;
+  return k;
+}
+
+void _roi_targets(const float* rois, int num_rois, const float* gt_boxes, int gt_dim,
+                  const int* keep_inds, const int* gt_assignment, int num_keep, int num_fg,
+                  int num_classes, const ProposalTargetParams* p, float* rois_out,
+                  float* labels, float* targets_out, float* inside_out, float* outside_out) {
+  const size_t dim = 4 * (size_t) num_classes;
+  memset(targets_out, 0, sizeof(float) * dim * num_keep);
+  memset(inside_out, 0, sizeof(float) * dim * num_keep);
+  memset(outside_out, 0, sizeof(float) * dim * num_keep);
+  for (int k = 0; k < num_keep; ++k) {
+    int i = keep_inds[k];
+    const float* g = gt_boxes + gt_assignment[k] * gt_dim;
+    const float* e = candidate(rois, num_rois, gt_boxes, gt_dim, i);
+    rois_out[k * 5] = i < num_rois ? rois[i * 5] : 0;
+    for (int c = 0; c < 4; ++c) rois_out[k * 5 + 1 + c] = e[c];
+    // bg rois are clamped to label 0
+    float cls = k < num_fg ? g[4] : 0;
+    labels[k] = cls;
+    if (!(cls > 0)) continue;
+
+    // bbox_transform, all in float32 like the blobs it is fed with
+    float ew = e[2] - e[0] + 1.0f, eh = e[3] - e[1] + 1.0f;
+    float ecx = e[0] + 0.5f * ew, ecy = e[1] + 0.5f * eh;
+    float gw = g[2] - g[0] + 1.0f, gh = g[3] - g[1] + 1.0f;
+    float gcx = g[0] + 0.5f * gw, gcy = g[1] + 0.5f * gh;
+    float t[4] = {(gcx - ecx) / ew, (gcy - ecy) / eh,
+                  std::log(gw / ew), std::log(gh / eh)};
+    size_t start = 4 * (p->agnostic ? 1 : (size_t) cls);
+    for (int c = 0; c < 4; ++c) {
+      float v = t[c];
+      if (p->normalize_targets) v = (float) ((t[c] - p->means[c]) / p->stds[c]);
+      size_t o = k * dim + start + c;
+      targets_out[o] = v;
+      inside_out[o] = p->inside_weights[c];
+      outside_out[o] = p->inside_weights[c] > 0 ? 1.0f : 0.0f;
+    }
+  }
+}
@@ -0,0 +1,40 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Native _sample_rois / _get_bbox_regression_labels of
+// rpn/proposal_target_layer.py, drawing the same npr.choice samples.
+
+#pragma once
+#include <stdint.h>
+
+struct ProposalTargetParams {
+  double fg_thresh;            // cfg.TRAIN.FG_THRESH
+  double bg_thresh_hi;         // cfg.TRAIN.BG_THRESH_HI
+  double bg_thresh_lo;         // cfg.TRAIN.BG_THRESH_LO
+  int rois_per_image;          // cfg.TRAIN.BATCH_SIZE, -1 keeps every roi (OHEM)
+  int fg_rois_per_image;       // np.round(FG_FRACTION * BATCH_SIZE)
+  int normalize_targets;       // cfg.TRAIN.BBOX_NORMALIZE_TARGETS_PRECOMPUTED
+  double means[4], stds[4];    // cfg.TRAIN.BBOX_NORMALIZE_MEANS / STDS
+  float inside_weights[4];     // cfg.TRAIN.BBOX_INSIDE_WEIGHTS
+  int agnostic;                // cfg.TRAIN.AGNOSTIC
+  int threads;                 // <= 0 picks from the problem size
+};
+
+// Candidates are the num_rois rois (batch_idx x1 y1 x2 y2) followed by the
+// gt boxes themselves. Writes the sampled candidate indices (fg first, in draw
+// order) to keep_inds and their gt to gt_assignment; both must hold
+// num_rois + num_gt entries. Returns the number kept, *num_fg of them fg.
+int _sample_rois(const float* rois, int num_rois, const float* gt_boxes, int num_gt,
+                 int gt_dim, const ProposalTargetParams* params, uint32_t* mt_key,
+                 int* mt_pos, int* keep_inds, int* gt_assignment, int* num_fg);
+
+// Gathers the sampled rois and labels and expands their regression targets
+// into the 4 * num_classes layout. Every output has num_keep rows and is fully
+// overwritten.
+void _roi_targets(const float* rois, int num_rois, const float* gt_boxes, int gt_dim,
+                  const int* keep_inds, const int* gt_assignment, int num_keep, int num_fg,
+                  int num_classes, const ProposalTargetParams* params, float* rois_out,
+                  float* labels, float* bbox_targets, float* bbox_inside_weights,
+                  float* bbox_outside_weights);
@@ -12,6 +12,7 @@ import numpy.random as npr
 from fast_rcnn.config import cfg
 from fast_rcnn.bbox_transform import bbox_transform
 from utils.cython_bbox import bbox_overlaps
+from rpn.cython_proposal_target import proposal_targets
 
 DEBUG = False
 
@@ -45,6 +46,16 @@ class ProposalTargetLayer(caffe.Layer):
         # and other times after box coordinates -- normalize to one format
         gt_boxes = bottom[1].data
         gt_boxes = gt_boxes.reshape(gt_boxes.shape[0], gt_boxes.shape[1])
+
+        if cfg.TRAIN.NATIVE_ROI_TARGETS and not DEBUG:
+            # same samples and targets, see rpn/proposal_target_kernel.cpp
+            labels, rois, bbox_targets, bbox_inside_weights, \
+                bbox_outside_weights = proposal_targets(
+                    all_rois, gt_boxes, self._num_classes, cfg.TRAIN)
+            self._set_tops(top, rois, labels, bbox_targets,
+                           bbox_inside_weights, bbox_outside_weights)
+            return
+
         # Include ground-truth boxes in the set of candidate rois
         zeros = np.zeros((gt_boxes.shape[0], 1), dtype=gt_boxes.dtype)
         all_rois = np.vstack(
@@ -75,6 +86,12 @@ class ProposalTargetLayer(caffe.Layer):
             print 'num bg avg: {}'.format(self._bg_num / self._count)
             print 'ratio: {:.3f}'.format(float(self._fg_num) / float(self._bg_num))
 
+        bbox_outside_weights = np.array(bbox_inside_weights > 0).astype(np.float32)
+        self._set_tops(top, rois, labels, bbox_targets,
+                       bbox_inside_weights, bbox_outside_weights)
+
+    def _set_tops(self, top, rois, labels, bbox_targets,
+                  bbox_inside_weights, bbox_outside_weights):
         # sampled rois
         # modified by ywxiong
         rois = rois.reshape((rois.shape[0], rois.shape[1], 1, 1))
@@ -101,9 +118,9 @@ class ProposalTargetLayer(caffe.Layer):
 
         # bbox_outside_weights
         # modified by ywxiong
-        bbox_inside_weights = bbox_inside_weights.reshape((bbox_inside_weights.shape[0], bbox_inside_weights.shape[1], 1, 1))
-        top[4].reshape(*bbox_inside_weights.shape)
-        top[4].data[...] = np.array(bbox_inside_weights > 0).astype(np.float32)
+        bbox_outside_weights = bbox_outside_weights.reshape((bbox_outside_weights.shape[0], bbox_outside_weights.shape[1], 1, 1))
+        top[4].reshape(*bbox_outside_weights.shape)
+        top[4].data[...] = bbox_outside_weights
 
     def backward(self, top, propagate_down, bottom):
         """This layer does not propagate gradients."""
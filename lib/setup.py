@@ -64,6 +64,11 @@ try:
 except AttributeError:
     numpy_include = np.get_numpy_include()
 
+# The native image loader reads JPEG too if libjpeg is installed
+HAVE_JPEG = any(os.path.exists(pjoin(d, 'jpeglib.h')) for d in
+                ['/usr/include', '/usr/local/include',
+                 '/usr/include/x86_64-linux-gnu'])
+
 def customize_compiler_for_nvcc(self):
     """inject deep into distutils to customize how the dispatch
     to gcc/nvcc works.
@@ -91,6 +96,9 @@ def customize_compiler_for_nvcc(self):
             # use only a subset of the extra_postargs, which are 1-1 translated
             # from the extra_compile_args in the Extension class
             postargs = extra_postargs['nvcc']
+        elif os.path.splitext(src)[1] in ('.cpp', '.cc') and 'g++' in extra_postargs:
+            # C++ sources of an extension that is otherwise C
+            postargs = extra_postargs['g++']
         else:
             postargs = extra_postargs['gcc']
 
@@ -112,9 +120,76 @@ class custom_build_ext(build_ext):
 ext_modules = [
     Extension(
         "utils.cython_bbox",
-        ["utils/bbox.pyx"],
-        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function"]},
-        include_dirs = [numpy_include]
+        ["utils/bbox.pyx", "utils/iou_engine.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = [numpy_include, 'utils']
+    ),
+    Extension(
+        "rpn.cython_anchor_target",
+        ["rpn/anchor_target.pyx", "rpn/anchor_target_kernel.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = [numpy_include, 'rpn', 'utils']
+    ),
+    Extension(
+        "rpn.cython_proposal_target",
+        ["rpn/proposal_target.pyx", "rpn/proposal_target_kernel.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = [numpy_include, 'rpn', 'utils']
+    ),
+    Extension(
+        "datasets.cython_det_eval",
+        ["datasets/det_eval.pyx", "datasets/det_eval_kernel.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = [numpy_include, 'datasets', 'utils']
+    ),
+    Extension(
+        "datasets.cython_shard",
+        ["datasets/shard.pyx", "datasets/shard_io.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11"]},
+        include_dirs = [numpy_include, 'datasets']
+    ),
+    Extension(
+        "data_preparation.cython_dataset_builder",
+        ["data_preparation/dataset_builder.pyx",
+         "data_preparation/dataset_builder_kernel.cpp"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = ['data_preparation']
+    ),
+    Extension(
+        "utils.cython_image_loader",
+        ["utils/image_loader.pyx", "utils/image_loader_kernel.cpp"],
+        language='c++',
+        define_macros=[('HAVE_JPEG', None)] if HAVE_JPEG else [],
+        libraries=['jpeg'] if HAVE_JPEG else [],
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11", "-pthread"]},
+        extra_link_args=["-pthread"],
+        include_dirs = [numpy_include, 'utils']
+    ),
+    Extension(
+        "rdb.cython_shm",
+        ["rdb/shm.pyx", "rdb/shm_kernel.cpp", "../rdbReader/PixelDecoder.cc"],
+        language='c++',
+        extra_compile_args={'gcc': ["-Wno-cpp", "-Wno-unused-function",
+                                    "-std=c++11"]},
+        include_dirs = [numpy_include, 'rdb', '../rdbReader']
     ),
     Extension(
         "nms.cpu_nms",
@@ -141,10 +216,17 @@ ext_modules = [
     ),
     Extension(
         'pycocotools._mask',
-        sources=['pycocotools/maskApi.c', 'pycocotools/_mask.pyx'],
-        include_dirs = [numpy_include, 'pycocotools'],
+        sources=['pycocotools/maskApi.c', 'pycocotools/_mask.pyx',
+                 'utils/iou_engine.cpp'],
+        include_dirs = [numpy_include, 'pycocotools', 'utils'],
+        # maskApi.c and _mask.pyx stay C, iou_engine.cpp gets the C++ flags
         extra_compile_args={
-            'gcc': ['-Wno-cpp', '-Wno-unused-function', '-std=c99']},
+            'gcc': ['-Wno-cpp', '-Wno-unused-function', '-std=c99',
+                    '-pthread'],
+            'g++': ['-Wno-cpp', '-Wno-unused-function', '-std=c++11',
+                    '-pthread']},
+        libraries=['stdc++'],
+        extra_link_args=['-pthread'],
     ),
 ]
 
@@ -8,21 +8,141 @@
 cimport cython
 import numpy as np
 cimport numpy as np
+from libc.stdlib cimport free
 
 DTYPE = np.float
 ctypedef np.float_t DTYPE_t
 
-def bbox_overlaps(
-        np.ndarray[DTYPE_t, ndim=2] boxes,
-        np.ndarray[DTYPE_t, ndim=2] query_boxes):
+cdef extern from "iou_engine.h":
+    ctypedef struct IouOpts:
+        int format
+        double offset
+        const unsigned char *crowd
+        int threads
+    ctypedef struct IouPair:
+        unsigned int row
+        unsigned int col
+        double iou
+    int IOU_BOX_XYXY
+    void iouMatrix(const double *a, size_t na, size_t sa,
+                   const double *b, size_t nb, size_t sb,
+                   const IouOpts *opts, double *o) nogil
+    void iouMatrixF(const float *a, size_t na, size_t sa,
+                    const float *b, size_t nb, size_t sb,
+                    const IouOpts *opts, float *o) nogil
+    size_t iouSparse(const double *a, size_t na, size_t sa,
+                     const double *b, size_t nb, size_t sb,
+                     const IouOpts *opts, double thresh, IouPair **pairs) nogil
+
+cdef IouOpts _opts(int threads):
+    cdef IouOpts opts
+    opts.format = IOU_BOX_XYXY
+    opts.offset = 1.0
+    opts.crowd = NULL
+    opts.threads = threads
+    return opts
+
+def bbox_overlaps(boxes, query_boxes, int threads=0):
     """
     Parameters
     ----------
     boxes: (N, 4) ndarray of float
     query_boxes: (K, 4) ndarray of float
+    threads: worker threads, 0 to pick from the problem size
     Returns
     -------
     overlaps: (N, K) ndarray of overlap between boxes and query_boxes
+
+    Only the first four columns are read, so (K, 5) gt boxes may be passed
+    as is. float32 inputs give a float32 matrix, anything else float64.
+    """
+    if boxes.dtype == np.float32 and query_boxes.dtype == np.float32:
+        return _bbox_overlaps_f32(np.ascontiguousarray(boxes),
+                                  np.ascontiguousarray(query_boxes), threads)
+    return _bbox_overlaps(np.ascontiguousarray(boxes, dtype=DTYPE),
+                          np.ascontiguousarray(query_boxes, dtype=DTYPE), threads)
+
+def _bbox_overlaps(
+        np.ndarray[DTYPE_t, ndim=2, mode='c'] boxes,
+        np.ndarray[DTYPE_t, ndim=2, mode='c'] query_boxes,
+        int threads):
+    cdef unsigned int N = boxes.shape[0]
+    cdef unsigned int K = query_boxes.shape[0]
+    cdef np.ndarray[DTYPE_t, ndim=2] overlaps = np.empty((N, K), dtype=DTYPE)
+    cdef IouOpts opts = _opts(threads)
+    cdef size_t sa = boxes.shape[1], sb = query_boxes.shape[1]
+    # every element is written by the engine, no need to zero first
+    cdef double *a
+    cdef double *b
+    cdef double *o
+    if N == 0 or K == 0:
+        return overlaps
+    a, b, o = &boxes[0, 0], &query_boxes[0, 0], &overlaps[0, 0]
+    with nogil:
+        iouMatrix(a, N, sa, b, K, sb, &opts, o)
+    return overlaps
+
+def _bbox_overlaps_f32(
+        np.ndarray[np.float32_t, ndim=2, mode='c'] boxes,
+        np.ndarray[np.float32_t, ndim=2, mode='c'] query_boxes,
+        int threads):
+    cdef unsigned int N = boxes.shape[0]
+    cdef unsigned int K = query_boxes.shape[0]
+    cdef np.ndarray[np.float32_t, ndim=2] overlaps = \
+            np.empty((N, K), dtype=np.float32)
+    cdef IouOpts opts = _opts(threads)
+    cdef size_t sa = boxes.shape[1], sb = query_boxes.shape[1]
+    cdef float *a
+    cdef float *b
+    cdef float *o
+    if N == 0 or K == 0:
+        return overlaps
+    a, b, o = &boxes[0, 0], &query_boxes[0, 0], &overlaps[0, 0]
+    with nogil:
+        iouMatrixF(a, N, sa, b, K, sb, &opts, o)
+    return overlaps
+
+def bbox_overlaps_sparse(boxes, query_boxes, double thresh, int threads=0):
+    """
+    Sparse form of bbox_overlaps: only pairs with overlap > thresh.
+
+    Returns
+    -------
+    rows, cols: (M,) int32 ndarrays of indices into boxes and query_boxes
+    overlaps: (M,) float ndarray, in row-major order
+    """
+    cdef np.ndarray[DTYPE_t, ndim=2, mode='c'] b = \
+            np.ascontiguousarray(boxes, dtype=DTYPE)
+    cdef np.ndarray[DTYPE_t, ndim=2, mode='c'] q = \
+            np.ascontiguousarray(query_boxes, dtype=DTYPE)
+    cdef unsigned int N = b.shape[0]
+    cdef unsigned int K = q.shape[0]
+    cdef IouOpts opts = _opts(threads)
+    cdef size_t sa = b.shape[1], sb = q.shape[1]
+    cdef IouPair *pairs = NULL
+    cdef size_t m = 0, k
+    cdef double *pa
+    cdef double *pb
+    if N > 0 and K > 0:
+        pa, pb = &b[0, 0], &q[0, 0]
+        with nogil:
+            m = iouSparse(pa, N, sa, pb, K, sb, &opts, thresh, &pairs)
+    cdef np.ndarray[np.int32_t, ndim=1] rows = np.empty(m, dtype=np.int32)
+    cdef np.ndarray[np.int32_t, ndim=1] cols = np.empty(m, dtype=np.int32)
+    cdef np.ndarray[DTYPE_t, ndim=1] overlaps = np.empty(m, dtype=DTYPE)
+    for k in range(m):
+        rows[k] = pairs[k].row
+        cols[k] = pairs[k].col
+        overlaps[k] = pairs[k].iou
+    free(pairs)
+    return rows, cols, overlaps
+
+def bbox_overlaps_loop(
+        np.ndarray[DTYPE_t, ndim=2] boxes,
+        np.ndarray[DTYPE_t, ndim=2] query_boxes):
+    """
+    The former per-pair loop of bbox_overlaps, kept as the reference for
+    tools/bench_bbox_overlaps.py.
     """
     cdef unsigned int N = boxes.shape[0]
     cdef unsigned int K = query_boxes.shape[0]
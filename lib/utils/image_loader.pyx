@@ -0,0 +1,162 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Asynchronous image loader (see image_loader_kernel.hpp): worker threads
+decode, scale, flip and mean-subtract training images into blobs while the
+net runs on the previous ones."""
+
+import numpy as np
+cimport numpy as np
+from libc.stdint cimport uint8_t, uint64_t
+from libc.stdlib cimport malloc, free
+
+np.import_array()
+
+cdef extern from "image_loader_kernel.hpp":
+    ctypedef struct ImageLoaderParams:
+        int threads
+        double cache_bytes
+        float pixel_means[3]
+        int max_size
+    ctypedef struct ImageLoaderResult:
+        const float* data
+        int height, width
+        int orig_height, orig_width
+        double scale
+        int image, target_size, flip
+        int ok
+        void* handle
+    ctypedef struct ImageLoaderStats:
+        uint64_t served, cache_hits, cache_misses, failed
+        uint64_t cache_bytes, cache_images
+        double decode_seconds
+    ctypedef struct _ImageLoader "ImageLoader":
+        pass
+    _ImageLoader* _loader_create(const ImageLoaderParams*)
+    void _loader_destroy(_ImageLoader*) nogil
+    void _loader_set_images(_ImageLoader*, int, const char* const*,
+                            const uint8_t* const*, const uint64_t*) nogil
+    void _loader_submit(_ImageLoader*, int, int, int)
+    int _loader_pending(_ImageLoader*)
+    int _loader_next(_ImageLoader*, ImageLoaderResult*) nogil
+    void _loader_release(void*)
+    void _loader_stats(_ImageLoader*, ImageLoaderStats*)
+
+cdef class _Blob:
+    # Owns the buffer of a result; it is the base of the array handed out.
+    cdef void* handle
+
+    def __dealloc__(self):
+        _loader_release(self.handle)
+
+cdef class ImageLoader:
+    """Loads the images of set_images() in the order they are submitted.
+
+    threads: workers, 0 for one per core
+    cache_mb: budget of the decoded image cache in MB, 0 to disable it
+    pixel_means, max_size: cfg.PIXEL_MEANS and cfg.TRAIN.MAX_SIZE
+    """
+    cdef _ImageLoader* _l
+    cdef list _sources
+
+    def __cinit__(self, pixel_means, int max_size, int threads=0,
+                  double cache_mb=0):
+        cdef ImageLoaderParams p
+        means = np.asarray(pixel_means, dtype=np.float32).reshape(-1)
+        assert means.shape[0] == 3, 'one mean per channel (BGR)'
+        p.threads = threads
+        p.cache_bytes = cache_mb * (1 << 20)
+        for c in range(3):
+            p.pixel_means[c] = means[c]
+        p.max_size = max_size
+        self._l = _loader_create(&p)
+        self._sources = []
+
+    def __dealloc__(self):
+        if self._l != NULL:
+            with nogil:
+                _loader_destroy(self._l)
+
+    def set_images(self, sources):
+        """Image i is read from sources[i]: a path, or the encoded image as a
+        uint8 array or buffer (kept referenced while the loader lives).
+        Wait for the submitted images first."""
+        assert _loader_pending(self._l) == 0, 'images are still being loaded'
+        cdef int n = len(sources)
+        cdef const char** paths = <const char**> malloc(n * sizeof(char*))
+        cdef const uint8_t** data = <const uint8_t**> malloc(n * sizeof(uint8_t*))
+        cdef uint64_t* sizes = <uint64_t*> malloc(n * sizeof(uint64_t))
+        cdef np.ndarray a
+        keep = []
+        try:
+            for i, s in enumerate(sources):
+                paths[i] = NULL
+                data[i] = NULL
+                sizes[i] = 0
+                if isinstance(s, (str, unicode)):
+                    path = s.encode('utf-8') if isinstance(s, unicode) else s
+                    keep.append(path)
+                    paths[i] = path
+                else:
+                    a = np.ascontiguousarray(s, dtype=np.uint8).reshape(-1)
+                    keep.append(a)
+                    data[i] = <const uint8_t*> np.PyArray_DATA(a)
+                    sizes[i] = a.shape[0]
+            with nogil:
+                _loader_set_images(self._l, n, paths, data, sizes)
+            self._sources = keep
+        finally:
+            free(paths)
+            free(data)
+            free(sizes)
+
+    def submit(self, int image, int target_size, bint flip=False):
+        """Queue image at the scale whose shortest side is target_size."""
+        assert 0 <= image < len(self._sources), 'no such image'
+        _loader_submit(self._l, image, target_size, flip)
+
+    def pending(self):
+        """Submitted images not yet returned by next()."""
+        return _loader_pending(self._l)
+
+    def next(self):
+        """Wait for the oldest submitted image.
+
+        Returns a dict with 'data' ((1, 3, H, W) float32 blob, None if the
+        image could not be loaded), 'im_scale', 'image', 'target_size',
+        'flip' and the decoded 'height' / 'width'. Raises IndexError if
+        nothing is pending.
+        """
+        cdef ImageLoaderResult r
+        cdef int got
+        with nogil:
+            got = _loader_next(self._l, &r)
+        if not got:
+            raise IndexError('no image submitted')
+        res = {'data': None, 'im_scale': r.scale, 'image': r.image,
+               'target_size': r.target_size, 'flip': bool(r.flip),
+               'height': r.orig_height, 'width': r.orig_width}
+        if not r.ok:
+            return res
+        cdef _Blob owner = _Blob()
+        owner.handle = r.handle
+        cdef np.npy_intp dims[4]
+        dims[0] = 1
+        dims[1] = 3
+        dims[2] = r.height
+        dims[3] = r.width
+        cdef np.ndarray blob = np.PyArray_SimpleNewFromData(
+            4, dims, np.NPY_FLOAT32, <void*> r.data)
+        np.set_array_base(blob, owner)
+        res['data'] = blob
+        return res
+
+    def stats(self):
+        cdef ImageLoaderStats s
+        _loader_stats(self._l, &s)
+        return {'served': s.served, 'cache_hits': s.cache_hits,
+                'cache_misses': s.cache_misses, 'failed': s.failed,
+                'cache_bytes': s.cache_bytes, 'cache_images': s.cache_images,
+                'decode_seconds': s.decode_seconds}
@@ -0,0 +1,467 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "image_loader_kernel.hpp"
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_JPEG
+#include <setjmp.h>
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// 8 bit BGR, row major
+struct Image {
+  int h, w;
+  std::vector<uint8_t> bgr;
+
+  Image() : h(0), w(0) {}
+};
+
+struct Resized {
+  Image im;
+  double scale;
+  int orig_h, orig_w;
+};
+
+struct Source {
+  std::string path;            // empty: data / size
+  const uint8_t* data;
+  uint64_t size;
+};
+
+struct Blob {
+  std::vector<float> data;
+};
+
+struct Request {
+  ImageLoaderResult result;
+  bool done;
+};
+
+bool readFile(const std::string& path, std::vector<uint8_t>& buf) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok) {
+    buf.resize(st.st_size);
+    size_t done = 0;
+    while (ok && done < buf.size()) {
+      ssize_t n = read(fd, &buf[done], buf.size() - done);
+      ok = n > 0;
+      done += ok ? n : 0;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+// Binary PGM (P5) and PPM (P6); samples above 8 bits are scaled down.
+bool decodePnm(const uint8_t* p, size_t n, Image& im) {
+  if (n < 2 || p[0] != 'P' || (p[1] != '5' && p[1] != '6')) return false;
+  int channels = p[1] == '6' ? 3 : 1;
+  size_t pos = 2;
+  long v[3];
+  for (int k = 0; k < 3; ++k) {
+    for (;;) {
+      if (pos >= n) return false;
+      if (isspace(p[pos])) {
+        ++pos;
+      } else if (p[pos] == '#') {
+        while (pos < n && p[pos] != '\n') ++pos;
+      } else {
+        break;
+      }
+    }
+    if (!isdigit(p[pos])) return false;
+    long x = 0;
+    while (pos < n && isdigit(p[pos]) && x <= 1 << 20) x = 10 * x + (p[pos++] - '0');
+    v[k] = x;
+  }
+  // a single whitespace separates the header from the samples
+  if (pos >= n || !isspace(p[pos])) return false;
+  ++pos;
+  long w = v[0], h = v[1], maxval = v[2];
+  if (w <= 0 || h <= 0 || w > 1 << 16 || h > 1 << 16 || maxval < 1 || maxval > 65535) return false;
+  size_t bytes = maxval > 255 ? 2 : 1;
+  size_t count = (size_t)w * h;
+  if ((n - pos) / (channels * bytes) < count) return false;
+
+  im.w = w;
+  im.h = h;
+  im.bgr.resize(3 * count);
+  const uint8_t* s = p + pos;
+  uint8_t* d = &im.bgr[0];
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t c[3];
+    for (int k = 0; k < channels; ++k) {
+      unsigned int x = bytes == 1 ? s[0] : (s[0] << 8) | s[1];
+      s += bytes;
+      c[k] = maxval == 255 ? x : (x * 255 + maxval / 2) / maxval;
+    }
+    if (channels == 1) c[1] = c[2] = c[0];
+    d[3 * i] = c[2];
+    d[3 * i + 1] = c[1];
+    d[3 * i + 2] = c[0];
+  }
+  return true;
+}
+
+#ifdef HAVE_JPEG
+struct JpegError {
+  jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr info) { longjmp(((JpegError*)info->err)->jump, 1); }
+
+bool decodeJpeg(const uint8_t* p, size_t n, Image& im) {
+  if (n < 3 || p[0] != 0xFF || p[1] != 0xD8) return false;
+  jpeg_decompress_struct info;
+  JpegError err;
+  info.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpegErrorExit;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&info);
+    return false;
+  }
+  jpeg_create_decompress(&info);
+  jpeg_mem_src(&info, (unsigned char*)p, n);
+  jpeg_read_header(&info, TRUE);
+  info.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&info);
+  im.w = info.output_width;
+  im.h = info.output_height;
+  im.bgr.resize((size_t)3 * im.w * im.h);
+  while (info.output_scanline < info.output_height) {
+    JSAMPROW row = &im.bgr[(size_t)3 * im.w * info.output_scanline];
+    jpeg_read_scanlines(&info, &row, 1);
+    for (int x = 0; x < im.w; ++x) std::swap(row[3 * x], row[3 * x + 2]);
+  }
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  return true;
+}
+#endif
+
+bool decode(const uint8_t* p, size_t n, Image& im) {
+#ifdef HAVE_JPEG
+  if (decodeJpeg(p, n, im)) return true;
+#endif
+  return decodePnm(p, n, im);
+}
+
+// im_scale of prep_im_for_blob
+double blobScale(int h, int w, int target_size, int max_size) {
+  double size_min = std::min(h, w), size_max = std::max(h, w);
+  double scale = (float)target_size / size_min;
+  if (nearbyint(scale * size_max) > max_size) scale = (float)max_size / size_max;
+  return scale;
+}
+
+// cv2.resize(fx=fy=scale, INTER_LINEAR) as it runs on float images, rounded
+// to 8 bits. With flip it resizes the mirrored image, as get_minibatch does;
+// that is not the mirrored resize unless src.w * scale is an integer.
+void resizeLinear(const Image& src, double scale, bool flip, Image& dst) {
+  dst.w = std::max(1L, lrint(src.w * scale));
+  dst.h = std::max(1L, lrint(src.h * scale));
+  dst.bgr.resize((size_t)3 * dst.w * dst.h);
+  double inv = 1. / scale;
+
+  std::vector<int> xofs(dst.w), yofs(dst.h);
+  std::vector<float> xa(dst.w), ya(dst.h);
+  for (int pass = 0; pass < 2; ++pass) {
+    int n = pass ? dst.h : dst.w, limit = pass ? src.h : src.w;
+    int* ofs = pass ? &yofs[0] : &xofs[0];
+    float* a = pass ? &ya[0] : &xa[0];
+    for (int i = 0; i < n; ++i) {
+      float f = (float)((i + 0.5) * inv - 0.5);
+      int s = (int)floorf(f);
+      f -= s;
+      if (s < 0) f = 0, s = 0;
+      if (s >= limit - 1) f = 0, s = limit - 1;
+      ofs[i] = s;
+      a[i] = f;
+    }
+  }
+
+  // horizontally interpolated source rows; rows sy and sy + 1 never share
+  // a slot
+  std::vector<float> rows(6 * dst.w);
+  int cached[2] = {-1, -1};
+  for (int y = 0; y < dst.h; ++y) {
+    float* r[2];
+    for (int k = 0; k < 2; ++k) {
+      int sy = std::min(yofs[y] + k, src.h - 1);
+      int slot = sy & 1;
+      if (cached[slot] != sy) {
+        const uint8_t* s = &src.bgr[(size_t)3 * src.w * sy];
+        float* d = &rows[3 * dst.w * slot];
+        for (int x = 0; x < dst.w; ++x) {
+          int x0 = xofs[x], x1 = std::min(x0 + 1, src.w - 1);
+          if (flip) x0 = src.w - 1 - x0, x1 = src.w - 1 - x1;
+          const uint8_t* p0 = s + 3 * x0;
+          const uint8_t* p1 = s + 3 * x1;
+          float a = xa[x];
+          for (int c = 0; c < 3; ++c) d[3 * x + c] = p0[c] * (1.f - a) + p1[c] * a;
+        }
+        cached[slot] = sy;
+      }
+      r[k] = &rows[3 * dst.w * slot];
+    }
+    float a = ya[y];
+    uint8_t* d = &dst.bgr[(size_t)3 * dst.w * y];
+    for (int i = 0; i < 3 * dst.w; ++i) {
+      long v = lrintf(r[0][i] * (1.f - a) + r[1][i] * a);
+      d[i] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+  }
+}
+
+}  // namespace
+
+struct ImageLoader {
+  ImageLoaderParams params;
+  std::vector<Source> sources;
+
+  std::deque<Request*> queue;  // submission order; [next, end) not started
+  size_t next;
+  bool stop;
+  std::mutex mutex;
+  std::condition_variable work, done;
+  std::vector<std::thread> workers;
+
+  // LRU of resized images, most recent first
+  typedef std::pair<std::shared_ptr<const Resized>, std::list<uint64_t>::iterator> Entry;
+  std::mutex cacheMutex;
+  std::list<uint64_t> lru;
+  std::unordered_map<uint64_t, Entry> cache;
+  uint64_t cacheBytes;
+
+  std::atomic<uint64_t> served, hits, misses, failed, decodeNanos;
+
+  ImageLoader() : next(0), stop(false), cacheBytes(0), served(0), hits(0), misses(0),
+                  failed(0), decodeNanos(0) {}
+
+  std::shared_ptr<const Resized> cacheGet(uint64_t key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    std::unordered_map<uint64_t, Entry>::iterator it = cache.find(key);
+    if (it == cache.end()) return std::shared_ptr<const Resized>();
+    lru.splice(lru.begin(), lru, it->second.second);
+    return it->second.first;
+  }
+
+  void cachePut(uint64_t key, const std::shared_ptr<const Resized>& r) {
+    uint64_t bytes = r->im.bgr.size();
+    if (bytes > params.cache_bytes) return;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.count(key)) return;  // another worker was faster
+    while (!lru.empty() && cacheBytes + bytes > params.cache_bytes) {
+      std::unordered_map<uint64_t, Entry>::iterator it = cache.find(lru.back());
+      cacheBytes -= it->second.first->im.bgr.size();
+      cache.erase(it);
+      lru.pop_back();
+    }
+    lru.push_front(key);
+    cache[key] = Entry(r, lru.begin());
+    cacheBytes += bytes;
+  }
+
+  void clearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.clear();
+    lru.clear();
+    cacheBytes = 0;
+  }
+
+  std::shared_ptr<const Resized> load(int image, int target_size, bool flip) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Source src;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (image < 0 || image >= (int)sources.size()) return std::shared_ptr<const Resized>();
+      src = sources[image];
+    }
+    std::vector<uint8_t> buf;
+    if (!src.path.empty()) {
+      if (!readFile(src.path, buf)) return std::shared_ptr<const Resized>();
+      src.data = buf.empty() ? 0 : &buf[0];
+      src.size = buf.size();
+    }
+    Image decoded;
+    if (!src.data || !decode(src.data, src.size, decoded)) return std::shared_ptr<const Resized>();
+
+    std::shared_ptr<Resized> r(new Resized());
+    r->orig_h = decoded.h;
+    r->orig_w = decoded.w;
+    r->scale = blobScale(decoded.h, decoded.w, target_size, params.max_size);
+    resizeLinear(decoded, r->scale, flip, r->im);
+    decodeNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return r;
+  }
+
+  void produce(ImageLoaderResult& res) {
+    uint64_t key = ((uint64_t)(uint32_t)res.image << 32) | ((uint64_t)res.target_size << 1) |
+                   (res.flip != 0);
+    std::shared_ptr<const Resized> r;
+    if (params.cache_bytes > 0) r = cacheGet(key);
+    if (r) {
+      ++hits;
+    } else {
+      ++misses;
+      r = load(res.image, res.target_size, res.flip);
+      if (!r) {
+        ++failed;
+        return;
+      }
+      if (params.cache_bytes > 0) cachePut(key, r);
+    }
+
+    const Image& im = r->im;
+    Blob* blob = new Blob();
+    size_t plane = (size_t)im.h * im.w;
+    blob->data.resize(3 * plane);
+    for (int c = 0; c < 3; ++c) {
+      float mean = params.pixel_means[c];
+      for (int y = 0; y < im.h; ++y) {
+        const uint8_t* s = &im.bgr[(size_t)3 * im.w * y + c];
+        float* d = &blob->data[c * plane + (size_t)im.w * y];
+        for (int x = 0; x < im.w; ++x) d[x] = s[3 * x] - mean;
+      }
+    }
+    res.data = &blob->data[0];
+    res.height = im.h;
+    res.width = im.w;
+    res.orig_height = r->orig_h;
+    res.orig_width = r->orig_w;
+    res.scale = r->scale;
+    res.ok = 1;
+    res.handle = blob;
+  }
+
+  void worker() {
+    for (;;) {
+      Request* req;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        work.wait(lock, [this]() { return stop || next < queue.size(); });
+        if (stop) return;
+        req = queue[next++];
+      }
+      produce(req->result);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        req->done = true;
+      }
+      done.notify_all();
+    }
+  }
+};
+
+ImageLoader* _loader_create(const ImageLoaderParams* params) {
+  ImageLoader* l = new ImageLoader();
+  l->params = *params;
+  unsigned int n = params->threads > 0 ? params->threads : std::thread::hardware_concurrency();
+  for (unsigned int t = 0; t < std::max(n, 1u); ++t)
+    l->workers.push_back(std::thread(&ImageLoader::worker, l));
+  return l;
+}
+
+void _loader_destroy(ImageLoader* l) {
+  {
+    std::lock_guard<std::mutex> lock(l->mutex);
+    l->stop = true;
+  }
+  l->work.notify_all();
+  for (size_t t = 0; t < l->workers.size(); ++t) l->workers[t].join();
+  for (size_t i = 0; i < l->queue.size(); ++i) {
+    _loader_release(l->queue[i]->result.handle);
+    delete l->queue[i];
+  }
+  delete l;
+}
+
+void _loader_set_images(ImageLoader* l, int num_images, const char* const* paths,
+                        const uint8_t* const* data, const uint64_t* sizes) {
+  {
+    std::lock_guard<std::mutex> lock(l->mutex);
+    l->sources.resize(num_images);
+    for (int i = 0; i < num_images; ++i) {
+      Source& s = l->sources[i];
+      s.path = paths && paths[i] ? paths[i] : "";
+      s.data = data ? data[i] : 0;
+      s.size = sizes ? sizes[i] : 0;
+    }
+  }
+  l->clearCache();
+}
+
+void _loader_submit(ImageLoader* l, int image, int target_size, int flip) {
+  Request* req = new Request();
+  memset(&req->result, 0, sizeof(req->result));
+  req->result.image = image;
+  req->result.target_size = target_size;
+  req->result.flip = flip;
+  req->done = false;
+  {
+    std::lock_guard<std::mutex> lock(l->mutex);
+    l->queue.push_back(req);
+  }
+  l->work.notify_one();
+}
+
+int _loader_pending(ImageLoader* l) {
+  std::lock_guard<std::mutex> lock(l->mutex);
+  return l->queue.size();
+}
+
+int _loader_next(ImageLoader* l, ImageLoaderResult* result) {
+  Request* req;
+  {
+    std::unique_lock<std::mutex> lock(l->mutex);
+    if (l->queue.empty()) return 0;
+    req = l->queue.front();
+    l->done.wait(lock, [req]() { return req->done; });
+    l->queue.pop_front();
+    --l->next;
+  }
+  *result = req->result;
+  delete req;
+  ++l->served;
+  return 1;
+}
+
+void _loader_release(void* handle) { delete (Blob*)handle; }
+
+void _loader_stats(ImageLoader* l, ImageLoaderStats* stats) {
+  stats->served = l->served;
+  stats->cache_hits = l->hits;
+  stats->cache_misses = l->misses;
+  stats->failed = l->failed;
+  stats->decode_seconds = l->decodeNanos * 1e-9;
+  std::lock_guard<std::mutex> lock(l->cacheMutex);
+  stats->cache_bytes = l->cacheBytes;
+  stats->cache_images = l->cache.size();
+}
@@ -0,0 +1,69 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Asynchronous training image loader. A pool of threads decodes images
+// (binary PPM / PGM, and JPEG if built with HAVE_JPEG), scales them the way
+// utils.blob.prep_im_for_blob does, flips them and writes mean-subtracted
+// (3, H, W) float blobs, while the caller trains on the previous ones.
+//
+// Requests are served in submission order. Decoded, resized images can be
+// kept in an LRU cache bounded by a byte budget, one entry per image, target
+// size and flip; they are stored as 8 bit BGR, so a blob is the same whether
+// it came from the cache or not. The resize is cv2.INTER_LINEAR on float;
+// rounding the result to 8 bits puts the blobs within about 0.5 of
+// prep_im_for_blob's.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct ImageLoaderParams {
+  int threads;                 // <= 0: one per core
+  double cache_bytes;          // budget of the resized image cache, 0: none
+  float pixel_means[3];        // cfg.PIXEL_MEANS (BGR)
+  int max_size;                // cfg.TRAIN.MAX_SIZE
+};
+
+struct ImageLoaderResult {
+  const float* data;           // (3, height, width), owned by handle
+  int height, width;           // of the blob
+  int orig_height, orig_width; // of the decoded image
+  double scale;                // im_scale
+  int image, target_size, flip;
+  int ok;                      // 0: the image could not be read / decoded
+  void* handle;                // pass to _loader_release
+};
+
+struct ImageLoaderStats {
+  uint64_t served, cache_hits, cache_misses, failed;
+  uint64_t cache_bytes, cache_images;
+  double decode_seconds;       // spent by the workers on misses
+};
+
+struct ImageLoader;
+
+ImageLoader* _loader_create(const ImageLoaderParams* params);
+
+// Stops the workers; outstanding results are dropped.
+void _loader_destroy(ImageLoader* loader);
+
+// Source of image i: a file (path != 0) or an encoded image in memory, which
+// must stay valid while the loader uses it. Replacing sources clears the
+// cache.
+void _loader_set_images(ImageLoader* loader, int num_images, const char* const* paths,
+                        const uint8_t* const* data, const uint64_t* sizes);
+
+// Queues image i at the scale whose shortest side is target_size.
+void _loader_submit(ImageLoader* loader, int image, int target_size, int flip);
+
+// Number of submitted requests not yet taken by _loader_next.
+int _loader_pending(ImageLoader* loader);
+
+// Blocks until the oldest request is done. Returns 0 if nothing is queued.
+int _loader_next(ImageLoader* loader, ImageLoaderResult* result);
+
+void _loader_release(void* handle);
+
+void _loader_stats(ImageLoader* loader, ImageLoaderStats* stats);
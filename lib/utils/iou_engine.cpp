@@ -0,0 +1,84 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+
+#include "iou_engine.hpp"
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const IouOpts kDefaultOpts = {IOU_BOX_XYXY, 1.0, NULL, 0};
+
+template <typename T>
+void matrix(const T *a, size_t na, size_t sa, const T *b, size_t nb, size_t sb,
+            const IouOpts *opts, T *o) {
+  if (!opts) opts = &kDefaultOpts;
+  iou::Boxes<T> A, B;
+  A.assign(a, na, sa, opts->format, (T) opts->offset);
+  B.assign(b, nb, sb, opts->format, (T) opts->offset);
+  iou::denseMatrix(A, B, (T) opts->offset, opts->crowd, opts->threads, o);
+}
+
+struct SparseVisit {
+  double thresh;
+  std::vector<IouPair> *out;
+  void operator()(size_t i, size_t j0, const double *v, size_t n) {
+    for (size_t j = 0; j < n; ++j) if (v[j] > thresh) {
+      IouPair p = {(unsigned int) i, (unsigned int) (j0 + j), v[j]};
+      out->push_back(p);
+    }
+  }
+};
+
+}  // namespace
+
+void iouMatrix( const double *a, size_t na, size_t sa, const double *b, size_t nb, size_t sb,
+                const IouOpts *opts, double *o ) {
+  matrix(a, na, sa, b, nb, sb, opts, o);
+}
+
+void iouMatrixF( const float *a, size_t na, size_t sa, const float *b, size_t nb, size_t sb,
+                 const IouOpts *opts, float *o ) {
+  matrix(a, na, sa, b, nb, sb, opts, o);
+}
+
+size_t iouSparse( const double *a, size_t na, size_t sa, const double *b, size_t nb, size_t sb,
+                  const IouOpts *opts, double thresh, IouPair **pairs ) {
+  if (!opts) opts = &kDefaultOpts;
+  iou::Boxes<double> A, B;
+  A.assign(a, na, sa, opts->format, opts->offset);
+  B.assign(b, nb, sb, opts->format, opts->offset);
+  int threads = iou::numThreads(na * nb, opts->threads);
+  std::vector<std::vector<IouPair> > parts(threads);
+  iou::parallelRows(na, threads, [&](size_t i0, size_t i1, int tid) {
+    SparseVisit visit = {thresh, &parts[tid]};
+    iou::forEachTile(A, B, opts->offset, opts->crowd, i0, i1, visit);
+  });
+  // chunks are contiguous row ranges, so concatenation keeps row-major order
+  size_t total = 0;
+  for (size_t t = 0; t < parts.size(); ++t) total += parts[t].size();
+  *pairs = (IouPair*) malloc(sizeof(IouPair) * (total ? total : 1));
+  size_t k = 0;
+  for (size_t t = 0; t < parts.size(); ++t) {
+    if (!parts[t].empty()) memcpy(*pairs + k, &parts[t][0], sizeof(IouPair) * parts[t].size());
+    k += parts[t].size();
+  }
+  return total;
+}
+
+void iouParallelFor( size_t n, size_t grain, int threads,
+                     void (*fn)( void *ctx, size_t i0, size_t i1 ), void *ctx ) {
+  size_t hw = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 16);
+  size_t t = threads > 0 ? std::min<size_t>(threads, hw) : hw;
+  if (grain == 0) grain = 1;
+  t = std::min(t, (n + grain - 1) / grain);
+  if (t <= 1) { if (n) fn(ctx, 0, n); return; }
+  std::atomic<size_t> next(0);
+  iou::parallelRows(t, (int) t, [&](size_t, size_t, int) {
+    for (size_t i0; (i0 = next.fetch_add(grain)) < n;)
+      fn(ctx, i0, std::min(n, i0 + grain));
+  });
+}
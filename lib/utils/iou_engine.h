@@ -0,0 +1,48 @@
+/* ------------------------------------------------------------------
+ * Deep Traffic Sign Detection
+ * Licensed under The MIT License [see LICENSE for details]
+ * ------------------------------------------------------------------
+ *
+ * C interface of the box IoU engine (see iou_engine.hpp). Shared by
+ * utils/bbox.pyx (bbox_overlaps) and pycocotools/maskApi.c (bbIou).
+ */
+#pragma once
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Box layouts accepted by the engine. */
+#define IOU_BOX_XYXY 0  /* x1 y1 x2 y2, width = x2 - x1 + offset */
+#define IOU_BOX_XYWH 1  /* x y w h (COCO), width = w */
+
+typedef struct {
+  int format;                   /* IOU_BOX_XYXY or IOU_BOX_XYWH */
+  double offset;                /* added to x2 - x1 (1 for pixel-inclusive boxes) */
+  const unsigned char *crowd;   /* per row of a; union becomes area of b (may be NULL) */
+  int threads;                  /* <= 0 picks from hardware and problem size */
+} IouOpts;
+
+typedef struct { unsigned int row, col; double iou; } IouPair;
+
+/* Dense IoU matrix o[i*nb+j] between boxes a (na x stride) and b (nb x stride). */
+void iouMatrix( const double *a, size_t na, size_t sa, const double *b, size_t nb, size_t sb,
+                const IouOpts *opts, double *o );
+void iouMatrixF( const float *a, size_t na, size_t sa, const float *b, size_t nb, size_t sb,
+                 const IouOpts *opts, float *o );
+
+/* Sparse IoU: only pairs with IoU > thresh, in row-major order. *pairs must be
+ * released with free(); returns the number of pairs. */
+size_t iouSparse( const double *a, size_t na, size_t sa, const double *b, size_t nb, size_t sb,
+                  const IouOpts *opts, double thresh, IouPair **pairs );
+
+/* Run fn(ctx, i0, i1) over [0, n) on up to `threads` threads (<= 0: one per
+ * core, at most 16). Workers claim `grain` items at a time, so uneven rows
+ * balance out. Lets C callers such as maskApi.c share the engine's threads. */
+void iouParallelFor( size_t n, size_t grain, int threads,
+                     void (*fn)( void *ctx, size_t i0, size_t i1 ), void *ctx );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,221 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Box IoU engine. Boxes are kept in structure-of-arrays form and the IoU
+// matrix is produced one row tile at a time with an AVX2 kernel (runtime
+// dispatched, scalar fallback). Every kernel performs exactly the same
+// floating point operations as the scalar loops it replaces, so double
+// precision results are bit-identical to utils/bbox.pyx and maskApi.c.
+
+#pragma once
+#include "iou_engine.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace iou {
+
+// Columns per tile: five SoA planes of doubles stay resident in L1.
+const size_t kColTile = 512;
+// SoA planes are padded to a multiple of this with boxes that overlap nothing,
+// so the vector kernels never need a scalar tail.
+const size_t kPad = 8;
+// Below this many pairs per thread, spawning threads costs more than it saves.
+const size_t kPairsPerThread = 1 << 18;
+
+template <typename T>
+struct Row {
+  T x1, y1, x2, y2, area;
+  bool crowd;
+};
+
+template <typename T>
+struct Boxes {
+  std::vector<T> x1, y1, x2, y2, area;
+  size_t n;
+
+  Boxes() : n(0) {}
+
+  size_t size() const { return n; }
+
+  // Pack n boxes of `stride` values each; only the first four are read.
+  template <typename S>
+  void assign(const S *boxes, size_t count, size_t stride, int format, T offset) {
+    n = count;
+    size_t padded = (n + kPad - 1) / kPad * kPad;
+    const T far = (T) 1e30;
+    x1.assign(padded, far); y1.assign(padded, far);
+    x2.assign(padded, -far); y2.assign(padded, -far);
+    area.assign(padded, (T) 1);
+    for (size_t i = 0; i < n; ++i) {
+      const S *p = boxes + i * stride;
+      x1[i] = (T) p[0];
+      y1[i] = (T) p[1];
+      if (format == IOU_BOX_XYWH) {
+        x2[i] = (T) p[2] + (T) p[0];
+        y2[i] = (T) p[3] + (T) p[1];
+        area[i] = (T) p[2] * (T) p[3];
+      } else {
+        x2[i] = (T) p[2];
+        y2[i] = (T) p[3];
+        area[i] = (x2[i] - x1[i] + offset) * (y2[i] - y1[i] + offset);
+      }
+    }
+  }
+
+  Row<T> row(size_t i, const unsigned char *crowd) const {
+    Row<T> r = {x1[i], y1[i], x2[i], y2[i], area[i], crowd != NULL && crowd[i] != 0};
+    return r;
+  }
+};
+
+// out[j - j0] = IoU(r, b[j]) for j in [j0, j1).
+template <typename T>
+inline void iouRowScalar(const Boxes<T> &b, size_t j0, size_t j1,
+                         const Row<T> &r, T offset, T *out) {
+  for (size_t j = j0; j < j1; ++j) {
+    T o = 0;
+    T iw = std::min(r.x2, b.x2[j]) - std::max(r.x1, b.x1[j]) + offset;
+    if (iw > 0) {
+      T ih = std::min(r.y2, b.y2[j]) - std::max(r.y1, b.y1[j]) + offset;
+      if (ih > 0) {
+        T inter = iw * ih;
+        T ua = r.crowd ? b.area[j] : r.area + b.area[j] - inter;
+        o = inter / ua;
+      }
+    }
+    out[j - j0] = o;
+  }
+}
+
+__attribute__((target("avx2")))
+inline void iouRowAvx2(const Boxes<double> &b, size_t j0, size_t j1,
+                       const Row<double> &r, double offset, double *out) {
+  const __m256d ax1 = _mm256_set1_pd(r.x1), ay1 = _mm256_set1_pd(r.y1);
+  const __m256d ax2 = _mm256_set1_pd(r.x2), ay2 = _mm256_set1_pd(r.y2);
+  const __m256d aarea = _mm256_set1_pd(r.area), off = _mm256_set1_pd(offset);
+  const __m256d zero = _mm256_setzero_pd();
+  for (size_t j = j0; j < j1; j += 4) {
+    __m256d iw = _mm256_sub_pd(_mm256_min_pd(ax2, _mm256_loadu_pd(&b.x2[j])),
+                               _mm256_max_pd(ax1, _mm256_loadu_pd(&b.x1[j])));
+    __m256d ih = _mm256_sub_pd(_mm256_min_pd(ay2, _mm256_loadu_pd(&b.y2[j])),
+                               _mm256_max_pd(ay1, _mm256_loadu_pd(&b.y1[j])));
+    iw = _mm256_add_pd(iw, off);
+    ih = _mm256_add_pd(ih, off);
+    __m256d keep = _mm256_and_pd(_mm256_cmp_pd(iw, zero, _CMP_GT_OQ),
+                                 _mm256_cmp_pd(ih, zero, _CMP_GT_OQ));
+    // Branch-free: whether a lane intersects is data dependent and predicts
+    // badly, so always divide and mask the non-intersecting lanes to zero.
+    __m256d barea = _mm256_loadu_pd(&b.area[j]);
+    __m256d inter = _mm256_mul_pd(iw, ih);
+    __m256d ua = r.crowd ? barea : _mm256_sub_pd(_mm256_add_pd(aarea, barea), inter);
+    __m256d o = _mm256_and_pd(keep, _mm256_div_pd(inter, ua));
+    if (j + 4 <= j1) {
+      _mm256_storeu_pd(out + (j - j0), o);
+    } else {
+      __m256i lanes = _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long) (j1 - j)),
+                                         _mm256_setr_epi64x(0, 1, 2, 3));
+      _mm256_maskstore_pd(out + (j - j0), lanes, o);
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+inline void iouRowAvx2(const Boxes<float> &b, size_t j0, size_t j1,
+                       const Row<float> &r, float offset, float *out) {
+  const __m256 ax1 = _mm256_set1_ps(r.x1), ay1 = _mm256_set1_ps(r.y1);
+  const __m256 ax2 = _mm256_set1_ps(r.x2), ay2 = _mm256_set1_ps(r.y2);
+  const __m256 aarea = _mm256_set1_ps(r.area), off = _mm256_set1_ps(offset);
+  const __m256 zero = _mm256_setzero_ps();
+  for (size_t j = j0; j < j1; j += 8) {
+    __m256 iw = _mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(&b.x2[j])),
+                              _mm256_max_ps(ax1, _mm256_loadu_ps(&b.x1[j])));
+    __m256 ih = _mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(&b.y2[j])),
+                              _mm256_max_ps(ay1, _mm256_loadu_ps(&b.y1[j])));
+    iw = _mm256_add_ps(iw, off);
+    ih = _mm256_add_ps(ih, off);
+    __m256 keep = _mm256_and_ps(_mm256_cmp_ps(iw, zero, _CMP_GT_OQ),
+                                _mm256_cmp_ps(ih, zero, _CMP_GT_OQ));
+    __m256 barea = _mm256_loadu_ps(&b.area[j]);
+    __m256 inter = _mm256_mul_ps(iw, ih);
+    __m256 ua = r.crowd ? barea : _mm256_sub_ps(_mm256_add_ps(aarea, barea), inter);
+    __m256 o = _mm256_and_ps(keep, _mm256_div_ps(inter, ua));
+    if (j + 8 <= j1) {
+      _mm256_storeu_ps(out + (j - j0), o);
+    } else {
+      __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (j1 - j)),
+                                         _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+      _mm256_maskstore_ps(out + (j - j0), lanes, o);
+    }
+  }
+}
+
+template <typename T>
+struct RowKernel {
+  typedef void (*Fn)(const Boxes<T> &, size_t, size_t, const Row<T> &, T, T *);
+};
+
+template <typename T>
+typename RowKernel<T>::Fn rowKernel() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2 ? static_cast<typename RowKernel<T>::Fn>(iouRowAvx2) : iouRowScalar<T>;
+}
+
+inline int numThreads(size_t pairs, int requested) {
+  if (requested > 0) return requested;
+  size_t hw = std::max(1u, std::thread::hardware_concurrency());
+  size_t byWork = pairs / kPairsPerThread;
+  return (int) std::max<size_t>(1, std::min(std::min<size_t>(hw, 16), byWork));
+}
+
+// Split rows [0, n) into contiguous chunks; fn(i0, i1, tid) runs once per chunk,
+// chunk 0 on the calling thread.
+template <typename Fn>
+void parallelRows(size_t n, int threads, Fn fn) {
+  size_t t = std::min<size_t>(std::max(threads, 1), std::max<size_t>(n, 1));
+  size_t chunk = (n + t - 1) / std::max<size_t>(t, 1);
+  std::vector<std::thread> pool;
+  for (size_t k = 1; k < t; ++k)
+    pool.push_back(std::thread(fn, std::min(n, k * chunk), std::min(n, (k + 1) * chunk), (int) k));
+  fn(0, std::min(n, chunk), 0);
+  for (size_t k = 0; k < pool.size(); ++k) pool[k].join();
+}
+
+// Visit rows [i0, i1) of the IoU matrix in row-major order, one column tile at
+// a time: visit(i, j0, vals, n) sees IoU(a[i], b[j0 .. j0+n)). Nothing beyond
+// one tile is ever materialized.
+template <typename T, typename Visit>
+void forEachTile(const Boxes<T> &a, const Boxes<T> &b, T offset, const unsigned char *crowd,
+                 size_t i0, size_t i1, Visit &visit) {
+  typename RowKernel<T>::Fn kernel = rowKernel<T>();
+  T buf[kColTile];
+  size_t nb = b.size();
+  for (size_t i = i0; i < i1; ++i) {
+    Row<T> r = a.row(i, crowd);
+    for (size_t j0 = 0; j0 < nb; j0 += kColTile) {
+      size_t j1 = std::min(nb, j0 + kColTile);
+      kernel(b, j0, j1, r, offset, buf);
+      visit(i, j0, buf, j1 - j0);
+    }
+  }
+}
+
+// Dense matrix o[i*nb+j], blocked so each column tile of b is reused across rows.
+template <typename T>
+void denseMatrix(const Boxes<T> &a, const Boxes<T> &b, T offset, const unsigned char *crowd,
+                 int threads, T *o) {
+  size_t na = a.size(), nb = b.size();
+  typename RowKernel<T>::Fn kernel = rowKernel<T>();
+  parallelRows(na, numThreads(na * nb, threads), [&](size_t i0, size_t i1, int) {
+    for (size_t j0 = 0; j0 < nb; j0 += kColTile) {
+      size_t j1 = std::min(nb, j0 + kColTile);
+      for (size_t i = i0; i < i1; ++i)
+        kernel(b, j0, j1, a.row(i, crowd), offset, o + i * nb + j0);
+    }
+  });
+}
+
+}  // namespace iou
@@ -0,0 +1,101 @@
+// ------------------------------------------------------------------
+// Deep Traffic Sign Detection
+// Licensed under The MIT License [see LICENSE for details]
+// ------------------------------------------------------------------
+//
+// Draws the same numbers as numpy's legacy RandomState (MT19937 from
+// randomkit), so native layers can replace npr.choice / npr.permutation and
+// still reproduce a seeded training run. The state is exchanged with
+// npr.get_state() / npr.set_state(): 624 uint32 keys and a position.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace nprand {
+
+class RandomState {
+ public:
+  static const int kN = 624;
+
+  // Continue from a state obtained with npr.get_state(); the advanced state
+  // is written back to key/pos by store().
+  RandomState(const uint32_t *key, int pos) : pos_(pos) {
+    for (int i = 0; i < kN; ++i) key_[i] = key[i];
+  }
+
+  void store(uint32_t *key, int *pos) const {
+    for (int i = 0; i < kN; ++i) key[i] = key_[i];
+    *pos = pos_;
+  }
+
+  // rk_random
+  uint32_t random() {
+    if (pos_ == kN) reload();
+    uint32_t y = key_[pos_++];
+    y ^= (y >> 11);
+    y ^= (y << 7) & 0x9d2c5680UL;
+    y ^= (y << 15) & 0xefc60000UL;
+    y ^= (y >> 18);
+    return y;
+  }
+
+  // rk_interval: uniform integer in [0, max] by rejection on a bit mask.
+  // Only the 32-bit branch is needed, populations never reach 2^32.
+  uint32_t interval(uint32_t max) {
+    if (max == 0) return 0;
+    uint32_t mask = max, value;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    while ((value = (random() & mask)) > max);
+    return value;
+  }
+
+  // npr.permutation(n)
+  void permutation(size_t n, std::vector<size_t> &perm) {
+    perm.resize(n);
+    for (size_t i = 0; i < n; ++i) perm[i] = i;
+    for (size_t i = n > 0 ? n - 1 : 0; i > 0; --i) {
+      size_t j = interval((uint32_t) i);
+      size_t t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+    }
+  }
+
+  // npr.choice(inds, size=k, replace=False): the first k entries of a
+  // permutation of inds. The whole permutation is drawn, as numpy does.
+  template <typename I>
+  void choice(const std::vector<I> &inds, size_t k, std::vector<I> &out) {
+    permutation(inds.size(), perm_);
+    out.resize(k);
+    for (size_t i = 0; i < k; ++i) out[i] = inds[perm_[i]];
+  }
+
+ private:
+  void reload() {
+    const int M = 397;
+    const uint32_t kMatrixA = 0x9908b0dfUL, kUpper = 0x80000000UL, kLower = 0x7fffffffUL;
+    uint32_t y;
+    int i;
+    for (i = 0; i < kN - M; ++i) {
+      y = (key_[i] & kUpper) | (key_[i + 1] & kLower);
+      key_[i] = key_[i + M] ^ (y >> 1) ^ (-(y & 1) & kMatrixA);
+    }
+    for (; i < kN - 1; ++i) {
+      y = (key_[i] & kUpper) | (key_[i + 1] & kLower);
+      key_[i] = key_[i + (M - kN)] ^ (y >> 1) ^ (-(y & 1) & kMatrixA);
+    }
+    y = (key_[kN - 1] & kUpper) | (key_[0] & kLower);
+    key_[kN - 1] = key_[M - 1] ^ (y >> 1) ^ (-(y & 1) & kMatrixA);
+    pos_ = 0;
+  }
+
+  uint32_t key_[kN];
+  int pos_;
+  std::vector<size_t> perm_;
+};
+
+}  // namespace nprand
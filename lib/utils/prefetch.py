@@ -0,0 +1,99 @@
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""RPN training minibatches from the native image loader.
+
+PrefetchLoader keeps cfg.TRAIN.LOADER_QUEUE images submitted to a
+utils.cython_image_loader.ImageLoader, so they are decoded, scaled and
+flipped by its threads while the solver runs. Flips are drawn per image and
+iteration (cfg.TRAIN.USE_FLIPPED) instead of doubling the roidb.
+"""
+
+import numpy as np
+import cv2
+from collections import deque
+from fast_rcnn.config import cfg
+from utils.blob import prep_im_for_blob, im_list_to_blob
+from utils.cython_image_loader import ImageLoader
+
+class PrefetchLoader(object):
+    """Drop-in for RoIDataLayer._get_next_minibatch with cfg.TRAIN.HAS_RPN.
+
+    roidb entries are read from entry['image_source'] (see
+    imdb.image_source_at) if present, else from entry['image'].
+    """
+
+    def __init__(self, roidb, threads=None, queue=None, cache_mb=None):
+        assert cfg.TRAIN.HAS_RPN and cfg.TRAIN.IMS_PER_BATCH == 1, \
+            'the native loader serves single image RPN minibatches'
+        self._roidb = roidb
+        self._queue = max(1, cfg.TRAIN.LOADER_QUEUE if queue is None else queue)
+        self._sources = [entry.get('image_source', entry['image'])
+                         for entry in roidb]
+        self._loader = ImageLoader(
+            cfg.PIXEL_MEANS, cfg.TRAIN.MAX_SIZE,
+            threads=cfg.TRAIN.LOADER_THREADS if threads is None else threads,
+            cache_mb=cfg.TRAIN.LOADER_CACHE_MB if cache_mb is None else cache_mb)
+        self._loader.set_images(self._sources)
+        self._perm = np.zeros(0, dtype=np.int)
+        self._cur = 0
+        self._flips = deque()   # of the submitted images, in order
+
+    def _submit(self):
+        if self._cur >= len(self._perm):
+            self._perm = np.random.permutation(np.arange(len(self._roidb)))
+            self._cur = 0
+        i = int(self._perm[self._cur])
+        self._cur += 1
+        flip = cfg.TRAIN.USE_FLIPPED and np.random.randint(2) == 1
+        target_size = cfg.TRAIN.SCALES[np.random.randint(len(cfg.TRAIN.SCALES))]
+        # entries flipped by append_flipped_images already describe the
+        # mirrored image
+        self._loader.submit(i, target_size, flip != self._roidb[i]['flipped'])
+        self._flips.append(flip)
+
+    def _load(self, i, target_size, flip):
+        """What the loader does, with cv2; for images it cannot decode."""
+        source = self._sources[i]
+        if isinstance(source, basestring):
+            im = cv2.imread(source)
+        else:
+            im = cv2.imdecode(np.asarray(source, dtype=np.uint8), cv2.IMREAD_COLOR)
+        assert im is not None, 'cannot read image {}'.format(i)
+        if flip:
+            im = im[:, ::-1, :]
+        im, im_scale = prep_im_for_blob(im, cfg.PIXEL_MEANS, target_size,
+                                        cfg.TRAIN.MAX_SIZE)
+        return im_list_to_blob([im]), im_scale
+
+    def next_minibatch(self):
+        """Return the blobs of the next image: data, im_info and gt_boxes."""
+        while self._loader.pending() < self._queue:
+            self._submit()
+        res = self._loader.next()
+        i = res['image']
+        flip = self._flips.popleft()
+        entry = self._roidb[i]
+        im_blob, im_scale = res['data'], res['im_scale']
+        if im_blob is None:
+            im_blob, im_scale = self._load(i, res['target_size'], res['flip'])
+
+        gt_inds = np.where(entry['gt_classes'] != 0)[0]
+        boxes = entry['boxes'][gt_inds, :].astype(np.float32)
+        if flip:
+            width = entry.get('width', res['width'])
+            x1 = boxes[:, 0].copy()
+            boxes[:, 0] = width - boxes[:, 2] - 1
+            boxes[:, 2] = width - x1 - 1
+        gt_boxes = np.empty((len(gt_inds), 5), dtype=np.float32)
+        gt_boxes[:, 0:4] = boxes * im_scale
+        gt_boxes[:, 4] = entry['gt_classes'][gt_inds]
+        return {'data': im_blob,
+                'im_info': np.array([[im_blob.shape[2], im_blob.shape[3],
+                                      im_scale]], dtype=np.float32),
+                'gt_boxes': gt_boxes}
+
+    def stats(self):
+        return self._loader.stats()
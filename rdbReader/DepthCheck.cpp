@@ -0,0 +1,140 @@
+// DepthCheck.cpp : occlusion test and point cloud of synthetic depth images in
+// every depth format and storage the IG may deliver
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "DepthOcclusion.hh"
+#include "DepthCloud.hh"
+
+/**
+* some global variables, considered "members" of this example
+*/
+int   mWidth    = 64;                 // image size
+int   mHeight   = 48;
+float mClipNear = 1.0f;               // [m]
+float mClipFar  = 200.0f;
+float mFarZ     = 50.0f;              // distance of the background [m]
+float mNearZ    = 10.0f;              // distance of the occluder [m]
+
+/**
+* one way of storing depth
+*/
+struct Case
+{
+    const char*   name;
+    unsigned char pixelFormat;
+    unsigned char pixelSize;        // [bit]
+    unsigned int  bits;             // of the depth value
+    float         tolerance;        // of the linearized depth, relative
+};
+
+/**
+* depth buffer value of a distance, quantized to the bits of the format
+*/
+uint32_t windowDepth( float z, unsigned int bits )
+{
+    double d   = mClipFar / ( double ) ( mClipFar - mClipNear ) * ( 1.0 - mClipNear / z );
+    double max = ( double ) ( ( 1ull << bits ) - 1 );
+
+    return ( uint32_t ) ( d * max + 0.5 );
+}
+
+/**
+* run a case, print the result
+* @return true if it passed
+*/
+bool runCase( const Case & c )
+{
+    unsigned int pixelBytes = c.pixelSize / 8;
+
+    std::vector<unsigned char> buffer( sizeof( RDB_IMAGE_t ) + mWidth * mHeight * pixelBytes );
+    RDB_IMAGE_t*   img  = ( RDB_IMAGE_t* ) &buffer[0];
+    unsigned char* data = &buffer[ sizeof( RDB_IMAGE_t ) ];
+
+    memset( img, 0, sizeof( RDB_IMAGE_t ) );
+    img->id          = 1;
+    img->width       = mWidth;
+    img->height      = mHeight;
+    img->pixelFormat = c.pixelFormat;
+    img->pixelSize   = c.pixelSize;
+    img->imgSize     = mWidth * mHeight * pixelBytes;
+
+    // background everywhere, an occluder over the left quarter, the far plane
+    // (nothing rendered) in the last row; values in the low bits, little endian
+    uint32_t farValue   = windowDepth( mFarZ, c.bits );
+    uint32_t nearValue  = windowDepth( mNearZ, c.bits );
+    uint32_t clearValue = ( uint32_t ) ( ( 1ull << c.bits ) - 1 );
+
+    for ( int y = 0; y < mHeight; y++ )
+    {
+        for ( int x = 0; x < mWidth; x++ )
+        {
+            uint32_t v = ( y == mHeight - 1 ) ? clearValue : ( x < mWidth / 4 ) ? nearValue : farValue;
+
+            for ( unsigned int b = 0; b < pixelBytes; b++ )
+                data[ ( y * mWidth + x ) * pixelBytes + b ] = ( unsigned char ) ( v >> ( 8 * b ) );
+        }
+    }
+
+    // a box on the background, its left half behind the occluder
+    Framework::DepthBox box = { 0, 0, mWidth / 2 - 1, mHeight / 2 - 1, mFarZ };
+    float               ratio = -1.0f;
+
+    Framework::DepthOcclusion occlusion;
+    occlusion.setThreads( 1 );
+
+    bool okRatio = occlusion.visibleRatios( *img, data, mClipNear, mClipFar, &box, 1, &ratio ) &&
+                   ( fabs( ratio - 0.5f ) < 1.e-6 );
+
+    // the background at its distance, the far plane empty
+    RDB_CAMERA_t cam;
+    memset( &cam, 0, sizeof( cam ) );
+    cam.width      = mWidth;
+    cam.height     = mHeight;
+    cam.clipNear   = mClipNear;
+    cam.clipFar    = mClipFar;
+    cam.focalX     = cam.focalY = 50.0f;
+    cam.principalX = 0.5f * mWidth;
+    cam.principalY = 0.5f * mHeight;
+
+    Framework::DepthCloud cloud;
+    cloud.setThreads( 1 );
+
+    bool  okCloud = ( cloud.convert( *img, data, cam ) == ( unsigned int ) ( mWidth * mHeight ) );
+    float depth   = okCloud ? cloud.getX()[ mWidth - 1 ] : NAN;
+
+    okCloud = okCloud && ( fabs( depth - mFarZ ) < c.tolerance * mFarZ ) &&
+              isnan( cloud.getX()[ ( mHeight - 1 ) * mWidth ] );
+
+    printf( "%-22s %5.3f %9.3f   %s\n", c.name, ratio, depth, ( okRatio && okCloud ) ? "ok" : "FAILED" );
+
+    return okRatio && okCloud;
+}
+
+int main()
+{
+    Case cases[] =
+    {
+        { "DEPTH8 in 8 bit",      RDB_PIX_FORMAT_DEPTH8,   8,  8, 0.25f  },
+        { "DEPTH16 in 16 bit",    RDB_PIX_FORMAT_DEPTH16, 16, 16, 0.01f  },
+        { "DEPTH24 in 24 bit",    RDB_PIX_FORMAT_DEPTH24, 24, 24, 0.001f },
+        { "DEPTH24 in 32 bit",    RDB_PIX_FORMAT_DEPTH24, 32, 24, 0.001f },
+        { "DEPTH_24 in 32 bit",   RDB_PIX_FORMAT_DEPTH_24, 32, 24, 0.001f },
+        { "DEPTH32 in 32 bit",    RDB_PIX_FORMAT_DEPTH32, 32, 32, 0.001f }
+    };
+
+    printf( "%dx%d, clip %.0f..%.0f m, background at %.0f m, occluder at %.0f m\n\n",
+            mWidth, mHeight, mClipNear, mClipFar, mFarZ, mNearZ );
+    printf( "%-22s %5s %9s   %s\n", "format", "ratio", "depth [m]", "check" );
+
+    int noFailed = 0;
+
+    for ( unsigned int i = 0; i < sizeof( cases ) / sizeof( cases[0] ); i++ )
+        noFailed += !runCase( cases[ i ] );
+
+    return noFailed ? 1 : 0;
+}
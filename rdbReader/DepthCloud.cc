@@ -0,0 +1,282 @@
+/* ===================================================
+ *  file:       DepthCloud.cc
+ * ---------------------------------------------------
+ *  purpose:	turn a depth image of the IG into a
+ *              point cloud
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include "DepthCloud.hh"
+#include "DepthOcclusion.hh"
+
+namespace Framework
+{
+
+/**
+* rows handed to a worker at a time
+*/
+static const int BAND_HEIGHT = 32;
+
+/**
+* back-project one row; branch-free, so that the compiler vectorizes it
+* @param d      depth buffer values of the row, normalized to 0..1
+* @param rayY   left per forward meter of each column
+* @param rayZ   up per forward meter of the row
+* @param rot    camera -> output frame, row major
+* @param pos    camera position in the output frame
+*/
+static void
+convertRow( const float* __restrict d, const float* __restrict rayY, float rayZ, int n,
+            float nearFar, float far, float range, const float rot[9], const float pos[3],
+            float* __restrict x, float* __restrict y, float* __restrict z )
+{
+    const float r0 = rot[0], r1 = rot[1], r2 = rot[2];
+    const float r3 = rot[3], r4 = rot[4], r5 = rot[5];
+    const float r6 = rot[6], r7 = rot[7], r8 = rot[8];
+    const float p0 = pos[0], p1 = pos[1], p2 = pos[2];
+
+    for ( int i = 0; i < n; i++ )
+    {
+        // inverse of the window depth d = f / ( f - n ) * ( 1 - n / z )
+        float xc = nearFar / ( far - d[i] * range );
+        float yc = rayY[i] * xc;
+        float zc = rayZ * xc;
+
+        // nothing was rendered at the far plane
+        xc = ( d[i] < 1.0f ) ? xc : NAN;
+
+        x[i] = p0 + r0 * xc + r1 * yc + r2 * zc;
+        y[i] = p1 + r3 * xc + r4 * yc + r5 * zc;
+        z[i] = p2 + r6 * xc + r7 * yc + r8 * zc;
+    }
+}
+
+/**
+* widen a row of depth buffer values to float
+*/
+template <class T>
+static void
+widenRow( const T* __restrict p, int n, float scale, float* __restrict d )
+{
+    for ( int i = 0; i < n; i++ )
+        d[i] = ( float ) p[i] * scale;
+}
+
+DepthCloud::DepthCloud() : mNoThreads( 0 ),
+                           mOriginBottomLeft( false ),
+                           mData( 0 ),
+                           mPixelBytes( 0 ),
+                           mWidth( 0 ),
+                           mHeight( 0 ),
+                           mDepthScale( 0.0f ),
+                           mNearFar( 0.0f ),
+                           mFar( 0.0f ),
+                           mRange( 0.0f )
+{
+}
+
+DepthCloud::~DepthCloud()
+{
+}
+
+void
+DepthCloud::setThreads( unsigned int noThreads )
+{
+    mNoThreads = noThreads;
+    mPool.start( noThreads );
+}
+
+void
+DepthCloud::setOriginBottomLeft( bool bottomLeft )
+{
+    mOriginBottomLeft = bottomLeft;
+}
+
+const float*
+DepthCloud::getX() const
+{
+    return mX.empty() ? 0 : &mX[0];
+}
+
+const float*
+DepthCloud::getY() const
+{
+    return mY.empty() ? 0 : &mY[0];
+}
+
+const float*
+DepthCloud::getZ() const
+{
+    return mZ.empty() ? 0 : &mZ[0];
+}
+
+unsigned int
+DepthCloud::getWidth() const
+{
+    return mWidth;
+}
+
+unsigned int
+DepthCloud::getHeight() const
+{
+    return mHeight;
+}
+
+void
+DepthCloud::convertBand( int y0, int y1, std::vector<float> & scratch )
+{
+    scratch.resize( mWidth );
+
+    float* d = &scratch[0];
+
+    for ( int y = y0; y < y1; y++ )
+    {
+        const unsigned char* row = mData + ( size_t ) y * mWidth * mPixelBytes;
+
+        switch ( mPixelBytes )
+        {
+            case 1:
+                widenRow( row, mWidth, mDepthScale, d );
+                break;
+
+            case 2:
+                widenRow( ( const uint16_t* ) row, mWidth, mDepthScale, d );
+                break;
+
+            case 3:
+                // packed 24 bit values (little endian)
+                for ( unsigned int i = 0; i < mWidth; i++ )
+                    d[ i ] = ( float ) ( row[ 3 * i ] | ( row[ 3 * i + 1 ] << 8 ) | ( row[ 3 * i + 2 ] << 16 ) ) * mDepthScale;
+                break;
+
+            default:
+                widenRow( ( const uint32_t* ) row, mWidth, mDepthScale, d );
+                break;
+        }
+
+        size_t k = ( size_t ) y * mWidth;
+
+        convertRow( d, &mRayY[0], mRayZ[ y ], mWidth, mNearFar, mFar, mRange, mRot, mPos,
+                    &mX[ k ], &mY[ k ], &mZ[ k ] );
+    }
+}
+
+unsigned int
+DepthCloud::convert( const RDB_IMAGE_t & img, const void* data, const RDB_CAMERA_t & cam, bool world )
+{
+    if ( !DepthOcclusion::isDepthFormat( img ) )
+    {
+        fprintf( stderr, "DepthCloud::convert: image %d: unsupported pixel format %d / size %d\n",
+                         img.id, img.pixelFormat, img.pixelSize );
+        return 0;
+    }
+
+    if ( img.imgSize < img.width * img.height * ( img.pixelSize / 8 ) )
+    {
+        fprintf( stderr, "DepthCloud::convert: image %d: %d bytes are too few for %dx%d pixels\n",
+                         img.id, img.imgSize, img.width, img.height );
+        return 0;
+    }
+
+    if ( !img.width || !img.height || !cam.width || !cam.height )
+        return 0;
+
+    mData       = ( const unsigned char* ) data;
+    mPixelBytes = img.pixelSize / 8;
+    mWidth      = img.width;
+    mHeight     = img.height;
+    mDepthScale = ( float ) ( 1.0 / DepthOcclusion::getMaxDepthValue( img ) );
+    mNearFar    = cam.clipNear * cam.clipFar;
+    mFar        = cam.clipFar;
+    mRange      = cam.clipFar - cam.clipNear;
+
+    // viewing rays of the pixel centers; the intrinsics belong to the viewport,
+    // which may be scaled to the image (u = px - fx * y / x, v = py - fy * z / x)
+    float sx = ( float ) cam.width  / img.width;
+    float sy = ( float ) cam.height / img.height;
+
+    mRayY.resize( mWidth );
+    mRayZ.resize( mHeight );
+
+    for ( unsigned int i = 0; i < mWidth; i++ )
+        mRayY[ i ] = ( cam.principalX - ( i + 0.5f ) * sx ) / cam.focalX;
+
+    for ( unsigned int j = 0; j < mHeight; j++ )
+    {
+        unsigned int row = mOriginBottomLeft ? mHeight - 1 - j : j;
+        mRayZ[ j ] = ( cam.principalY - ( row + 0.5f ) * sy ) / cam.focalY;
+    }
+
+    if ( world )
+    {
+        // columns of R = Rz(h) * Ry(p) * Rx(r): forward, left and up axes of the camera
+        double ch = cos( cam.pos.h ), sh = sin( cam.pos.h );
+        double cp = cos( cam.pos.p ), sp = sin( cam.pos.p );
+        double cr = cos( cam.pos.r ), sr = sin( cam.pos.r );
+
+        mRot[0] = ch * cp;  mRot[1] = ch * sp * sr - sh * cr;  mRot[2] = ch * sp * cr + sh * sr;
+        mRot[3] = sh * cp;  mRot[4] = sh * sp * sr + ch * cr;  mRot[5] = sh * sp * cr - ch * sr;
+        mRot[6] = -sp;      mRot[7] = cp * sr;                 mRot[8] = cp * cr;
+
+        mPos[0] = cam.pos.x;
+        mPos[1] = cam.pos.y;
+        mPos[2] = cam.pos.z;
+    }
+    else
+    {
+        for ( int i = 0; i < 9; i++ )
+            mRot[ i ] = ( i % 4 ) ? 0.0f : 1.0f;
+
+        mPos[0] = mPos[1] = mPos[2] = 0.0f;
+    }
+
+    size_t noPoints = ( size_t ) mWidth * mHeight;
+
+    mX.resize( noPoints );
+    mY.resize( noPoints );
+    mZ.resize( noPoints );
+
+    unsigned int noThreads = mNoThreads ? mNoThreads : std::thread::hardware_concurrency();
+    int          noBands   = ( mHeight + BAND_HEIGHT - 1 ) / BAND_HEIGHT;
+
+    if ( noThreads > ( unsigned int ) noBands )
+        noThreads = noBands;
+
+    if ( noThreads < 1 )
+        noThreads = 1;
+
+    // without setThreads() the pool is started here, once
+    if ( ( noThreads > mPool.getNoThreads() ) && ( mPool.getNoThreads() == 1 ) )
+        mPool.start( mNoThreads );
+
+    if ( noThreads > mPool.getNoThreads() )
+        noThreads = mPool.getNoThreads();
+
+    if ( mScratch.size() < noThreads )
+        mScratch.resize( noThreads );
+
+    std::atomic<int> nextBand( 0 );
+
+    mPool.run( noThreads, [&]( unsigned int t )
+    {
+        int band;
+
+        while ( ( band = nextBand++ ) < noBands )
+        {
+            int y0 = band * BAND_HEIGHT;
+            int y1 = ( y0 + BAND_HEIGHT < ( int ) mHeight ) ? y0 + BAND_HEIGHT : mHeight;
+
+            convertBand( y0, y1, mScratch[ t ] );
+        }
+    } );
+
+    mData = 0;
+
+    return noPoints;
+}
+
+} // namespace Framework
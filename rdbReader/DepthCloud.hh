@@ -0,0 +1,120 @@
+/* ===================================================
+ *  file:       DepthCloud.hh
+ * ---------------------------------------------------
+ *  purpose:	turn a depth image of the IG into a
+ *              point cloud
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_DEPTH_CLOUD_HH
+#define _FRAMEWORK_DEPTH_CLOUD_HH
+
+/* ====== INCLUSIONS ====== */
+#include <vector>
+#include "viRDBIcd.h"
+#include "WorkerPool.hh"
+
+namespace Framework
+{
+/**
+* Back-projects every pixel of a depth image with the intrinsics of its camera.
+* The depth buffer value is linearized with the clipping planes, the viewing ray
+* of each column and row is computed once per image, and the rows are converted
+* in branch-free loops over structure-of-arrays buffers, spread over a pool of
+* threads in bands of rows.
+*
+* Points are stored per pixel (index = row * width + column) in the camera frame
+* (x forward, y left, z up) or, on request, in the world frame of the camera
+* position. Pixels at the far clipping plane (nothing rendered) are NaN.
+*
+* Only depth images are read (DepthOcclusion::isDepthFormat). An IG that also
+* renders RGB delivers both images per frame; the caller picks the depth one.
+*/
+class DepthCloud
+{
+    public:
+        /**
+        * constructor
+        */
+        explicit DepthCloud();
+
+        /**
+        * Destroy the class.
+        */
+        virtual ~DepthCloud();
+
+        /**
+        * set the number of worker threads and start them; call before
+        * RealTime::apply(), so no thread is created on the critical path
+        * @param noThreads  0 uses one per core
+        */
+        void setThreads( unsigned int noThreads );
+
+        /**
+        * pixel rows count from the bottom of the image (OpenGL read-back) instead of the top
+        */
+        void setOriginBottomLeft( bool bottomLeft );
+
+        /**
+        * convert a depth image
+        * @param img    depth image information, not the RGB image of the frame
+        * @param data   pixels of the image
+        * @param cam    camera of the image (its viewport may be scaled to the image)
+        * @param world  true: transform by the camera position into world coordinates
+        * @return number of points (width * height), 0 if the image is not a supported depth image
+        */
+        unsigned int convert( const RDB_IMAGE_t & img, const void* data, const RDB_CAMERA_t & cam, bool world = false );
+
+        /**
+        * access the coordinates of the last conversion [m]
+        */
+        const float* getX() const;
+        const float* getY() const;
+        const float* getZ() const;
+
+        /**
+        * get the size of the last conversion
+        */
+        unsigned int getWidth() const;
+        unsigned int getHeight() const;
+
+    private:
+        /**
+        * convert the rows [y0, y1)
+        */
+        void convertBand( int y0, int y1, std::vector<float> & scratch );
+
+        /**
+        * settings
+        */
+        unsigned int mNoThreads;
+        bool         mOriginBottomLeft;
+
+        /**
+        * state of the current image, shared with the workers
+        */
+        const unsigned char* mData;
+        unsigned int         mPixelBytes;
+        unsigned int         mWidth;
+        unsigned int         mHeight;
+        float                mDepthScale;    // depth buffer value -> 0..1
+        float                mNearFar;       // near * far
+        float                mFar;
+        float                mRange;         // far - near
+        float                mRot[9];        // camera -> output frame, row major
+        float                mPos[3];        // camera position in the output frame
+        std::vector<float>   mRayY;          // left per forward meter, per column
+        std::vector<float>   mRayZ;          // up per forward meter, per row
+
+        /**
+        * the cloud (structure of arrays)
+        */
+        std::vector<float>   mX, mY, mZ;
+
+        /**
+        * the workers and their buffers, kept from image to image
+        */
+        WorkerPool                        mPool;
+        std::vector< std::vector<float> > mScratch;     // per thread
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_DEPTH_CLOUD_HH */
@@ -0,0 +1,283 @@
+/* ===================================================
+ *  file:       DepthOcclusion.cc
+ * ---------------------------------------------------
+ *  purpose:	visible pixel ratio of image boxes from
+ *              the depth buffer of the IG
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "DepthOcclusion.hh"
+
+namespace Framework
+{
+
+/**
+* rows handed to a worker at a time
+*/
+static const int BAND_HEIGHT = 16;
+
+/**
+* boxes with less pixels in total are not worth starting threads for
+*/
+static const unsigned int MIN_PIXELS_PER_THREAD = 32768;
+
+/**
+* number of pixels in a row that are not closer than the threshold;
+* branch-free, so that the compiler vectorizes it
+*/
+template <class T>
+static unsigned int
+countRow( const T* __restrict p, int n, T threshold )
+{
+    unsigned int count = 0;
+
+    for ( int i = 0; i < n; i++ )
+        count += ( p[i] >= threshold );
+
+    return count;
+}
+
+DepthOcclusion::DepthOcclusion() : mNoThreads( 0 ),
+                                   mTolerance( 0.5f ),
+                                   mData( 0 ),
+                                   mStride( 0 ),
+                                   mPixelBytes( 0 ),
+                                   mBoxes( 0 ),
+                                   mNoBoxes( 0 )
+{
+}
+
+DepthOcclusion::~DepthOcclusion()
+{
+}
+
+void
+DepthOcclusion::setThreads( unsigned int noThreads )
+{
+    mNoThreads = noThreads;
+    mPool.start( noThreads );
+}
+
+void
+DepthOcclusion::setTolerance( float tolerance )
+{
+    mTolerance = tolerance;
+}
+
+bool
+DepthOcclusion::isDepthFormat( const RDB_IMAGE_t & img )
+{
+    return getMaxDepthValue( img ) > 0.0;
+}
+
+double
+DepthOcclusion::getMaxDepthValue( const RDB_IMAGE_t & img )
+{
+    unsigned int bits;
+
+    switch ( img.pixelFormat )
+    {
+        case RDB_PIX_FORMAT_DEPTH_8:
+        case RDB_PIX_FORMAT_DEPTH8:
+            bits = 8;
+            break;
+
+        case RDB_PIX_FORMAT_DEPTH_16:
+        case RDB_PIX_FORMAT_DEPTH16:
+            bits = 16;
+            break;
+
+        case RDB_PIX_FORMAT_DEPTH_24:
+        case RDB_PIX_FORMAT_DEPTH24:
+            bits = 24;
+            break;
+
+        case RDB_PIX_FORMAT_DEPTH_32:
+        case RDB_PIX_FORMAT_DEPTH32:
+            bits = 32;
+            break;
+
+        default:
+            return 0.0;
+    }
+
+    // the storage decides how the values are read (24 bit depth may come in 32 bit words)
+    if ( ( img.pixelSize != 8 ) && ( img.pixelSize != 16 ) && ( img.pixelSize != 24 ) && ( img.pixelSize != 32 ) )
+        return 0.0;
+
+    if ( img.pixelSize < bits )
+        return 0.0;
+
+    return ( double ) ( ( 1ull << bits ) - 1 );
+}
+
+void
+DepthOcclusion::countBand( int y0, int y1, unsigned int* counts, std::vector<uint32_t> & scratch ) const
+{
+    for ( unsigned int b = 0; b < mNoBoxes; b++ )
+    {
+        const DepthBox & box = mBoxes[ b ];
+
+        int ya = ( box.y1 > y0 ) ? box.y1 : y0;
+        int yb = ( box.y2 < y1 - 1 ) ? box.y2 : y1 - 1;
+        int n  = box.x2 - box.x1 + 1;
+
+        if ( ( ya > yb ) || ( n <= 0 ) )
+            continue;
+
+        uint32_t     t     = mThresholds[ b ];
+        unsigned int count = 0;
+
+        for ( int y = ya; y <= yb; y++ )
+        {
+            const unsigned char* row = mData + ( size_t ) y * mStride + ( size_t ) box.x1 * mPixelBytes;
+
+            switch ( mPixelBytes )
+            {
+                case 1:
+                    count += countRow( row, n, ( uint8_t ) t );
+                    break;
+
+                case 2:
+                    count += countRow( ( const uint16_t* ) row, n, ( uint16_t ) t );
+                    break;
+
+                case 3:
+                    // packed 24 bit values (little endian) are widened first
+                    scratch.resize( n );
+                    for ( int i = 0; i < n; i++ )
+                        scratch[ i ] = row[ 3 * i ] | ( row[ 3 * i + 1 ] << 8 ) | ( row[ 3 * i + 2 ] << 16 );
+                    count += countRow( &scratch[0], n, t );
+                    break;
+
+                default:
+                    count += countRow( ( const uint32_t* ) row, n, t );
+                    break;
+            }
+        }
+
+        counts[ b ] += count;
+    }
+}
+
+bool
+DepthOcclusion::visibleRatios( const RDB_IMAGE_t & img, const void* data, float clipNear, float clipFar,
+                               const DepthBox* boxes, unsigned int noBoxes, float* ratios )
+{
+    if ( !isDepthFormat( img ) )
+    {
+        fprintf( stderr, "DepthOcclusion::visibleRatios: image %d: unsupported pixel format %d / size %d\n",
+                         img.id, img.pixelFormat, img.pixelSize );
+        return false;
+    }
+
+    if ( img.imgSize < img.width * img.height * ( img.pixelSize / 8 ) )
+    {
+        fprintf( stderr, "DepthOcclusion::visibleRatios: image %d: %d bytes are too few for %dx%d pixels\n",
+                         img.id, img.imgSize, img.width, img.height );
+        return false;
+    }
+
+    if ( !noBoxes )
+        return true;
+
+    mData       = ( const unsigned char* ) data;
+    mPixelBytes = img.pixelSize / 8;
+    mStride     = img.width * mPixelBytes;
+    mBoxes      = boxes;
+    mNoBoxes    = noBoxes;
+
+    // window depth of the standard perspective projection: d = f / ( f - n ) * ( 1 - n / z ),
+    // stored as an unsigned normalized value of the pixel format
+    double maxValue = getMaxDepthValue( img );
+    double scale    = clipFar / ( double ) ( clipFar - clipNear );
+
+    mThresholds.resize( noBoxes );
+
+    int          yMin   = img.height;
+    int          yMax   = -1;
+    unsigned int pixels = 0;
+
+    for ( unsigned int b = 0; b < noBoxes; b++ )
+    {
+        const DepthBox & box = boxes[ b ];
+
+        double z = box.depth - mTolerance;
+        double d = ( z > clipNear ) ? scale * ( 1.0 - clipNear / z ) : 0.0;
+
+        d = ( d < 0.0 ) ? 0.0 : ( ( d > 1.0 ) ? 1.0 : d );
+
+        mThresholds[ b ] = ( uint32_t ) ( d * maxValue );
+
+        if ( ( box.x2 >= box.x1 ) && ( box.y2 >= box.y1 ) )
+        {
+            yMin    = ( box.y1 < yMin ) ? box.y1 : yMin;
+            yMax    = ( box.y2 > yMax ) ? box.y2 : yMax;
+            pixels += ( box.x2 - box.x1 + 1 ) * ( box.y2 - box.y1 + 1 );
+        }
+    }
+
+    unsigned int noThreads = mNoThreads ? mNoThreads : std::thread::hardware_concurrency();
+    int          noBands   = ( yMax >= yMin ) ? ( yMax - yMin ) / BAND_HEIGHT + 1 : 0;
+
+    if ( noThreads > pixels / MIN_PIXELS_PER_THREAD )
+        noThreads = pixels / MIN_PIXELS_PER_THREAD;
+
+    if ( noThreads > ( unsigned int ) noBands )
+        noThreads = noBands;
+
+    if ( noThreads < 1 )
+        noThreads = 1;
+
+    // without setThreads() the pool is started here, once
+    if ( ( noThreads > mPool.getNoThreads() ) && ( mPool.getNoThreads() == 1 ) )
+        mPool.start( mNoThreads );
+
+    if ( noThreads > mPool.getNoThreads() )
+        noThreads = mPool.getNoThreads();
+
+    if ( mScratch.size() < noThreads )
+        mScratch.resize( noThreads );
+
+    // bands are pulled off a shared counter, every thread sums into its own counts
+    std::atomic<int> nextBand( 0 );
+
+    mThreadCounts.assign( noThreads * noBoxes, 0 );
+
+    mPool.run( noThreads, [&]( unsigned int t )
+    {
+        int band;
+
+        while ( ( band = nextBand++ ) < noBands )
+        {
+            int y0 = yMin + band * BAND_HEIGHT;
+            int y1 = ( y0 + BAND_HEIGHT < yMax + 1 ) ? y0 + BAND_HEIGHT : yMax + 1;
+
+            countBand( y0, y1, &mThreadCounts[ t * noBoxes ], mScratch[ t ] );
+        }
+    } );
+
+    for ( unsigned int t = 1; t < noThreads; t++ )
+        for ( unsigned int b = 0; b < noBoxes; b++ )
+            mThreadCounts[ b ] += mThreadCounts[ t * noBoxes + b ];
+
+    const unsigned int* counts = &mThreadCounts[0];
+
+    for ( unsigned int b = 0; b < noBoxes; b++ )
+    {
+        const DepthBox & box = boxes[ b ];
+        int area = ( box.x2 - box.x1 + 1 ) * ( box.y2 - box.y1 + 1 );
+
+        ratios[ b ] = ( ( box.x2 >= box.x1 ) && ( box.y2 >= box.y1 ) ) ? ( float ) counts[ b ] / area : 0.0f;
+    }
+
+    mData  = 0;
+    mBoxes = 0;
+
+    return true;
+}
+
+} // namespace Framework
@@ -0,0 +1,117 @@
+/* ===================================================
+ *  file:       DepthOcclusion.hh
+ * ---------------------------------------------------
+ *  purpose:	visible pixel ratio of image boxes from
+ *              the depth buffer of the IG
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_DEPTH_OCCLUSION_HH
+#define _FRAMEWORK_DEPTH_OCCLUSION_HH
+
+/* ====== INCLUSIONS ====== */
+#include <vector>
+#include "viRDBIcd.h"
+#include "WorkerPool.hh"
+
+namespace Framework
+{
+/**
+* a box in depth image pixels (inclusive) and the distance of the object
+* it shows along the camera axis
+*/
+struct DepthBox
+{
+    int   x1, y1, x2, y2;
+    float depth;        // [m]
+};
+
+/**
+* A pixel of a box counts as visible if the depth buffer holds nothing closer
+* than the object (minus a tolerance for slanted faces). The object distance is
+* turned into a depth buffer value once per box, so the per-pixel work is an
+* integer compare and a sum over the rows of the box. Images are cut into
+* bands of rows that are spread over a pool of threads, started by
+* setThreads() or else by the first image that needs them.
+*/
+class DepthOcclusion
+{
+    public:
+        /**
+        * constructor
+        */
+        explicit DepthOcclusion();
+
+        /**
+        * Destroy the class.
+        */
+        virtual ~DepthOcclusion();
+
+        /**
+        * set the number of worker threads and start them; call before
+        * RealTime::apply(), so no thread is created on the critical path
+        * @param noThreads  0 uses one per core
+        */
+        void setThreads( unsigned int noThreads );
+
+        /**
+        * set the distance an occluder must be in front of the object [m]
+        */
+        void setTolerance( float tolerance );
+
+        /**
+        * true for the depth formats the class can read
+        */
+        static bool isDepthFormat( const RDB_IMAGE_t & img );
+
+        /**
+        * depth buffer value of the far plane, given by the pixel format, not
+        * the storage: 24 bit depth in 32 bit words (low bits) ends at 2^24 - 1
+        * @return 0 if the class cannot read the image
+        */
+        static double getMaxDepthValue( const RDB_IMAGE_t & img );
+
+        /**
+        * compute the visible pixel ratio of boxes
+        * @param img        depth image information
+        * @param data       pixels of the image
+        * @param clipNear   near clipping plane of the camera [m]
+        * @param clipFar    far clipping plane of the camera [m]
+        * @param boxes      boxes in pixels of the depth image, clipped to it
+        * @param noBoxes    number of boxes
+        * @param ratios     receives the visible ratio per box (0..1)
+        * @return false if the image format is not supported
+        */
+        bool visibleRatios( const RDB_IMAGE_t & img, const void* data, float clipNear, float clipFar,
+                            const DepthBox* boxes, unsigned int noBoxes, float* ratios );
+
+    private:
+        /**
+        * count the visible pixels of all boxes within the rows [y0, y1)
+        */
+        void countBand( int y0, int y1, unsigned int* counts, std::vector<uint32_t> & scratch ) const;
+
+        /**
+        * settings
+        */
+        unsigned int mNoThreads;
+        float        mTolerance;
+
+        /**
+        * state of the current image, shared with the workers
+        */
+        const unsigned char*  mData;
+        unsigned int          mStride;        // bytes per row
+        unsigned int          mPixelBytes;    // 1 to 4
+        const DepthBox*       mBoxes;
+        unsigned int          mNoBoxes;
+        std::vector<uint32_t> mThresholds;    // depth buffer value of each box
+
+        /**
+        * the workers and their buffers, kept from image to image
+        */
+        WorkerPool                           mPool;
+        std::vector<unsigned int>            mThreadCounts;     // visible pixels per thread and box
+        std::vector< std::vector<uint32_t> > mScratch;          // per thread
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_DEPTH_OCCLUSION_HH */
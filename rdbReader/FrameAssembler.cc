@@ -0,0 +1,375 @@
+/* ===================================================
+ *  file:       FrameAssembler.cc
+ * ---------------------------------------------------
+ *  purpose:	join the image of a frame (IG SHM) with
+ *              its ground truth (RDB network stream)
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <string.h>
+#include "FrameAssembler.hh"
+
+namespace Framework
+{
+
+/**
+* index of a single PART_* bit
+*/
+static unsigned int
+partIndex( unsigned int part )
+{
+    return ( part == FrameAssembler::PART_IMAGE ) ? 0 : ( part == FrameAssembler::PART_CAMERA ) ? 1 : 2;
+}
+
+/**
+* exchange two frames without copying their buffers
+*/
+static void
+swapFrames( FrameData & a, FrameData & b )
+{
+    FrameData tmp;
+
+    tmp.frameNo   = a.frameNo;   a.frameNo   = b.frameNo;   b.frameNo   = tmp.frameNo;
+    tmp.simTime   = a.simTime;   a.simTime   = b.simTime;   b.simTime   = tmp.simTime;
+    tmp.parts     = a.parts;     a.parts     = b.parts;     b.parts     = tmp.parts;
+    tmp.firstSeen = a.firstSeen; a.firstSeen = b.firstSeen; b.firstSeen = tmp.firstSeen;
+    tmp.noImages  = a.noImages;  a.noImages  = b.noImages;  b.noImages  = tmp.noImages;
+    tmp.camera    = a.camera;    a.camera    = b.camera;    b.camera    = tmp.camera;
+
+    a.images.swap( b.images );
+    a.imageData.swap( b.imageData );
+    a.signs.swap( b.signs );
+    a.sensorObjects.swap( b.sensorObjects );
+    a.objects.swap( b.objects );
+}
+
+FrameAssembler::FrameAssembler( unsigned int capacity, double timeout, unsigned int required ) :
+    mSlots( capacity ? capacity : 1 ),
+    mUsed( capacity ? capacity : 1, false ),
+    mNoImage( capacity ? capacity : 1, false ),
+    mNoUsed( 0 ),
+    mBase( 0 ),
+    mHaveBase( false ),
+    mSourceValid( 0 ),
+    mTimeout( timeout ),
+    mRequired( required )
+{
+    memset( mSourceFrame, 0, sizeof( mSourceFrame ) );
+    memset( &mStatistics, 0, sizeof( mStatistics ) );
+}
+
+FrameAssembler::~FrameAssembler()
+{
+}
+
+FrameData*
+FrameAssembler::getSlot( unsigned int frameNo, double simTime, double now )
+{
+    unsigned int capacity = mSlots.size();
+
+    if ( !mHaveBase )
+    {
+        mBase     = frameNo;
+        mHaveBase = true;
+    }
+
+    // already emitted or dropped
+    if ( frameNo < mBase )
+    {
+        mStatistics.lateParts++;
+        return 0;
+    }
+
+    // make room, oldest frames first
+    while ( frameNo - mBase >= capacity )
+    {
+        if ( !mNoUsed )
+        {
+            mBase = frameNo - capacity + 1;
+            break;
+        }
+
+        unsigned int oldest = mBase % capacity;
+
+        if ( mUsed[ oldest ] && mNoImage[ oldest ] )
+            mStatistics.notRendered++;
+        else if ( mUsed[ oldest ] )
+            mStatistics.overflow++;
+
+        advance();
+    }
+
+    unsigned int idx   = frameNo % capacity;
+    FrameData &  frame = mSlots[ idx ];
+
+    if ( !mUsed[ idx ] )
+    {
+        frame.frameNo   = frameNo;
+        frame.simTime   = simTime;
+        frame.parts     = 0;
+        frame.firstSeen = now;
+        frame.noImages  = 0;
+        frame.signs.clear();
+        frame.sensorObjects.clear();
+        frame.objects.clear();
+
+        mUsed[ idx ]    = true;
+        mNoImage[ idx ] = false;
+        mNoUsed++;
+    }
+
+    return &frame;
+}
+
+void
+FrameAssembler::markSource( unsigned int part, unsigned int frameNo )
+{
+    unsigned int i = partIndex( part );
+
+    // far behind the window: the simulation started over
+    if ( mHaveBase && ( frameNo < mBase ) && ( mBase - frameNo > mSlots.size() ) )
+        restart();
+
+    if ( !( mSourceValid & part ) || ( frameNo > mSourceFrame[ i ] ) )
+        mSourceFrame[ i ] = frameNo;
+
+    mSourceValid |= part;
+}
+
+bool
+FrameAssembler::isUnresolvable( unsigned int frameNo, unsigned int parts ) const
+{
+    unsigned int missing = mRequired & ~parts;
+
+    for ( unsigned int part = PART_IMAGE; part <= PART_STATE; part <<= 1 )
+        if ( ( missing & part ) && ( mSourceValid & part ) && ( mSourceFrame[ partIndex( part ) ] > frameNo ) )
+            return true;
+
+    return false;
+}
+
+void
+FrameAssembler::advance()
+{
+    unsigned int idx = mBase % mSlots.size();
+
+    if ( mUsed[ idx ] )
+    {
+        mUsed[ idx ] = false;
+        mNoUsed--;
+    }
+
+    mBase++;
+}
+
+void
+FrameAssembler::restart()
+{
+    for ( size_t i = 0; i < mUsed.size(); i++ )
+        mUsed[ i ] = false;
+
+    mNoUsed      = 0;
+    mHaveBase    = false;
+    mSourceValid = 0;
+    mStatistics.restarts++;
+}
+
+void
+FrameAssembler::addImage( unsigned int frameNo, double simTime, const RDB_IMAGE_t* img, double now )
+{
+    markSource( PART_IMAGE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( !frame )
+        return;
+
+    // one image per camera and pixel format; a second one of the same kind replaces the first
+    unsigned int i = 0;
+
+    while ( ( i < frame->noImages ) &&
+            ( ( frame->images[ i ].cameraId != img->cameraId ) || ( frame->images[ i ].pixelFormat != img->pixelFormat ) ) )
+        i++;
+
+    if ( i < frame->noImages )
+        mStatistics.replacedImages++;
+    else
+    {
+        if ( frame->images.size() <= i )
+        {
+            frame->images.resize( i + 1 );
+            frame->imageData.resize( i + 1 );
+        }
+
+        frame->noImages++;
+    }
+
+    // the pixels follow the image package
+    const unsigned char* data = ( const unsigned char* ) ( img + 1 );
+
+    frame->images[ i ] = *img;
+    frame->imageData[ i ].assign( data, data + img->imgSize );
+    frame->parts |= PART_IMAGE;
+}
+
+void
+FrameAssembler::addCamera( unsigned int frameNo, double simTime, const RDB_CAMERA_t* cam, double now )
+{
+    markSource( PART_CAMERA, frameNo );
+    markSource( PART_STATE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( !frame )
+        return;
+
+    frame->camera = *cam;
+    frame->parts |= PART_CAMERA;
+}
+
+void
+FrameAssembler::addSigns( unsigned int frameNo, double simTime, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns, double now )
+{
+    markSource( PART_CAMERA, frameNo );
+    markSource( PART_STATE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( frame )
+        frame->signs.insert( frame->signs.end(), signs, signs + noSigns );
+}
+
+void
+FrameAssembler::addSensorObjects( unsigned int frameNo, double simTime, const RDB_SENSOR_OBJECT_t* objs, unsigned int noObjs, double now )
+{
+    markSource( PART_CAMERA, frameNo );
+    markSource( PART_STATE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( frame )
+        frame->sensorObjects.insert( frame->sensorObjects.end(), objs, objs + noObjs );
+}
+
+void
+FrameAssembler::addObjects( unsigned int frameNo, double simTime, const RDB_OBJECT_STATE_t* objs, unsigned int noObjs, double now )
+{
+    markSource( PART_CAMERA, frameNo );
+    markSource( PART_STATE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( frame )
+        frame->objects.insert( frame->objects.end(), objs, objs + noObjs );
+}
+
+void
+FrameAssembler::endOfState( unsigned int frameNo, double simTime, double now )
+{
+    markSource( PART_CAMERA, frameNo );
+    markSource( PART_STATE, frameNo );
+
+    FrameData* frame = getSlot( frameNo, simTime, now );
+
+    if ( frame )
+        frame->parts |= PART_STATE;
+}
+
+void
+FrameAssembler::skipImage( unsigned int frameNo )
+{
+    unsigned int capacity = mSlots.size();
+
+    // frames that are gone or not there yet need no mark
+    if ( !mHaveBase || ( frameNo < mBase ) || ( frameNo - mBase >= capacity ) )
+        return;
+
+    unsigned int idx = frameNo % capacity;
+
+    if ( mUsed[ idx ] )
+        mNoImage[ idx ] = true;
+}
+
+unsigned int
+FrameAssembler::getCapacity() const
+{
+    return mSlots.size();
+}
+
+bool
+FrameAssembler::pop( double now, FrameData & frame )
+{
+    unsigned int capacity = mSlots.size();
+
+    while ( mNoUsed )
+    {
+        unsigned int idx = mBase % capacity;
+
+        if ( mUsed[ idx ] )
+        {
+            FrameData & front = mSlots[ idx ];
+
+            if ( ( front.parts & mRequired ) == mRequired )
+            {
+                swapFrames( frame, front );
+                mStatistics.emitted++;
+                advance();
+                return true;
+            }
+
+            if ( mNoImage[ idx ] )
+                mStatistics.notRendered++;
+            else if ( isUnresolvable( front.frameNo, front.parts ) )
+                mStatistics.incomplete++;
+            else if ( ( mTimeout > 0.0 ) && ( now - front.firstSeen > mTimeout ) )
+                mStatistics.timedOut++;
+            else
+                return false;   // wait for the missing parts
+
+            advance();
+            continue;
+        }
+
+        // nothing arrived for this frame yet; skip it once it cannot complete
+        // or once a later frame has waited too long
+        if ( isUnresolvable( mBase, 0 ) )
+        {
+            advance();
+            continue;
+        }
+
+        double oldest = now;
+
+        for ( unsigned int i = 0; i < capacity; i++ )
+            if ( mUsed[ i ] && ( mSlots[ i ].firstSeen < oldest ) )
+                oldest = mSlots[ i ].firstSeen;
+
+        if ( ( mTimeout > 0.0 ) && ( now - oldest > mTimeout ) )
+        {
+            advance();
+            continue;
+        }
+
+        return false;
+    }
+
+    return false;
+}
+
+const FrameAssembler::Statistics &
+FrameAssembler::getStatistics() const
+{
+    return mStatistics;
+}
+
+void
+FrameAssembler::printStatistics() const
+{
+    fprintf( stderr, "FrameAssembler: emitted = %u, dropped incomplete = %u, timed out = %u, overflow = %u, late parts = %u, replaced images = %u, not rendered = %u, restarts = %u, pending = %u\n",
+                     mStatistics.emitted, mStatistics.incomplete, mStatistics.timedOut,
+                     mStatistics.overflow, mStatistics.lateParts, mStatistics.replacedImages,
+                     mStatistics.notRendered, mStatistics.restarts, mNoUsed );
+}
+
+} // namespace Framework
@@ -0,0 +1,188 @@
+/* ===================================================
+ *  file:       FrameAssembler.hh
+ * ---------------------------------------------------
+ *  purpose:	join the image of a frame (IG SHM) with
+ *              its ground truth (RDB network stream)
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_FRAME_ASSEMBLER_HH
+#define _FRAMEWORK_FRAME_ASSEMBLER_HH
+
+/* ====== INCLUSIONS ====== */
+#include <vector>
+#include "viRDBIcd.h"
+
+namespace Framework
+{
+/**
+* everything known about one simulation frame
+*/
+struct FrameData
+{
+    unsigned int                     frameNo;
+    double                           simTime;
+    unsigned int                     parts;         // FrameAssembler::PART_* received so far
+    double                           firstSeen;     // wall clock time of the first part
+
+    unsigned int                     noImages;      // one image per camera and pixel format (e.g. RGB and depth)
+    std::vector<RDB_IMAGE_t>         images;        // first noImages are valid, the rest are kept for re-use
+    std::vector< std::vector<unsigned char> > imageData;   // pixels following each image package
+    RDB_CAMERA_t                     camera;
+    std::vector<RDB_TRAFFIC_SIGN_t>  signs;
+    std::vector<RDB_SENSOR_OBJECT_t> sensorObjects;
+    std::vector<RDB_OBJECT_STATE_t>  objects;
+};
+
+/**
+* fixed-capacity reorder buffer keyed by frame number
+*
+* Each part of a frame comes from a source that delivers frames in order
+* (images from the IG SHM, everything else from the RDB network stream).
+* Complete frames are handed out in frame order. A frame is dropped as soon
+* as it cannot become complete any more: a source it still waits for has
+* already moved past it, it waited longer than the timeout, or it fell out
+* of the window of <capacity> frames. Memory is bounded by the capacity
+* and slot buffers are reused, so a stalled source never blocks the others
+* and nothing grows with the length of a run.
+*
+* Frames the IG is not asked to render are announced with skipImage(); they
+* are dropped as not rendered instead of incomplete, so the incomplete count
+* stands for data that was actually lost. A part more than a window behind
+* the oldest pending frame means the simulation was restarted: the window
+* starts over at that frame.
+*/
+class FrameAssembler
+{
+    public:
+        enum
+        {
+            PART_IMAGE  = 0x1,      // image package (+ pixels), IG SHM
+            PART_CAMERA = 0x2,      // camera package, network
+            PART_STATE  = 0x4       // end of frame of the network stream, i.e. signs and objects are complete
+        };
+
+        /**
+        * drop and throughput counters
+        */
+        struct Statistics
+        {
+            unsigned int emitted;       // complete frames handed out
+            unsigned int incomplete;    // dropped, a required source moved past the frame
+            unsigned int timedOut;      // dropped, waited longer than the timeout
+            unsigned int overflow;      // dropped, pushed out of the window by newer frames
+            unsigned int lateParts;     // parts of frames that were already emitted or dropped
+            unsigned int replacedImages; // images that replaced one of the same camera and format in their frame
+            unsigned int notRendered;   // dropped, the IG was not asked to render the frame
+            unsigned int restarts;      // frame numbers went back by more than the window, pending frames dropped
+        };
+
+    public:
+        /**
+        * constructor
+        * @param capacity   number of frames that may be pending at once
+        * @param timeout    time a frame may wait for its missing parts [s]; <= 0 waits forever
+        * @param required   parts that make a frame complete
+        */
+        explicit FrameAssembler( unsigned int capacity = 16, double timeout = 0.5,
+                                 unsigned int required = PART_IMAGE | PART_STATE );
+
+        /**
+        * Destroy the class.
+        */
+        virtual ~FrameAssembler();
+
+        /**
+        * add the parts of a frame
+        * @param frameNo    simulation frame the part belongs to
+        * @param simTime    simulation time of the frame
+        * @param now        current wall clock time [s]
+        */
+        void addImage( unsigned int frameNo, double simTime, const RDB_IMAGE_t* img, double now );
+        void addCamera( unsigned int frameNo, double simTime, const RDB_CAMERA_t* cam, double now );
+        void addSigns( unsigned int frameNo, double simTime, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns, double now );
+        void addSensorObjects( unsigned int frameNo, double simTime, const RDB_SENSOR_OBJECT_t* objs, unsigned int noObjs, double now );
+        void addObjects( unsigned int frameNo, double simTime, const RDB_OBJECT_STATE_t* objs, unsigned int noObjs, double now );
+        void endOfState( unsigned int frameNo, double simTime, double now );
+
+        /**
+        * the frame will get no image, it is dropped once it reaches the front
+        * unless it is complete by then
+        */
+        void skipImage( unsigned int frameNo );
+
+        /**
+        * number of frames that may be pending at once
+        */
+        unsigned int getCapacity() const;
+
+        /**
+        * get the next complete frame, dropping the ones that cannot complete any more
+        * @param now    current wall clock time [s]
+        * @param frame  receives the frame (its buffers are swapped with a free slot, so
+        *               passing the same object again avoids allocations)
+        * @return true if a frame was handed out
+        */
+        bool pop( double now, FrameData & frame );
+
+        /**
+        * get the counters
+        */
+        const Statistics & getStatistics() const;
+
+        /**
+        * print the counters
+        */
+        void printStatistics() const;
+
+    private:
+        /**
+        * get the slot of a frame, creating it if necessary; 0 for a frame that is already gone
+        */
+        FrameData* getSlot( unsigned int frameNo, double simTime, double now );
+
+        /**
+        * remember how far the source of a part has got
+        */
+        void markSource( unsigned int part, unsigned int frameNo );
+
+        /**
+        * true if a frame lacking the given parts can never be completed
+        */
+        bool isUnresolvable( unsigned int frameNo, unsigned int parts ) const;
+
+        /**
+        * free the oldest slot of the window and move the window on
+        */
+        void advance();
+
+        /**
+        * drop all pending frames and forget the sources, the next part starts a new window
+        */
+        void restart();
+
+        /**
+        * the ring of slots, frame f lives in slot f % capacity
+        */
+        std::vector<FrameData> mSlots;
+        std::vector<bool>      mUsed;
+        std::vector<bool>      mNoImage;        // skipImage() was called for the frame of the slot
+        unsigned int           mNoUsed;
+
+        /**
+        * the window covers frames [mBase, mBase + capacity)
+        */
+        unsigned int           mBase;
+        bool                   mHaveBase;
+
+        /**
+        * latest frame seen per source part (valid if the bit is set in mSourceValid)
+        */
+        unsigned int           mSourceFrame[3];
+        unsigned int           mSourceValid;
+
+        double                 mTimeout;
+        unsigned int           mRequired;
+        Statistics             mStatistics;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_FRAME_ASSEMBLER_HH */
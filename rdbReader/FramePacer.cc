@@ -0,0 +1,161 @@
+/* ===================================================
+ *  file:       FramePacer.cc
+ * ---------------------------------------------------
+ *  purpose:	drift-free periodic pacing on absolute
+ *              deadlines
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include "FramePacer.hh"
+#include "RealTime.hh"
+
+namespace Framework
+{
+
+/**
+* sleep until an absolute CLOCK_MONOTONIC time [s]
+*/
+static void
+sleepUntil( double t )
+{
+    struct timespec ts;
+
+    ts.tv_sec  = ( time_t ) t;
+    ts.tv_nsec = ( long ) ( ( t - ts.tv_sec ) * 1.e9 );
+
+    if ( ts.tv_nsec >= 1000000000L )
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    // restart after signals, the deadline stays the same
+    while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0 ) == EINTR )
+        ;
+}
+
+FramePacer::FramePacer( double period, double spin, Policy policy, unsigned int maxCatchUp ) :
+    mPeriod( period ),
+    mSpin( spin > 0.0 ? spin : 0.0 ),
+    mPolicy( policy ),
+    mMaxCatchUp( maxCatchUp )
+{
+    start();
+}
+
+void
+FramePacer::start()
+{
+    mStart     = RealTime::now();
+    mIndex     = 0;
+    mFirstTick = -1.0;
+    mLastTick  = -1.0;
+
+    memset( &mStatistics, 0, sizeof( mStatistics ) );
+    mStatistics.minJitter =  1.e9;
+    mStatistics.maxJitter = -1.e9;
+}
+
+unsigned int
+FramePacer::wait()
+{
+    unsigned int skipped  = 0;
+    double       now      = RealTime::now();
+    double       deadline = mStart + mIndex * mPeriod;
+
+    // a whole period or more behind?
+    if ( now - deadline >= mPeriod )
+    {
+        unsigned long behind = ( unsigned long ) ( ( now - deadline ) / mPeriod );
+
+        if ( mPolicy == POLICY_SKIP || behind > mMaxCatchUp )
+        {
+            skipped   = behind;
+            mIndex   += behind;
+            deadline  = mStart + mIndex * mPeriod;
+
+            // next one is in the future, not now
+            if ( deadline <= now )
+            {
+                mIndex++;
+                skipped++;
+                deadline += mPeriod;
+            }
+            mStatistics.skipped += skipped;
+        }
+    }
+
+    if ( deadline - mSpin > now )
+        sleepUntil( deadline - mSpin );
+
+    while ( ( now = RealTime::now() ) < deadline )
+        ;
+
+    mIndex++;
+
+    double late = now - deadline;
+
+    if ( late >= mPeriod )
+        mStatistics.misses++;
+
+    if ( late > mStatistics.maxLate )
+        mStatistics.maxLate = late;
+
+    if ( mLastTick >= 0.0 && !skipped )
+    {
+        double jitter = ( now - mLastTick ) - mPeriod;
+
+        mStatistics.intervals++;
+        mStatistics.sumJitter   += jitter;
+        mStatistics.sumSqJitter += jitter * jitter;
+
+        if ( jitter < mStatistics.minJitter )
+            mStatistics.minJitter = jitter;
+
+        if ( jitter > mStatistics.maxJitter )
+            mStatistics.maxJitter = jitter;
+    }
+
+    if ( mLastTick < 0.0 )
+        mFirstTick = now;
+
+    mLastTick = now;
+    mStatistics.ticks++;
+
+    return skipped;
+}
+
+const FramePacer::Statistics &
+FramePacer::getStatistics() const
+{
+    return mStatistics;
+}
+
+void
+FramePacer::printStatistics( const char* caller ) const
+{
+    const Statistics & s = mStatistics;
+    double elapsed = mLastTick - mFirstTick;
+
+    fprintf( stderr, "%s: %u ticks at %.3lf Hz (measured %.4lf Hz), %u missed, %u skipped, max late = %.1lf us\n",
+                     caller, s.ticks, 1.0 / mPeriod,
+                     elapsed > 0.0 ? ( s.ticks - 1 ) / elapsed : 0.0,
+                     s.misses, s.skipped, 1.e6 * s.maxLate );
+
+    if ( s.intervals )
+    {
+        double mean = s.sumJitter / s.intervals;
+        double var  = s.sumSqJitter / s.intervals - mean * mean;
+
+        fprintf( stderr, "%s: period jitter mean = %.1lf us, stddev = %.1lf us, min = %.1lf us, max = %.1lf us\n",
+                         caller, 1.e6 * mean, 1.e6 * sqrt( var > 0.0 ? var : 0.0 ),
+                         1.e6 * s.minJitter, 1.e6 * s.maxJitter );
+    }
+}
+
+} // namespace Framework
@@ -0,0 +1,98 @@
+/* ===================================================
+ *  file:       FramePacer.hh
+ * ---------------------------------------------------
+ *  purpose:	drift-free periodic pacing on absolute
+ *              deadlines
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_FRAME_PACER_HH
+#define _FRAMEWORK_FRAME_PACER_HH
+
+namespace Framework
+{
+/**
+* Paces a loop at a fixed period. Deadlines are absolute points on
+* CLOCK_MONOTONIC (start + n * period), so neither the work done in a period
+* nor the oversleep of a wake-up accumulates. wait() sleeps with
+* clock_nanosleep( TIMER_ABSTIME ) until spin seconds before the deadline and
+* busy-waits the rest, which trades a little CPU for wake-up precision.
+*
+* When a deadline is missed by a whole period or more:
+*   POLICY_SKIP      the missed deadlines are dropped and the pacer continues
+*                    with the next one in the future (keeps the phase, loses
+*                    frames)
+*   POLICY_CATCH_UP  wait() returns immediately until the loop has caught up
+*                    with the deadlines (keeps the frame count matching the
+*                    elapsed time); at most maxCatchUp periods, then it skips
+*/
+class FramePacer
+{
+    public:
+        enum Policy
+        {
+            POLICY_SKIP = 0,
+            POLICY_CATCH_UP
+        };
+
+        /**
+        * jitter and deadline counters
+        */
+        struct Statistics
+        {
+            unsigned int ticks;         // wait() calls that returned
+            unsigned int misses;        // returned a whole period or more late
+            unsigned int skipped;       // deadlines dropped
+            unsigned int intervals;     // tick to tick intervals in the jitter sums
+            double       sumJitter;     // sum and sum of squares of ( interval - period ) [s]
+            double       sumSqJitter;
+            double       minJitter;
+            double       maxJitter;
+            double       maxLate;       // largest wake-up after the deadline [s]
+        };
+
+    public:
+        /**
+        * constructor
+        * @param period     [s]
+        * @param spin       [s] to busy-wait before each deadline
+        * @param policy     what to do with missed deadlines
+        * @param maxCatchUp periods POLICY_CATCH_UP may fall behind
+        */
+        explicit FramePacer( double period = 1.0 / 60.0, double spin = 0.0,
+                             Policy policy = POLICY_SKIP, unsigned int maxCatchUp = 10 );
+
+        /**
+        * the first deadline is now; resets the statistics
+        */
+        void start();
+
+        /**
+        * wait for the next deadline
+        * @return number of deadlines skipped before this one
+        */
+        unsigned int wait();
+
+        double getPeriod() const { return mPeriod; }
+
+        const Statistics & getStatistics() const;
+
+        /**
+        * print the statistics to stderr
+        */
+        void printStatistics( const char* caller ) const;
+
+    private:
+        double        mPeriod;
+        double        mSpin;
+        Policy        mPolicy;
+        unsigned int  mMaxCatchUp;
+
+        double        mStart;       // time of the deadline with index 0
+        unsigned long mIndex;       // of the next deadline
+        double        mFirstTick;
+        double        mLastTick;    // < 0 before the first tick
+
+        Statistics    mStatistics;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_FRAME_PACER_HH */
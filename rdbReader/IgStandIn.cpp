@@ -0,0 +1,473 @@
+// IgStandIn.cpp : stand-in for taskControl and IG, as seen by shmWriterExt
+//
+// Answers every trigger on the RDB port with a simulation frame (camera and
+// traffic signs) and renders an image into the IG output SHM whenever the
+// IG control SHM asks for one. Rendering takes a fixed time (the GPU of a
+// real IG), the pixels are a cheap test pattern. Meant for running the data
+// generation pipeline, e.g. several instances of it, without the simulator.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/shm.h>
+#include <vector>
+#include "RDBHandler.hh"
+#include "ShmSegment.hh"
+#include "RealTime.hh"
+
+// forward declarations of methods
+
+/**
+* open the listening socket
+*/
+int openServer();
+
+/**
+* serve one client until it disconnects
+*/
+void serveClient( int client );
+
+/**
+* answer a trigger with the ground truth of the frame
+*/
+void sendFrame( int client, unsigned int simFrame, double simTime );
+
+/**
+* check the IG control SHM for a render request and render if there is one
+*/
+void checkIgCtrlShm();
+
+/**
+* render the current frame into the IG output SHM
+*/
+void renderImage();
+
+/**
+* some global variables, considered "members" of this example
+*/
+unsigned int mIgCtrlShmKey = RDB_SHM_ID_CONTROL_GENERATOR_IN;     // created by the client
+unsigned int mIgOutShmKey  = RDB_SHM_ID_IMG_GENERATOR_OUT;        // created here
+int          iPort         = RDB_DEFAULT_PORT;
+int          mWidth        = 640;                                 // image size
+int          mHeight       = 480;
+double       mRenderTime   = 0.02;                                // [s] per image
+int          mNoSigns      = 4;                                   // signs per frame
+double       mSignSpacing  = 0.0;                                 // [m] between signs along the road, 0: signs stay close
+bool         mVerbose      = false;
+
+void*        mIgCtrlShmPtr = 0;
+void*        mIgOutShmPtr  = 0;
+Framework::RDBHandler mIgCtrlRdbHandler;
+Framework::RDBHandler mIgOutRdbHandler;
+
+unsigned int mLastFrame    = 0;                                   // last frame sent over the network
+double       mLastSimTime  = 0.0;
+unsigned int mImageId      = 0;
+unsigned int mNoImages     = 0;
+volatile sig_atomic_t mQuit = 0;
+
+/**
+* information about usage of the software
+* this method will exit the program
+*/
+void usage()
+{
+    printf("usage: igStandIn [-k:key] [-i:key] [-p:x] [-s:WxH] [-r:ms] [-n:signs] [-d:m] [-v]\n\n");
+    printf("       -k:key        SHM key of the IG control (created by the client)\n");
+    printf("       -i:key        SHM key of the IG image output\n");
+    printf("       -p:x          port to listen on for the RDB client\n");
+    printf("       -s:WxH        image size\n");
+    printf("       -r:ms         render time per image\n");
+    printf("       -n:signs      traffic signs per frame\n");
+    printf("       -d:m          place the signs every m meters along the road, so most frames show none\n");
+    printf("       -v            run in verbose mode\n");
+    exit(1);
+}
+
+/**
+* validate the arguments given in the command line
+*/
+void ValidateArgs(int argc, char **argv)
+{
+    for( int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] == '-') || (argv[i][0] == '/'))
+        {
+            switch (tolower(argv[i][1]))
+            {
+                case 'k':
+                    if ( strlen( argv[i] ) > 3 )
+                        sscanf( &argv[i][3], "0x%x", &mIgCtrlShmKey );
+                    break;
+
+                case 'i':
+                    if ( strlen( argv[i] ) > 3 )
+                        sscanf( &argv[i][3], "0x%x", &mIgOutShmKey );
+                    break;
+
+                case 'p':
+                    if ( strlen( argv[i] ) > 3 )
+                        iPort = atoi( &argv[i][3] );
+                    break;
+
+                case 's':
+                    if ( strlen( argv[i] ) > 3 )
+                        sscanf( &argv[i][3], "%dx%d", &mWidth, &mHeight );
+                    break;
+
+                case 'r':
+                    if ( strlen( argv[i] ) > 3 )
+                        mRenderTime = 1.e-3 * atof( &argv[i][3] );
+                    break;
+
+                case 'n':
+                    if ( strlen( argv[i] ) > 3 )
+                        mNoSigns = atoi( &argv[i][3] );
+                    break;
+
+                case 'd':
+                    if ( strlen( argv[i] ) > 3 )
+                        mSignSpacing = atof( &argv[i][3] );
+                    break;
+
+                case 'v':
+                    mVerbose = true;
+                    break;
+
+                default:
+                    usage();
+                    break;
+            }
+        }
+    }
+
+    fprintf( stderr, "ValidateArgs: control key = 0x%x, image key = 0x%x, port = %d, %dx%d, %.1lf ms per image\n",
+                     mIgCtrlShmKey, mIgOutShmKey, iPort, mWidth, mHeight, 1.e3 * mRenderTime );
+}
+
+void handleSignal( int )
+{
+    mQuit = 1;
+}
+
+int main(int argc, char* argv[])
+{
+    ValidateArgs(argc, argv);
+
+    // no SA_RESTART, so a signal ends a waiting accept()
+    struct sigaction action;
+    memset( &action, 0, sizeof( action ) );
+    action.sa_handler = handleSignal;
+    sigaction( SIGINT, &action, 0 );
+    sigaction( SIGTERM, &action, 0 );
+    signal( SIGPIPE, SIG_IGN );
+
+    // the image output: two buffers, each holding one RGB8 image message
+    size_t bufferSize = 1024 + sizeof( RDB_IMAGE_t ) + ( size_t ) mWidth * mHeight * 3;
+    size_t totalSize  = sizeof( RDB_SHM_HDR_t ) + 2 * ( sizeof( RDB_SHM_BUFFER_INFO_t ) + bufferSize );
+    Framework::ShmSegment::Info info;
+
+    // start from a fresh segment, a stale one may have the wrong size
+    int shmId = shmget( mIgOutShmKey, 0, 0 );
+
+    if ( shmId >= 0 )
+        shmctl( shmId, IPC_RMID, 0 );
+
+    if ( !( mIgOutShmPtr = Framework::ShmSegment::open( mIgOutShmKey, totalSize, 0, info ) ) )
+        return 1;
+
+    Framework::ShmSegment::print( "main", mIgOutShmKey, info );
+    mIgOutRdbHandler.shmConfigure( mIgOutShmPtr, 2, info.size );
+
+    int server = openServer();
+
+    if ( server < 0 )
+        return 1;
+
+    while ( !mQuit )
+    {
+        int client = accept( server, 0, 0 );
+
+        if ( client < 0 )
+        {
+            if ( errno != EINTR )
+                perror( "main: accept()" );
+            continue;
+        }
+
+        int opt = 1;
+        setsockopt( client, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof( opt ) );
+
+        fprintf( stderr, "main: client connected\n" );
+        serveClient( client );
+        close( client );
+        fprintf( stderr, "main: client disconnected after %u images\n", mNoImages );
+    }
+
+    close( server );
+    Framework::ShmSegment::close( info );
+    shmctl( info.shmId, IPC_RMID, 0 );
+
+    return 0;
+}
+
+int openServer()
+{
+    int server = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+    if ( server < 0 )
+    {
+        perror( "openServer: socket()" );
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt( server, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof( opt ) );
+
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons( iPort );
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+
+    if ( bind( server, ( struct sockaddr* ) &addr, sizeof( addr ) ) < 0 || listen( server, 1 ) < 0 )
+    {
+        perror( "openServer: bind() / listen()" );
+        close( server );
+        return -1;
+    }
+
+    return server;
+}
+
+void serveClient( int client )
+{
+    std::vector<unsigned char> data;
+    unsigned char buffer[ 65536 ];
+
+    while ( !mQuit )
+    {
+        fd_set         fs;
+        struct timeval timeout;
+
+        FD_ZERO( &fs );
+        FD_SET( client, &fs );
+        timeout.tv_sec  = 0;
+        timeout.tv_usec = 200;
+
+        if ( select( client + 1, &fs, 0, 0, &timeout ) > 0 )
+        {
+            int ret = recv( client, buffer, sizeof( buffer ), 0 );
+
+            if ( ret <= 0 )
+                break;
+
+            data.insert( data.end(), buffer, buffer + ret );
+
+            // handle all complete messages
+            size_t used = 0;
+
+            while ( data.size() - used >= sizeof( RDB_MSG_HDR_t ) )
+            {
+                RDB_MSG_t* msg = ( RDB_MSG_t* ) &data[ used ];
+
+                if ( msg->hdr.magicNo != RDB_MAGIC_NO )
+                {
+                    fprintf( stderr, "serveClient: message out of sync, discarding data\n" );
+                    used = data.size();
+                    break;
+                }
+
+                size_t size = msg->hdr.headerSize + msg->hdr.dataSize;
+
+                if ( data.size() - used < size )
+                    break;
+
+                // look for triggers
+                char* entry = ( char* ) msg + msg->hdr.headerSize;
+                char* end   = entry + msg->hdr.dataSize;
+
+                while ( entry + sizeof( RDB_MSG_ENTRY_HDR_t ) <= end )
+                {
+                    RDB_MSG_ENTRY_HDR_t* hdr = ( RDB_MSG_ENTRY_HDR_t* ) entry;
+
+                    if ( !hdr->headerSize )
+                        break;
+
+                    if ( hdr->pkgId == RDB_PKG_ID_TRIGGER && hdr->dataSize >= sizeof( RDB_TRIGGER_t ) )
+                    {
+                        RDB_TRIGGER_t* trigger = ( RDB_TRIGGER_t* ) ( entry + hdr->headerSize );
+
+                        sendFrame( client, trigger->frameNo, msg->hdr.simTime );
+                    }
+
+                    entry += hdr->headerSize + hdr->dataSize;
+                }
+
+                used += size;
+            }
+
+            data.erase( data.begin(), data.begin() + used );
+        }
+
+        checkIgCtrlShm();
+    }
+}
+
+void sendFrame( int client, unsigned int simFrame, double simTime )
+{
+    Framework::RDBHandler handler;
+
+    handler.initMsg();
+    handler.addPackage( simTime, simFrame, RDB_PKG_ID_START_OF_FRAME );
+
+    RDB_CAMERA_t* cam = ( RDB_CAMERA_t* ) handler.addPackage( simTime, simFrame, RDB_PKG_ID_CAMERA );
+
+    if ( cam )
+    {
+        cam->width      = mWidth;
+        cam->height     = mHeight;
+        cam->clipNear   = 0.1f;
+        cam->clipFar    = 1000.0f;
+        cam->focalX     = cam->focalY = 0.8f * mWidth;
+        cam->principalX = 0.5f * mWidth;
+        cam->principalY = 0.5f * mHeight;
+    }
+
+    if ( mNoSigns > 0 )
+    {
+        RDB_TRAFFIC_SIGN_t* signs = ( RDB_TRAFFIC_SIGN_t* ) handler.addPackage( simTime, simFrame, RDB_PKG_ID_TRAFFIC_SIGN, mNoSigns );
+
+        for ( int i = 0; signs && i < mNoSigns; i++ )
+        {
+            signs[ i ].id       = i + 1;
+            signs[ i ].type     = 274;
+            signs[ i ].subType  = 50;
+            signs[ i ].roadDist = 10.0f * ( i + 1 ) - 0.1f * ( simFrame % 100 );
+
+            // the next signs ahead of a camera that drives 0.1 m per frame
+            if ( mSignSpacing > 0.0 )
+            {
+                double       x = 0.1 * simFrame;
+                unsigned int k = ( unsigned int ) ( x / mSignSpacing ) + 1 + i;
+
+                signs[ i ].id       = k;
+                signs[ i ].roadDist = k * mSignSpacing - x;
+            }
+
+            signs[ i ].pos.x    = signs[ i ].roadDist;
+            signs[ i ].pos.y    = ( i & 1 ) ? 4.0 : -4.0;
+            signs[ i ].pos.z    = 2.0;
+        }
+    }
+
+    handler.addPackage( simTime, simFrame, RDB_PKG_ID_END_OF_FRAME );
+
+    if ( send( client, ( const char* ) handler.getMsg(), handler.getMsgTotalSize(), 0 ) < 0 )
+        perror( "sendFrame: send()" );
+
+    mLastFrame   = simFrame;
+    mLastSimTime = simTime;
+}
+
+void checkIgCtrlShm()
+{
+    // the client creates the control segment
+    if ( !mIgCtrlShmPtr )
+    {
+        int shmId = shmget( mIgCtrlShmKey, 0, 0 );
+
+        if ( shmId < 0 )
+            return;
+
+        void* ptr = shmat( shmId, 0, 0 );
+
+        if ( ptr == ( void* ) -1 )
+            return;
+
+        mIgCtrlShmPtr = ptr;
+        mIgCtrlRdbHandler.shmSetAddress( mIgCtrlShmPtr );
+    }
+
+    RDB_SHM_BUFFER_INFO_t* info = mIgCtrlRdbHandler.shmBufferGetInfo( 0 );
+
+    if ( !info || !( info->flags & RDB_SHM_BUFFER_FLAG_IG ) || ( info->flags & RDB_SHM_BUFFER_FLAG_LOCK ) )
+        return;
+
+    // the request is taken, the client may write the next one
+    info->flags = 0;
+
+    renderImage();
+}
+
+void renderImage()
+{
+    double start = Framework::RealTime::now();
+
+    mIgOutRdbHandler.initMsg();
+
+    size_t       imgSize = ( size_t ) mWidth * mHeight * 3;
+    RDB_IMAGE_t* img     = ( RDB_IMAGE_t* ) mIgOutRdbHandler.addPackage( mLastSimTime, mLastFrame, RDB_PKG_ID_IMAGE, 1, false, imgSize );
+
+    if ( !img )
+        return;
+
+    mImageId += 3;      // one image every 3rd frame, as the client expects
+
+    img->id          = mImageId;
+    img->width       = mWidth;
+    img->height      = mHeight;
+    img->pixelSize   = 24;
+    img->pixelFormat = RDB_PIX_FORMAT_RGB8;
+    img->imgSize     = imgSize;
+
+    // a pattern that moves with the frame
+    unsigned char* pixels = ( unsigned char* ) ( img + 1 );
+
+    for ( int y = 0; y < mHeight; y++ )
+        memset( pixels + ( size_t ) y * mWidth * 3, ( y + mLastFrame ) & 0xff, mWidth * 3 );
+
+    // the rest of the render time is the GPU's
+    double remaining = mRenderTime - ( Framework::RealTime::now() - start );
+
+    if ( remaining > 0.0 )
+        usleep( ( unsigned int ) ( 1.e6 * remaining ) );
+
+    // write into a buffer the client is not reading, the older one if both are free
+    int index = -1;
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        RDB_SHM_BUFFER_INFO_t* info = mIgOutRdbHandler.shmBufferGetInfo( i );
+        RDB_MSG_HDR_t*         hdr  = ( RDB_MSG_HDR_t* ) mIgOutRdbHandler.shmBufferGetPtr( i );
+
+        if ( !info || ( info->flags & RDB_SHM_BUFFER_FLAG_LOCK ) )
+            continue;
+
+        if ( index < 0 || hdr->frameNo < ( ( RDB_MSG_HDR_t* ) mIgOutRdbHandler.shmBufferGetPtr( index ) )->frameNo )
+            index = i;
+    }
+
+    if ( index < 0 )
+    {
+        fprintf( stderr, "renderImage: both buffers locked, image %u dropped\n", mImageId );
+        return;
+    }
+
+    mIgOutRdbHandler.shmBufferSetFlags( index, 0 );
+    mIgOutRdbHandler.mapMsgToShm( index, false );
+    mIgOutRdbHandler.shmBufferSetFlags( index, RDB_SHM_BUFFER_FLAG_TC );
+    mNoImages++;
+
+    if ( mVerbose )
+        fprintf( stderr, "renderImage: image %u of frame %u in buffer %d\n", mImageId, mLastFrame, index );
+}
@@ -0,0 +1,158 @@
+// PixelBench.cpp : throughput of the pixel decoders for the formats of the IG
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include <vector>
+#include "PixelDecoder.hh"
+
+/**
+* some global variables, considered "members" of this example
+*/
+int    mWidth   = 1920;               // image size
+int    mHeight  = 1080;
+double mMinTime = 0.5;                // time per measurement [s]
+
+/**
+* information about usage of the software
+* this method will exit the program
+*/
+void usage()
+{
+    printf("usage: pixelBench [-w:width] [-h:height] [-t:seconds]\n\n");
+    printf("       -w:width      image width\n");
+    printf("       -h:height     image height\n");
+    printf("       -t:seconds    time per format and output\n");
+    exit(1);
+}
+
+/**
+* validate the arguments given in the command line
+*/
+void ValidateArgs(int argc, char **argv)
+{
+    for( int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] == '-') || (argv[i][0] == '/'))
+        {
+            if ( strlen( argv[i] ) <= 3 )
+                usage();
+
+            switch (tolower(argv[i][1]))
+            {
+                case 'w':
+                    mWidth = atoi( &argv[i][3] );
+                    break;
+
+                case 'h':
+                    mHeight = atoi( &argv[i][3] );
+                    break;
+
+                case 't':
+                    mMinTime = atof( &argv[i][3] );
+                    break;
+
+                default:
+                    usage();
+                    break;
+            }
+        }
+    }
+}
+
+double getTime()
+{
+    struct timeval tme;
+    gettimeofday(&tme, 0);
+
+    return tme.tv_sec + 1.0e-6 * tme.tv_usec;
+}
+
+/**
+* random pixels; float formats get values in 0..1
+*/
+void fillImage( const Framework::PixelDecoder::Format & format, std::vector<unsigned char> & data )
+{
+    size_t n = ( size_t ) mWidth * mHeight * format.pixelSize / 8;
+
+    data.resize( n );
+
+    if ( strstr( format.name, "32F" ) )
+    {
+        float* f = ( float* ) &data[0];
+
+        for ( size_t i = 0; i < n / 4; i++ )
+            f[ i ] = rand() / ( float ) RAND_MAX;
+    }
+    else if ( strstr( format.name, "16F" ) )
+    {
+        unsigned short* h = ( unsigned short* ) &data[0];
+
+        // exponent 0..14: positive halves below 1
+        for ( size_t i = 0; i < n / 2; i++ )
+            h[ i ] = ( unsigned short ) ( ( ( rand() % 15 ) << 10 ) | ( rand() & 0x3FF ) );
+    }
+    else
+    {
+        for ( size_t i = 0; i < n; i++ )
+            data[ i ] = ( unsigned char ) rand();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ValidateArgs(argc, argv);
+
+    unsigned int noFormats;
+    const Framework::PixelDecoder::Format* formats = Framework::PixelDecoder::getFormats( noFormats );
+
+    size_t                     n = ( size_t ) mWidth * mHeight;
+    std::vector<unsigned char> data;
+    std::vector<unsigned char> bgr( 3 * n );
+    std::vector<float>         planes( 3 * n );
+
+    printf( "%dx%d pixels, GB/s of input (output)\n\n", mWidth, mHeight );
+    printf( "%-14s %8s %18s %18s\n", "format", "MB", "-> BGR8", "-> float planes" );
+
+    for ( unsigned int i = 0; i < noFormats; i++ )
+    {
+        const Framework::PixelDecoder::Format & format = formats[ i ];
+
+        // deprecated ids share the decoders
+        if ( i && !strcmp( formats[ i - 1 ].name, format.name ) )
+            continue;
+
+        fillImage( format, data );
+
+        double rate[2];
+
+        for ( int out = 0; out < 2; out++ )
+        {
+            int    noRuns = 0;
+            double start  = getTime();
+            double dt;
+
+            do
+            {
+                if ( out == 0 )
+                    format.toBGR( &data[0], n, &bgr[0] );
+                else
+                    format.toPlanes( &data[0], n, &planes[0], &planes[n], &planes[2 * n] );
+
+                noRuns++;
+                dt = getTime() - start;
+            }
+            while ( dt < mMinTime );
+
+            rate[ out ] = noRuns * ( double ) data.size() / dt * 1.e-9;
+        }
+
+        printf( "%-14s %8.2f %8.2f (%6.2f) %8.2f (%6.2f)\n", format.name, data.size() * 1.e-6,
+                rate[0], rate[0] * 3.0 * n / data.size(), rate[1], rate[1] * 12.0 * n / data.size() );
+    }
+
+    return 0;
+}
@@ -0,0 +1,531 @@
+/* ===================================================
+ *  file:       PixelDecoder.cc
+ * ---------------------------------------------------
+ *  purpose:	decode the pixel formats of RDB images
+ *              into 8 bit BGR or float planes
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "PixelDecoder.hh"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <immintrin.h>
+#define PIXEL_DECODER_X86
+#endif
+
+namespace Framework
+{
+
+/**
+* pixels converted at a time by the float paths (fits the L1 cache)
+*/
+static const size_t CHUNK = 512;
+
+/**
+* expand 2 / 3 / 5 / 6 bit values to 8 bit by repeating their bits
+* (the tables are padded for the 8 byte loads of the shuffle path)
+*/
+static const unsigned char sExpand2[16] = { 0, 85, 170, 255 };
+static const unsigned char sExpand3[16] = { 0, 36, 73, 109, 146, 182, 219, 255 };
+
+static inline unsigned char expand5( unsigned int v ) { return ( unsigned char ) ( ( v << 3 ) | ( v >> 2 ) ); }
+static inline unsigned char expand6( unsigned int v ) { return ( unsigned char ) ( ( v << 2 ) | ( v >> 4 ) ); }
+
+/**
+* float (0..1) to byte, NaN goes to 0
+*/
+static inline unsigned char
+toByte( float v )
+{
+    v = ( v > 0.0f ) ? v : 0.0f;
+    v = ( v < 1.0f ) ? v : 1.0f;
+
+    return ( unsigned char ) ( v * 255.0f + 0.5f );
+}
+
+/**
+* IEEE half to float, including subnormals, infinity and NaN (quieted like F16C does)
+*/
+static inline float
+halfToFloat( uint16_t h )
+{
+    uint32_t s = ( uint32_t ) ( h & 0x8000 ) << 16;
+    uint32_t e = ( h >> 10 ) & 0x1F;
+    uint32_t m = h & 0x3FF;
+    uint32_t f;
+    float    v;
+
+    if ( e == 0 )
+    {
+        v = m * ( 1.0f / 16777216.0f );     // m * 2^-24
+        return s ? -v : v;
+    }
+
+    if ( e == 31 )
+        f = s | 0x7F800000 | ( m << 13 ) | ( m ? 0x00400000 : 0 );
+    else
+        f = s | ( ( e + 112 ) << 23 ) | ( m << 13 );
+
+    memcpy( &v, &f, sizeof( v ) );
+    return v;
+}
+
+static void
+halvesToFloatsScalar( const uint16_t* src, size_t n, float* dst )
+{
+    for ( size_t i = 0; i < n; i++ )
+        dst[ i ] = halfToFloat( src[ i ] );
+}
+
+#ifdef PIXEL_DECODER_X86
+__attribute__(( target( "avx,f16c" ) ))
+static void
+halvesToFloatsF16C( const uint16_t* src, size_t n, float* dst )
+{
+    size_t i = 0;
+
+    for ( ; i + 8 <= n; i += 8 )
+        _mm256_storeu_ps( dst + i, _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) ( src + i ) ) ) );
+
+    halvesToFloatsScalar( src + i, n - i, dst + i );
+}
+
+/**
+* interleave 16 blue, green and red bytes into 48 bytes of BGR
+*/
+__attribute__(( target( "ssse3" ) ))
+static inline void
+storeBGR16( __m128i b, __m128i g, __m128i r, unsigned char* dst )
+{
+    const __m128i b0 = _mm_setr_epi8(  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5 );
+    const __m128i g0 = _mm_setr_epi8( -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1 );
+    const __m128i r0 = _mm_setr_epi8( -1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1 );
+    const __m128i b1 = _mm_setr_epi8( -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1 );
+    const __m128i g1 = _mm_setr_epi8(  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10 );
+    const __m128i r1 = _mm_setr_epi8( -1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1 );
+    const __m128i b2 = _mm_setr_epi8( -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 );
+    const __m128i g2 = _mm_setr_epi8( -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 );
+    const __m128i r2 = _mm_setr_epi8( 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 );
+
+    _mm_storeu_si128( ( __m128i* ) dst,
+                      _mm_or_si128( _mm_or_si128( _mm_shuffle_epi8( b, b0 ), _mm_shuffle_epi8( g, g0 ) ), _mm_shuffle_epi8( r, r0 ) ) );
+    _mm_storeu_si128( ( __m128i* ) ( dst + 16 ),
+                      _mm_or_si128( _mm_or_si128( _mm_shuffle_epi8( b, b1 ), _mm_shuffle_epi8( g, g1 ) ), _mm_shuffle_epi8( r, r1 ) ) );
+    _mm_storeu_si128( ( __m128i* ) ( dst + 32 ),
+                      _mm_or_si128( _mm_or_si128( _mm_shuffle_epi8( b, b2 ), _mm_shuffle_epi8( g, g2 ) ), _mm_shuffle_epi8( r, r2 ) ) );
+}
+
+/**
+* 8 pixels of 5-6-5 to 8 bit channels in 16 bit lanes
+*/
+__attribute__(( target( "ssse3" ) ))
+static inline void
+expand565( __m128i p, __m128i & b, __m128i & g, __m128i & r )
+{
+    __m128i b5 = _mm_and_si128( p, _mm_set1_epi16( 0x1F ) );
+    __m128i g6 = _mm_and_si128( _mm_srli_epi16( p, 5 ), _mm_set1_epi16( 0x3F ) );
+    __m128i r5 = _mm_srli_epi16( p, 11 );
+
+    b = _mm_or_si128( _mm_slli_epi16( b5, 3 ), _mm_srli_epi16( b5, 2 ) );
+    g = _mm_or_si128( _mm_slli_epi16( g6, 2 ), _mm_srli_epi16( g6, 4 ) );
+    r = _mm_or_si128( _mm_slli_epi16( r5, 3 ), _mm_srli_epi16( r5, 2 ) );
+}
+
+__attribute__(( target( "ssse3" ) ))
+static size_t
+rgb565ToBGRSSSE3( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    size_t i = 0;
+
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        __m128i ba, ga, ra, bb, gb, rb;
+
+        expand565( _mm_loadu_si128( ( const __m128i* ) ( src + 2 * i ) ), ba, ga, ra );
+        expand565( _mm_loadu_si128( ( const __m128i* ) ( src + 2 * i + 16 ) ), bb, gb, rb );
+
+        storeBGR16( _mm_packus_epi16( ba, bb ), _mm_packus_epi16( ga, gb ), _mm_packus_epi16( ra, rb ), bgr + 3 * i );
+    }
+
+    return i;
+}
+
+__attribute__(( target( "ssse3" ) ))
+static size_t
+rgb332ToBGRSSSE3( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    // the channel bits are table indices for the byte shuffle
+    const __m128i lut2 = _mm_loadl_epi64( ( const __m128i* ) sExpand2 );
+    const __m128i lut3 = _mm_loadl_epi64( ( const __m128i* ) sExpand3 );
+    const __m128i m2   = _mm_set1_epi8( 0x03 );
+    const __m128i m3   = _mm_set1_epi8( 0x07 );
+    size_t i = 0;
+
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        __m128i p = _mm_loadu_si128( ( const __m128i* ) ( src + i ) );
+        __m128i r = _mm_shuffle_epi8( lut3, _mm_and_si128( _mm_srli_epi16( p, 5 ), m3 ) );
+        __m128i g = _mm_shuffle_epi8( lut3, _mm_and_si128( _mm_srli_epi16( p, 2 ), m3 ) );
+        __m128i b = _mm_shuffle_epi8( lut2, _mm_and_si128( p, m2 ) );
+
+        storeBGR16( b, g, r, bgr + 3 * i );
+    }
+
+    return i;
+}
+#endif
+
+/**
+* n halves to floats, with F16C if available
+*/
+static void
+halvesToFloats( const uint16_t* src, size_t n, float* dst )
+{
+#ifdef PIXEL_DECODER_X86
+    static int f16c = -1;
+
+    if ( f16c < 0 )
+        f16c = __builtin_cpu_supports( "avx" ) && __builtin_cpu_supports( "f16c" );
+
+    if ( f16c )
+    {
+        halvesToFloatsF16C( src, n, dst );
+        return;
+    }
+#endif
+    halvesToFloatsScalar( src, n, dst );
+}
+
+static bool
+haveSSSE3()
+{
+#ifdef PIXEL_DECODER_X86
+    static int ssse3 = -1;
+
+    if ( ssse3 < 0 )
+        ssse3 = __builtin_cpu_supports( "ssse3" );
+
+    return ssse3;
+#else
+    return false;
+#endif
+}
+
+/* ------ 3-3-2 ------ */
+
+template <size_t STRIDE>
+static void
+rgb332ToBGR( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    size_t i = 0;
+
+#ifdef PIXEL_DECODER_X86
+    if ( ( STRIDE == 1 ) && haveSSSE3() )
+        i = rgb332ToBGRSSSE3( src, n, bgr );
+#endif
+
+    for ( ; i < n; i++ )
+    {
+        unsigned int p = src[ STRIDE * i ];
+
+        bgr[ 3 * i ]     = sExpand2[ p & 3 ];
+        bgr[ 3 * i + 1 ] = sExpand3[ ( p >> 2 ) & 7 ];
+        bgr[ 3 * i + 2 ] = sExpand3[ p >> 5 ];
+    }
+}
+
+template <size_t STRIDE>
+static void
+rgb332ToPlanes( const unsigned char* __restrict src, size_t n, float* __restrict b, float* __restrict g, float* __restrict r )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        unsigned int p = src[ STRIDE * i ];
+
+        b[ i ] = ( p & 3 ) * ( 1.0f / 3.0f );
+        g[ i ] = ( ( p >> 2 ) & 7 ) * ( 1.0f / 7.0f );
+        r[ i ] = ( p >> 5 ) * ( 1.0f / 7.0f );
+    }
+}
+
+/* ------ 5-6-5 ------ */
+
+template <size_t STRIDE>
+static void
+rgb565ToBGR( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    size_t i = 0;
+
+#ifdef PIXEL_DECODER_X86
+    if ( ( STRIDE == 2 ) && haveSSSE3() )
+        i = rgb565ToBGRSSSE3( src, n, bgr );
+#endif
+
+    for ( ; i < n; i++ )
+    {
+        unsigned int p = src[ STRIDE * i ] | ( src[ STRIDE * i + 1 ] << 8 );
+
+        bgr[ 3 * i ]     = expand5( p & 0x1F );
+        bgr[ 3 * i + 1 ] = expand6( ( p >> 5 ) & 0x3F );
+        bgr[ 3 * i + 2 ] = expand5( p >> 11 );
+    }
+}
+
+template <size_t STRIDE>
+static void
+rgb565ToPlanes( const unsigned char* __restrict src, size_t n, float* __restrict b, float* __restrict g, float* __restrict r )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        unsigned int p = src[ STRIDE * i ] | ( src[ STRIDE * i + 1 ] << 8 );
+
+        b[ i ] = ( p & 0x1F ) * ( 1.0f / 31.0f );
+        g[ i ] = ( ( p >> 5 ) & 0x3F ) * ( 1.0f / 63.0f );
+        r[ i ] = ( p >> 11 ) * ( 1.0f / 31.0f );
+    }
+}
+
+/* ------ 8 bit per channel ------ */
+
+template <size_t STRIDE>
+static void
+rgb8ToPlanes( const unsigned char* __restrict src, size_t n, float* __restrict b, float* __restrict g, float* __restrict r )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        b[ i ] = src[ STRIDE * i + 2 ] * ( 1.0f / 255.0f );
+        g[ i ] = src[ STRIDE * i + 1 ] * ( 1.0f / 255.0f );
+        r[ i ] = src[ STRIDE * i ]     * ( 1.0f / 255.0f );
+    }
+}
+
+/* ------ floats with C channels, interleaved ------ */
+
+#ifdef __SSE2__
+/**
+* 4 floats to 32 bit lanes of 0..255; maxps returns its second operand for NaN
+*/
+static inline __m128i
+quantize4( const float* f )
+{
+    __m128 v = _mm_max_ps( _mm_loadu_ps( f ), _mm_setzero_ps() );
+
+    v = _mm_min_ps( v, _mm_set1_ps( 1.0f ) );
+
+    return _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( v, _mm_set1_ps( 255.0f ) ), _mm_set1_ps( 0.5f ) ) );
+}
+#endif
+
+/**
+* floats (0..1) to bytes, NaN goes to 0
+*/
+static void
+quantize( const float* f, size_t n, unsigned char* q )
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        __m128i lo = _mm_packs_epi32( quantize4( f + i ),     quantize4( f + i + 4 ) );
+        __m128i hi = _mm_packs_epi32( quantize4( f + i + 8 ), quantize4( f + i + 12 ) );
+
+        _mm_storeu_si128( ( __m128i* ) ( q + i ), _mm_packus_epi16( lo, hi ) );
+    }
+#endif
+
+    for ( ; i < n; i++ )
+        q[ i ] = toByte( f[ i ] );
+}
+
+/**
+* bytes with C channels (R, RG.., RGB, RGBA) to BGR
+*/
+template <size_t C>
+static void
+bytesToBGR( const unsigned char* __restrict src, size_t n, unsigned char* __restrict bgr )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        bgr[ 3 * i ]     = src[ C * i + ( C > 2 ? 2 : 0 ) ];
+        bgr[ 3 * i + 1 ] = src[ C * i + ( C > 1 ? 1 : 0 ) ];
+        bgr[ 3 * i + 2 ] = src[ C * i ];
+    }
+}
+
+template <size_t C>
+static void
+floatsToBGR( const float* f, size_t n, unsigned char* bgr )
+{
+    unsigned char tmp[ CHUNK * C ];
+
+    for ( size_t i = 0; i < n; i += CHUNK )
+    {
+        size_t m = ( n - i < CHUNK ) ? n - i : CHUNK;
+
+        quantize( f + C * i, C * m, tmp );
+        bytesToBGR<C>( tmp, m, bgr + 3 * i );
+    }
+}
+
+template <size_t C>
+static void
+floatsToPlanes( const float* __restrict f, size_t n, float* __restrict b, float* __restrict g, float* __restrict r )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        b[ i ] = f[ C * i + ( C > 2 ? 2 : 0 ) ];
+        g[ i ] = f[ C * i + ( C > 1 ? 1 : 0 ) ];
+        r[ i ] = f[ C * i ];
+    }
+}
+
+template <size_t C>
+static void
+float32ToBGR( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    floatsToBGR<C>( ( const float* ) src, n, bgr );
+}
+
+template <size_t C>
+static void
+float32ToPlanes( const unsigned char* src, size_t n, float* b, float* g, float* r )
+{
+    floatsToPlanes<C>( ( const float* ) src, n, b, g, r );
+}
+
+/* ------ halves with C channels, converted to floats chunk by chunk ------ */
+
+template <size_t C>
+static void
+float16ToBGR( const unsigned char* src, size_t n, unsigned char* bgr )
+{
+    float tmp[ CHUNK * C ];
+
+    for ( size_t i = 0; i < n; i += CHUNK )
+    {
+        size_t m = ( n - i < CHUNK ) ? n - i : CHUNK;
+
+        halvesToFloats( ( const uint16_t* ) src + C * i, C * m, tmp );
+        floatsToBGR<C>( tmp, m, bgr + 3 * i );
+    }
+}
+
+template <size_t C>
+static void
+float16ToPlanes( const unsigned char* src, size_t n, float* b, float* g, float* r )
+{
+    float tmp[ CHUNK * C ];
+
+    for ( size_t i = 0; i < n; i += CHUNK )
+    {
+        size_t m = ( n - i < CHUNK ) ? n - i : CHUNK;
+
+        halvesToFloats( ( const uint16_t* ) src + C * i, C * m, tmp );
+        floatsToPlanes<C>( tmp, m, b + i, g + i, r + i );
+    }
+}
+
+/**
+* the dispatch table
+*/
+static const PixelDecoder::Format sFormats[] =
+{
+    { RDB_PIX_FORMAT_R3_G2_B2,       8, "R3_G2_B2",     rgb332ToBGR<1>,     rgb332ToPlanes<1>   },
+    { RDB_PIX_FORMAT_RGB,            8, "R3_G2_B2",     rgb332ToBGR<1>,     rgb332ToPlanes<1>   },
+    { RDB_PIX_FORMAT_R3_G2_B2_A8,   16, "R3_G2_B2_A8",  rgb332ToBGR<2>,     rgb332ToPlanes<2>   },
+    { RDB_PIX_FORMAT_RGBA,          16, "R3_G2_B2_A8",  rgb332ToBGR<2>,     rgb332ToPlanes<2>   },
+    { RDB_PIX_FORMAT_R5_G6_B5,      16, "R5_G6_B5",     rgb565ToBGR<2>,     rgb565ToPlanes<2>   },
+    { RDB_PIX_FORMAT_RGB_16,        16, "R5_G6_B5",     rgb565ToBGR<2>,     rgb565ToPlanes<2>   },
+    { RDB_PIX_FORMAT_R5_G6_B5_A16,  32, "R5_G6_B5_A16", rgb565ToBGR<4>,     rgb565ToPlanes<4>   },
+    { RDB_PIX_FORMAT_RGBA_16,       32, "R5_G6_B5_A16", rgb565ToBGR<4>,     rgb565ToPlanes<4>   },
+    { RDB_PIX_FORMAT_RGB8,          24, "RGB8",         bytesToBGR<3>,      rgb8ToPlanes<3>     },
+    { RDB_PIX_FORMAT_RGB_24,        24, "RGB8",         bytesToBGR<3>,      rgb8ToPlanes<3>     },
+    { RDB_PIX_FORMAT_RGBA8,         32, "RGBA8",        bytesToBGR<4>,      rgb8ToPlanes<4>     },
+    { RDB_PIX_FORMAT_RGB8_A24,      48, "RGB8_A24",     bytesToBGR<6>,      rgb8ToPlanes<6>     },
+    { RDB_PIX_FORMAT_RGBA_24,       48, "RGB8_A24",     bytesToBGR<6>,      rgb8ToPlanes<6>     },
+    { RDB_PIX_FORMAT_RED16F,        16, "RED16F",       float16ToBGR<1>,    float16ToPlanes<1>  },
+    { RDB_PIX_FORMAT_LUM_16_F,      16, "RED16F",       float16ToBGR<1>,    float16ToPlanes<1>  },
+    { RDB_PIX_FORMAT_RGB16F,        48, "RGB16F",       float16ToBGR<3>,    float16ToPlanes<3>  },
+    { RDB_PIX_FORMAT_RGB_16_F,      48, "RGB16F",       float16ToBGR<3>,    float16ToPlanes<3>  },
+    { RDB_PIX_FORMAT_RGBA16F,       64, "RGBA16F",      float16ToBGR<4>,    float16ToPlanes<4>  },
+    { RDB_PIX_FORMAT_RGBA_16_F,     64, "RGBA16F",      float16ToBGR<4>,    float16ToPlanes<4>  },
+    { RDB_PIX_FORMAT_RGB32F,        96, "RGB32F",       float32ToBGR<3>,    float32ToPlanes<3>  },
+    { RDB_PIX_FORMAT_RGB_32_F,      96, "RGB32F",       float32ToBGR<3>,    float32ToPlanes<3>  },
+    { RDB_PIX_FORMAT_RGBA32F,      128, "RGBA32F",      float32ToBGR<4>,    float32ToPlanes<4>  },
+    { RDB_PIX_FORMAT_RGBA_32_F,    128, "RGBA32F",      float32ToBGR<4>,    float32ToPlanes<4>  }
+};
+
+const PixelDecoder::Format*
+PixelDecoder::find( unsigned char pixelFormat, unsigned char pixelSize )
+{
+    for ( size_t i = 0; i < sizeof( sFormats ) / sizeof( sFormats[0] ); i++ )
+        if ( ( sFormats[ i ].pixelFormat == pixelFormat ) && ( sFormats[ i ].pixelSize == pixelSize ) )
+            return &sFormats[ i ];
+
+    return 0;
+}
+
+const PixelDecoder::Format*
+PixelDecoder::getFormats( unsigned int & noFormats )
+{
+    noFormats = sizeof( sFormats ) / sizeof( sFormats[0] );
+
+    return sFormats;
+}
+
+const PixelDecoder::Format*
+PixelDecoder::check( const RDB_IMAGE_t & img, const char* caller )
+{
+    const Format* format = find( img.pixelFormat, img.pixelSize );
+
+    if ( !format )
+    {
+        fprintf( stderr, "PixelDecoder::%s: image %d: unsupported pixel format %d / size %d\n",
+                         caller, img.id, img.pixelFormat, img.pixelSize );
+        return 0;
+    }
+
+    if ( img.imgSize < ( size_t ) img.width * img.height * img.pixelSize / 8 )
+    {
+        fprintf( stderr, "PixelDecoder::%s: image %d: %d bytes are too few for %dx%d pixels\n",
+                         caller, img.id, img.imgSize, img.width, img.height );
+        return 0;
+    }
+
+    return format;
+}
+
+bool
+PixelDecoder::toBGR( const RDB_IMAGE_t & img, const void* data, unsigned char* bgr )
+{
+    const Format* format = check( img, "toBGR" );
+
+    if ( !format )
+        return false;
+
+    format->toBGR( ( const unsigned char* ) data, ( size_t ) img.width * img.height, bgr );
+
+    return true;
+}
+
+bool
+PixelDecoder::toPlanes( const RDB_IMAGE_t & img, const void* data, float* planes )
+{
+    const Format* format = check( img, "toPlanes" );
+
+    if ( !format )
+        return false;
+
+    size_t n = ( size_t ) img.width * img.height;
+
+    format->toPlanes( ( const unsigned char* ) data, n, planes, planes + n, planes + 2 * n );
+
+    return true;
+}
+
+} // namespace Framework
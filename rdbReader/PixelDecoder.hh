@@ -0,0 +1,91 @@
+/* ===================================================
+ *  file:       PixelDecoder.hh
+ * ---------------------------------------------------
+ *  purpose:	decode the pixel formats of RDB images
+ *              into 8 bit BGR or float planes
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_PIXEL_DECODER_HH
+#define _FRAMEWORK_PIXEL_DECODER_HH
+
+/* ====== INCLUSIONS ====== */
+#include <stddef.h>
+#include "viRDBIcd.h"
+
+namespace Framework
+{
+/**
+* Decoders for the color formats of the IG, looked up by pixel format and
+* pixel size of RDB_IMAGE_t (deprecated format ids map to the same decoders):
+*
+*   R3_G2_B2, R3_G2_B2_A8        3-3-2 bits per pixel (red in the high bits)
+*   R5_G6_B5, R5_G6_B5_A16       5-6-5 bits per pixel (red in the high bits)
+*   RGB8, RGBA8, RGB8_A24        8 bits per channel
+*   RED16F, RGB16F, RGBA16F      half floats
+*   RGB32F, RGBA32F              floats
+*
+* BGR output is 3 interleaved bytes per pixel. Float output is three planes
+* (blue, green, red) of width * height values; integer formats are scaled to
+* 0..1, float formats are passed on as they are. A single channel (RED16F)
+* goes to all three. Alpha is dropped.
+*
+* Half floats are converted with F16C and the packed formats are expanded and
+* interleaved with byte shuffles (SSSE3) if the CPU supports them.
+*/
+class PixelDecoder
+{
+    public:
+        /**
+        * decode n pixels into interleaved BGR bytes
+        */
+        typedef void ( *ToBGRFunc )( const unsigned char* src, size_t n, unsigned char* bgr );
+
+        /**
+        * decode n pixels into float planes
+        */
+        typedef void ( *ToPlanesFunc )( const unsigned char* src, size_t n, float* b, float* g, float* r );
+
+        /**
+        * one entry of the dispatch table
+        */
+        struct Format
+        {
+            unsigned char pixelFormat;   // RDB_PIX_FORMAT_*
+            unsigned char pixelSize;     // [bit]
+            const char*   name;
+            ToBGRFunc     toBGR;
+            ToPlanesFunc  toPlanes;
+        };
+
+        /**
+        * look up the decoder of an image format
+        * @return 0 if the format is not supported
+        */
+        static const Format* find( unsigned char pixelFormat, unsigned char pixelSize );
+
+        /**
+        * get the dispatch table
+        * @param noFormats  receives the number of entries
+        */
+        static const Format* getFormats( unsigned int & noFormats );
+
+        /**
+        * decode an image into width * height * 3 bytes (B, G, R)
+        * @return false if the format is not supported or the image is too small
+        */
+        static bool toBGR( const RDB_IMAGE_t & img, const void* data, unsigned char* bgr );
+
+        /**
+        * decode an image into three planes of width * height floats (B, G, R)
+        * @return false if the format is not supported or the image is too small
+        */
+        static bool toPlanes( const RDB_IMAGE_t & img, const void* data, float* planes );
+
+    private:
+        /**
+        * check an image before decoding it; 0 if it cannot be decoded
+        */
+        static const Format* check( const RDB_IMAGE_t & img, const char* caller );
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_PIXEL_DECODER_HH */
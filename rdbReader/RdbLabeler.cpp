@@ -0,0 +1,216 @@
+// RdbLabeler.cpp : reads the RDB stream of the simulation and writes
+// a VOC annotation of the visible traffic signs for every rendered image
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include "SignLabeler.hh"
+
+#define DEFAULT_PORT        48190
+#define DEFAULT_BUFFER      204800
+
+/**
+* some global variables, considered "members" of this example
+*/
+char                   szServer[128];                 // server to connect to for RDB data
+int                    iPort       = DEFAULT_PORT;    // port on server to connect to
+int                    mClient     = -1;              // client socket
+char*                  mOutDir     = 0;               // output directory (VOC layout)
+char*                  mClassFile  = 0;               // sign class table
+bool                   mBottomLeft = false;           // image rows count from the bottom
+Framework::SignLabeler mLabeler;
+
+/**
+* information about usage of the software
+* this method will exit the program
+*/
+void usage()
+{
+    printf("usage: rdbLabeler [-p:x] [-s:IP] [-o:dir] [-c:classes] [-b] [-h]\n\n");
+    printf("       -p:x          Remote port to read from\n");
+    printf("       -s:IP         Server's IP address or hostname\n");
+    printf("       -o:dir        output directory with Annotations/ and ImageSets/Main/\n");
+    printf("       -c:classes    sign class table (type subType name [width height [zOffset]])\n");
+    printf("       -b            image origin is at the bottom left\n");
+    exit(1);
+}
+
+/**
+* validate the arguments given in the command line
+*/
+void ValidateArgs(int argc, char **argv)
+{
+    // initalize the server variable
+    strcpy( szServer, "127.0.0.1" );
+
+    for( int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] == '-') || (argv[i][0] == '/'))
+        {
+            switch (tolower(argv[i][1]))
+            {
+                case 'p':        // Remote port
+                    if (strlen(argv[i]) > 3)
+                        iPort = atoi(&argv[i][3]);
+                    break;
+
+                case 's':       // Server
+                    if (strlen(argv[i]) > 3)
+                        strcpy(szServer, &argv[i][3]);
+                    break;
+
+                case 'o':       // output directory
+                    if (strlen(argv[i]) > 3)
+                        mOutDir = &argv[i][3];
+                    break;
+
+                case 'c':       // class table
+                    if (strlen(argv[i]) > 3)
+                        mClassFile = &argv[i][3];
+                    break;
+
+                case 'b':       // bottom left origin
+                    mBottomLeft = true;
+                    break;
+
+                case 'h':
+                default:
+                    usage();
+                    break;
+            }
+        }
+    }
+}
+
+/**
+* open the network interface for reading RDB data (blocking until connected)
+*/
+void openNetwork()
+{
+    struct sockaddr_in server;
+    struct hostent    *host = NULL;
+
+    // Create the socket, and attempt to connect to the server
+    mClient = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+    if ( mClient == -1 )
+    {
+        fprintf( stderr, "socket() failed: %s\n", strerror( errno ) );
+        return;
+    }
+
+    int opt = 1;
+    setsockopt ( mClient, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof( opt ) );
+
+    server.sin_family      = AF_INET;
+    server.sin_port        = htons(iPort);
+    server.sin_addr.s_addr = inet_addr(szServer);
+
+    // If the supplied server address wasn't in the form
+    // "aaa.bbb.ccc.ddd" it's a hostname, so try to resolve it
+    if ( server.sin_addr.s_addr == INADDR_NONE )
+    {
+        host = gethostbyname(szServer);
+        if ( host == NULL )
+        {
+            fprintf( stderr, "Unable to resolve server: %s\n", szServer );
+            return;
+        }
+        memcpy( &server.sin_addr, host->h_addr_list[0], host->h_length );
+    }
+
+    while ( connect( mClient, (struct sockaddr *)&server, sizeof( server ) ) == -1 )
+    {
+        fprintf( stderr, "connect() failed: %s\n", strerror( errno ) );
+        sleep( 1 );
+    }
+
+    fprintf( stderr, "connected!\n" );
+}
+
+int main(int argc, char* argv[])
+{
+    ValidateArgs(argc, argv);
+
+    if ( mClassFile && ( mLabeler.loadClasses( mClassFile ) < 0 ) )
+        exit( 1 );
+
+    mLabeler.setOriginBottomLeft( mBottomLeft );
+    mLabeler.setOutput( mOutDir );
+
+    openNetwork();
+
+    if ( mClient < 0 )
+        exit( 1 );
+
+    char*          szBuffer       = new char[DEFAULT_BUFFER];
+    unsigned int   bytesInBuffer  = 0;
+    size_t         bufferSize     = sizeof( RDB_MSG_HDR_t );
+    unsigned char* pData          = ( unsigned char* ) calloc( 1, bufferSize );
+    unsigned int   lastNoImages   = 0;
+
+    // blocking read; all packages of a frame are handled at its end
+    while ( 1 )
+    {
+        int ret = recv( mClient, szBuffer, DEFAULT_BUFFER, 0 );
+
+        if ( ret <= 0 )
+        {
+            fprintf( stderr, "recv() failed or connection closed: %s\n", ret ? strerror( errno ) : "eof" );
+            break;
+        }
+
+        // do we have to grow the buffer??
+        if ( ( bytesInBuffer + ret ) > bufferSize )
+        {
+            pData      = ( unsigned char* ) realloc( pData, bytesInBuffer + ret );
+            bufferSize = bytesInBuffer + ret;
+        }
+
+        memcpy( pData + bytesInBuffer, szBuffer, ret );
+        bytesInBuffer += ret;
+
+        // handle all complete messages in the buffer
+        while ( bytesInBuffer >= sizeof( RDB_MSG_HDR_t ) )
+        {
+            RDB_MSG_HDR_t* hdr = ( RDB_MSG_HDR_t* ) pData;
+
+            if ( hdr->magicNo != RDB_MAGIC_NO )
+            {
+                fprintf( stderr, "message receiving is out of sync; discarding data\n" );
+                bytesInBuffer = 0;
+                break;
+            }
+
+            unsigned int msgSize = hdr->headerSize + hdr->dataSize;
+
+            if ( bytesInBuffer < msgSize )
+                break;
+
+            mLabeler.parseMessage( ( RDB_MSG_t* ) pData );
+
+            memmove( pData, pData + msgSize, bytesInBuffer - msgSize );
+            bytesInBuffer -= msgSize;
+        }
+
+        if ( mLabeler.getNoImages() / 100 != lastNoImages / 100 )
+            fprintf( stderr, "rdbLabeler: %d images, %d labels\n", mLabeler.getNoImages(), mLabeler.getNoLabels() );
+
+        lastNoImages = mLabeler.getNoImages();
+    }
+
+    close( mClient );
+    free( pData );
+    delete[] szBuffer;
+
+    return 0;
+}
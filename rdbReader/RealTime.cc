@@ -0,0 +1,251 @@
+/* ===================================================
+ *  file:       RealTime.cc
+ * ---------------------------------------------------
+ *  purpose:	real-time execution profile of a loop
+ *              thread and a watchdog for its deadlines
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "RealTime.hh"
+
+namespace Framework
+{
+
+/**
+* touch size bytes of stack below the caller; not inlined, so the frame is
+* really allocated
+*/
+static void __attribute__((noinline))
+prefaultStack( size_t size )
+{
+    volatile unsigned char* stack = ( volatile unsigned char* ) alloca( size );
+    long step = sysconf( _SC_PAGESIZE );
+
+    for ( size_t i = 0; i < size; i += step )
+        stack[ i ] = 0;
+}
+
+RealTime::Options
+RealTime::defaults()
+{
+    Options options;
+
+    options.cpu        = -1;
+    options.priority   = 0;
+    options.lockMemory = false;
+    options.stackSize  = 512 * 1024;
+    options.heapSize   = 64 * 1024 * 1024;
+
+    return options;
+}
+
+bool
+RealTime::apply( const Options & options )
+{
+    bool ok = true;
+    int  err;
+
+    if ( options.cpu >= 0 )
+    {
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        CPU_SET( options.cpu, &set );
+
+        if ( ( err = pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) ) != 0 )
+        {
+            fprintf( stderr, "RealTime::apply: cannot pin to CPU %d (%s)\n", options.cpu, strerror( err ) );
+            ok = false;
+        }
+    }
+
+    if ( options.lockMemory )
+    {
+        // freed memory stays with the process and nothing is mmap()ed
+        // behind our back, so the heap faulted in now is reused later
+        mallopt( M_TRIM_THRESHOLD, -1 );
+        mallopt( M_MMAP_MAX, 0 );
+
+        if ( mlockall( MCL_CURRENT | MCL_FUTURE ) != 0 )
+        {
+            fprintf( stderr, "RealTime::apply: mlockall() failed (%s), raise ulimit -l\n", strerror( errno ) );
+            ok = false;
+        }
+
+        prefaultStack( options.stackSize );
+
+        if ( options.heapSize )
+        {
+            long           step = sysconf( _SC_PAGESIZE );
+            unsigned char* heap = ( unsigned char* ) malloc( options.heapSize );
+
+            if ( heap )
+            {
+                for ( size_t i = 0; i < options.heapSize; i += step )
+                    heap[ i ] = 0;
+
+                free( heap );
+            }
+        }
+    }
+
+    if ( options.priority > 0 )
+    {
+        struct sched_param param;
+        memset( &param, 0, sizeof( param ) );
+        param.sched_priority = options.priority;
+
+        if ( ( err = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) ) != 0 )
+        {
+            fprintf( stderr, "RealTime::apply: cannot run SCHED_FIFO %d (%s)\n", options.priority, strerror( err ) );
+            ok = false;
+        }
+    }
+
+    fprintf( stderr, "RealTime::apply: cpu = %d, SCHED_FIFO priority = %d, memory %s%s\n",
+                     options.cpu, options.priority, options.lockMemory ? "locked" : "not locked",
+                     ok ? "" : " (not all applied)" );
+
+    return ok;
+}
+
+double
+RealTime::now()
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+
+    return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+LoopWatchdog::LoopWatchdog( double deadline ) : mDeadline( deadline )
+{
+    reset();
+}
+
+void
+LoopWatchdog::setDeadline( double deadline )
+{
+    mDeadline = deadline;
+}
+
+void
+LoopWatchdog::reset()
+{
+    mLast     = -1.0;
+    mNoSteps  = 0;
+    mNoMisses = 0;
+
+    // also faults the histograms in
+    memset( &mInterval, 0, sizeof( mInterval ) );
+    memset( &mWakeup, 0, sizeof( mWakeup ) );
+}
+
+bool
+LoopWatchdog::step( double now )
+{
+    bool missed = false;
+
+    if ( mLast >= 0.0 )
+    {
+        double interval = now - mLast;
+
+        add( mInterval, interval );
+        mNoSteps++;
+
+        if ( interval > mDeadline )
+        {
+            mNoMisses++;
+            missed = true;
+        }
+    }
+
+    mLast = now;
+
+    return missed;
+}
+
+void
+LoopWatchdog::wakeup( double late )
+{
+    add( mWakeup, late > 0.0 ? late : 0.0 );
+}
+
+void
+LoopWatchdog::add( Histogram & h, double value )
+{
+    unsigned int bin = 0;
+
+    if ( value >= 1.e-6 )
+    {
+        double decades = log10( value * 1.e6 );
+
+        bin = ( decades < 7.0 ) ? 1 + ( unsigned int ) ( decades * BINS_PER_DECADE ) : NO_BINS - 1;
+    }
+
+    h.bins[ bin ]++;
+    h.count++;
+    h.sum += value;
+
+    if ( value > h.max )
+        h.max = value;
+}
+
+double
+LoopWatchdog::percentile( const Histogram & h, double q )
+{
+    if ( !h.count )
+        return 0.0;
+
+    unsigned int rank  = ( unsigned int ) ( q * ( h.count - 1 ) );
+    unsigned int total = 0;
+
+    for ( unsigned int i = 0; i < NO_BINS; i++ )
+    {
+        total += h.bins[ i ];
+
+        if ( total > rank )
+            return ( i < NO_BINS - 1 ) ? upperEdge( i ) : h.max;
+    }
+
+    return h.max;
+}
+
+double
+LoopWatchdog::upperEdge( unsigned int bin )
+{
+    return 1.e-6 * pow( 10.0, ( double ) bin / BINS_PER_DECADE );
+}
+
+void
+LoopWatchdog::print( const char* caller ) const
+{
+    fprintf( stderr, "%s: %u steps, %u over the %.3lf ms deadline (%.2lf%%)\n", caller,
+                     mNoSteps, mNoMisses, 1.e3 * mDeadline, mNoSteps ? 100.0 * mNoMisses / mNoSteps : 0.0 );
+
+    if ( mInterval.count )
+        fprintf( stderr, "%s: step interval mean = %.3lf ms, p50 = %.2lf ms, p99 = %.2lf ms, max = %.3lf ms\n", caller,
+                         1.e3 * mInterval.sum / mInterval.count, 1.e3 * percentile( mInterval, 0.5 ),
+                         1.e3 * percentile( mInterval, 0.99 ), 1.e3 * mInterval.max );
+
+    if ( mWakeup.count )
+        fprintf( stderr, "%s: wake-up latency mean = %.1lf us, p99 = %.0lf us, p99.9 = %.0lf us, max = %.1lf us (%u wake-ups)\n", caller,
+                         1.e6 * mWakeup.sum / mWakeup.count, 1.e6 * percentile( mWakeup, 0.99 ),
+                         1.e6 * percentile( mWakeup, 0.999 ), 1.e6 * mWakeup.max, mWakeup.count );
+}
+
+} // namespace Framework
@@ -0,0 +1,133 @@
+/* ===================================================
+ *  file:       RealTime.hh
+ * ---------------------------------------------------
+ *  purpose:	real-time execution profile of a loop
+ *              thread and a watchdog for its deadlines
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_REAL_TIME_HH
+#define _FRAMEWORK_REAL_TIME_HH
+
+/* ====== INCLUSIONS ====== */
+#include <stddef.h>
+
+namespace Framework
+{
+/**
+* Keeps the scheduler and the pager off the critical path of the calling
+* thread:
+*
+*   cpu         pin the thread to one CPU (best isolated with isolcpus= or a
+*               cpuset, so nothing else runs there)
+*   priority    run it SCHED_FIFO with this priority (1..99); needs root or
+*               CAP_SYS_NICE / an rtprio limit
+*   lockMemory  mlockall() current and future pages, stop malloc from giving
+*               memory back to the kernel and fault in stackSize bytes of
+*               stack and heapSize bytes of heap now, so that the loop never
+*               takes a page fault once it runs
+*
+* Each setting that fails is reported and skipped; the others still apply.
+*/
+class RealTime
+{
+    public:
+        struct Options
+        {
+            int    cpu;             // -1: no affinity
+            int    priority;        // 0: keep the normal scheduler
+            bool   lockMemory;
+            size_t stackSize;       // [byte] of stack to fault in
+            size_t heapSize;        // [byte] of heap to fault in
+        };
+
+        /**
+        * options that change nothing
+        */
+        static Options defaults();
+
+        /**
+        * apply the options to the calling thread
+        * @return true if everything asked for could be applied
+        */
+        static bool apply( const Options & options );
+
+        /**
+        * monotonic clock [s]
+        */
+        static double now();
+};
+
+/**
+* Measures a periodic loop against its deadline without allocating or
+* printing on the way: step() once per cycle (e.g. per simulation frame
+* triggered) and wakeup() with the time a sleep overshot. Intervals and
+* wake-up latencies go into 10us histograms up to 1s, from which print()
+* reports the percentiles and the worst case.
+*/
+class LoopWatchdog
+{
+    public:
+        /**
+        * constructor
+        * @param deadline   allowed time between two steps [s]
+        */
+        explicit LoopWatchdog( double deadline = 0.01 );
+
+        void setDeadline( double deadline );
+
+        /**
+        * forget everything measured so far; the next step() starts anew
+        */
+        void reset();
+
+        /**
+        * a cycle is complete
+        * @param now    RealTime::now()
+        * @return true if it missed the deadline
+        */
+        bool step( double now );
+
+        /**
+        * the loop slept and woke up late
+        * @param late   [s] beyond the time it asked for
+        */
+        void wakeup( double late );
+
+        unsigned int getNoSteps() const  { return mNoSteps; }
+        unsigned int getNoMisses() const { return mNoMisses; }
+
+        /**
+        * print step and wake-up statistics to stderr
+        */
+        void print( const char* caller ) const;
+
+    private:
+        // log-spaced bins, BINS_PER_DECADE from 1us on (about 7.5% wide);
+        // bin 0 takes everything below 1us, the last one everything above 10s
+        enum
+        {
+            BINS_PER_DECADE = 32,
+            NO_BINS         = 7 * BINS_PER_DECADE + 2
+        };
+
+        struct Histogram
+        {
+            unsigned int count;
+            double       sum;
+            double       max;
+            unsigned int bins[ NO_BINS ];
+        };
+
+        static void add( Histogram & h, double value );
+        static double upperEdge( unsigned int bin );
+        static double percentile( const Histogram & h, double q );
+
+        double       mDeadline;
+        double       mLast;         // time of the last step, < 0 before the first
+        unsigned int mNoSteps;
+        unsigned int mNoMisses;
+        Histogram    mInterval;
+        Histogram    mWakeup;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_REAL_TIME_HH */
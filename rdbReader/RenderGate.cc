@@ -0,0 +1,143 @@
+/* ===================================================
+ *  file:       RenderGate.cc
+ * ---------------------------------------------------
+ *  purpose:	decide from the ground truth of a frame
+ *              whether rendering its image is worth it
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <string.h>
+#include "RenderGate.hh"
+
+namespace Framework
+{
+
+RenderGate::RenderGate() : mEnabled( false ),
+                           mMaxDistance( 0.0f ),
+                           mBackgroundRate( 1.0f ),
+                           mBackgroundCredit( 0.0f ),
+                           mFrameNo( 0 ),
+                           mHaveFrame( false ),
+                           mHaveCamera( false )
+{
+    memset( &mCamera, 0, sizeof( mCamera ) );
+    memset( &mStatistics, 0, sizeof( mStatistics ) );
+}
+
+void
+RenderGate::enable( float maxDistance, float backgroundRate )
+{
+    mEnabled          = true;
+    mMaxDistance      = maxDistance;
+    mBackgroundRate   = ( backgroundRate < 0.0f ) ? 0.0f : ( ( backgroundRate > 1.0f ) ? 1.0f : backgroundRate );
+    mBackgroundCredit = 0.0f;
+}
+
+void
+RenderGate::setFrame( unsigned int frameNo )
+{
+    if ( mHaveFrame && ( frameNo == mFrameNo ) )
+        return;
+
+    mFrameNo    = frameNo;
+    mHaveFrame  = true;
+    mHaveCamera = false;
+    mSigns.clear();
+}
+
+void
+RenderGate::addCamera( unsigned int frameNo, const RDB_CAMERA_t* cam )
+{
+    if ( !cam )
+        return;
+
+    setFrame( frameNo );
+
+    memcpy( &mCamera, cam, sizeof( RDB_CAMERA_t ) );
+    mHaveCamera = true;
+}
+
+void
+RenderGate::addSigns( unsigned int frameNo, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns )
+{
+    if ( !signs || !noSigns )
+        return;
+
+    setFrame( frameNo );
+
+    mSigns.insert( mSigns.end(), signs, signs + noSigns );
+}
+
+RenderGate::Decision
+RenderGate::decide( unsigned int frameNo )
+{
+    mStatistics.frames++;
+
+    // nothing known about the frame, let the IG render it
+    if ( !mHaveFrame || ( frameNo != mFrameNo ) || !mHaveCamera )
+    {
+        mStatistics.unknown++;
+        return DECISION_UNKNOWN;
+    }
+
+    // cheap distance test first, only the rest is projected
+    mNear.clear();
+
+    for ( size_t i = 0; i < mSigns.size(); i++ )
+    {
+        if ( ( mMaxDistance <= 0.0f ) || ( mSigns[i].roadDist <= mMaxDistance ) )
+            mNear.push_back( mSigns[i] );
+    }
+
+    unsigned int noSigns = 0;
+
+    if ( !mNear.empty() )
+    {
+        mLabeler.project( mCamera, &mNear[0], mNear.size(), mLabels );
+
+        for ( size_t i = 0; i < mLabels.size(); i++ )
+        {
+            if ( ( mMaxDistance <= 0.0f ) || ( mLabels[i].depth <= mMaxDistance ) )
+                noSigns++;
+        }
+    }
+
+    if ( noSigns )
+    {
+        mStatistics.positives++;
+        mStatistics.signs += noSigns;
+        return DECISION_POSITIVE;
+    }
+
+    mBackgroundCredit += mBackgroundRate;
+
+    if ( mBackgroundCredit >= 1.0f )
+    {
+        mBackgroundCredit -= 1.0f;
+        mStatistics.background++;
+        return DECISION_BACKGROUND;
+    }
+
+    mStatistics.skipped++;
+    return DECISION_SKIP;
+}
+
+const RenderGate::Statistics &
+RenderGate::getStatistics() const
+{
+    return mStatistics;
+}
+
+void
+RenderGate::printStatistics( const char* caller ) const
+{
+    const Statistics & s = mStatistics;
+    unsigned int rendered = s.positives + s.background + s.unknown;
+
+    fprintf( stderr, "%s: render gate %s: %u frames, %u positive (%u signs), %u background, %u unknown, %u skipped; %.1lf%% of the renders are positive\n",
+                     caller, mEnabled ? "on" : "off", s.frames, s.positives, s.signs, s.background, s.unknown, s.skipped,
+                     rendered ? 100.0 * s.positives / rendered : 0.0 );
+}
+
+} // namespace Framework
@@ -0,0 +1,122 @@
+/* ===================================================
+ *  file:       RenderGate.hh
+ * ---------------------------------------------------
+ *  purpose:	decide from the ground truth of a frame
+ *              whether rendering its image is worth it
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_RENDER_GATE_HH
+#define _FRAMEWORK_RENDER_GATE_HH
+
+/* ====== INCLUSIONS ====== */
+#include <vector>
+#include "SignLabeler.hh"
+
+namespace Framework
+{
+/**
+* Trigger policy of the image generator for data generation.
+*
+* The network stream delivers camera and traffic signs of a frame before the
+* IG is asked to render it, so the labels the image would get are known in
+* advance. A frame is positive if at least one sign passes the distance limit
+* (roadDist and depth along the camera axis) and the frustum, size,
+* readability and occlusion filters of the SignLabeler. Positives are always
+* rendered; of the negatives, a fixed fraction is rendered as background
+* samples. The fraction is met exactly (error accumulation, no random
+* numbers), so runs are reproducible.
+*
+* Frames without a camera cannot be judged and are rendered.
+*/
+class RenderGate
+{
+    public:
+        enum Decision
+        {
+            DECISION_SKIP = 0,          // negative, no background sample due
+            DECISION_POSITIVE,          // at least one sign will be labelled
+            DECISION_BACKGROUND,        // negative, rendered as background sample
+            DECISION_UNKNOWN            // no camera for the frame, rendered
+        };
+
+        /**
+        * decision counters
+        */
+        struct Statistics
+        {
+            unsigned int frames;        // decide() calls
+            unsigned int positives;
+            unsigned int background;
+            unsigned int unknown;
+            unsigned int skipped;
+            unsigned int signs;         // signs that passed the gate in positive frames
+        };
+
+    public:
+        /**
+        * constructor; until enabled, every frame is rendered but still judged,
+        * so the statistics tell the share of renders that get labels
+        */
+        explicit RenderGate();
+
+        /**
+        * gate the frames
+        * @param maxDistance    signs farther away [m] are ignored, <= 0: no limit
+        * @param backgroundRate fraction of the negative frames that is rendered anyway (0..1)
+        */
+        void enable( float maxDistance, float backgroundRate );
+
+        bool isEnabled() const { return mEnabled; }
+
+        /**
+        * sign classes, default size and filters used to judge the signs
+        */
+        SignLabeler & getLabeler() { return mLabeler; }
+
+        /**
+        * ground truth of a frame from the network stream; parts of an older
+        * frame are discarded
+        */
+        void addCamera( unsigned int frameNo, const RDB_CAMERA_t* cam );
+        void addSigns( unsigned int frameNo, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns );
+
+        /**
+        * decide about a frame; its ground truth must be complete
+        * @param frameNo    simulation frame the IG would render
+        * @return DECISION_SKIP if the frame shall not be rendered
+        */
+        Decision decide( unsigned int frameNo );
+
+        const Statistics & getStatistics() const;
+
+        /**
+        * print the statistics to stderr
+        */
+        void printStatistics( const char* caller ) const;
+
+    private:
+        /**
+        * start collecting the ground truth of a frame
+        */
+        void setFrame( unsigned int frameNo );
+
+    private:
+        bool                            mEnabled;
+        float                           mMaxDistance;
+        float                           mBackgroundRate;
+        float                           mBackgroundCredit;  // background frames owed, renders one at >= 1
+
+        SignLabeler                     mLabeler;
+
+        unsigned int                    mFrameNo;
+        bool                            mHaveFrame;
+        bool                            mHaveCamera;
+        RDB_CAMERA_t                    mCamera;
+        std::vector<RDB_TRAFFIC_SIGN_t> mSigns;         // of mFrameNo
+        std::vector<RDB_TRAFFIC_SIGN_t> mNear;          // within the distance limit, re-used
+        std::vector<SignLabel>          mLabels;        // re-used
+
+        Statistics                      mStatistics;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_RENDER_GATE_HH */
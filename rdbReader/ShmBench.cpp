@@ -0,0 +1,320 @@
+// ShmBench.cpp : frame copy bandwidth and hand-off jitter of a double
+// buffered RDB image SHM, with normal / huge pages, unlocked / locked
+//
+// A writer process copies frames into the two buffers of a fresh segment at a
+// fixed rate, the way the IG does, and flags them for TC; a reader process
+// polls the flags, copies each frame out and releases the buffer.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <vector>
+#include <algorithm>
+#include "viRDBIcd.h"
+#include "ShmSegment.hh"
+
+/**
+* some global variables, considered "members" of this example
+*/
+unsigned int mShmKey   = 0x0819f;     // scratch key, removed after each run
+int          mWidth    = 3840;        // image size
+int          mHeight   = 2160;
+int          mPixel    = 4;           // bytes per pixel (RGBA8)
+int          mNoFrames = 240;
+double       mRate     = 60.0;        // frames per second
+
+/**
+* information about usage of the software
+* this method will exit the program
+*/
+void usage()
+{
+    printf("usage: shmBench [-w:width] [-h:height] [-p:bytes] [-f:frames] [-r:rate] [-k:key]\n\n");
+    printf("       -w:width      image width\n");
+    printf("       -h:height     image height\n");
+    printf("       -p:bytes      bytes per pixel\n");
+    printf("       -f:frames     frames per configuration\n");
+    printf("       -r:rate       frames per second written\n");
+    printf("       -k:key        SHM key to use (the segment is removed!)\n");
+    exit(1);
+}
+
+/**
+* validate the arguments given in the command line
+*/
+void ValidateArgs(int argc, char **argv)
+{
+    for( int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] == '-') || (argv[i][0] == '/'))
+        {
+            if ( strlen( argv[i] ) <= 3 )
+                usage();
+
+            switch (tolower(argv[i][1]))
+            {
+                case 'w':
+                    mWidth = atoi( &argv[i][3] );
+                    break;
+
+                case 'h':
+                    mHeight = atoi( &argv[i][3] );
+                    break;
+
+                case 'p':
+                    mPixel = atoi( &argv[i][3] );
+                    break;
+
+                case 'f':
+                    mNoFrames = atoi( &argv[i][3] );
+                    break;
+
+                case 'r':
+                    mRate = atof( &argv[i][3] );
+                    break;
+
+                case 'k':
+                    mShmKey = strtoul( &argv[i][3], 0, 0 );
+                    break;
+
+                default:
+                    usage();
+                    break;
+            }
+        }
+    }
+}
+
+double getTime()
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+
+    return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+/**
+* the segment: RDB_SHM_HDR_t, two RDB_SHM_BUFFER_INFO_t, then two buffers of
+* an RDB_MSG_HDR_t followed by the pixels
+*/
+struct Layout
+{
+    RDB_SHM_HDR_t*         hdr;
+    RDB_SHM_BUFFER_INFO_t* info[2];
+    RDB_MSG_HDR_t*         msg[2];
+    unsigned char*         pixels[2];
+};
+
+static size_t frameSize()
+{
+    return ( size_t ) mWidth * mHeight * mPixel;
+}
+
+static size_t segmentSize()
+{
+    return sizeof( RDB_SHM_HDR_t ) + 2 * sizeof( RDB_SHM_BUFFER_INFO_t ) + 2 * ( 64 + frameSize() );
+}
+
+static Layout getLayout( void* ptr, bool init )
+{
+    Layout l;
+    char*  p = ( char* ) ptr;
+
+    l.hdr = ( RDB_SHM_HDR_t* ) p;
+
+    if ( init )
+    {
+        l.hdr->headerSize = sizeof( RDB_SHM_HDR_t );
+        l.hdr->dataSize   = segmentSize() - sizeof( RDB_SHM_HDR_t );
+        l.hdr->noBuffers  = 2;
+    }
+
+    size_t offset = sizeof( RDB_SHM_HDR_t ) + 2 * sizeof( RDB_SHM_BUFFER_INFO_t );
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        l.info[ i ] = ( RDB_SHM_BUFFER_INFO_t* ) ( p + sizeof( RDB_SHM_HDR_t ) + i * sizeof( RDB_SHM_BUFFER_INFO_t ) );
+
+        if ( init )
+        {
+            l.info[ i ]->thisSize   = sizeof( RDB_SHM_BUFFER_INFO_t );
+            l.info[ i ]->bufferSize = 64 + frameSize();
+            l.info[ i ]->id         = i;
+            l.info[ i ]->flags      = 0;
+            l.info[ i ]->offset     = offset + i * ( 64 + frameSize() );
+        }
+
+        l.msg[ i ]    = ( RDB_MSG_HDR_t* ) ( p + l.info[ i ]->offset );
+        l.pixels[ i ] = ( unsigned char* ) l.msg[ i ] + 64;
+    }
+
+    return l;
+}
+
+static double percentile( std::vector<double> v, double q )
+{
+    if ( v.empty() )
+        return 0.0;
+
+    std::sort( v.begin(), v.end() );
+    return v[ std::min( v.size() - 1, ( size_t ) ( q * ( v.size() - 1 ) + 0.5 ) ) ];
+}
+
+/**
+* reader: wait for flagged buffers, copy them out, release them; sends the
+* copy times and hand-off latencies through the pipe
+*/
+static void runReader( unsigned int options, int fd )
+{
+    Framework::ShmSegment::Info info;
+
+    if ( !Framework::ShmSegment::open( mShmKey, 0, options, info ) )
+        exit( 1 );
+
+    Layout l = getLayout( info.ptr, false );
+    std::vector<unsigned char> frame( frameSize() );
+    std::vector<double> copy, latency;
+
+    for ( int n = 0; n < mNoFrames; n++ )
+    {
+        int    i = n & 1;
+        double seen;
+
+        // poll until the writer hands the buffer over
+        while ( !( __atomic_load_n( &l.info[ i ]->flags, __ATOMIC_ACQUIRE ) & RDB_SHM_BUFFER_FLAG_TC ) )
+            sched_yield();
+
+        seen = getTime();
+        __sync_fetch_and_or( &l.info[ i ]->flags, RDB_SHM_BUFFER_FLAG_LOCK );
+        memcpy( &frame[0], l.pixels[ i ], frameSize() );
+        copy.push_back( getTime() - seen );
+        latency.push_back( seen - l.msg[ i ]->simTime );
+        __sync_fetch_and_and( &l.info[ i ]->flags, ~( RDB_SHM_BUFFER_FLAG_TC | RDB_SHM_BUFFER_FLAG_LOCK ) );
+    }
+
+    if ( write( fd, &copy[0], copy.size() * sizeof( double ) ) < 0 ||
+         write( fd, &latency[0], latency.size() * sizeof( double ) ) < 0 )
+        perror( "shmBench: write()" );
+
+    Framework::ShmSegment::close( info );
+    _exit( 0 );
+}
+
+/**
+* one configuration: fresh segment, writer here, reader in a child process
+*/
+static void runConfig( const char* name, unsigned int options )
+{
+    int shmid = shmget( mShmKey, 0, 0 );
+
+    if ( shmid >= 0 )
+        shmctl( shmid, IPC_RMID, 0 );
+
+    Framework::ShmSegment::Info info;
+
+    if ( !Framework::ShmSegment::open( mShmKey, segmentSize(), options, info ) )
+        return;
+
+    Layout l = getLayout( info.ptr, true );
+
+    int fd[2];
+
+    if ( pipe( fd ) < 0 )
+    {
+        perror( "shmBench: pipe()" );
+        return;
+    }
+
+    fflush( stdout );
+    pid_t pid = fork();
+
+    if ( pid == 0 )
+    {
+        close( fd[0] );
+        runReader( options, fd[1] );
+    }
+
+    close( fd[1] );
+
+    std::vector<unsigned char> frame( frameSize() );
+
+    for ( size_t i = 0; i < frame.size(); i++ )
+        frame[ i ] = ( unsigned char ) ( i * 7 );
+
+    std::vector<double> copy;
+    double period = 1.0 / mRate;
+    double next   = getTime() + 0.1;     // give the reader time to attach
+
+    for ( int n = 0; n < mNoFrames; n++ )
+    {
+        int i = n & 1;
+
+        // wait for the frame time, then for the reader to release the buffer
+        struct timespec t;
+        t.tv_sec  = ( time_t ) next;
+        t.tv_nsec = ( long ) ( ( next - t.tv_sec ) * 1.0e9 );
+        clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &t, 0 );
+        next += period;
+
+        while ( __atomic_load_n( &l.info[ i ]->flags, __ATOMIC_ACQUIRE ) )
+            sched_yield();
+
+        l.info[ i ]->flags = RDB_SHM_BUFFER_FLAG_LOCK;
+
+        double start = getTime();
+        memcpy( l.pixels[ i ], &frame[0], frameSize() );
+        copy.push_back( getTime() - start );
+
+        l.msg[ i ]->frameNo = n + 1;
+        l.msg[ i ]->simTime = getTime();
+        __atomic_store_n( &l.info[ i ]->flags, RDB_SHM_BUFFER_FLAG_TC, __ATOMIC_RELEASE );
+    }
+
+    std::vector<double> readCopy( mNoFrames ), latency( mNoFrames );
+    size_t bytes = mNoFrames * sizeof( double );
+
+    if ( read( fd[0], &readCopy[0], bytes ) != ( ssize_t ) bytes || read( fd[0], &latency[0], bytes ) != ( ssize_t ) bytes )
+        fprintf( stderr, "shmBench: reader failed\n" );
+
+    close( fd[0] );
+    waitpid( pid, 0, 0 );
+
+    double gb = frameSize() * 1.e-9;
+
+    printf( "%-14s %6lu %8.2f %8.2f %8.2f %8.1f %8.1f %8.1f %8.1f\n", name,
+            ( unsigned long ) ( info.pageSize / 1024 ),
+            copy[0] * 1.e3,
+            gb / percentile( copy, 0.5 ), gb / percentile( readCopy, 0.5 ),
+            percentile( latency, 0.5 ) * 1.e6, percentile( latency, 0.99 ) * 1.e6,
+            *std::max_element( latency.begin(), latency.end() ) * 1.e6,
+            ( percentile( copy, 0.99 ) - percentile( copy, 0.5 ) ) * 1.e6 );
+
+    Framework::ShmSegment::close( info );
+    shmctl( info.shmId, IPC_RMID, 0 );
+}
+
+int main(int argc, char* argv[])
+{
+    ValidateArgs(argc, argv);
+
+    printf( "%dx%dx%d frames (%.1f MB), %d frames at %.0f Hz per configuration\n\n",
+            mWidth, mHeight, mPixel, frameSize() * 1.e-6, mNoFrames, mRate );
+    printf( "%-14s %6s %8s %8s %8s %8s %8s %8s %8s\n", "", "page", "first", "write", "read",
+            "handoff", "handoff", "handoff", "write" );
+    printf( "%-14s %6s %8s %8s %8s %8s %8s %8s %8s\n", "segment", "kB", "copy ms", "GB/s", "GB/s",
+            "p50 us", "p99 us", "max us", "p99-p50" );
+
+    runConfig( "normal",        0 );
+    runConfig( "normal+lock",   Framework::ShmSegment::OPT_LOCK );
+    runConfig( "huge",          Framework::ShmSegment::OPT_HUGE_PAGES );
+    runConfig( "huge+lock",     Framework::ShmSegment::OPT_HUGE_PAGES | Framework::ShmSegment::OPT_LOCK );
+
+    return 0;
+}
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <unistd.h>
 #include "RDBHandler.hh"
+#include "ShmSegment.hh"
 
 // forward declarations of methods
 
@@ -36,6 +37,7 @@ void*        mShmPtr       = 0;                                 // pointer to th
 size_t       mShmTotalSize = 0;                                 // remember the total size of the SHM segment
 bool         mVerbose      = false;                             // run in verbose mode?
 int          mForceBuffer  = -1;                                // force reading one of the SHM buffers (0=A, 1=B)
+unsigned int mShmOptions   = 0;                                 // Framework::ShmSegment::OPT_* for attaching
 
 /**
 * information about usage of the software
@@ -43,11 +45,13 @@ int          mForceBuffer  = -1;                                // force reading
 */
 void usage()
 {
-    printf("usage: shmReader [-k:key] [-c:checkMask] [-v] [-f:bufferId]\n\n");
+    printf("usage: shmReader [-k:key] [-c:checkMask] [-v] [-f:bufferId] [-g] [-l]\n\n");
     printf("       -k:key        SHM key that is to be addressed\n");
     printf("       -c:checkMask  mask against which to check before reading an SHM buffer\n");
     printf("       -f:bufferId   force reading of a given buffer (0 or 1) instead of checking for a valid checkMask\n");
     printf("       -v            run in verbose mode\n");
+    printf("       -g            ask for transparent huge pages for the SHM\n");
+    printf("       -l            fault in and lock the SHM in memory\n");
     exit(1);
 }
 
@@ -81,6 +85,14 @@ void ValidateArgs(int argc, char **argv)
                     mVerbose = true;
                     break;
                     
+                case 'g':       // huge pages
+                    mShmOptions |= Framework::ShmSegment::OPT_HUGE_PAGES;
+                    break;
+                    
+                case 'l':       // lock in memory
+                    mShmOptions |= Framework::ShmSegment::OPT_LOCK;
+                    break;
+                    
                 default:
                     usage();
                     break;
@@ -133,26 +145,14 @@ void openShm()
     if ( mShmPtr )
         return;
         
-    int shmid = 0; 
+    // attach only, the image generator creates the segment
+    Framework::ShmSegment::Info info;
 
-    if ( ( shmid = shmget( mShmKey, 0, 0 ) ) < 0 )
+    if ( !( mShmPtr = Framework::ShmSegment::open( mShmKey, 0, mShmOptions, info ) ) )
         return;
 
-    if ( ( mShmPtr = (char *)shmat( shmid, (char *)0, 0 ) ) == (char *) -1 )
-    {
-        perror("openShm: shmat()");
-        mShmPtr = 0;
-    }
-
-    if ( mShmPtr )
-    {
-        struct shmid_ds sInfo;
-
-        if ( ( shmid = shmctl( shmid, IPC_STAT, &sInfo ) ) < 0 )
-            perror( "openShm: shmctl()" );
-        else
-            mShmTotalSize = sInfo.shm_segsz;
-    }
+    mShmTotalSize = info.size;
+    Framework::ShmSegment::print( "openShm", mShmKey, info );
 }
 
 int checkShm()
@@ -0,0 +1,203 @@
+/* ===================================================
+ *  file:       ShmSegment.cc
+ * ---------------------------------------------------
+ *  purpose:	create / attach RDB shared memory
+ *              segments, optionally on huge pages and
+ *              locked into memory
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include "ShmSegment.hh"
+
+#ifndef SHM_HUGETLB
+#define SHM_HUGETLB 04000
+#endif
+
+namespace Framework
+{
+
+/**
+* value of the next "Name:   1234 kB" line of a /proc file, in bytes; 0 if it
+* is not found before the next mapping of an smaps file
+*/
+static size_t
+readKb( FILE* f, const char* name )
+{
+    char line[256];
+    size_t len = strlen( name );
+
+    while ( fgets( line, sizeof( line ), f ) )
+    {
+        unsigned long lo, hi;
+
+        if ( sscanf( line, "%lx-%lx ", &lo, &hi ) == 2 )
+            break;
+
+        if ( !strncmp( line, name, len ) && line[ len ] == ':' )
+        {
+            unsigned long kb = 0;
+            sscanf( line + len + 1, "%lu", &kb );
+            return kb * 1024;
+        }
+    }
+    return 0;
+}
+
+size_t
+ShmSegment::getHugePageSize()
+{
+    FILE* f = fopen( "/proc/meminfo", "r" );
+
+    if ( !f )
+        return 0;
+
+    size_t size = readKb( f, "Hugepagesize" );
+    fclose( f );
+    return size;
+}
+
+size_t
+ShmSegment::getPageSize( const void* ptr )
+{
+    FILE* f = fopen( "/proc/self/smaps", "r" );
+
+    if ( !f )
+        return 0;
+
+    // find the mapping holding ptr, then its page sizes
+    char line[256];
+    size_t pageSize = 0;
+
+    while ( fgets( line, sizeof( line ), f ) )
+    {
+        unsigned long lo, hi;
+
+        if ( sscanf( line, "%lx-%lx ", &lo, &hi ) != 2 )
+            continue;
+
+        if ( ( unsigned long ) ptr < lo || ( unsigned long ) ptr >= hi )
+            continue;
+
+        pageSize = readKb( f, "KernelPageSize" );
+
+        // transparent huge pages are mapped by PMDs inside a 4 kB page mapping
+        if ( pageSize && pageSize < getHugePageSize() && readKb( f, "ShmemPmdMapped" ) )
+            pageSize = getHugePageSize();
+        break;
+    }
+
+    fclose( f );
+    return pageSize;
+}
+
+void*
+ShmSegment::open( unsigned int key, size_t size, unsigned int options, Info & info )
+{
+    memset( &info, 0, sizeof( info ) );
+    info.shmId = -1;
+
+    // does the memory already exist?
+    if ( ( info.shmId = shmget( key, 0, 0 ) ) < 0 )
+    {
+        if ( !size )
+            return 0;
+
+        int flag = IPC_CREAT | 0777;
+
+        if ( options & OPT_HUGE_PAGES )
+        {
+            size_t huge = getHugePageSize();
+            size_t hugeSize = huge ? ( size + huge - 1 ) / huge * huge : size;
+
+            if ( ( info.shmId = shmget( key, hugeSize, flag | SHM_HUGETLB ) ) >= 0 )
+                info.hugetlb = true;
+            else
+                fprintf( stderr, "ShmSegment::open: no huge pages for 0x%x (%s), using normal pages; "
+                                 "reserve some with sysctl vm.nr_hugepages\n", key, strerror( errno ) );
+        }
+
+        if ( info.shmId < 0 && ( info.shmId = shmget( key, size, flag ) ) < 0 )
+        {
+            perror( "ShmSegment::open: shmget()" );
+            return 0;
+        }
+
+        info.created = true;
+    }
+
+    // now attach to the segment
+    if ( ( info.ptr = shmat( info.shmId, 0, 0 ) ) == ( void* ) -1 )
+    {
+        perror( "ShmSegment::open: shmat()" );
+        info.ptr = 0;
+        return 0;
+    }
+
+    struct shmid_ds sInfo;
+
+    if ( shmctl( info.shmId, IPC_STAT, &sInfo ) < 0 )
+        perror( "ShmSegment::open: shmctl()" );
+    else
+        info.size = sInfo.shm_segsz;
+
+#ifdef MADV_HUGEPAGE
+    // ask for transparent huge pages where hugetlb was not possible
+    if ( ( options & OPT_HUGE_PAGES ) && info.size && getPageSize( info.ptr ) < getHugePageSize() )
+        madvise( info.ptr, info.size, MADV_HUGEPAGE );
+#endif
+
+    if ( ( options & OPT_LOCK ) && info.size )
+    {
+        if ( mlock( info.ptr, info.size ) == 0 )
+            info.locked = true;
+        else
+        {
+            fprintf( stderr, "ShmSegment::open: cannot lock 0x%x in memory (%s), raise ulimit -l\n", key, strerror( errno ) );
+
+            // at least fault everything in now instead of during the first frames
+            long step = sysconf( _SC_PAGESIZE );
+            volatile const char* p = ( const char* ) info.ptr;
+
+            for ( size_t i = 0; i < info.size; i += step )
+                ( void ) p[ i ];
+        }
+    }
+
+    info.pageSize = getPageSize( info.ptr );
+
+    return info.ptr;
+}
+
+void
+ShmSegment::close( Info & info )
+{
+    if ( info.ptr )
+    {
+        if ( info.locked )
+            munlock( info.ptr, info.size );
+
+        shmdt( info.ptr );
+    }
+
+    info.ptr    = 0;
+    info.locked = false;
+}
+
+void
+ShmSegment::print( const char* caller, unsigned int key, const Info & info )
+{
+    fprintf( stderr, "%s: SHM 0x%x %s, %lu bytes, %lu kB pages%s%s\n", caller, key,
+                     info.created ? "created" : "attached",
+                     ( unsigned long ) info.size, ( unsigned long ) ( info.pageSize / 1024 ),
+                     info.hugetlb ? " (hugetlb)" : "",
+                     info.locked ? ", locked" : "" );
+}
+
+} // namespace Framework
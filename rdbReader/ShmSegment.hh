@@ -0,0 +1,93 @@
+/* ===================================================
+ *  file:       ShmSegment.hh
+ * ---------------------------------------------------
+ *  purpose:	create / attach RDB shared memory
+ *              segments, optionally on huge pages and
+ *              locked into memory
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_SHM_SEGMENT_HH
+#define _FRAMEWORK_SHM_SEGMENT_HH
+
+/* ====== INCLUSIONS ====== */
+#include <stddef.h>
+
+namespace Framework
+{
+/**
+* The openShm() routines of the samples, with two options for large image
+* segments:
+*
+*   OPT_HUGE_PAGES  a new segment is created with SHM_HUGETLB (its size rounded
+*                   up to the huge page size). If no huge pages are reserved
+*                   (vm.nr_hugepages) it falls back to normal pages and asks for
+*                   transparent huge pages with madvise, which the kernel honors
+*                   if transparent_hugepage/shmem_enabled is "advise".
+*                   Segments created by someone else keep their page size.
+*   OPT_LOCK        the mapping is faulted in and mlock()ed, so no frame copy
+*                   takes a page fault or waits for swap. Needs RLIMIT_MEMLOCK
+*                   (ulimit -l) of the segment size or CAP_IPC_LOCK; without,
+*                   the pages are only faulted in.
+*
+* The page size reported is the one the kernel actually maps the segment
+* with (KernelPageSize in /proc/self/smaps, or the PMD size if transparent
+* huge pages back the mapping).
+*/
+class ShmSegment
+{
+    public:
+        enum
+        {
+            OPT_HUGE_PAGES = 0x01,
+            OPT_LOCK       = 0x02
+        };
+
+        /**
+        * what open() did
+        */
+        struct Info
+        {
+            int    shmId;
+            void*  ptr;
+            size_t size;        // [byte] of the segment
+            size_t pageSize;    // [byte] actually used
+            bool   created;     // true: created by this call
+            bool   hugetlb;     // SHM_HUGETLB segment
+            bool   locked;      // mlock() succeeded
+        };
+
+        /**
+        * attach to the segment with the given key, creating it if it does not
+        * exist and size is not 0
+        * @param key        SHM key
+        * @param size       [byte] of a new segment, 0: attach only
+        * @param options    OPT_* flags
+        * @param info       receives the details
+        * @return pointer to the segment, 0 on failure (errors are printed)
+        */
+        static void* open( unsigned int key, size_t size, unsigned int options, Info & info );
+
+        /**
+        * detach a segment (the segment itself stays)
+        */
+        static void close( Info & info );
+
+        /**
+        * page size the kernel maps an address with
+        * @return [byte], 0 if unknown
+        */
+        static size_t getPageSize( const void* ptr );
+
+        /**
+        * size of the default huge pages
+        * @return [byte], 0 if unknown
+        */
+        static size_t getHugePageSize();
+
+        /**
+        * print a one-line summary to stderr
+        */
+        static void print( const char* caller, unsigned int key, const Info & info );
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_SHM_SEGMENT_HH */
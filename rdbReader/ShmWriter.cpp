@@ -10,7 +10,10 @@
 #include <sys/shm.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
 #include "RDBHandler.hh"
+#include "ShmSegment.hh"
+#include "FramePacer.hh"
 
 // forward declarations of methods
 
@@ -30,6 +33,10 @@ double       mFrameTime    = 0.030;                             // frame time is
 void*        mShmPtr       = 0;                                 // pointer to the SHM segment
 size_t       mShmTotalSize = 64 * 1024;                         // 64kB total size of SHM segment
 bool         mVerbose      = false;                             // run in verbose mode?
+unsigned int mShmOptions   = 0;                                 // Framework::ShmSegment::OPT_* for the segment
+double       mSpinTime     = 0.0;                               // [s] to busy-wait before each trigger
+Framework::FramePacer::Policy mPacerPolicy = Framework::FramePacer::POLICY_SKIP;
+volatile sig_atomic_t mQuit = 0;                                // set by SIGINT / SIGTERM
 Framework::RDBHandler mRdbHandler;                              // use the RDBHandler helper routines to handle 
                                                                 // the memory and message management
 
@@ -39,9 +46,14 @@ Framework::RDBHandler mRdbHandler;                              // use the RDBHa
 */
 void usage()
 {
-    printf("usage: shmWriter [-k:key]\n\n");
+    printf("usage: shmWriter [-k:key] [-v] [-g] [-l] [-f:rate] [-s:us] [-c]\n\n");
     printf("       -k:key        SHM key that is to be addressed\n");
     printf("       -v            run in verbose mode\n");
+    printf("       -g            create the SHM on huge pages\n");
+    printf("       -l            fault in and lock the SHM in memory\n");
+    printf("       -f:rate       trigger rate [Hz] (default 33.3)\n");
+    printf("       -s:us         busy-wait the last us before each trigger\n");
+    printf("       -c            catch up missed triggers instead of skipping them\n");
     exit(1);
 }
 
@@ -65,6 +77,28 @@ void ValidateArgs(int argc, char **argv)
                     mVerbose = true;
                     break;
                     
+                case 'g':       // huge pages
+                    mShmOptions |= Framework::ShmSegment::OPT_HUGE_PAGES;
+                    break;
+                    
+                case 'l':       // lock in memory
+                    mShmOptions |= Framework::ShmSegment::OPT_LOCK;
+                    break;
+                    
+                case 'f':       // trigger rate
+                    if ( strlen( argv[i] ) > 3 && atof( &argv[i][3] ) > 0.0 )
+                        mFrameTime = 1.0 / atof( &argv[i][3] );
+                    break;
+                    
+                case 's':       // spin time
+                    if ( strlen( argv[i] ) > 3 )
+                        mSpinTime = 1.e-6 * atof( &argv[i][3] );
+                    break;
+                    
+                case 'c':       // catch up
+                    mPacerPolicy = Framework::FramePacer::POLICY_CATCH_UP;
+                    break;
+                    
                 default:
                     usage();
                     break;
@@ -72,7 +106,15 @@ void ValidateArgs(int argc, char **argv)
         }
     }
     
-    fprintf( stderr, "ValidateArgs: key = 0x%x\n", mShmKey );
+    fprintf( stderr, "ValidateArgs: key = 0x%x, rate = %.3lf Hz\n", mShmKey, 1.0 / mFrameTime );
+}
+
+/**
+* let the trigger loop end so the statistics get printed
+*/
+void handleSignal( int )
+{
+    mQuit = 1;
 }
 
 /**
@@ -86,6 +128,9 @@ int main(int argc, char* argv[])
     //
     ValidateArgs(argc, argv);
     
+    signal( SIGINT, handleSignal );
+    signal( SIGTERM, handleSignal );
+    
     // first: open the shared memory (try to attach without creating a new segment)
     
     fprintf( stderr, "attaching to shared memory....\n" );
@@ -101,13 +146,27 @@ int main(int argc, char* argv[])
     int retVal = initShm();
     
     fprintf( stderr, "...initialized (result = %d)! Triggering now...\n", retVal );
-    // now write the trigger to the SHM for the time being
-    while ( 1 )
+    // now write the trigger to the SHM for the time being, on absolute
+    // deadlines so the work and the wake-up delays do not add up
+    Framework::FramePacer pacer( mFrameTime, mSpinTime, mPacerPolicy );
+    unsigned int reportTicks = ( unsigned int ) ( 10.0 / mFrameTime + 0.5 );  // every 10s
+    
+    while ( !mQuit )
     {
+        unsigned int skipped = pacer.wait();
+        
+        if ( skipped && mVerbose )
+            fprintf( stderr, "main: skipped %u trigger(s)\n", skipped );
+        
         writeTriggerToShm();
         
-        usleep( ( unsigned int ) ( 1.e6 * mFrameTime ) );    // wait for frame time (not very precise!)
+        if ( reportTicks && pacer.getStatistics().ticks % reportTicks == 0 )
+            pacer.printStatistics( "main" );
     }
+    
+    pacer.printStatistics( "main" );
+    
+    return 0;
 }
 
 /**
@@ -119,37 +178,14 @@ void openShm()
     if ( mShmPtr )
         return;
         
-    int shmid = 0; 
-    int flag  = IPC_CREAT | 0777;
-    
-    // does the memory already exist?
-    if ( ( shmid = shmget( mShmKey, 0, 0 ) ) < 0 )
-    {
-        // not yet there, so let's create the segment
-        if ( ( shmid = shmget( mShmKey, mShmTotalSize, flag ) ) < 0 )
-        {
-            perror("openShm: shmget()");
-            mShmPtr = 0;
-            return;
-        }
-    }
-    
-    // now attach to the segment
-    if ( ( mShmPtr = (char *)shmat( shmid, (char *)0, 0 ) ) == (char *) -1 )
-    {
-        perror("openShm: shmat()");
-        mShmPtr = 0;
-    }
-    
-    if ( !mShmPtr )
-        return;
+    // attach to the segment, create it if it is not there yet
+    Framework::ShmSegment::Info info;
 
-    struct shmid_ds sInfo;
+    if ( !( mShmPtr = Framework::ShmSegment::open( mShmKey, mShmTotalSize, mShmOptions, info ) ) )
+        return;
 
-    if ( ( shmid = shmctl( shmid, IPC_STAT, &sInfo ) ) < 0 )
-        perror( "openShm: shmctl()" );
-    else
-        mShmTotalSize = sInfo.shm_segsz;
+    mShmTotalSize = info.size;
+    Framework::ShmSegment::print( "openShm", mShmKey, info );
         
     // allocate a single buffer within the shared memory segment
     mRdbHandler.shmConfigure( mShmPtr, 1, mShmTotalSize );
@@ -18,7 +18,14 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <signal.h>
 #include "RDBHandler.hh"
+#include "FrameAssembler.hh"
+#include "DepthCloud.hh"
+#include "DepthOcclusion.hh"
+#include "ShmSegment.hh"
+#include "RealTime.hh"
+#include "RenderGate.hh"
 
 #define DEFAULT_PORT        48190   /* for image port it should be 48192 */
 #define DEFAULT_BUFFER      204800
@@ -93,6 +100,27 @@ void parseRDBMessageEntry( const double & simTime, const unsigned int & simFrame
 */
 void handleMessage( RDB_MSG_t* msg );
 
+/**
+* routine for handling a frame whose image and ground truth are complete;
+* here, only a printing of the frame is performed
+* @param frame  the assembled frame
+*/
+void handleFrame( const Framework::FrameData & frame );
+
+/**
+* append a frame to the output file as one RDB message (image with its
+* pixels, camera, traffic signs)
+* @param frame  the assembled frame
+*/
+void writeFrame( const Framework::FrameData & frame );
+
+/**
+* tell the frame assembler that the network frames up to lastFrame, which
+* have not been decided on yet, will not be rendered
+* @param lastFrame  last network frame that gets no image
+*/
+void skipUnrendered( int lastFrame );
+
 /**
 * send a trigger to the taskControl via network socket
 * @param sendSocket socket descriptor
@@ -131,6 +159,8 @@ double       mDeltaTime        = 0.01;                              // simulatio
 int          mLastShmFrame     = -1;
 int          mLastNetworkFrame = -1;
 int          mLastIGTriggerFrame = -1;
+const int    mRenderStride     = 3;                                 // network frames per IG trigger
+int          mLastDecidedFrame = -1;                                // last network frame known to be rendered or not
 int          mLastImageId      = 0;
 int          mTotalNoImages    = 0;
 
@@ -158,18 +188,62 @@ bool         mCheckForImage  = false;
 // some stuff for performance measurement
 double       mStartTime = -1.0;
 
+// joining images with the ground truth of their frame
+Framework::FrameAssembler mFrameAssembler( 16, 0.5 );                // 16 frames pending at most, 0.5s timeout
+Framework::FrameData      mFrame;                                     // re-used for every assembled frame
+bool                      mMsgFromIgOut = false;                      // message being parsed comes from the IG SHM
+
+// point clouds from depth images
+bool                      mConvertDepth = false;                      // convert depth images to point clouds?
+
+// recording of the assembled frames
+char                      mOutFileName[256] = "";                     // empty: do not record
+FILE*                     mOutFile = 0;
+Framework::RDBHandler     mOutRdbHandler;                             // composes the recorded messages
+unsigned int              mNoFramesWritten = 0;
+
+// huge pages / locking of both SHM segments
+unsigned int              mShmOptions = 0;                            // Framework::ShmSegment::OPT_*
+Framework::DepthCloud     mDepthCloud;
+
+// real-time profile of the loop thread
+Framework::RealTime::Options mRtOptions = Framework::RealTime::defaults();
+Framework::LoopWatchdog      mWatchdog;                               // deadline misses and jitter of the loop
+double                       mDeadline  = -1.0;                       // [s] between two triggers, < 0: render period
+volatile sig_atomic_t        mQuit      = 0;                          // set by SIGINT / SIGTERM
+
+// render only frames with signs in view (plus some background)
+Framework::RenderGate        mRenderGate;
+float                        mGateDistance   = -1.0f;                 // [m] < 0: gate off
+float                        mGateBackground = 0.05f;                 // fraction of the negatives rendered anyway
+float                        mGateMinSize    = 16.0f;                 // [pixel] smallest box side that counts
+char                         mGateClasses[256] = "";                  // sign class table, empty: default size
+
 /**
 * information about usage of the software
 * this method will exit the program
 */
 void usage()
 {
-    printf("usage: videoTest [-k:key] [-c:checkMask] [-v] [-f:bufferId] [-p:x] [-s:IP] [-h]\n\n");
+    printf("usage: videoTest [-k:key] [-c:checkMask] [-v] [-f:bufferId] [-p:x] [-s:IP] [-d] [-g] [-l] [-a:cpu] [-r:prio] [-m] [-w:ms] [-i:key] [-o:file] [-e:m] [-b:rate] [-z:px] [-t:file] [-h]\n\n");
     printf("       -k:key        SHM key that is to be addressed\n");
     printf("       -c:checkMask  mask against which to check before reading an SHM buffer\n");
     printf("       -p:x          Remote port to send to\n");
     printf("       -s:IP         Server's IP address or hostname\n");
     printf("       -v            run in verbose mode\n");
+    printf("       -d            convert depth images to point clouds (world frame)\n");
+    printf("       -g            use huge pages for the SHM segments\n");
+    printf("       -l            fault in and lock the SHM segments in memory\n");
+    printf("       -a:cpu        pin the loop thread to this CPU\n");
+    printf("       -r:prio       run the loop thread SCHED_FIFO with this priority (1..99)\n");
+    printf("       -m            mlockall() and pre-fault stack and heap\n");
+    printf("       -w:ms         watchdog deadline per frame (default: render period, 3 simulation steps)\n");
+    printf("       -i:key        SHM key of the IG image output\n");
+    printf("       -o:file       append every assembled frame to file as an RDB message\n");
+    printf("       -e:m          render only frames with a sign in view within m meters (0: any distance)\n");
+    printf("       -b:rate       fraction of the frames without signs that is rendered anyway (default: 0.05)\n");
+    printf("       -z:px         smallest sign box side that counts as in view (default: 16)\n");
+    printf("       -t:file       sign class table (type subType name width height), see rdbLabeler\n");
     exit(1);
 }
 
@@ -192,6 +266,42 @@ void ValidateArgs(int argc, char **argv)
                         sscanf( &argv[i][3], "0x%x", &mIgCtrlShmKey );
                     break;
                     
+                case 'i':        // IG image output key
+                    if ( strlen( argv[i] ) > 3 )
+                        sscanf( &argv[i][3], "0x%x", &mIgOutShmKey );
+                    break;
+                    
+                case 'o':       // output file
+                    if ( strlen( argv[i] ) > 3 )
+                    {
+                        strncpy( mOutFileName, &argv[i][3], sizeof( mOutFileName ) - 1 );
+                        mOutFileName[ sizeof( mOutFileName ) - 1 ] = 0;
+                    }
+                    break;
+                    
+                case 'e':       // render gate distance
+                    if ( strlen( argv[i] ) > 3 )
+                        mGateDistance = atof( &argv[i][3] );
+                    break;
+                    
+                case 'b':       // background rate
+                    if ( strlen( argv[i] ) > 3 )
+                        mGateBackground = atof( &argv[i][3] );
+                    break;
+                    
+                case 'z':       // minimum sign size
+                    if ( strlen( argv[i] ) > 3 )
+                        mGateMinSize = atof( &argv[i][3] );
+                    break;
+                    
+                case 't':       // sign class table
+                    if ( strlen( argv[i] ) > 3 )
+                    {
+                        strncpy( mGateClasses, &argv[i][3], sizeof( mGateClasses ) - 1 );
+                        mGateClasses[ sizeof( mGateClasses ) - 1 ] = 0;
+                    }
+                    break;
+                    
                 case 'c':       // check mask
                     if ( strlen( argv[i] ) > 3 )
                         mCheckMask = atoi( &argv[i][3] );
@@ -201,6 +311,37 @@ void ValidateArgs(int argc, char **argv)
                     mVerbose = true;
                     break;
                     
+                case 'g':       // huge pages
+                    mShmOptions |= Framework::ShmSegment::OPT_HUGE_PAGES;
+                    break;
+                    
+                case 'l':       // lock in memory
+                    mShmOptions |= Framework::ShmSegment::OPT_LOCK;
+                    break;
+                    
+                case 'a':       // CPU affinity
+                    if ( strlen( argv[i] ) > 3 )
+                        mRtOptions.cpu = atoi( &argv[i][3] );
+                    break;
+                    
+                case 'r':       // SCHED_FIFO priority
+                    if ( strlen( argv[i] ) > 3 )
+                        mRtOptions.priority = atoi( &argv[i][3] );
+                    break;
+                    
+                case 'm':       // lock all memory
+                    mRtOptions.lockMemory = true;
+                    break;
+                    
+                case 'w':       // watchdog deadline
+                    if ( strlen( argv[i] ) > 3 )
+                        mDeadline = 1.e-3 * atof( &argv[i][3] );
+                    break;
+                    
+                case 'd':       // depth images to point clouds
+                    mConvertDepth = true;
+                    break;
+                    
                 case 'p':        // Remote port
                     if (strlen(argv[i]) > 3)
                         iPort = atoi(&argv[i][3]);
@@ -218,8 +359,16 @@ void ValidateArgs(int argc, char **argv)
         }
     }
     
-    fprintf( stderr, "ValidateArgs: key = 0x%x, checkMask = 0x%x\n", 
-                     mIgCtrlShmKey, mCheckMask );
+    fprintf( stderr, "ValidateArgs: key = 0x%x, image key = 0x%x, checkMask = 0x%x\n", 
+                     mIgCtrlShmKey, mIgOutShmKey, mCheckMask );
+}
+
+/**
+* let the loop end so the statistics get printed
+*/
+void handleSignal( int )
+{
+    mQuit = 1;
 }
 
 /**
@@ -232,11 +381,39 @@ int main(int argc, char* argv[])
     // Parse the command line
     ValidateArgs(argc, argv);
     
+    signal( SIGINT, handleSignal );
+    signal( SIGTERM, handleSignal );
+    
+    // open the recording before anything else may fail
+    if ( mOutFileName[0] && !( mOutFile = fopen( mOutFileName, "ab" ) ) )
+    {
+        perror( "main: fopen()" );
+        return 1;
+    }
+    
+    // the gate judges signs like the labeler will, only with its own minimum size
+    if ( mGateClasses[0] && ( mRenderGate.getLabeler().loadClasses( mGateClasses ) < 0 ) )
+        return 1;
+        
+    mRenderGate.getLabeler().setFilter( 0, 95, 32, mGateMinSize, mGateMinSize );
+    
+    if ( mGateDistance >= 0.0f )
+        mRenderGate.enable( mGateDistance, mGateBackground );
+    
     // open the communication ports
     openCommunication();
     
+    // the conversion threads are started now, not on the first frame, so
+    // their stacks are locked with the rest
+    if ( mConvertDepth )
+        mDepthCloud.setThreads( 0 );
+    
+    // from here on, the loop is on the critical path of the simulation
+    Framework::RealTime::apply( mRtOptions );
+    mWatchdog.setDeadline( mDeadline > 0.0 ? mDeadline : mRenderStride * mDeltaTime );
+    
     // now check the SHM for the time being
-    while ( 1 )
+    while ( !mQuit )
     {
         int lastSimFrame = mLastNetworkFrame;
         
@@ -253,15 +430,35 @@ int main(int argc, char* argv[])
             mCheckForImage = !mHaveImage;
         }
         
+        // hand out the frames that are complete by now
+        while ( mFrameAssembler.pop( getTime(), mFrame ) )
+            handleFrame( mFrame );
+        
         if ( haveNewFrame )
         {
             fprintf( stderr, "main: new simulation frame (%d) available, mLastIGTriggerFrame = %d\n", 
                              mLastNetworkFrame, mLastIGTriggerFrame );
                              
             mHaveFirstFrame = true;
+            
+            // frame numbers went back: the simulation was restarted
+            if ( mLastNetworkFrame < mLastIGTriggerFrame )
+                mLastIGTriggerFrame = mLastNetworkFrame - mRenderStride;
         }
             
-        if ( mLastNetworkFrame >= ( mLastIGTriggerFrame + 3 ) ) // create an image only every 3rd network frame
+        // create an image only every mRenderStride-th network frame, and only if it is worth it;
+        // the start-up frames are always rendered, the IG needs them to deliver at all
+        if ( ( mLastNetworkFrame >= ( mLastIGTriggerFrame + mRenderStride ) ) && mHaveFirstImage && 
+             ( mRenderGate.decide( mLastNetworkFrame ) == Framework::RenderGate::DECISION_SKIP ) )
+        {
+            if ( mVerbose )
+                fprintf( stderr, "main: frame %d has no sign in view, not rendered\n", mLastNetworkFrame );
+            
+            // the simulation goes on right away
+            mLastIGTriggerFrame = mLastNetworkFrame;
+            skipUnrendered( mLastNetworkFrame );
+        }
+        else if ( mLastNetworkFrame >= ( mLastIGTriggerFrame + mRenderStride ) )
         {
             usleep( 5000 );
             
@@ -271,6 +468,8 @@ int main(int argc, char* argv[])
                 usleep( 100 );
             }
             mLastIGTriggerFrame = mLastNetworkFrame;
+            skipUnrendered( mLastNetworkFrame - 1 );
+            mLastDecidedFrame = mLastNetworkFrame;
             
             mHaveImage     = false;
             mCheckForImage = true;
@@ -288,6 +487,15 @@ int main(int argc, char* argv[])
                 usleep( 100000 );   // 10H
 
             sendRDBTrigger( mClient, mSimTime, mSimFrame );
+            
+            // start watching once the start-up delays are over
+            if ( mHaveFirstImage && mHaveFirstFrame )
+            {
+                if ( mWatchdog.step( Framework::RealTime::now() ) && mVerbose )
+                    fprintf( stderr, "main: frame %d missed its deadline\n", mSimFrame );
+            }
+            else
+                mWatchdog.reset();
 
             // increase internal counters
             mSimTime += mDeltaTime;
@@ -299,8 +507,24 @@ int main(int argc, char* argv[])
             calcStatistics();
         }
         
+        double sleepStart = Framework::RealTime::now();
+        
         usleep( 10 );       // do not overload the CPU
+        
+        mWatchdog.wakeup( Framework::RealTime::now() - sleepStart - 1.e-5 );
+    }
+    
+    calcStatistics();
+    mWatchdog.print( "main" );
+    mRenderGate.printStatistics( "main" );
+    
+    if ( mOutFile )
+    {
+        fprintf( stderr, "main: wrote %u frames to %s\n", mNoFramesWritten, mOutFileName );
+        fclose( mOutFile );
     }
+    
+    return 0;
 }
 
 void openCommunication()
@@ -462,8 +686,123 @@ void readNetwork()
 
 void handleMessage( RDB_MSG_t* msg )
 {
-    // just print the message
+    // messages handled here come from the IG output SHM
+    mMsgFromIgOut = true;
     parseRDBMessage( msg );
+    mMsgFromIgOut = false;
+}
+
+void handleFrame( const Framework::FrameData & frame )
+{
+    if ( mVerbose )
+    {
+        fprintf( stderr, "handleFrame: frame %d: %d images, %d signs, %d sensor objects, %d objects\n",
+                         frame.frameNo, frame.noImages,
+                         ( int ) frame.signs.size(), ( int ) frame.sensorObjects.size(), ( int ) frame.objects.size() );
+        
+        for ( unsigned int i = 0; i < frame.noImages; i++ )
+            fprintf( stderr, "handleFrame:     image %d of camera %d: %dx%d, format %d, %d bytes\n",
+                             frame.images[ i ].id, frame.images[ i ].cameraId, frame.images[ i ].width, frame.images[ i ].height,
+                             frame.images[ i ].pixelFormat, ( int ) frame.imageData[ i ].size() );
+    }
+    
+    if ( mOutFile )
+        writeFrame( frame );
+                         
+    // a depth image with its camera can be turned into 3D points
+    if ( !mConvertDepth || !( frame.parts & Framework::FrameAssembler::PART_CAMERA ) )
+        return;
+    
+    // the IG may deliver an RGB image as well, the depth image is the one to convert
+    unsigned int d = 0;
+    
+    while ( ( d < frame.noImages ) && ( frame.imageData[ d ].empty() || !Framework::DepthOcclusion::isDepthFormat( frame.images[ d ] ) ) )
+        d++;
+        
+    if ( d == frame.noImages )
+        return;
+    
+    const RDB_IMAGE_t & image = frame.images[ d ];
+        
+    double       start    = getTime();
+    unsigned int noPoints = mDepthCloud.convert( image, &frame.imageData[ d ][0], frame.camera, true );
+    
+    if ( mVerbose && noPoints )
+    {
+        // the point in the image center as a sanity check
+        unsigned int k = ( image.height / 2 ) * image.width + image.width / 2;
+        
+        fprintf( stderr, "handleFrame: frame %d: %d points in %.3lf ms, center = ( %.3f, %.3f, %.3f )\n",
+                         frame.frameNo, noPoints, 1.e3 * ( getTime() - start ),
+                         mDepthCloud.getX()[ k ], mDepthCloud.getY()[ k ], mDepthCloud.getZ()[ k ] );
+    }
+}
+
+void writeFrame( const Framework::FrameData & frame )
+{
+    mOutRdbHandler.initMsg();
+    
+    mOutRdbHandler.addPackage( frame.simTime, frame.frameNo, RDB_PKG_ID_START_OF_FRAME );
+    
+    // the message may move with each package, so fill them right away
+    for ( unsigned int i = 0; i < frame.noImages; i++ )
+    {
+        const std::vector<unsigned char> & data = frame.imageData[ i ];
+        
+        RDB_IMAGE_t* img = ( RDB_IMAGE_t* ) mOutRdbHandler.addPackage( frame.simTime, frame.frameNo, RDB_PKG_ID_IMAGE, 1, false, data.size() );
+        
+        if ( img )
+        {
+            memcpy( img, &frame.images[ i ], sizeof( RDB_IMAGE_t ) );
+            img->imgSize = data.size();
+            
+            if ( !data.empty() )
+                memcpy( img + 1, &data[0], data.size() );
+        }
+    }
+    
+    if ( frame.parts & Framework::FrameAssembler::PART_CAMERA )
+    {
+        RDB_CAMERA_t* cam = ( RDB_CAMERA_t* ) mOutRdbHandler.addPackage( frame.simTime, frame.frameNo, RDB_PKG_ID_CAMERA );
+        
+        if ( cam )
+            memcpy( cam, &frame.camera, sizeof( RDB_CAMERA_t ) );
+    }
+    
+    if ( !frame.signs.empty() )
+    {
+        RDB_TRAFFIC_SIGN_t* signs = ( RDB_TRAFFIC_SIGN_t* ) mOutRdbHandler.addPackage( frame.simTime, frame.frameNo, RDB_PKG_ID_TRAFFIC_SIGN, frame.signs.size() );
+        
+        if ( signs )
+            memcpy( signs, &frame.signs[0], frame.signs.size() * sizeof( RDB_TRAFFIC_SIGN_t ) );
+    }
+    
+    mOutRdbHandler.addPackage( frame.simTime, frame.frameNo, RDB_PKG_ID_END_OF_FRAME );
+    
+    // flushed per frame, so whoever watches the file only sees whole messages
+    // (unless we die in the middle of one)
+    if ( fwrite( mOutRdbHandler.getMsg(), mOutRdbHandler.getMsgTotalSize(), 1, mOutFile ) != 1 || fflush( mOutFile ) )
+    {
+        perror( "writeFrame: fwrite()" );
+        return;
+    }
+    
+    mNoFramesWritten++;
+}
+
+void skipUnrendered( int lastFrame )
+{
+    int first = mLastDecidedFrame + 1;
+    
+    // after a restart of the simulation the frame numbers start over; frames
+    // further back than the assembler window are gone anyway
+    if ( ( first > lastFrame + 1 ) || ( lastFrame - first >= ( int ) mFrameAssembler.getCapacity() ) )
+        first = lastFrame - mFrameAssembler.getCapacity() + 1;
+    
+    for ( int frameNo = ( first < 0 ) ? 0 : first; frameNo <= lastFrame; frameNo++ )
+        mFrameAssembler.skipImage( frameNo );
+    
+    mLastDecidedFrame = lastFrame;
 }
 
 void parseRDBMessage( RDB_MSG_t* msg )
@@ -493,9 +832,17 @@ void parseRDBMessageEntry( const double & simTime, const unsigned int & simFrame
     if ( !entryHdr )
         return;
     
+    char*        data       = ( ( char* ) entryHdr ) + entryHdr->headerSize;
+    unsigned int noElements = entryHdr->elementSize ? ( entryHdr->dataSize / entryHdr->elementSize ) : 0;
+    
     if ( entryHdr->pkgId == RDB_PKG_ID_END_OF_FRAME )   // check for end-of-frame only
     {
         mLastNetworkFrame = simFrame;
+        
+        // the ground truth of a frame is complete once the network stream ends it
+        if ( !mMsgFromIgOut )
+            mFrameAssembler.endOfState( simFrame, simTime, getTime() );
+        
         return;
     }
     
@@ -507,16 +854,66 @@ void parseRDBMessageEntry( const double & simTime, const unsigned int & simFrame
         {
             fprintf( stderr, "parseRDBMessageEntry: simframe = %d: have image no. %d\n", simFrame, myImg->id );
             
-            if ( ( myImg->id > 3 ) && ( ( myImg->id - mLastImageId ) != 3 ) )
+            // with the render gate, frames in between may not have been rendered
+            int delta = myImg->id - mLastImageId;
+            
+            if ( ( myImg->id > 3 ) && ( mRenderGate.isEnabled() ? ( ( delta <= 0 ) || ( delta % 3 ) ) : ( delta != 3 ) ) )
             {
-                fprintf( stderr, "WARNING: parseRDBMessageEntry: delta of image ID out of bounds: delta = %d\n", myImg->id - mLastImageId );
+                fprintf( stderr, "WARNING: parseRDBMessageEntry: delta of image ID out of bounds: delta = %d\n", delta );
             }
 
             mLastImageId    = myImg->id;
             mHaveImage      = true;
             mHaveFirstImage = true;
             mTotalNoImages++;
+            
+            // the IG renders the frame given in the message header
+            mFrameAssembler.addImage( simFrame, simTime, myImg, getTime() );
         }
+        return;
+    }
+    
+    // ground truth of the frame comes from the network stream only; packages the
+    // IG SHM carries along would count as network parts in the assembler
+    if ( !noElements || mMsgFromIgOut )
+        return;
+    
+    switch ( entryHdr->pkgId )
+    {
+        case RDB_PKG_ID_CAMERA:
+            if ( entryHdr->elementSize == sizeof( RDB_CAMERA_t ) )
+            {
+                mFrameAssembler.addCamera( simFrame, simTime, ( RDB_CAMERA_t* ) data, getTime() );
+                mRenderGate.addCamera( simFrame, ( RDB_CAMERA_t* ) data );
+            }
+            break;
+            
+        case RDB_PKG_ID_TRAFFIC_SIGN:
+            if ( entryHdr->elementSize == sizeof( RDB_TRAFFIC_SIGN_t ) )
+            {
+                mFrameAssembler.addSigns( simFrame, simTime, ( RDB_TRAFFIC_SIGN_t* ) data, noElements, getTime() );
+                mRenderGate.addSigns( simFrame, ( RDB_TRAFFIC_SIGN_t* ) data, noElements );
+            }
+            break;
+            
+        case RDB_PKG_ID_SENSOR_OBJECT:
+            if ( entryHdr->elementSize == sizeof( RDB_SENSOR_OBJECT_t ) )
+                mFrameAssembler.addSensorObjects( simFrame, simTime, ( RDB_SENSOR_OBJECT_t* ) data, noElements, getTime() );
+            break;
+            
+        case RDB_PKG_ID_OBJECT_STATE:
+            // basic or extended object state; the extension stays zero for basic ones
+            for ( unsigned int i = 0; i < noElements; i++ )
+            {
+                RDB_OBJECT_STATE_t state;
+                
+                memset( &state, 0, sizeof( state ) );
+                memcpy( &state, data + i * entryHdr->elementSize, 
+                        ( entryHdr->elementSize < sizeof( state ) ) ? entryHdr->elementSize : sizeof( state ) );
+                
+                mFrameAssembler.addObjects( simFrame, simTime, &state, 1, getTime() );
+            }
+            break;
     }
 }
 
@@ -584,37 +981,14 @@ void openIgCtrlShm()
     if ( mIgCtrlShmPtr )
         return;
         
-    int shmid = 0; 
-    int flag  = IPC_CREAT | 0777;
-    
-    // does the memory already exist?
-    if ( ( shmid = shmget( mIgCtrlShmKey, 0, 0 ) ) < 0 )
-    {
-        // not yet there, so let's create the segment
-        if ( ( shmid = shmget( mIgCtrlShmKey, mIgCtrlShmTotalSize, flag ) ) < 0 )
-        {
-            perror("openIgCtrlShm: shmget()");
-            mIgCtrlShmPtr = 0;
-            return;
-        }
-    }
-    
-    // now attach to the segment
-    if ( ( mIgCtrlShmPtr = (char *)shmat( shmid, (char *)0, 0 ) ) == (char *) -1 )
-    {
-        perror("openIgCtrlShm: shmat()");
-        mIgCtrlShmPtr = 0;
-    }
-    
-    if ( !mIgCtrlShmPtr )
-        return;
+    // attach to the segment, create it if it is not there yet
+    Framework::ShmSegment::Info info;
 
-    struct shmid_ds sInfo;
+    if ( !( mIgCtrlShmPtr = Framework::ShmSegment::open( mIgCtrlShmKey, mIgCtrlShmTotalSize, mShmOptions, info ) ) )
+        return;
 
-    if ( ( shmid = shmctl( shmid, IPC_STAT, &sInfo ) ) < 0 )
-        perror( "openIgCtrlShm: shmctl()" );
-    else
-        mIgCtrlShmTotalSize = sInfo.shm_segsz;
+    mIgCtrlShmTotalSize = info.size;
+    Framework::ShmSegment::print( "openIgCtrlShm", mIgCtrlShmKey, info );
         
     // allocate a single buffer within the shared memory segment
     mIgCtrlRdbHandler.shmConfigure( mIgCtrlShmPtr, 1, mIgCtrlShmTotalSize );
@@ -709,26 +1083,14 @@ void openIgOutShm()
     if ( mIgOutShmPtr )
         return;
         
-    int shmid = 0; 
+    // attach only, the image generator creates the segment
+    Framework::ShmSegment::Info info;
 
-    if ( ( shmid = shmget( mIgOutShmKey, 0, 0 ) ) < 0 )
+    if ( !( mIgOutShmPtr = Framework::ShmSegment::open( mIgOutShmKey, 0, mShmOptions, info ) ) )
         return;
 
-    if ( ( mIgOutShmPtr = (char *)shmat( shmid, (char *)0, 0 ) ) == (char *) -1 )
-    {
-        perror("openIgOutShm: shmat()");
-        mIgOutShmPtr = 0;
-    }
-
-    if ( mIgOutShmPtr )
-    {
-        struct shmid_ds sInfo;
-
-        if ( ( shmid = shmctl( shmid, IPC_STAT, &sInfo ) ) < 0 )
-            perror( "openIgOutShm: shmctl()" );
-        else
-            mIgOutShmTotalSize = sInfo.shm_segsz;
-    }
+    mIgOutShmTotalSize = info.size;
+    Framework::ShmSegment::print( "openIgOutShm", mIgOutShmKey, info );
 }
 
 int checkIgOutShm()
@@ -931,4 +1293,12 @@ void calcStatistics()
         
     fprintf( stderr, "calcStatistics: received %d images in %.3lf seconds (i.e. %.3lf images per second )\n", 
                      mTotalNoImages, dt, mTotalNoImages / dt );
+                     
+    mFrameAssembler.printStatistics();
+    
+    if ( mSimFrame % 100 == 0 )
+    {
+        mWatchdog.print( "calcStatistics" );
+        mRenderGate.printStatistics( "calcStatistics" );
+    }
 }
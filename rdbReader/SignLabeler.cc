@@ -0,0 +1,588 @@
+/* ===================================================
+ *  file:       SignLabeler.cc
+ * ---------------------------------------------------
+ *  purpose:	turn the traffic signs of an RDB stream
+ *              into 2D image labels (VOC annotations)
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "SignLabeler.hh"
+
+namespace Framework
+{
+
+/**
+* axes of the frame rotated by heading, pitch and roll (R = Rz(h) * Ry(p) * Rx(r)),
+* i.e. the columns of R: forward, left and up
+*/
+static void
+hprAxes( double h, double p, double r, double fwd[3], double left[3], double up[3] )
+{
+    double ch = cos( h ), sh = sin( h );
+    double cp = cos( p ), sp = sin( p );
+    double cr = cos( r ), sr = sin( r );
+
+    fwd[0]  = ch * cp;                  fwd[1]  = sh * cp;                  fwd[2]  = -sp;
+    left[0] = ch * sp * sr - sh * cr;   left[1] = sh * sp * sr + ch * cr;   left[2] = cp * sr;
+    up[0]   = ch * sp * cr + sh * sr;   up[1]   = sh * sp * cr - ch * sr;   up[2]   = cp * cr;
+}
+
+/**
+* pinhole projection of n points given relative to the camera, in one branch-free
+* pass over the arrays (vectorized by the compiler)
+* @param rot    rows: camera forward, left and up axes
+*/
+static void
+projectCorners( const float* __restrict x, const float* __restrict y, const float* __restrict z, size_t n,
+                const float rot[9], float fx, float fy, float px, float py,
+                float* __restrict u, float* __restrict v, float* __restrict depth )
+{
+    const float f0 = rot[0], f1 = rot[1], f2 = rot[2];
+    const float l0 = rot[3], l1 = rot[4], l2 = rot[5];
+    const float u0 = rot[6], u1 = rot[7], u2 = rot[8];
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        float xc = f0 * x[i] + f1 * y[i] + f2 * z[i];    // along the viewing axis
+        float yc = l0 * x[i] + l1 * y[i] + l2 * z[i];    // to the left
+        float zc = u0 * x[i] + u1 * y[i] + u2 * z[i];    // up
+        float inv = 1.0f / xc;
+
+        u[i]     = px - fx * yc * inv;
+        v[i]     = py - fy * zc * inv;
+        depth[i] = xc;
+    }
+}
+
+SignLabeler::SignLabeler() : mMinReadability( 0 ),
+                             mMaxOcclusion( 95 ),            // ~75%
+                             mDifficultOcclusion( 32 ),      // ~25%
+                             mMinSize( 8.0f ),
+                             mDifficultSize( 16.0f ),
+                             mMinVisible( 0.25f ),
+                             mDifficultVisible( 0.75f ),
+                             mOriginBottomLeft( false ),
+                             mImageSetFile( 0 ),
+                             mNoImages( 0 ),
+                             mNoLabels( 0 )
+{
+    // common round / triangular sign, face center at the sign position
+    mDefaultClass.width   = 0.6f;
+    mDefaultClass.height  = 0.6f;
+    mDefaultClass.zOffset = 0.0f;
+}
+
+SignLabeler::~SignLabeler()
+{
+    if ( mImageSetFile )
+        fclose( mImageSetFile );
+}
+
+int
+SignLabeler::loadClasses( const char* filename )
+{
+    FILE* fp = fopen( filename, "r" );
+
+    if ( !fp )
+    {
+        perror( "SignLabeler::loadClasses: fopen()" );
+        return -1;
+    }
+
+    char line[256];
+    int  noClasses = 0;
+
+    while ( fgets( line, sizeof( line ), fp ) )
+    {
+        int       type, subType;
+        char      name[64];
+        SignClass cls = mDefaultClass;
+
+        if ( line[0] == '#' )
+            continue;
+
+        int n = sscanf( line, "%d %d %63s %f %f %f", &type, &subType, name, &cls.width, &cls.height, &cls.zOffset );
+
+        if ( n < 3 )
+            continue;
+
+        if ( n == 4 )   // a width alone means a square face
+            cls.height = cls.width;
+
+        cls.name = name;
+        setClass( type, subType, cls );
+        noClasses++;
+    }
+
+    fclose( fp );
+
+    fprintf( stderr, "SignLabeler::loadClasses: %d classes from %s\n", noClasses, filename );
+
+    return noClasses;
+}
+
+void
+SignLabeler::setClass( int32_t type, int32_t subType, const SignClass & cls )
+{
+    mClasses[ std::make_pair( type, subType ) ] = cls;
+}
+
+void
+SignLabeler::setDefaultSize( float width, float height, float zOffset )
+{
+    mDefaultClass.width   = width;
+    mDefaultClass.height  = height;
+    mDefaultClass.zOffset = zOffset;
+}
+
+void
+SignLabeler::setFilter( int minReadability, int maxOcclusion, int difficultOcclusion, float minSize, float difficultSize )
+{
+    mMinReadability     = minReadability;
+    mMaxOcclusion       = maxOcclusion;
+    mDifficultOcclusion = difficultOcclusion;
+    mMinSize            = minSize;
+    mDifficultSize      = difficultSize;
+}
+
+void
+SignLabeler::setDepthFilter( float minVisible, float difficultVisible, float tolerance, unsigned int noThreads )
+{
+    mMinVisible       = minVisible;
+    mDifficultVisible = difficultVisible;
+
+    mDepthOcclusion.setTolerance( tolerance );
+    mDepthOcclusion.setThreads( noThreads );
+}
+
+void
+SignLabeler::setOriginBottomLeft( bool bottomLeft )
+{
+    mOriginBottomLeft = bottomLeft;
+}
+
+void
+SignLabeler::setOutput( const char* dir, const char* imageSet, const char* prefix )
+{
+    if ( mImageSetFile )
+    {
+        fclose( mImageSetFile );
+        mImageSetFile = 0;
+    }
+
+    mOutDir   = dir ? dir : "";
+    mImageSet = imageSet;
+    mPrefix   = prefix;
+
+    if ( mOutDir.empty() )
+        return;
+
+    std::string name = mOutDir + "/ImageSets/Main/" + mImageSet + ".txt";
+
+    if ( !( mImageSetFile = fopen( name.c_str(), "a" ) ) )
+        perror( "SignLabeler::setOutput: fopen()" );
+}
+
+unsigned int
+SignLabeler::getNoImages() const
+{
+    return mNoImages;
+}
+
+unsigned int
+SignLabeler::getNoLabels() const
+{
+    return mNoLabels;
+}
+
+const SignClass*
+SignLabeler::getClass( const RDB_TRAFFIC_SIGN_t & sign, SignClass & scratch ) const
+{
+    std::map< std::pair<int32_t, int32_t>, SignClass >::const_iterator it = mClasses.find( std::make_pair( sign.type, sign.subType ) );
+
+    if ( it != mClasses.end() )
+        return &( it->second );
+
+    // without a class table every sign is labelled by its OpenDRIVE type
+    if ( !mClasses.empty() )
+        return 0;
+
+    char name[32];
+    snprintf( name, sizeof( name ), "%d_%d", sign.type, sign.subType );
+
+    scratch      = mDefaultClass;
+    scratch.name = name;
+
+    return &scratch;
+}
+
+void
+SignLabeler::project( const RDB_CAMERA_t & cam, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns,
+                      std::vector<SignLabel> & labels )
+{
+    labels.clear();
+
+    // corners of all signs that pass the attribute filters, relative to the camera
+    std::vector<const RDB_TRAFFIC_SIGN_t*> accepted;
+    std::vector<SignClass>                 classes;
+    SignClass                              scratch;
+
+    mCornerX.resize( 4 * noSigns );
+    mCornerY.resize( 4 * noSigns );
+    mCornerZ.resize( 4 * noSigns );
+
+    for ( unsigned int i = 0; i < noSigns; i++ )
+    {
+        const RDB_TRAFFIC_SIGN_t & sign = signs[ i ];
+
+        if ( ( sign.readability >= 0 ) && ( sign.readability < mMinReadability ) )
+            continue;
+
+        if ( ( sign.occlusion >= 0 ) && ( sign.occlusion > mMaxOcclusion ) )
+            continue;
+
+        const SignClass* cls = getClass( sign, scratch );
+
+        if ( !cls )
+            continue;
+
+        double fwd[3], left[3], up[3];
+        hprAxes( sign.pos.h, sign.pos.p, sign.pos.r, fwd, left, up );
+
+        double center[3] = { sign.pos.x - cam.pos.x + cls->zOffset * up[0],
+                             sign.pos.y - cam.pos.y + cls->zOffset * up[1],
+                             sign.pos.z - cam.pos.z + cls->zOffset * up[2] };
+
+        size_t k = 4 * accepted.size();
+
+        for ( int c = 0; c < 4; c++ )
+        {
+            double w = ( c & 1 ) ? 0.5 * cls->width  : -0.5 * cls->width;
+            double h = ( c & 2 ) ? 0.5 * cls->height : -0.5 * cls->height;
+
+            // subtract the camera position in double, the rest is fine in float
+            mCornerX[ k + c ] = ( float ) ( center[0] + w * left[0] + h * up[0] );
+            mCornerY[ k + c ] = ( float ) ( center[1] + w * left[1] + h * up[1] );
+            mCornerZ[ k + c ] = ( float ) ( center[2] + w * left[2] + h * up[2] );
+        }
+
+        accepted.push_back( &sign );
+        classes.push_back( *cls );
+    }
+
+    if ( accepted.empty() )
+        return;
+
+    size_t noCorners = 4 * accepted.size();
+
+    mU.resize( noCorners );
+    mV.resize( noCorners );
+    mDepth.resize( noCorners );
+
+    double fwd[3], left[3], up[3];
+    hprAxes( cam.pos.h, cam.pos.p, cam.pos.r, fwd, left, up );
+
+    float rot[9] = { ( float ) fwd[0],  ( float ) fwd[1],  ( float ) fwd[2],
+                     ( float ) left[0], ( float ) left[1], ( float ) left[2],
+                     ( float ) up[0],   ( float ) up[1],   ( float ) up[2] };
+
+    projectCorners( &mCornerX[0], &mCornerY[0], &mCornerZ[0], noCorners, rot,
+                    cam.focalX, cam.focalY, cam.principalX, cam.principalY,
+                    &mU[0], &mV[0], &mDepth[0] );
+
+    const float* pu = &mU[0];
+    const float* pv = &mV[0];
+    const float* pd = &mDepth[0];
+
+    // boxes, frustum and size filters
+    const float width  = cam.width;
+    const float height = cam.height;
+
+    for ( size_t s = 0; s < accepted.size(); s++ )
+    {
+        const RDB_TRAFFIC_SIGN_t & sign = *accepted[ s ];
+        size_t k = 4 * s;
+
+        float dmin = pd[k], dmax = pd[k];
+        float x1 = pu[k], x2 = pu[k], y1 = pv[k], y2 = pv[k];
+
+        for ( int c = 1; c < 4; c++ )
+        {
+            dmin = fminf( dmin, pd[k + c] );
+            dmax = fmaxf( dmax, pd[k + c] );
+            x1 = fminf( x1, pu[k + c] );
+            x2 = fmaxf( x2, pu[k + c] );
+            y1 = fminf( y1, pv[k + c] );
+            y2 = fmaxf( y2, pv[k + c] );
+        }
+
+        // the whole face must lie between the clipping planes
+        if ( ( dmin <= cam.clipNear ) || ( dmax >= cam.clipFar ) )
+            continue;
+
+        if ( mOriginBottomLeft )
+        {
+            float t = height - y2;
+            y2 = height - y1;
+            y1 = t;
+        }
+
+        // continuous extent [x1, x2) -> inclusive pixel box
+        x2 -= 1.0f;
+        y2 -= 1.0f;
+
+        if ( ( x2 < 0.0f ) || ( y2 < 0.0f ) || ( x1 > width - 1.0f ) || ( y1 > height - 1.0f ) )
+            continue;
+
+        SignLabel label;
+        label.truncated = ( x1 < 0.0f ) || ( y1 < 0.0f ) || ( x2 > width - 1.0f ) || ( y2 > height - 1.0f );
+        label.x1 = fmaxf( x1, 0.0f );
+        label.y1 = fmaxf( y1, 0.0f );
+        label.x2 = fminf( x2, width - 1.0f );
+        label.y2 = fminf( y2, height - 1.0f );
+
+        float size = fminf( label.x2 - label.x1, label.y2 - label.y1 ) + 1.0f;
+
+        if ( size < mMinSize )
+            continue;
+
+        label.id        = sign.id;
+        label.type      = sign.type;
+        label.subType   = sign.subType;
+        label.name      = classes[ s ].name;
+        label.depth     = 0.25f * ( pd[k] + pd[k + 1] + pd[k + 2] + pd[k + 3] );
+        label.difficult = ( size < mDifficultSize ) || ( ( sign.occlusion >= 0 ) && ( sign.occlusion > mDifficultOcclusion ) );
+        label.visible   = -1.0f;
+
+        labels.push_back( label );
+    }
+}
+
+void
+SignLabeler::applyDepth( const RDB_CAMERA_t & cam, const RDB_IMAGE_t & img, const unsigned char* data, std::vector<SignLabel> & labels )
+{
+    if ( labels.empty() )
+        return;
+
+    // viewport pixels -> depth image pixels; both are read back with the same row order
+    float sx = ( float ) img.width  / cam.width;
+    float sy = ( float ) img.height / cam.height;
+
+    mDepthBoxes.resize( labels.size() );
+    mVisible.resize( labels.size() );
+
+    for ( size_t i = 0; i < labels.size(); i++ )
+    {
+        DepthBox & box = mDepthBoxes[ i ];
+
+        box.x1    = ( int ) floorf( labels[i].x1 * sx );
+        box.y1    = ( int ) floorf( labels[i].y1 * sy );
+        box.x2    = ( int ) ceilf( ( labels[i].x2 + 1.0f ) * sx ) - 1;
+        box.y2    = ( int ) ceilf( ( labels[i].y2 + 1.0f ) * sy ) - 1;
+        box.depth = labels[i].depth;
+
+        box.x1 = ( box.x1 < 0 ) ? 0 : box.x1;
+        box.y1 = ( box.y1 < 0 ) ? 0 : box.y1;
+        box.x2 = ( box.x2 > img.width  - 1 ) ? img.width  - 1 : box.x2;
+        box.y2 = ( box.y2 > img.height - 1 ) ? img.height - 1 : box.y2;
+    }
+
+    if ( !mDepthOcclusion.visibleRatios( img, data, cam.clipNear, cam.clipFar, &mDepthBoxes[0], mDepthBoxes.size(), &mVisible[0] ) )
+        return;
+
+    size_t n = 0;
+
+    for ( size_t i = 0; i < labels.size(); i++ )
+    {
+        if ( mVisible[ i ] < mMinVisible )
+            continue;
+
+        labels[ i ].visible   = mVisible[ i ];
+        labels[ i ].difficult = labels[ i ].difficult || ( mVisible[ i ] < mDifficultVisible );
+
+        if ( n != i )
+            labels[ n ] = labels[ i ];
+
+        n++;
+    }
+
+    labels.resize( n );
+}
+
+void
+SignLabeler::handleLabels( const unsigned int & simFrame, const RDB_IMAGE_t & img, const std::vector<SignLabel> & labels )
+{
+    mNoImages++;
+    mNoLabels += labels.size();
+
+    if ( mOutDir.empty() )
+        return;
+
+    // the prefix is given by the user and may be of any length
+    char number[16];
+    snprintf( number, sizeof( number ), "%06u", img.id );
+
+    std::string imageName = mPrefix + number;
+
+    std::string filename = mOutDir + "/Annotations/" + imageName + ".xml";
+    FILE* fp = fopen( filename.c_str(), "w" );
+
+    if ( !fp )
+    {
+        perror( "SignLabeler::handleLabels: fopen()" );
+        return;
+    }
+
+    fprintf( fp, "<annotation>\n" );
+    fprintf( fp, "    <filename>%s.ppm</filename>\n", imageName.c_str() );
+    fprintf( fp, "    <source>\n        <database>VTD</database>\n        <frame>%u</frame>\n    </source>\n", simFrame );
+    fprintf( fp, "    <size>\n        <width>%d</width>\n        <height>%d</height>\n        <depth>3</depth>\n    </size>\n",
+                 img.width, img.height );
+    fprintf( fp, "    <segmented>0</segmented>\n" );
+
+    for ( size_t i = 0; i < labels.size(); i++ )
+    {
+        const SignLabel & label = labels[ i ];
+
+        // VOC boxes are 1-based
+        fprintf( fp, "    <object>\n" );
+        fprintf( fp, "        <name>%s</name>\n", label.name.c_str() );
+        fprintf( fp, "        <pose>Unspecified</pose>\n" );
+        fprintf( fp, "        <truncated>%d</truncated>\n", label.truncated ? 1 : 0 );
+        fprintf( fp, "        <difficult>%d</difficult>\n", label.difficult ? 1 : 0 );
+        fprintf( fp, "        <bndbox>\n" );
+        fprintf( fp, "            <xmin>%d</xmin>\n", ( int ) floorf( label.x1 + 0.5f ) + 1 );
+        fprintf( fp, "            <ymin>%d</ymin>\n", ( int ) floorf( label.y1 + 0.5f ) + 1 );
+        fprintf( fp, "            <xmax>%d</xmax>\n", ( int ) floorf( label.x2 + 0.5f ) + 1 );
+        fprintf( fp, "            <ymax>%d</ymax>\n", ( int ) floorf( label.y2 + 0.5f ) + 1 );
+        fprintf( fp, "        </bndbox>\n" );
+        fprintf( fp, "    </object>\n" );
+    }
+
+    fprintf( fp, "</annotation>\n" );
+    fclose( fp );
+
+    if ( mImageSetFile )
+    {
+        fprintf( mImageSetFile, "%s\n", imageName.c_str() );
+        fflush( mImageSetFile );
+    }
+}
+
+void
+SignLabeler::parseMessageEntryInfo( const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem )
+{
+    // other packages are of no interest
+}
+
+void
+SignLabeler::parseStartOfFrame( const double & simTime, const unsigned int & simFrame )
+{
+    mCameras.clear();
+    mSigns.clear();
+    mSignIndex.clear();
+    mImages.clear();
+    mDepthImages.clear();
+}
+
+void
+SignLabeler::parseEndOfFrame( const double & simTime, const unsigned int & simFrame )
+{
+    std::vector<SignLabel> labels;
+
+    for ( size_t i = 0; i < mImages.size(); i++ )
+    {
+        const RDB_IMAGE_t & img = mImages[ i ];
+        const RDB_CAMERA_t* cam = 0;
+
+        // the image's camera; an uninitialized camera id takes the first one
+        for ( size_t c = 0; c < mCameras.size() && !cam; c++ )
+            if ( !img.cameraId || ( mCameras[ c ].id == img.cameraId ) )
+                cam = &mCameras[ c ];
+
+        if ( !cam )
+        {
+            fprintf( stderr, "SignLabeler::parseEndOfFrame: simFrame = %d: no camera for image %d\n", simFrame, img.id );
+            continue;
+        }
+
+        project( *cam, mSigns.empty() ? 0 : &mSigns[0], mSigns.size(), labels );
+
+        // the depth image of the same camera tells which signs are hidden
+        for ( size_t d = 0; d < mDepthImages.size(); d++ )
+        {
+            if ( mDepthImages[ d ].cameraId == img.cameraId )
+            {
+                applyDepth( *cam, mDepthImages[ d ], &mDepthData[ d ][0], labels );
+                break;
+            }
+        }
+
+        // the image may be a scaled copy of the viewport
+        if ( ( cam->width != img.width ) || ( cam->height != img.height ) )
+        {
+            float sx = ( float ) img.width  / cam->width;
+            float sy = ( float ) img.height / cam->height;
+
+            for ( size_t k = 0; k < labels.size(); k++ )
+            {
+                labels[k].x1 = labels[k].x1 * sx;
+                labels[k].y1 = labels[k].y1 * sy;
+                labels[k].x2 = ( labels[k].x2 + 1.0f ) * sx - 1.0f;
+                labels[k].y2 = ( labels[k].y2 + 1.0f ) * sy - 1.0f;
+            }
+        }
+
+        handleLabels( simFrame, img, labels );
+    }
+
+    mImages.clear();
+    mDepthImages.clear();
+}
+
+void
+SignLabeler::parseEntry( RDB_CAMERA_t *data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem )
+{
+    mCameras.push_back( *data );
+}
+
+void
+SignLabeler::parseEntry( RDB_TRAFFIC_SIGN_t *data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem )
+{
+    // a sign may be reported once per player that sees it
+    if ( !mSignIndex.insert( std::make_pair( data->id, mSigns.size() ) ).second )
+        return;
+
+    mSigns.push_back( *data );
+}
+
+void
+SignLabeler::parseEntry( RDB_IMAGE_t *data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem )
+{
+    if ( data->id <= 0 )
+        return;
+
+    if ( !DepthOcclusion::isDepthFormat( *data ) )
+    {
+        mImages.push_back( *data );
+        return;
+    }
+
+    if ( !data->imgSize )
+        return;
+
+    // the pixels follow the image package and are gone once the message is parsed
+    const unsigned char* pixels = ( const unsigned char* ) ( data + 1 );
+
+    if ( mDepthData.size() <= mDepthImages.size() )
+        mDepthData.resize( mDepthImages.size() + 1 );
+
+    mDepthData[ mDepthImages.size() ].assign( pixels, pixels + data->imgSize );
+    mDepthImages.push_back( *data );
+}
+
+} // namespace Framework
@@ -0,0 +1,219 @@
+/* ===================================================
+ *  file:       SignLabeler.hh
+ * ---------------------------------------------------
+ *  purpose:	turn the traffic signs of an RDB stream
+ *              into 2D image labels (VOC annotations)
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_SIGN_LABELER_HH
+#define _FRAMEWORK_SIGN_LABELER_HH
+
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RDBHandler.hh"
+#include "DepthOcclusion.hh"
+
+namespace Framework
+{
+/**
+* size and label of one OpenDRIVE sign type
+*/
+struct SignClass
+{
+    std::string name;       // label name, e.g. the GTSRB class "00014"
+    float       width;      // width of the sign face [m]
+    float       height;     // height of the sign face [m]
+    float       zOffset;    // height of the face center above the sign position [m]
+};
+
+/**
+* one projected sign
+*/
+struct SignLabel
+{
+    uint32_t    id;             // RDB id of the sign
+    int32_t     type;           // OpenDRIVE type / subType
+    int32_t     subType;
+    std::string name;           // label name
+    float       x1, y1, x2, y2; // pixel box (0-based, inclusive), clipped to the image
+    float       depth;          // distance of the face center along the camera axis [m]
+    bool        truncated;      // box was clipped at the image border
+    bool        difficult;      // small or partly occluded
+    float       visible;        // visible pixel ratio from the depth buffer, -1 if there was none
+};
+
+class SignLabeler : public RDBHandler
+{
+    public:
+        /**
+        * constructor
+        */
+        explicit SignLabeler();
+
+        /**
+        * Destroy the class.
+        */
+        virtual ~SignLabeler();
+
+        /**
+        * read the sign classes from a text file, one "type subType name [width height [zOffset]]" per line;
+        * once a table is loaded, signs without an entry are not labelled
+        * @param filename   name of the table
+        * @return number of classes read, -1 if the file could not be opened
+        */
+        int loadClasses( const char* filename );
+
+        /**
+        * add or replace one sign class
+        */
+        void setClass( int32_t type, int32_t subType, const SignClass & cls );
+
+        /**
+        * set the default size of signs that have no size of their own
+        */
+        void setDefaultSize( float width, float height, float zOffset = 0.0f );
+
+        /**
+        * filter settings; readability / occlusion are in RDB units (0..127), -1 (not valid) always passes
+        * @param minReadability     signs that are less readable are dropped
+        * @param maxOcclusion       signs that are more occluded are dropped
+        * @param difficultOcclusion signs that are more occluded are labelled difficult
+        * @param minSize            boxes with a smaller side [viewport pixel] are dropped
+        * @param difficultSize      boxes with a smaller side [viewport pixel] are labelled difficult
+        */
+        void setFilter( int minReadability, int maxOcclusion, int difficultOcclusion, float minSize, float difficultSize );
+
+        /**
+        * filter settings for frames that come with a depth image of the camera;
+        * ratios are visible box pixels / box pixels
+        * @param minVisible         signs with a smaller ratio are dropped
+        * @param difficultVisible   signs with a smaller ratio are labelled difficult
+        * @param tolerance          distance an occluder must be in front of the sign [m]
+        * @param noThreads          worker threads of the depth compare, 0 uses one per core
+        */
+        void setDepthFilter( float minVisible, float difficultVisible, float tolerance = 0.5f, unsigned int noThreads = 0 );
+
+        /**
+        * pixel rows count from the bottom of the image (OpenGL read-back) instead of the top
+        */
+        void setOriginBottomLeft( bool bottomLeft );
+
+        /**
+        * write a VOC annotation per labelled image to <dir>/Annotations and append
+        * the image names to <dir>/ImageSets/Main/<imageSet>.txt; 0 disables writing
+        * @param dir        output directory (must contain the two sub-directories)
+        * @param imageSet   name of the image set file
+        * @param prefix     prefix of the image names, the image id follows
+        */
+        void setOutput( const char* dir, const char* imageSet = "train", const char* prefix = "sim_" );
+
+        /**
+        * project signs into the image of a camera
+        * @param cam        camera of the image
+        * @param signs      signs to project
+        * @param noSigns    number of signs
+        * @param labels     receives the labels of all visible signs that pass the filters
+        */
+        void project( const RDB_CAMERA_t & cam, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns,
+                      std::vector<SignLabel> & labels );
+
+        /**
+        * get the number of images labelled so far
+        */
+        unsigned int getNoImages() const;
+
+        /**
+        * get the number of labels written so far
+        */
+        unsigned int getNoLabels() const;
+
+    protected:
+        /**
+        * called once per image at the end of its frame; writes the VOC annotation
+        * @param simFrame   simulation frame
+        * @param img        image information
+        * @param labels     labels of the image
+        */
+        virtual void handleLabels( const unsigned int & simFrame, const RDB_IMAGE_t & img, const std::vector<SignLabel> & labels );
+
+        /**
+        * collect the packages of a frame, label at its end
+        */
+        virtual void parseMessageEntryInfo( const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem );
+        virtual void parseStartOfFrame( const double & simTime, const unsigned int & simFrame );
+        virtual void parseEndOfFrame(   const double & simTime, const unsigned int & simFrame );
+        virtual void parseEntry( RDB_CAMERA_t *       data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem );
+        virtual void parseEntry( RDB_TRAFFIC_SIGN_t * data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem );
+        virtual void parseEntry( RDB_IMAGE_t *        data, const double & simTime, const unsigned int & simFrame, const unsigned short & pkgId, const unsigned short & flags, const unsigned int & elemId, const unsigned int & totalElem );
+
+    private:
+        /**
+        * measure the visible part of the labels in a depth image, drop or tag the occluded ones
+        * @param cam        camera of the image (labels are in its viewport pixels)
+        * @param img        depth image information
+        * @param data       pixels of the depth image
+        * @param labels     labels to check
+        */
+        void applyDepth( const RDB_CAMERA_t & cam, const RDB_IMAGE_t & img, const unsigned char* data, std::vector<SignLabel> & labels );
+
+        /**
+        * look up the class of a sign; 0 if the sign is not to be labelled
+        */
+        const SignClass* getClass( const RDB_TRAFFIC_SIGN_t & sign, SignClass & scratch ) const;
+
+        /**
+        * sign classes by ( type, subType )
+        */
+        std::map< std::pair<int32_t, int32_t>, SignClass > mClasses;
+        SignClass mDefaultClass;
+
+        /**
+        * filter settings
+        */
+        int   mMinReadability;
+        int   mMaxOcclusion;
+        int   mDifficultOcclusion;
+        float mMinSize;
+        float mDifficultSize;
+        float mMinVisible;
+        float mDifficultVisible;
+        bool  mOriginBottomLeft;
+
+        /**
+        * packages of the current frame
+        */
+        std::vector<RDB_CAMERA_t>       mCameras;
+        std::vector<RDB_TRAFFIC_SIGN_t> mSigns;
+        std::unordered_map<uint32_t, size_t> mSignIndex;        // sign id -> element of mSigns
+        std::vector<RDB_IMAGE_t>        mImages;
+        std::vector<RDB_IMAGE_t>        mDepthImages;
+        std::vector< std::vector<unsigned char> > mDepthData;   // pixels of the depth images, buffers are kept
+
+        /**
+        * depth compare
+        */
+        DepthOcclusion           mDepthOcclusion;
+        std::vector<DepthBox>    mDepthBoxes;
+        std::vector<float>       mVisible;
+
+        /**
+        * corner scratch (structure of arrays, 4 corners per sign)
+        */
+        std::vector<float> mCornerX, mCornerY, mCornerZ, mU, mV, mDepth;
+
+        /**
+        * output
+        */
+        std::string  mOutDir;
+        std::string  mImageSet;
+        std::string  mPrefix;
+        FILE*        mImageSetFile;
+        unsigned int mNoImages;
+        unsigned int mNoLabels;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_SIGN_LABELER_HH */
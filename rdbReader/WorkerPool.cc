@@ -0,0 +1,131 @@
+/* ===================================================
+ *  file:       WorkerPool.cc
+ * ---------------------------------------------------
+ *  purpose:	threads that are started once and run
+ *              the parallel part of each frame
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include "WorkerPool.hh"
+
+namespace Framework
+{
+
+WorkerPool::WorkerPool() : mJob( 0 ),
+                           mJobThreads( 0 ),
+                           mGeneration( 0 ),
+                           mPending( 0 ),
+                           mStop( false )
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void
+WorkerPool::start( unsigned int noThreads )
+{
+    stop();
+
+    if ( !noThreads )
+        noThreads = std::thread::hardware_concurrency();
+
+    mStop = false;
+
+    for ( unsigned int i = 1; i < noThreads; i++ )
+        mWorkers.push_back( std::thread( &WorkerPool::work, this, i ) );
+}
+
+void
+WorkerPool::stop()
+{
+    if ( mWorkers.empty() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mStop = true;
+    }
+
+    mStartCond.notify_all();
+
+    for ( size_t i = 0; i < mWorkers.size(); i++ )
+        mWorkers[ i ].join();
+
+    mWorkers.clear();
+}
+
+unsigned int
+WorkerPool::getNoThreads() const
+{
+    return mWorkers.size() + 1;
+}
+
+void
+WorkerPool::run( unsigned int noThreads, const Job & job )
+{
+    if ( noThreads > getNoThreads() )
+        noThreads = getNoThreads();
+
+    if ( noThreads <= 1 )
+    {
+        job( 0 );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+
+        mJob        = &job;
+        mJobThreads = noThreads - 1;
+        mPending    = noThreads - 1;
+        mGeneration++;
+    }
+
+    mStartCond.notify_all();
+
+    job( 0 );
+
+    std::unique_lock<std::mutex> lock( mMutex );
+
+    while ( mPending )
+        mDoneCond.wait( lock );
+
+    mJob = 0;
+}
+
+void
+WorkerPool::work( unsigned int index )
+{
+    unsigned int generation = 0;
+
+    std::unique_lock<std::mutex> lock( mMutex );
+
+    while ( true )
+    {
+        while ( !mStop && ( mGeneration == generation ) )
+            mStartCond.wait( lock );
+
+        if ( mStop )
+            return;
+
+        generation = mGeneration;
+
+        // workers beyond the threads the job asked for sit it out
+        if ( index > mJobThreads )
+            continue;
+
+        const Job* job = mJob;
+
+        lock.unlock();
+        ( *job )( index );
+        lock.lock();
+
+        if ( !--mPending )
+            mDoneCond.notify_one();
+    }
+}
+
+} // namespace Framework
@@ -0,0 +1,91 @@
+/* ===================================================
+ *  file:       WorkerPool.hh
+ * ---------------------------------------------------
+ *  purpose:	threads that are started once and run
+ *              the parallel part of each frame
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_WORKER_POOL_HH
+#define _FRAMEWORK_WORKER_POOL_HH
+
+/* ====== INCLUSIONS ====== */
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Framework
+{
+/**
+* A fixed set of worker threads that wait for jobs. Starting a thread per
+* frame costs its creation and, with mlockall( MCL_FUTURE ), faulting in
+* and locking a fresh stack every time; the pool pays this once. Start it
+* before RealTime::apply(), so the stacks are part of what gets locked.
+*
+* run() executes a job on the calling thread and on some of the workers and
+* returns when all of them are done. One job at a time; run() is not meant
+* to be called from several threads at once.
+*/
+class WorkerPool
+{
+    public:
+        /**
+        * job of one thread
+        * @param index  0 for the calling thread, 1.. for the workers
+        */
+        typedef std::function<void( unsigned int index )> Job;
+
+    public:
+        /**
+        * constructor; no threads are started yet
+        */
+        explicit WorkerPool();
+
+        /**
+        * Destroy the class, stopping the workers.
+        */
+        virtual ~WorkerPool();
+
+        /**
+        * start the workers, replacing those already running
+        * @param noThreads  threads taking part in a job including the caller,
+        *                   0: one per core
+        */
+        void start( unsigned int noThreads );
+
+        /**
+        * stop and join the workers
+        */
+        void stop();
+
+        /**
+        * threads that can take part in a job including the caller; 1 before start()
+        */
+        unsigned int getNoThreads() const;
+
+        /**
+        * run a job on noThreads threads including the caller (at most getNoThreads())
+        */
+        void run( unsigned int noThreads, const Job & job );
+
+    private:
+        /**
+        * loop of a worker
+        */
+        void work( unsigned int index );
+
+    private:
+        std::vector<std::thread> mWorkers;
+        std::mutex               mMutex;
+        std::condition_variable  mStartCond;     // a job or the stop request is there
+        std::condition_variable  mDoneCond;      // the last worker of a job finished
+
+        const Job*               mJob;
+        unsigned int             mJobThreads;    // workers taking part in mJob
+        unsigned int             mGeneration;    // counts the jobs, so each is taken once
+        unsigned int             mPending;       // workers still running mJob
+        bool                     mStop;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_WORKER_POOL_HH */
@@ -0,0 +1,520 @@
+/* ===================================================
+ *  file:       WorldIndex.cc
+ * ---------------------------------------------------
+ *  purpose:	spatial index of the traffic signs and
+ *              objects of an RDB stream
+ * ===================================================
+ */
+/* ====== INCLUSIONS ====== */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "WorldIndex.hh"
+
+namespace Framework
+{
+
+/**
+* axes of the frame rotated by heading, pitch and roll (R = Rz(h) * Ry(p) * Rx(r)),
+* i.e. the columns of R: forward, left and up
+*/
+static void
+hprAxes( double h, double p, double r, double fwd[3], double left[3], double up[3] )
+{
+    double ch = cos( h ), sh = sin( h );
+    double cp = cos( p ), sp = sin( p );
+    double cr = cos( r ), sr = sin( r );
+
+    fwd[0]  = ch * cp;                  fwd[1]  = sh * cp;                  fwd[2]  = -sp;
+    left[0] = ch * sp * sr - sh * cr;   left[1] = sh * sp * sr + ch * cr;   left[2] = cp * sr;
+    up[0]   = ch * sp * cr + sh * sr;   up[1]   = sh * sp * cr - ch * sr;   up[2]   = cp * cr;
+}
+
+WorldIndex::WorldIndex( double cellSize, unsigned int noBuckets ) : mCellSize( cellSize > 0.0 ? cellSize : 50.0 ),
+                                                                    mSignRadius( 1.0f ),
+                                                                    mMaxRadius( 0.0f ),
+                                                                    mNoEntries( 0 ),
+                                                                    mBucketMask( 0 )
+{
+    mInvCellSize = 1.0 / mCellSize;
+
+    unsigned int n = 1;
+
+    while ( n < noBuckets )
+        n <<= 1;
+
+    mBuckets.resize( n );
+    mBucketMask = n - 1;
+
+    memset( &mStatistics, 0, sizeof( mStatistics ) );
+}
+
+WorldIndex::~WorldIndex()
+{
+}
+
+void
+WorldIndex::setSignRadius( float radius )
+{
+    mSignRadius = radius;
+}
+
+void
+WorldIndex::clear()
+{
+    mEntries.clear();
+    mFree.clear();
+    mIds.clear();
+    mObjects.clear();
+    mNoEntries = 0;
+    mMaxRadius = 0.0f;
+
+    for ( size_t i = 0; i < mBuckets.size(); i++ )
+        mBuckets[ i ].clear();
+}
+
+uint64_t
+WorldIndex::keyOf( unsigned int kind, uint32_t id )
+{
+    return ( ( uint64_t ) kind << 32 ) | id;
+}
+
+int
+WorldIndex::cellOf( double v ) const
+{
+    return ( int ) floor( v * mInvCellSize );
+}
+
+unsigned int
+WorldIndex::bucketOf( int cx, int cy ) const
+{
+    // spatial hash with two large primes
+    return ( ( ( unsigned int ) cx * 73856093u ) ^ ( ( unsigned int ) cy * 19349663u ) ) & mBucketMask;
+}
+
+void
+WorldIndex::link( unsigned int e )
+{
+    Entry & entry = mEntries[ e ];
+    std::vector<unsigned int> & bucket = mBuckets[ entry.bucket ];
+
+    entry.slot = bucket.size();
+    bucket.push_back( e );
+}
+
+void
+WorldIndex::unlink( unsigned int e )
+{
+    Entry & entry = mEntries[ e ];
+    std::vector<unsigned int> & bucket = mBuckets[ entry.bucket ];
+
+    // the last one of the bucket takes the place
+    unsigned int last = bucket.back();
+
+    bucket[ entry.slot ] = last;
+    mEntries[ last ].slot = entry.slot;
+    bucket.pop_back();
+}
+
+void
+WorldIndex::rehash( unsigned int noBuckets )
+{
+    mBuckets.clear();
+    mBuckets.resize( noBuckets );
+    mBucketMask = noBuckets - 1;
+
+    for ( unsigned int e = 0; e < mEntries.size(); e++ )
+    {
+        if ( !mEntries[ e ].used )
+            continue;
+
+        mEntries[ e ].bucket = bucketOf( mEntries[ e ].cx, mEntries[ e ].cy );
+        link( e );
+    }
+}
+
+void
+WorldIndex::place( unsigned int kind, uint32_t id, double x, double y, double z, float radius,
+                   unsigned int frameNo, unsigned int index )
+{
+    int cx = cellOf( x );
+    int cy = cellOf( y );
+
+    std::unordered_map<uint64_t, unsigned int>::iterator it = mIds.find( keyOf( kind, id ) );
+    unsigned int e;
+
+    if ( it != mIds.end() )
+    {
+        e = it->second;
+
+        // moved to another cell?
+        if ( ( mEntries[ e ].cx != cx ) || ( mEntries[ e ].cy != cy ) )
+        {
+            unlink( e );
+
+            mEntries[ e ].cx     = cx;
+            mEntries[ e ].cy     = cy;
+            mEntries[ e ].bucket = bucketOf( cx, cy );
+            link( e );
+        }
+    }
+    else
+    {
+        if ( !mFree.empty() )
+        {
+            e = mFree.back();
+            mFree.pop_back();
+        }
+        else
+        {
+            e = mEntries.size();
+            mEntries.push_back( Entry() );
+        }
+
+        mIds[ keyOf( kind, id ) ] = e;
+        mNoEntries++;
+
+        mEntries[ e ].id     = id;
+        mEntries[ e ].kind   = kind;
+        mEntries[ e ].cx     = cx;
+        mEntries[ e ].cy     = cy;
+        mEntries[ e ].bucket = bucketOf( cx, cy );
+        mEntries[ e ].used   = true;
+        link( e );
+
+        if ( kind == KIND_OBJECT )
+        {
+            mEntries[ e ].objectSlot = mObjects.size();
+            mObjects.push_back( e );
+        }
+
+        // keep the buckets short
+        if ( mNoEntries > 4 * mBuckets.size() )
+            rehash( 2 * mBuckets.size() );
+    }
+
+    Entry & entry = mEntries[ e ];
+
+    entry.x       = x;
+    entry.y       = y;
+    entry.z       = z;
+    entry.radius  = radius;
+    entry.frameNo = frameNo;
+    entry.index   = index;
+
+    if ( radius > mMaxRadius )
+        mMaxRadius = radius;
+}
+
+void
+WorldIndex::addSigns( unsigned int frameNo, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns )
+{
+    for ( unsigned int i = 0; signs && i < noSigns; i++ )
+    {
+        std::unordered_map<uint64_t, unsigned int>::iterator it = mIds.find( keyOf( KIND_SIGN, signs[i].id ) );
+
+        // static, only the frame it was last seen in changes
+        if ( it != mIds.end() )
+        {
+            mEntries[ it->second ].frameNo = frameNo;
+            mEntries[ it->second ].index   = i;
+            continue;
+        }
+
+        place( KIND_SIGN, signs[i].id, signs[i].pos.x, signs[i].pos.y, signs[i].pos.z, mSignRadius, frameNo, i );
+    }
+}
+
+void
+WorldIndex::addObjects( unsigned int frameNo, const void* objs, unsigned int noObjs, unsigned int elementSize )
+{
+    if ( !objs || ( elementSize < sizeof( RDB_OBJECT_STATE_BASE_t ) ) )
+        return;
+
+    for ( unsigned int i = 0; i < noObjs; i++ )
+    {
+        const RDB_OBJECT_STATE_BASE_t* obj = ( const RDB_OBJECT_STATE_BASE_t* ) ( ( const char* ) objs + i * elementSize );
+
+        double fwd[3], left[3], up[3];
+        hprAxes( obj->pos.h, obj->pos.p, obj->pos.r, fwd, left, up );
+
+        // center of the geometry, the reference point is usually not
+        const RDB_GEOMETRY_t & geo = obj->geo;
+        double x = obj->pos.x + geo.offX * fwd[0] + geo.offY * left[0] + geo.offZ * up[0];
+        double y = obj->pos.y + geo.offX * fwd[1] + geo.offY * left[1] + geo.offZ * up[1];
+        double z = obj->pos.z + geo.offX * fwd[2] + geo.offY * left[2] + geo.offZ * up[2];
+
+        float radius = 0.5f * sqrtf( geo.dimX * geo.dimX + geo.dimY * geo.dimY + geo.dimZ * geo.dimZ );
+
+        place( KIND_OBJECT, obj->id, x, y, z, radius, frameNo, i );
+    }
+}
+
+bool
+WorldIndex::remove( unsigned int kind, uint32_t id )
+{
+    std::unordered_map<uint64_t, unsigned int>::iterator it = mIds.find( keyOf( kind, id ) );
+
+    if ( it == mIds.end() )
+        return false;
+
+    unsigned int e = it->second;
+
+    unlink( e );
+
+    if ( kind == KIND_OBJECT )
+    {
+        unsigned int last = mObjects.back();
+
+        mObjects[ mEntries[ e ].objectSlot ] = last;
+        mEntries[ last ].objectSlot = mEntries[ e ].objectSlot;
+        mObjects.pop_back();
+    }
+
+    mEntries[ e ].used = false;
+    mFree.push_back( e );
+    mIds.erase( it );
+    mNoEntries--;
+
+    return true;
+}
+
+unsigned int
+WorldIndex::removeStale( unsigned int frameNo, unsigned int maxAge )
+{
+    unsigned int noRemoved = 0;
+
+    // backwards, a removed object takes the last one of the list
+    for ( size_t i = mObjects.size(); i-- > 0; )
+    {
+        const Entry & entry = mEntries[ mObjects[ i ] ];
+
+        if ( frameNo - entry.frameNo <= maxAge )
+            continue;
+
+        if ( remove( entry.kind, entry.id ) )
+            noRemoved++;
+    }
+
+    return noRemoved;
+}
+
+unsigned int
+WorldIndex::queryRadius( double x, double y, double z, double radius, unsigned int kinds,
+                         std::vector<const Entry*> & found ) const
+{
+    found.clear();
+    mStatistics.queries++;
+
+    int    cx1 = cellOf( x - radius ), cx2 = cellOf( x + radius );
+    int    cy1 = cellOf( y - radius ), cy2 = cellOf( y + radius );
+    double r2  = radius * radius;
+
+    for ( int cy = cy1; cy <= cy2; cy++ )
+    {
+        for ( int cx = cx1; cx <= cx2; cx++ )
+        {
+            const std::vector<unsigned int> & bucket = mBuckets[ bucketOf( cx, cy ) ];
+
+            mStatistics.cells++;
+            mStatistics.tested += bucket.size();
+
+            for ( size_t i = 0; i < bucket.size(); i++ )
+            {
+                const Entry & e = mEntries[ bucket[i] ];
+
+                // other cells may share the bucket
+                if ( ( e.cx != cx ) || ( e.cy != cy ) || !( e.kind & kinds ) )
+                    continue;
+
+                double dx = e.x - x, dy = e.y - y, dz = e.z - z;
+
+                if ( dx * dx + dy * dy + dz * dz <= r2 )
+                    found.push_back( &e );
+            }
+        }
+    }
+
+    mStatistics.found += found.size();
+
+    return found.size();
+}
+
+unsigned int
+WorldIndex::scanRadius( double x, double y, double z, double radius, unsigned int kinds,
+                        std::vector<const Entry*> & found ) const
+{
+    found.clear();
+
+    double r2 = radius * radius;
+
+    for ( size_t i = 0; i < mEntries.size(); i++ )
+    {
+        const Entry & e = mEntries[ i ];
+
+        if ( !e.used || !( e.kind & kinds ) )
+            continue;
+
+        double dx = e.x - x, dy = e.y - y, dz = e.z - z;
+
+        if ( dx * dx + dy * dy + dz * dz <= r2 )
+            found.push_back( &e );
+    }
+
+    return found.size();
+}
+
+void
+WorldIndex::setupFrustum( const RDB_CAMERA_t & cam, double maxDistance, Frustum & f ) const
+{
+    double left[3], up[3];
+    hprAxes( cam.pos.h, cam.pos.p, cam.pos.r, f.fwd, left, up );
+
+    f.pos[0] = cam.pos.x;
+    f.pos[1] = cam.pos.y;
+    f.pos[2] = cam.pos.z;
+    f.near   = cam.clipNear;
+    f.far    = ( maxDistance > 0.0 && maxDistance < cam.clipFar ) ? maxDistance : cam.clipFar;
+
+    // image borders as slopes ( left / forward, up / forward ), cf. the projection
+    // u = px - fx * left / forward, v = py - fy * up / forward
+    double sLeft   = cam.principalX / cam.focalX;
+    double sRight  = ( cam.principalX - cam.width ) / cam.focalX;
+    double sTop    = cam.principalY / cam.focalY;
+    double sBottom = ( cam.principalY - cam.height ) / cam.focalY;
+
+    // inward normals in ( forward, left, up ): left - sRight * forward >= 0 etc.
+    double n[4][3] = { {  sLeft,   -1.0,  0.0 },
+                       { -sRight,   1.0,  0.0 },
+                       {  sTop,     0.0, -1.0 },
+                       { -sBottom,  0.0,  1.0 } };
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        double len = sqrt( n[i][0] * n[i][0] + n[i][1] * n[i][1] + n[i][2] * n[i][2] );
+
+        for ( int k = 0; k < 3; k++ )
+            f.normal[i][k] = ( n[i][0] * f.fwd[k] + n[i][1] * left[k] + n[i][2] * up[k] ) / len;
+    }
+
+    // cells covered by the corners of the near and far rectangles
+    double xMin = f.pos[0], xMax = f.pos[0], yMin = f.pos[1], yMax = f.pos[1];
+
+    for ( int c = 0; c < 8; c++ )
+    {
+        double d  = ( c & 4 ) ? f.far : f.near;
+        double sl = ( c & 1 ) ? sLeft : sRight;
+        double su = ( c & 2 ) ? sTop  : sBottom;
+
+        double x = f.pos[0] + d * ( f.fwd[0] + sl * left[0] + su * up[0] );
+        double y = f.pos[1] + d * ( f.fwd[1] + sl * left[1] + su * up[1] );
+
+        xMin = ( x < xMin ) ? x : xMin;
+        xMax = ( x > xMax ) ? x : xMax;
+        yMin = ( y < yMin ) ? y : yMin;
+        yMax = ( y > yMax ) ? y : yMax;
+    }
+
+    // entries live in the cell of their center, their spheres reach further
+    f.cx1 = cellOf( xMin - mMaxRadius );
+    f.cx2 = cellOf( xMax + mMaxRadius );
+    f.cy1 = cellOf( yMin - mMaxRadius );
+    f.cy2 = cellOf( yMax + mMaxRadius );
+}
+
+bool
+WorldIndex::inFrustum( const Frustum & f, const Entry & e ) const
+{
+    double d[3] = { e.x - f.pos[0], e.y - f.pos[1], e.z - f.pos[2] };
+    double r    = e.radius;
+
+    double depth = f.fwd[0] * d[0] + f.fwd[1] * d[1] + f.fwd[2] * d[2];
+
+    if ( ( depth < f.near - r ) || ( depth > f.far + r ) )
+        return false;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        if ( f.normal[i][0] * d[0] + f.normal[i][1] * d[1] + f.normal[i][2] * d[2] < -r )
+            return false;
+    }
+
+    return true;
+}
+
+unsigned int
+WorldIndex::queryFrustum( const RDB_CAMERA_t & cam, double maxDistance, unsigned int kinds,
+                          std::vector<const Entry*> & found ) const
+{
+    found.clear();
+    mStatistics.queries++;
+
+    Frustum f;
+    setupFrustum( cam, maxDistance, f );
+
+    for ( int cy = f.cy1; cy <= f.cy2; cy++ )
+    {
+        for ( int cx = f.cx1; cx <= f.cx2; cx++ )
+        {
+            const std::vector<unsigned int> & bucket = mBuckets[ bucketOf( cx, cy ) ];
+
+            mStatistics.cells++;
+            mStatistics.tested += bucket.size();
+
+            for ( size_t i = 0; i < bucket.size(); i++ )
+            {
+                const Entry & e = mEntries[ bucket[i] ];
+
+                if ( ( e.cx != cx ) || ( e.cy != cy ) || !( e.kind & kinds ) )
+                    continue;
+
+                if ( inFrustum( f, e ) )
+                    found.push_back( &e );
+            }
+        }
+    }
+
+    mStatistics.found += found.size();
+
+    return found.size();
+}
+
+unsigned int
+WorldIndex::scanFrustum( const RDB_CAMERA_t & cam, double maxDistance, unsigned int kinds,
+                         std::vector<const Entry*> & found ) const
+{
+    found.clear();
+
+    Frustum f;
+    setupFrustum( cam, maxDistance, f );
+
+    for ( size_t i = 0; i < mEntries.size(); i++ )
+    {
+        const Entry & e = mEntries[ i ];
+
+        if ( e.used && ( e.kind & kinds ) && inFrustum( f, e ) )
+            found.push_back( &e );
+    }
+
+    return found.size();
+}
+
+const WorldIndex::Statistics &
+WorldIndex::getStatistics() const
+{
+    return mStatistics;
+}
+
+void
+WorldIndex::printStatistics( const char* caller ) const
+{
+    const Statistics & s = mStatistics;
+
+    fprintf( stderr, "%s: %u entries in %u buckets (cell size %.1lf m), %u queries: %.1lf cells, %.1lf tested, %.1lf found per query\n",
+                     caller, mNoEntries, ( unsigned int ) mBuckets.size(), mCellSize, s.queries,
+                     s.queries ? ( double ) s.cells / s.queries : 0.0,
+                     s.queries ? ( double ) s.tested / s.queries : 0.0,
+                     s.queries ? ( double ) s.found / s.queries : 0.0 );
+}
+
+} // namespace Framework
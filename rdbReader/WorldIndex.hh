@@ -0,0 +1,207 @@
+/* ===================================================
+ *  file:       WorldIndex.hh
+ * ---------------------------------------------------
+ *  purpose:	spatial index of the traffic signs and
+ *              objects of an RDB stream
+ * ===================================================
+ */
+#ifndef _FRAMEWORK_WORLD_INDEX_HH
+#define _FRAMEWORK_WORLD_INDEX_HH
+
+/* ====== INCLUSIONS ====== */
+#include <unordered_map>
+#include <vector>
+#include "viRDBIcd.h"
+
+namespace Framework
+{
+/**
+* Uniform grid over the x/y plane of the inertial system, hashed into a
+* power-of-two table of buckets, so the world needs no bounds and memory
+* grows with the number of entries only. Each entry is a bounding sphere
+* stored in the cell of its center.
+*
+* The index is kept up to date from the packages of each frame: signs are
+* static, a sign id that is already known is not looked at again; objects
+* are moved, an object that stays in its cell costs a position update only.
+* Objects that are no longer reported are removed with removeStale().
+*
+* Queries visit the cells overlapping the query region and test only their
+* entries, so the cost depends on the size of the region, not the world.
+*/
+class WorldIndex
+{
+    public:
+        enum Kind
+        {
+            KIND_SIGN   = 0x1,      // RDB_TRAFFIC_SIGN_t, static
+            KIND_OBJECT = 0x2,      // RDB_OBJECT_STATE_t, moving
+            KIND_ALL    = 0x3
+        };
+
+        /**
+        * one indexed sign or object
+        */
+        struct Entry
+        {
+            uint32_t     id;            // RDB id of the sign or object
+            unsigned int kind;          // KIND_*
+            double       x, y, z;       // center of the bounding sphere, inertial [m]
+            float        radius;        // [m]
+            unsigned int frameNo;       // frame of the last update
+            unsigned int index;         // element of the package in that frame
+
+            int          cx, cy;        // grid cell
+            unsigned int bucket;        // bucket and position in the bucket
+            unsigned int slot;
+            unsigned int objectSlot;    // position in the list of objects
+            bool         used;
+        };
+
+        /**
+        * work done by the queries, for tuning the cell size
+        */
+        struct Statistics
+        {
+            unsigned int queries;
+            unsigned int cells;         // cells visited
+            unsigned int tested;        // entries tested
+            unsigned int found;         // entries returned
+        };
+
+    public:
+        /**
+        * constructor
+        * @param cellSize   edge length of a grid cell [m]; about the typical query radius
+        * @param noBuckets  initial size of the hash table, rounded up to a power of two
+        */
+        explicit WorldIndex( double cellSize = 50.0, unsigned int noBuckets = 4096 );
+
+        /**
+        * Destroy the class.
+        */
+        virtual ~WorldIndex();
+
+        /**
+        * radius of the bounding sphere of signs (they carry no size) [m]
+        */
+        void setSignRadius( float radius );
+
+        /**
+        * remove all entries
+        */
+        void clear();
+
+        /**
+        * add the signs of a frame; known signs are left as they are
+        */
+        void addSigns( unsigned int frameNo, const RDB_TRAFFIC_SIGN_t* signs, unsigned int noSigns );
+
+        /**
+        * add or move the objects of a frame; basic or extended object states,
+        * elementSize is the size of one element in the package
+        */
+        void addObjects( unsigned int frameNo, const void* objs, unsigned int noObjs, unsigned int elementSize );
+
+        /**
+        * remove one entry
+        * @return false if it was not indexed
+        */
+        bool remove( unsigned int kind, uint32_t id );
+
+        /**
+        * remove the objects that have not been updated for more than maxAge frames
+        * @return number of objects removed
+        */
+        unsigned int removeStale( unsigned int frameNo, unsigned int maxAge );
+
+        /**
+        * entries whose center is within radius of a point
+        * @param kinds  KIND_* mask
+        * @param found  receives the entries; the pointers are valid until the next update
+        * @return number of entries found
+        */
+        unsigned int queryRadius( double x, double y, double z, double radius, unsigned int kinds,
+                                  std::vector<const Entry*> & found ) const;
+
+        /**
+        * entries whose bounding sphere intersects the view frustum of a camera
+        * @param maxDistance    far limit along the viewing axis [m], <= 0: the far clipping plane
+        * @param kinds          KIND_* mask
+        * @param found          receives the entries; the pointers are valid until the next update
+        * @return number of entries found
+        */
+        unsigned int queryFrustum( const RDB_CAMERA_t & cam, double maxDistance, unsigned int kinds,
+                                   std::vector<const Entry*> & found ) const;
+
+        /**
+        * the same queries by testing every entry, as a reference
+        */
+        unsigned int scanRadius( double x, double y, double z, double radius, unsigned int kinds,
+                                 std::vector<const Entry*> & found ) const;
+        unsigned int scanFrustum( const RDB_CAMERA_t & cam, double maxDistance, unsigned int kinds,
+                                  std::vector<const Entry*> & found ) const;
+
+        unsigned int getNoEntries() const { return mNoEntries; }
+
+        const Statistics & getStatistics() const;
+
+        /**
+        * print the statistics to stderr
+        */
+        void printStatistics( const char* caller ) const;
+
+    private:
+        /**
+        * the frustum of a camera as planes through the camera position
+        */
+        struct Frustum
+        {
+            double pos[3];
+            double fwd[3];                  // viewing axis
+            double normal[4][3];            // inward unit normals of the side planes
+            double near, far;               // along the viewing axis
+            int    cx1, cy1, cx2, cy2;      // cells to visit
+        };
+
+        /**
+        * insert or move an entry
+        */
+        void place( unsigned int kind, uint32_t id, double x, double y, double z, float radius,
+                    unsigned int frameNo, unsigned int index );
+
+        void link( unsigned int e );
+        void unlink( unsigned int e );
+
+        /**
+        * grow the hash table when the buckets get long
+        */
+        void rehash( unsigned int noBuckets );
+
+        int          cellOf( double v ) const;
+        unsigned int bucketOf( int cx, int cy ) const;
+
+        static uint64_t keyOf( unsigned int kind, uint32_t id );
+
+        void setupFrustum( const RDB_CAMERA_t & cam, double maxDistance, Frustum & f ) const;
+        bool inFrustum( const Frustum & f, const Entry & e ) const;
+
+    private:
+        double                                 mCellSize;
+        double                                 mInvCellSize;
+        float                                  mSignRadius;
+        float                                  mMaxRadius;      // of all entries, widens the frustum search
+
+        std::vector<Entry>                     mEntries;
+        std::vector<unsigned int>              mFree;           // unused elements of mEntries
+        unsigned int                           mNoEntries;
+        std::unordered_map<uint64_t, unsigned int> mIds;        // ( kind, id ) -> element of mEntries
+        std::vector<unsigned int>              mObjects;        // entries of KIND_OBJECT, checked by removeStale()
+
+        std::vector< std::vector<unsigned int> > mBuckets;      // entries, cells may share a bucket
+        unsigned int                           mBucketMask;
+
+        mutable Statistics                     mStatistics;
+};
+} // namespace Framework
+#endif /* _FRAMEWORK_WORLD_INDEX_HH */
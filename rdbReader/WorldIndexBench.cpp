@@ -0,0 +1,282 @@
+// WorldIndexBench.cpp : frustum and radius queries of the world index against
+// a scan over all signs and objects
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
+#include "WorldIndex.hh"
+
+/**
+* some global variables, considered "members" of this example
+*/
+int    mNoSigns    = 0;                // signs per scene, 0: a series of scenes
+int    mNoObjects  = 1000;             // moving objects per scene
+double mDensity    = 500.0;            // signs per km^2
+double mCellSize   = 50.0;             // [m]
+double mRadius     = 100.0;            // of the radius queries [m]
+double mMaxDist    = 200.0;            // far limit of the frustum queries [m]
+int    mNoQueries  = 2000;             // per query type and scene
+
+/**
+* information about usage of the software
+* this method will exit the program
+*/
+void usage()
+{
+    printf("usage: worldIndexBench [-n:signs] [-o:objects] [-d:density] [-c:m] [-r:m] [-f:m] [-q:queries]\n\n");
+    printf("       -n:signs      signs per scene (default: 10000, 30000, 100000, 300000)\n");
+    printf("       -o:objects    moving objects per scene\n");
+    printf("       -d:density    signs per square kilometer, the scene grows with the signs\n");
+    printf("       -c:m          grid cell size\n");
+    printf("       -r:m          radius of the radius queries\n");
+    printf("       -f:m          far limit of the frustum queries\n");
+    printf("       -q:queries    queries per type and scene\n");
+    exit(1);
+}
+
+/**
+* validate the arguments given in the command line
+*/
+void ValidateArgs(int argc, char **argv)
+{
+    for( int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] == '-') || (argv[i][0] == '/'))
+        {
+            if ( strlen( argv[i] ) <= 3 )
+                usage();
+
+            switch (tolower(argv[i][1]))
+            {
+                case 'n':
+                    mNoSigns = atoi( &argv[i][3] );
+                    break;
+
+                case 'o':
+                    mNoObjects = atoi( &argv[i][3] );
+                    break;
+
+                case 'd':
+                    mDensity = atof( &argv[i][3] );
+                    break;
+
+                case 'c':
+                    mCellSize = atof( &argv[i][3] );
+                    break;
+
+                case 'r':
+                    mRadius = atof( &argv[i][3] );
+                    break;
+
+                case 'f':
+                    mMaxDist = atof( &argv[i][3] );
+                    break;
+
+                case 'q':
+                    mNoQueries = atoi( &argv[i][3] );
+                    break;
+
+                default:
+                    usage();
+                    break;
+            }
+        }
+    }
+}
+
+double getTime()
+{
+    struct timeval tme;
+    gettimeofday(&tme, 0);
+
+    return tme.tv_sec + 1.0e-6 * tme.tv_usec;
+}
+
+double uniform( double lo, double hi )
+{
+    return lo + ( hi - lo ) * ( rand() / ( double ) RAND_MAX );
+}
+
+/**
+* same entries in both results?
+*/
+bool sameResult( std::vector<const Framework::WorldIndex::Entry*> & a, std::vector<const Framework::WorldIndex::Entry*> & b )
+{
+    std::sort( a.begin(), a.end() );
+    std::sort( b.begin(), b.end() );
+
+    return a == b;
+}
+
+/**
+* build a scene, move its objects for some frames and time both kinds of query
+*/
+void runScene( int noSigns )
+{
+    double side = 1000.0 * sqrt( noSigns / mDensity );
+
+    srand( noSigns );
+
+    // the signs and the objects of one frame
+    std::vector<RDB_TRAFFIC_SIGN_t> signs( noSigns );
+    std::vector<RDB_OBJECT_STATE_t> objs( mNoObjects );
+    std::vector<double>             speed( mNoObjects );
+
+    memset( &signs[0], 0, signs.size() * sizeof( RDB_TRAFFIC_SIGN_t ) );
+
+    for ( int i = 0; i < noSigns; i++ )
+    {
+        signs[i].id    = i + 1;
+        signs[i].pos.x = uniform( 0.0, side );
+        signs[i].pos.y = uniform( 0.0, side );
+        signs[i].pos.z = uniform( 1.5, 3.0 );
+    }
+
+    if ( mNoObjects )
+        memset( &objs[0], 0, objs.size() * sizeof( RDB_OBJECT_STATE_t ) );
+
+    for ( int i = 0; i < mNoObjects; i++ )
+    {
+        objs[i].base.id       = i + 1;
+        objs[i].base.geo.dimX = 4.5f;
+        objs[i].base.geo.dimY = 1.8f;
+        objs[i].base.geo.dimZ = 1.5f;
+        objs[i].base.geo.offX = 1.4f;
+        objs[i].base.geo.offZ = 0.75f;
+        objs[i].base.pos.x    = uniform( 0.0, side );
+        objs[i].base.pos.y    = uniform( 0.0, side );
+        objs[i].base.pos.h    = uniform( -M_PI, M_PI );
+        speed[i]              = uniform( 5.0, 40.0 );
+    }
+
+    Framework::WorldIndex index( mCellSize );
+
+    // first frame: everything is new
+    double start = getTime();
+
+    index.addSigns( 0, &signs[0], signs.size() );
+
+    if ( mNoObjects )
+        index.addObjects( 0, &objs[0], objs.size(), sizeof( RDB_OBJECT_STATE_t ) );
+
+    double tBuild = getTime() - start;
+
+    // following frames: signs are known, objects drive on (100 Hz)
+    const int noFrames = 100;
+    start = getTime();
+
+    for ( int frame = 1; frame <= noFrames; frame++ )
+    {
+        for ( int i = 0; i < mNoObjects; i++ )
+        {
+            objs[i].base.pos.x += 0.01 * speed[i] * cos( objs[i].base.pos.h );
+            objs[i].base.pos.y += 0.01 * speed[i] * sin( objs[i].base.pos.h );
+        }
+
+        index.addSigns( frame, &signs[0], signs.size() );
+
+        if ( mNoObjects )
+            index.addObjects( frame, &objs[0], objs.size(), sizeof( RDB_OBJECT_STATE_t ) );
+
+        index.removeStale( frame, 10 );
+    }
+
+    double tUpdate = ( getTime() - start ) / noFrames;
+
+    // query positions and cameras
+    std::vector<RDB_CAMERA_t> cams( mNoQueries );
+    memset( &cams[0], 0, cams.size() * sizeof( RDB_CAMERA_t ) );
+
+    for ( int i = 0; i < mNoQueries; i++ )
+    {
+        RDB_CAMERA_t & cam = cams[i];
+
+        cam.width      = 1920;
+        cam.height     = 1080;
+        cam.clipNear   = 0.1f;
+        cam.clipFar    = 1500.0f;
+        cam.focalX     = cam.focalY = 1400.0f;     // ~69 degrees horizontally
+        cam.principalX = 0.5f * cam.width;
+        cam.principalY = 0.5f * cam.height;
+        cam.pos.x      = uniform( 0.0, side );
+        cam.pos.y      = uniform( 0.0, side );
+        cam.pos.z      = 1.3;
+        cam.pos.h      = uniform( -M_PI, M_PI );
+        cam.pos.p      = uniform( -0.05, 0.05 );
+    }
+
+    std::vector<const Framework::WorldIndex::Entry*> a, b;
+    double       t[4];
+    unsigned int noFound[2] = { 0, 0 };
+    unsigned int noWrong    = 0;
+
+    // index and scan, radius and frustum
+    for ( int m = 0; m < 4; m++ )
+    {
+        start = getTime();
+
+        for ( int i = 0; i < mNoQueries; i++ )
+        {
+            const RDB_CAMERA_t & cam = cams[i];
+
+            switch ( m )
+            {
+                case 0: noFound[0] += index.queryRadius( cam.pos.x, cam.pos.y, cam.pos.z, mRadius, Framework::WorldIndex::KIND_ALL, a ); break;
+                case 1: index.scanRadius( cam.pos.x, cam.pos.y, cam.pos.z, mRadius, Framework::WorldIndex::KIND_ALL, b ); break;
+                case 2: noFound[1] += index.queryFrustum( cam, mMaxDist, Framework::WorldIndex::KIND_ALL, a ); break;
+                case 3: index.scanFrustum( cam, mMaxDist, Framework::WorldIndex::KIND_ALL, b ); break;
+            }
+        }
+
+        t[m] = ( getTime() - start ) / mNoQueries;
+    }
+
+    // both must find the same, checked outside of the timing
+    for ( int i = 0; i < mNoQueries; i++ )
+    {
+        const RDB_CAMERA_t & cam = cams[i];
+
+        index.queryRadius( cam.pos.x, cam.pos.y, cam.pos.z, mRadius, Framework::WorldIndex::KIND_ALL, a );
+        index.scanRadius( cam.pos.x, cam.pos.y, cam.pos.z, mRadius, Framework::WorldIndex::KIND_ALL, b );
+        noWrong += !sameResult( a, b );
+
+        index.queryFrustum( cam, mMaxDist, Framework::WorldIndex::KIND_ALL, a );
+        index.scanFrustum( cam, mMaxDist, Framework::WorldIndex::KIND_ALL, b );
+        noWrong += !sameResult( a, b );
+    }
+
+    printf( "%8d %7d %7.1f %9.2f %9.1f | %6.1f %8.2f %9.1f %6.0fx | %6.1f %8.2f %9.1f %6.0fx | %s\n",
+            noSigns, mNoObjects, side * 1.e-3, 1.e3 * tBuild, 1.e6 * tUpdate,
+            ( double ) noFound[0] / mNoQueries, 1.e6 * t[0], 1.e6 * t[1], t[1] / t[0],
+            ( double ) noFound[1] / mNoQueries, 1.e6 * t[2], 1.e6 * t[3], t[3] / t[2],
+            noWrong ? "MISMATCH" : "ok" );
+}
+
+int main(int argc, char* argv[])
+{
+    ValidateArgs(argc, argv);
+
+    printf( "%.0f signs/km^2, cell size %.0f m, radius %.0f m, frustum 1920x1080 f=1400 to %.0f m, %d queries each\n\n",
+            mDensity, mCellSize, mRadius, mMaxDist, mNoQueries );
+    printf( "%8s %7s %7s %9s %9s | %-33s | %-33s |\n", "", "", "side", "build", "update", "radius: found, us/query", "frustum: found, us/query" );
+    printf( "%8s %7s %7s %9s %9s | %6s %8s %9s %7s | %6s %8s %9s %7s | %s\n",
+            "signs", "objects", "km", "ms", "us/frame", "found", "index", "scan", "gain", "found", "index", "scan", "gain", "check" );
+
+    if ( mNoSigns > 0 )
+        runScene( mNoSigns );
+    else
+    {
+        int sizes[] = { 10000, 30000, 100000, 300000 };
+
+        for ( unsigned int i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ )
+            runScene( sizes[i] );
+    }
+
+    return 0;
+}
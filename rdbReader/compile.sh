@@ -3,13 +3,37 @@
 # compile the RDB shm reader and writer examples
 
 echo "compiling shmReader..."
-g++ -o shmReader RDBHandler.cc ShmReader.cpp
+g++ -o shmReader RDBHandler.cc ShmSegment.cc ShmReader.cpp
 echo "...done"
 
 echo "compiling shmWriter..."
-g++ -o shmWriter RDBHandler.cc ShmWriter.cpp
+g++ -pthread -o shmWriter RDBHandler.cc ShmSegment.cc RealTime.cc FramePacer.cc ShmWriter.cpp
 echo "...done"
 
 echo "compiling shmWriterExt..."
-g++ -o shmWriterExt RDBHandler.cc ShmWriterExt.cpp
+g++ -O3 -pthread -o shmWriterExt RDBHandler.cc FrameAssembler.cc WorkerPool.cc DepthOcclusion.cc DepthCloud.cc ShmSegment.cc RealTime.cc SignLabeler.cc RenderGate.cc ShmWriterExt.cpp
+echo "...done"
+
+echo "compiling rdbLabeler..."
+g++ -O3 -pthread -o rdbLabeler RDBHandler.cc WorkerPool.cc DepthOcclusion.cc SignLabeler.cc RdbLabeler.cpp
+echo "...done"
+
+echo "compiling pixelBench..."
+g++ -O3 -o pixelBench PixelDecoder.cc PixelBench.cpp
+echo "...done"
+
+echo "compiling shmBench..."
+g++ -O3 -o shmBench ShmSegment.cc ShmBench.cpp
+echo "...done"
+
+echo "compiling igStandIn..."
+g++ -O3 -pthread -o igStandIn RDBHandler.cc ShmSegment.cc RealTime.cc IgStandIn.cpp
+echo "...done"
+
+echo "compiling worldIndexBench..."
+g++ -O3 -o worldIndexBench WorldIndex.cc WorldIndexBench.cpp
+echo "...done"
+
+echo "compiling depthCheck..."
+g++ -O3 -pthread -o depthCheck WorkerPool.cc DepthOcclusion.cc DepthCloud.cc DepthCheck.cpp
 echo "...done"
@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Time bbox_overlaps against the former per-pair loop."""
+
+import _init_paths
+from utils.cython_bbox import bbox_overlaps, bbox_overlaps_loop
+from rpn.generate_anchors import generate_anchors
+import argparse
+import time
+import numpy as np
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Benchmark bbox_overlaps')
+    parser.add_argument('--boxes', dest='num_boxes', help='random boxes',
+                        default=20000, type=int)
+    parser.add_argument('--gt', dest='num_gt', help='gt boxes per image',
+                        default=50, type=int)
+    parser.add_argument('--width', dest='width', help='image width',
+                        default=1000, type=int)
+    parser.add_argument('--height', dest='height', help='image height',
+                        default=600, type=int)
+    parser.add_argument('--stride', dest='stride', help='feature stride',
+                        default=16, type=int)
+    parser.add_argument('--threads', dest='threads',
+                        help='engine threads, 0 to pick from the problem size',
+                        default=1, type=int)
+    parser.add_argument('--iters', dest='iters', default=20, type=int)
+    return parser.parse_args()
+
+def random_boxes(num, width, height, rng):
+    boxes = np.zeros((num, 4), dtype=np.float64)
+    boxes[:, 0] = rng.randint(0, width - 16, num)
+    boxes[:, 1] = rng.randint(0, height - 16, num)
+    boxes[:, 2:4] = boxes[:, :2] + rng.randint(8, 300, (num, 2))
+    return boxes
+
+def anchor_boxes(width, height, stride):
+    """All anchors of an image, as the anchor target layer enumerates them."""
+    anchors = generate_anchors()
+    shift_x = np.arange(0, width // stride) * stride
+    shift_y = np.arange(0, height // stride) * stride
+    shift_x, shift_y = np.meshgrid(shift_x, shift_y)
+    shifts = np.vstack((shift_x.ravel(), shift_y.ravel(),
+                        shift_x.ravel(), shift_y.ravel())).transpose()
+    all_anchors = (anchors.reshape((1, -1, 4)) +
+                   shifts.reshape((1, -1, 4)).transpose((1, 0, 2)))
+    return all_anchors.reshape((-1, 4)).astype(np.float64)
+
+def best_of(fn, iters):
+    """Fastest of several runs, the machine is rarely idle."""
+    fn()
+    best = float('inf')
+    for _ in xrange(iters):
+        start = time.time()
+        fn()
+        best = min(best, time.time() - start)
+    return best
+
+if __name__ == '__main__':
+    args = parse_args()
+    rng = np.random.RandomState(3)
+    gt = random_boxes(args.num_gt, args.width, args.height, rng)
+    layouts = [('random', random_boxes(args.num_boxes, args.width,
+                                       args.height, rng)),
+               ('anchors', anchor_boxes(args.width, args.height,
+                                        args.stride))]
+
+    print '{:8s} {:>6s} {:>4s} | {:>9s} {:>9s} {:>6s} | {:>9s} {:>6s} | {}'.format(
+        'layout', 'boxes', 'gt', 'loop ms', 'f64 ms', 'gain', 'f32 ms',
+        'gain', 'check')
+    for name, boxes in layouts:
+        ref = bbox_overlaps_loop(boxes, gt)
+        ok = np.array_equal(ref, bbox_overlaps(boxes, gt, args.threads)) and \
+            np.allclose(ref, bbox_overlaps(boxes.astype(np.float32),
+                                           gt.astype(np.float32),
+                                           args.threads), atol=1e-5)
+        boxes32, gt32 = boxes.astype(np.float32), gt.astype(np.float32)
+        t_loop = best_of(lambda: bbox_overlaps_loop(boxes, gt), args.iters)
+        t_f64 = best_of(lambda: bbox_overlaps(boxes, gt, args.threads),
+                        args.iters)
+        t_f32 = best_of(lambda: bbox_overlaps(boxes32, gt32, args.threads),
+                        args.iters)
+        print '{:8s} {:6d} {:4d} | {:9.2f} {:9.2f} {:5.1f}x | {:9.2f} {:5.1f}x | {}'.format(
+            name, boxes.shape[0], gt.shape[0], 1e3 * t_loop, 1e3 * t_f64,
+            t_loop / t_f64, 1e3 * t_f32, t_loop / t_f32,
+            'ok' if ok else 'MISMATCH')
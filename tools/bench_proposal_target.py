@@ -0,0 +1,90 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Time ProposalTargetLayer.forward with the Python and the native sampler."""
+
+import _init_paths
+from fast_rcnn.config import cfg, cfg_from_file
+from rpn.proposal_target_layer import ProposalTargetLayer
+import argparse
+import time
+import numpy as np
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Benchmark the proposal target layer')
+    parser.add_argument('--cfg', dest='cfg_file',
+                        help='optional config file (e.g. the OHEM config)',
+                        default=None, type=str)
+    parser.add_argument('--rois', dest='rois', help='rois per image',
+                        default=[2000, 6000], type=int, nargs='+')
+    parser.add_argument('--gt', dest='num_gt', help='gt boxes per image',
+                        default=20, type=int)
+    parser.add_argument('--classes', dest='num_classes',
+                        default=44, type=int)
+    parser.add_argument('--iters', dest='iters', default=200, type=int)
+    parser.add_argument('--rounds', dest='rounds',
+                        help='timed rounds, the fastest is reported',
+                        default=5, type=int)
+    return parser.parse_args()
+
+class Blob(object):
+    """Stands in for a caffe blob."""
+    def __init__(self, data=None):
+        self.data = data
+
+    def reshape(self, *shape):
+        self.data = np.empty(shape, dtype=np.float32)
+
+class Layer(object):
+    """Runs the layer code without a caffe net around it."""
+    forward = ProposalTargetLayer.__dict__['forward']
+    _set_tops = ProposalTargetLayer.__dict__['_set_tops']
+
+    def __init__(self, num_classes):
+        self._num_classes = num_classes
+
+def make_inputs(num_rois, num_gt, rng):
+    gt = np.zeros((num_gt, 5), dtype=np.float32)
+    gt[:, 0] = rng.randint(0, 900, num_gt)
+    gt[:, 1] = rng.randint(0, 500, num_gt)
+    gt[:, 2:4] = gt[:, :2] + rng.randint(10, 120, (num_gt, 2))
+    gt[:, 4] = rng.randint(1, 44, num_gt)
+    # proposals jittered around the gt, like a trained RPN produces
+    rois = np.zeros((num_rois, 5), dtype=np.float32)
+    rois[:, 1:5] = gt[rng.randint(0, num_gt, num_rois), :4] + \
+        rng.randn(num_rois, 4) * rng.choice([3, 15, 60], (num_rois, 1))
+    rois[:, 3:5] = np.maximum(rois[:, 3:5], rois[:, 1:3] + 1)
+    return rois, gt
+
+if __name__ == '__main__':
+    args = parse_args()
+    if args.cfg_file is not None:
+        cfg_from_file(args.cfg_file)
+    print 'BATCH_SIZE: {}  AGNOSTIC: {}'.format(cfg.TRAIN.BATCH_SIZE,
+                                                cfg.TRAIN.AGNOSTIC)
+
+    layer = Layer(2 if cfg.TRAIN.AGNOSTIC else args.num_classes)
+    top = [Blob() for _ in xrange(5)]
+    rng = np.random.RandomState(cfg.RNG_SEED)
+    for num_rois in args.rois:
+        rois, gt = make_inputs(num_rois, args.num_gt, rng)
+        bottom = [Blob(rois), Blob(gt)]
+        for native in (False, True):
+            cfg.TRAIN.NATIVE_ROI_TARGETS = native
+            layer.forward(bottom, top)
+            elapsed = float('inf')
+            for _ in xrange(args.rounds):
+                start = time.time()
+                for _ in xrange(args.iters):
+                    layer.forward(bottom, top)
+                elapsed = min(elapsed, time.time() - start)
+            print '{:5d} rois  {:6s}: {:8.1f} it/s'.format(
+                num_rois, 'native' if native else 'python',
+                args.iters / elapsed)
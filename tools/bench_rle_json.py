@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Time loading COCO-format segmentation results: json parsing and the
+conversion of the compressed RLE strings to masks."""
+
+import _init_paths
+from pycocotools import mask as COCOmask
+import argparse
+import json
+import os
+import tempfile
+import time
+import numpy as np
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Benchmark RLE json loading')
+    parser.add_argument('--json', dest='json_file',
+                        help='results file to load (default: synthetic)',
+                        default=None, type=str)
+    parser.add_argument('--num', dest='num', help='synthetic segmentations',
+                        default=100000, type=int)
+    parser.add_argument('--height', dest='height', default=600, type=int)
+    parser.add_argument('--width', dest='width', default=1000, type=int)
+    return parser.parse_args()
+
+def make_results(num, height, width, rng):
+    """Elliptic blobs of sign-like sizes, encoded 1000 at a time."""
+    yy, xx = np.mgrid[:height, :width]
+    res = []
+    for start in xrange(0, num, 1000):
+        n = min(1000, num - start)
+        masks = np.zeros((height, width, n), dtype=np.uint8, order='F')
+        for i in xrange(n):
+            cx, cy = rng.randint(0, width), rng.randint(0, height)
+            rx, ry = rng.randint(4, 80, 2)
+            y0, y1 = max(cy - ry, 0), min(cy + ry + 1, height)
+            x0, x1 = max(cx - rx, 0), min(cx + rx + 1, width)
+            masks[y0:y1, x0:x1, i] = \
+                ((xx[y0:y1, x0:x1] - cx) / float(rx)) ** 2 + \
+                ((yy[y0:y1, x0:x1] - cy) / float(ry)) ** 2 <= 1
+        for rle in COCOmask.encode(masks):
+            res.append({'image_id': len(res) / 20, 'category_id': 1,
+                        'segmentation': rle, 'score': rng.rand()})
+    return res
+
+if __name__ == '__main__':
+    args = parse_args()
+    json_file = args.json_file
+    if json_file is None:
+        rng = np.random.RandomState(3)
+        fd, json_file = tempfile.mkstemp(suffix='.json')
+        with os.fdopen(fd, 'w') as f:
+            json.dump(make_results(args.num, args.height, args.width, rng), f)
+
+    start = time.time()
+    with open(json_file) as f:
+        res = json.load(f)
+    t_json = time.time() - start
+    segs = [r['segmentation'] for r in res]
+
+    # one call per segmentation, as loadRes/annToRLE style code does
+    start = time.time()
+    bb_single = np.vstack([COCOmask.toBbox([s]) for s in segs])
+    t_single = time.time() - start
+
+    start = time.time()
+    bb_batch = COCOmask.toBbox(segs)
+    t_batch = time.time() - start
+    assert np.array_equal(bb_single, bb_batch)
+
+    print '{} segmentations, {:.1f} MB'.format(
+        len(segs), os.path.getsize(json_file) / 1e6)
+    print 'json.load         : {:8.1f} ms'.format(t_json * 1e3)
+    print 'RLE, one at a time: {:8.1f} ms'.format(t_single * 1e3)
+    print 'RLE, batched      : {:8.1f} ms'.format(t_batch * 1e3)
+    if args.json_file is None:
+        os.remove(json_file)
@@ -0,0 +1,81 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Build the Images, Annotations and ImageSets of a traffic devkit from GTSRB
+style label CSVs, in one parallel pass (replaces running
+lib/data_preparation/csvToXml.py and then split_dataset.py)."""
+
+import _init_paths
+from data_preparation.cython_dataset_builder import build_dataset
+from datasets.traffic_eval import parse_rec
+import os, sys, argparse
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Build a traffic dataset')
+    parser.add_argument('src_dir',
+                        help='directory with one subdirectory per class, '
+                             'each with its images and GT-<class>.csv',
+                        type=str)
+    parser.add_argument('--out', dest='out_dir',
+                        help='devkit data directory',
+                        default=os.path.join(os.path.dirname(__file__), '..',
+                                             'data', 'traffic_devkit', 'data'),
+                        type=str)
+    parser.add_argument('--train', dest='train', help='fraction for train',
+                        default=0.64, type=float)
+    parser.add_argument('--val', dest='val', help='fraction for val '
+                        '(test gets the rest)', default=0.16, type=float)
+    parser.add_argument('--seed', dest='seed', help='seed of the split',
+                        default=0, type=int)
+    parser.add_argument('--link', dest='link',
+                        help='hard-link the images instead of copying them',
+                        action='store_true')
+    parser.add_argument('--threads', dest='threads',
+                        help='I/O workers (default: two per core)',
+                        default=0, type=int)
+
+    if len(sys.argv) == 1:
+        parser.print_help()
+        sys.exit(1)
+
+    args = parser.parse_args()
+    return args
+
+def check_annotations(out_dir):
+    """
+    Parse the first annotation of each image set the way the evaluation
+    does (traffic_eval.parse_rec); the builder writes all of them alike.
+    """
+    for image_set in ('train', 'val', 'test'):
+        with open(os.path.join(out_dir, 'ImageSets', image_set + '.txt')) as f:
+            index = f.readline().strip()
+        if not index:
+            continue
+        filename = os.path.join(out_dir, 'Annotations', index + '.xml')
+        try:
+            objs = parse_rec(filename)
+        except (ValueError, AttributeError) as e:
+            print '{} cannot be parsed for evaluation: {}'.format(filename, e)
+            sys.exit(1)
+        assert len(objs) > 0, 'no objects in {}'.format(filename)
+
+if __name__ == '__main__':
+    args = parse_args()
+
+    print 'Building {} from {}'.format(args.out_dir, args.src_dir)
+    stats = build_dataset(args.src_dir, args.out_dir, train=args.train,
+                          val=args.val, seed=args.seed, link=args.link,
+                          threads=args.threads)
+    print ('{images} images with {objects} objects in {seconds:.1f}s: '
+           '{train} train, {val} val, {test} test').format(**stats)
+    print ('{copied} copied, {linked} linked, {bytes} bytes; '
+           '{bad_rows} invalid rows dropped, {failed} images failed').format(
+               **stats)
+    check_annotations(args.out_dir)
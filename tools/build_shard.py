@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Pack the images and XML annotations of a traffic image set into one shard
+file (lib/datasets/shard_io.hpp). datasets.traffic picks the shard up from
+data/Shards/<image_set>.shard instead of reading the files one by one."""
+
+import _init_paths
+from datasets.traffic import traffic
+from datasets.cython_shard import ShardWriter
+import os, sys, time, argparse
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Build a dataset shard')
+    parser.add_argument('image_set', help='image set to pack, e.g. train',
+                        type=str)
+    parser.add_argument('--devkit', dest='devkit_path',
+                        help='traffic devkit (default: data/traffic_devkit)',
+                        default=None, type=str)
+    parser.add_argument('--out', dest='shard_path',
+                        help='shard file (default: data/Shards/<image_set>.shard '
+                             'in the devkit)',
+                        default=None, type=str)
+
+    if len(sys.argv) == 1:
+        parser.print_help()
+        sys.exit(1)
+
+    args = parser.parse_args()
+    return args
+
+if __name__ == '__main__':
+    args = parse_args()
+
+    imdb = traffic(args.image_set, args.devkit_path, args.shard_path,
+                   use_shard=False)
+    shard_path = imdb.shard_path
+    if not os.path.isdir(os.path.dirname(shard_path)):
+        os.makedirs(os.path.dirname(shard_path))
+
+    print 'Packing {} images into {}'.format(imdb.num_images, shard_path)
+    start = time.time()
+    num_bytes = 0
+    with ShardWriter(shard_path) as w:
+        for i, index in enumerate(imdb.image_index):
+            boxes, gt_classes, difficult, width, height = \
+                imdb.load_traffic_objects(index)
+            with open(imdb.image_path_at(i), 'rb') as f:
+                data = f.read()
+            w.add(index, data, boxes, gt_classes, difficult, width, height)
+            num_bytes += len(data)
+            if (i + 1) % 1000 == 0:
+                print '{:d}/{:d} images'.format(i + 1, imdb.num_images)
+    elapsed = time.time() - start
+    print 'Wrote {:d} images ({:.1f} MB) in {:.1f}s'.format(
+        imdb.num_images, num_bytes / 1e6, elapsed)
@@ -0,0 +1,354 @@
+#!/usr/bin/env python
+
+# --------------------------------------------------------
+# Deep Traffic Sign Detection
+# Licensed under The MIT License [see LICENSE for details]
+# --------------------------------------------------------
+
+"""Run N data generation instances side by side and supervise them.
+
+Each instance is a simulator / IG (started by --ig-cmd, or found running)
+and an rdbReader/shmWriterExt client, with its own pair of SHM keys
+(RDB_SHM_ID_CONTROL_GENERATOR_IN and RDB_SHM_ID_IMG_GENERATOR_OUT plus
+index * --key-stride), its own RDB port (--port + index * --port-stride),
+its own set of CPUs and its own recording (<out>/instance_NN.rdb, the
+assembled frames as RDB messages).
+
+CPU sets are cut from one socket each, instances taking turns between the
+sockets, so neither an instance nor its memory traffic straddles sockets.
+
+An instance is restarted, simulator and client together, when one of its
+processes exits or its recording did not grow for --stall seconds. The
+partial message a killed client may leave at the end of its recording is cut
+off first.
+
+Local test against stand-in IGs (rdbReader/igStandIn):
+
+    ./tools/run_data_generation.py -n 4 --standin --duration 60
+"""
+
+import os, sys, time, signal, struct, argparse, subprocess
+from distutils.spawn import find_executable
+
+RDB_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                       'rdbReader')
+RDB_MAGIC_NO = 35712
+RDB_SHM_ID_CONTROL_GENERATOR_IN = 0x0817b
+RDB_SHM_ID_IMG_GENERATOR_OUT = 0x0816a
+# RDB_MSG_HDR_t: magicNo, version, headerSize, dataSize, frameNo, simTime
+MSG_HDR = struct.Struct('<HHIIId')
+
+CLIENT_CMD = (os.path.join(RDB_DIR, 'shmWriterExt') +
+              ' -k:{ctrl_key} -i:{img_key} -p:{port} -s:{host} -o:{recording}'
+              ' -a:{cpu}')
+STANDIN_CMD = (os.path.join(RDB_DIR, 'igStandIn') +
+               ' -k:{ctrl_key} -i:{img_key} -p:{port} -r:{render_ms}')
+
+def parse_args():
+    """
+    Parse input arguments
+    """
+    parser = argparse.ArgumentParser(description='Run and supervise several '
+                                     'data generation instances')
+    parser.add_argument('-n', dest='instances', help='number of instances',
+                        default=1, type=int)
+    parser.add_argument('--out', dest='out_dir',
+                        help='directory of the recordings',
+                        default='rdb_recordings', type=str)
+    parser.add_argument('--client-cmd', dest='client_cmd',
+                        help='client command; {index} {ctrl_key} {img_key} '
+                             '{port} {host} {recording} {cpu} {cpus} are '
+                             'replaced',
+                        default=CLIENT_CMD, type=str)
+    parser.add_argument('--ig-cmd', dest='ig_cmd',
+                        help='simulator / IG command, same fields (default: '
+                             'none, they are started elsewhere)',
+                        default=None, type=str)
+    parser.add_argument('--standin', dest='standin',
+                        help='use rdbReader/igStandIn as --ig-cmd',
+                        action='store_true')
+    parser.add_argument('--render-ms', dest='render_ms',
+                        help='render time of the stand-in IGs',
+                        default=20.0, type=float)
+    parser.add_argument('--host', dest='host', help='simulator host',
+                        default='127.0.0.1', type=str)
+    parser.add_argument('--port', dest='port', help='RDB port of instance 0',
+                        default=48190, type=int)
+    parser.add_argument('--port-stride', dest='port_stride',
+                        default=10, type=int)
+    parser.add_argument('--key-stride', dest='key_stride',
+                        help='added to both SHM keys per instance',
+                        default=0x100, type=lambda s: int(s, 0))
+    parser.add_argument('--cpus', dest='cpus_per_instance',
+                        help='CPUs per instance (default: all of them, '
+                             'split evenly)',
+                        default=0, type=int)
+    parser.add_argument('--stall', dest='stall',
+                        help='restart an instance whose recording did not grow '
+                             'for this many seconds',
+                        default=30.0, type=float)
+    parser.add_argument('--grace', dest='grace',
+                        help='seconds an instance may take to start up',
+                        default=20.0, type=float)
+    parser.add_argument('--max-restarts', dest='max_restarts',
+                        help='give an instance up after this many restarts',
+                        default=10, type=int)
+    parser.add_argument('--report', dest='report',
+                        help='seconds between throughput reports',
+                        default=10.0, type=float)
+    parser.add_argument('--duration', dest='duration',
+                        help='seconds to run (default: until Ctrl-C)',
+                        default=0.0, type=float)
+
+    args = parser.parse_args()
+    if args.standin and not args.ig_cmd:
+        args.ig_cmd = STANDIN_CMD
+    return args
+
+def allowed_cpus():
+    """CPUs this process may run on."""
+    try:
+        with open('/proc/self/status') as f:
+            for line in f:
+                if line.startswith('Cpus_allowed_list:'):
+                    cpus = []
+                    for part in line.split(':')[1].strip().split(','):
+                        lo, _, hi = part.partition('-')
+                        cpus.extend(range(int(lo), int(hi or lo) + 1))
+                    return cpus
+    except IOError:
+        pass
+    import multiprocessing
+    return range(multiprocessing.cpu_count())
+
+def cpu_socket(cpu):
+    path = '/sys/devices/system/cpu/cpu{}/topology/physical_package_id'.format(cpu)
+    try:
+        with open(path) as f:
+            return int(f.read())
+    except (IOError, ValueError):
+        return 0
+
+def assign_cpus(num_instances, per_instance):
+    """One list of CPUs per instance, each from a single socket; instances
+    alternate between sockets. Sets are shared (and reported) once there are
+    more instances than CPUs."""
+    sockets = {}
+    for cpu in allowed_cpus():
+        sockets.setdefault(cpu_socket(cpu), []).append(cpu)
+    sockets = [sockets[s] for s in sorted(sockets)]
+    total = sum(len(s) for s in sockets)
+    if per_instance <= 0:
+        per_instance = max(1, total // num_instances)
+    per_instance = min(per_instance, min(len(s) for s in sockets))
+
+    used = [0] * len(sockets)
+    sets = []
+    for i in xrange(num_instances):
+        s = i % len(sockets)
+        cpus = sockets[s]
+        start = used[s] % len(cpus)
+        sets.append([cpus[(start + k) % len(cpus)] for k in xrange(per_instance)])
+        used[s] += per_instance
+    if num_instances * per_instance > total:
+        print 'Warning: {} instances x {} CPUs on {} CPUs, CPU sets are ' \
+              'shared'.format(num_instances, per_instance, total)
+    return sets
+
+class Instance(object):
+    """One simulator / client pair and its recording."""
+
+    def __init__(self, index, args, cpus):
+        self.index = index
+        self.fields = {
+            'index': index,
+            'ctrl_key': '0x{:x}'.format(RDB_SHM_ID_CONTROL_GENERATOR_IN +
+                                        index * args.key_stride),
+            'img_key': '0x{:x}'.format(RDB_SHM_ID_IMG_GENERATOR_OUT +
+                                       index * args.key_stride),
+            'port': args.port + index * args.port_stride,
+            'host': args.host,
+            'recording': os.path.join(args.out_dir,
+                                  'instance_{:02d}.rdb'.format(index)),
+            'cpu': cpus[0],
+            'cpus': ','.join(str(c) for c in cpus),
+            'render_ms': args.render_ms,
+        }
+        self.args = args
+        self.procs = []
+        self.frames = 0             # complete frames in the recording
+        self.offset = 0             # bytes of complete frames in the recording
+        self.restarts = 0
+        self.failed = False
+        self.restart_at = None      # pending restart, after a back-off
+        self.started = 0.0
+        self.last_growth = 0.0
+        self._log = None
+        self._scan_existing()
+
+    def _scan_existing(self):
+        # a recording from an earlier run is continued
+        self.scan()
+        self._truncate()
+
+    def _command(self, template):
+        cmd = template.format(**self.fields).split()
+        if find_executable('taskset'):
+            cmd = ['taskset', '-c', self.fields['cpus']] + cmd
+        return cmd
+
+    def start(self):
+        if self._log is None:
+            self._log = open(self.fields['recording'][:-4] + '.log', 'a')
+        self._log.write('--- {} start\n'.format(time.ctime()))
+        self._log.flush()
+        self.procs = []
+        if self.args.ig_cmd:
+            self.procs.append(subprocess.Popen(self._command(self.args.ig_cmd),
+                                               stdout=self._log,
+                                               stderr=subprocess.STDOUT))
+            time.sleep(0.2)     # let it create its SHM and listen
+        self.procs.append(subprocess.Popen(self._command(self.args.client_cmd),
+                                           stdout=self._log,
+                                           stderr=subprocess.STDOUT))
+        self.started = self.last_growth = time.time()
+
+    def stop(self):
+        # client first, so it does not see its simulator vanish
+        for p in reversed(self.procs):
+            if p.poll() is None:
+                p.send_signal(signal.SIGTERM)
+        deadline = time.time() + 3.0
+        for p in reversed(self.procs):
+            while p.poll() is None and time.time() < deadline:
+                time.sleep(0.05)
+            if p.poll() is None:
+                p.kill()
+                p.wait()
+        self.procs = []
+
+    def _truncate(self):
+        # drop a partial message at the end, the client appends after it
+        path = self.fields['recording']
+        if os.path.exists(path) and os.path.getsize(path) > self.offset:
+            with open(path, 'r+b') as f:
+                f.truncate(self.offset)
+
+    def restart(self, reason):
+        self.stop()
+        self.scan()
+        self._truncate()
+        self.restarts += 1
+        if self.restarts > self.args.max_restarts:
+            print 'Instance {}: {}, giving up after {} restarts'.format(
+                self.index, reason, self.restarts - 1)
+            self.failed = True
+            return
+        # back off, so a broken setup does not spin
+        delay = min(2 ** (self.restarts - 1), 30)
+        print 'Instance {}: {}, restarting in {}s ({})'.format(
+            self.index, reason, delay, self.restarts)
+        self.restart_at = time.time() + delay
+
+    def scan(self):
+        """Count the complete RDB messages appended since the last scan."""
+        path = self.fields['recording']
+        if not os.path.exists(path):
+            return
+        with open(path, 'rb') as f:
+            size = os.fstat(f.fileno()).st_size
+            while self.offset + MSG_HDR.size <= size:
+                f.seek(self.offset)
+                magic, _, header_size, data_size, _, _ = \
+                    MSG_HDR.unpack(f.read(MSG_HDR.size))
+                if magic != RDB_MAGIC_NO or header_size < MSG_HDR.size:
+                    break       # cut off on the next restart
+                end = self.offset + header_size + data_size
+                if end > size:
+                    break       # still being written
+                self.offset = end
+                self.frames += 1
+                self.last_growth = time.time()
+
+    def check(self, now):
+        """Restart the instance if it died or stalled."""
+        if self.failed:
+            return
+        if self.restart_at is not None:
+            if now >= self.restart_at:
+                self.restart_at = None
+                self.start()
+            return
+        for p in self.procs:
+            if p.poll() is not None:
+                self.restart('process {} exited with {}'.format(p.pid,
+                                                                p.returncode))
+                return
+        if now - self.started > self.args.grace and \
+           now - self.last_growth > self.args.stall:
+            self.restart('no frames for {:.0f}s'.format(now - self.last_growth))
+
+def report(instances, last, now, start, total_start):
+    frames = [inst.frames for inst in instances]
+    dt = now - last[0]
+    per = ['{:5.1f}'.format((f - l) / dt) for f, l in zip(frames, last[1])]
+    print '{:7.1f}s  {:7.1f} frames/s  ({} per instance)  {} frames, ' \
+          '{} restarts'.format(now - start, (sum(frames) - sum(last[1])) / dt,
+                               ' '.join(per), sum(frames) - total_start,
+                               sum(inst.restarts for inst in instances))
+    sys.stdout.flush()
+    return now, frames
+
+if __name__ == '__main__':
+    args = parse_args()
+
+    if not os.path.isdir(args.out_dir):
+        os.makedirs(args.out_dir)
+
+    cpu_sets = assign_cpus(args.instances, args.cpus_per_instance)
+    instances = [Instance(i, args, cpus) for i, cpus in enumerate(cpu_sets)]
+    for inst in instances:
+        print 'Instance {index}: keys {ctrl_key}/{img_key}, port {port}, ' \
+              'CPUs {cpus}, {recording}'.format(**inst.fields)
+        inst.start()
+
+    stop = []
+    signal.signal(signal.SIGINT, lambda *a: stop.append(True))
+    signal.signal(signal.SIGTERM, lambda *a: stop.append(True))
+
+    start = time.time()
+    total_start = sum(inst.frames for inst in instances)
+    last = (start, [inst.frames for inst in instances])
+    # frames are counted from the first one, start-up is not throughput
+    first = None
+    try:
+        while not stop and (not args.duration or
+                            time.time() - start < args.duration):
+            time.sleep(0.5)
+            now = time.time()
+            for inst in instances:
+                inst.scan()
+                inst.check(now)
+            if first is None and sum(i.frames for i in instances) > total_start:
+                first = (now, sum(i.frames for i in instances))
+            if now - last[0] >= args.report:
+                last = report(instances, last, now, start, total_start)
+            if all(inst.failed for inst in instances):
+                break
+    finally:
+        for inst in instances:
+            inst.stop()
+            inst.scan()
+
+    now = time.time()
+    total = sum(inst.frames for inst in instances) - total_start
+    print '{} frames in {:.1f}s'.format(total, now - start),
+    if first is not None and now > first[0]:
+        print '({:.1f} frames/s after the first frame)'.format(
+            (total_start + total - first[1]) / (now - first[0]))
+    else:
+        print
+    for inst in instances:
+        print '  instance {}: {} frames, {} restarts{}'.format(
+            inst.index, inst.frames, inst.restarts,
+            ', failed' if inst.failed else '')
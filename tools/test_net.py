@@ -13,6 +13,7 @@ import _init_paths
 from fast_rcnn.test import test_net
 from fast_rcnn.config import cfg, cfg_from_file, cfg_from_list
 from datasets.factory import get_imdb
+from datasets.online_eval import OnlineEvaluator
 import caffe
 import argparse
 import pprint
@@ -51,6 +52,9 @@ def parse_args():
                         default=400, type=int)
     parser.add_argument('--rpn_file', dest='rpn_file',
                         default=None, type=str)
+    parser.add_argument('--online_eval', dest='online_eval',
+                        help='report the running mAP while testing',
+                        action='store_true')
 
     if len(sys.argv) == 1:
         parser.print_help()
@@ -92,4 +96,6 @@ if __name__ == '__main__':
         if cfg.TEST.PROPOSAL_METHOD == 'rpn':
             imdb.config['rpn_file'] = args.rpn_file
 
-    test_net(net, imdb, max_per_image=args.max_per_image, vis=args.vis)
+    online_eval = OnlineEvaluator(imdb.num_classes) if args.online_eval else None
+    test_net(net, imdb, max_per_image=args.max_per_image, vis=args.vis,
+             online_eval=online_eval)